@@ -0,0 +1,27 @@
+
+#include "BenchmarkUtils.h"
+
+#include "OgreException.h"
+
+#include <iostream>
+
+int main( int argc, const char *argv[] )
+{
+    try
+    {
+        const bool bRan = Demo::BenchmarkUtils::runFromCmdLine( argc, argv );
+        if( !Demo::BenchmarkUtils::runSceneBenchmarkFromCmdLine( argc, argv ) && !bRan )
+        {
+            std::cerr << "Usage: " << argv[0] << " --benchmark=<name>. See BenchmarkUtils.h"
+                      << std::endl;
+            return 1;
+        }
+    }
+    catch( Ogre::Exception &e )
+    {
+        std::cerr << "An exception has occured: " << e.getFullDescription().c_str() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
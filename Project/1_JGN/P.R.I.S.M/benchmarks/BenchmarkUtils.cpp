@@ -0,0 +1,1229 @@
+
+#include "BenchmarkUtils.h"
+
+#include "GameEntity.h"
+#include "GameEntityManager.h"
+#include "GameState.h"
+#include "GraphicsSystem.h"
+#include "LogicSystem.h"
+#include "System/MainEntryPoints.h"
+#include "Threading/FramePacer.h"
+#include "Threading/JobSystem.h"
+#include "Threading/MessageQueueSystem.h"
+#include "Utils/TextureMetadataCache.h"
+
+#include "OgrePlatformInformation.h"
+#include "OgreResourceGroupManager.h"
+#include "OgreTimer.h"
+#include "OgrePixelFormatGpuUtils.h"
+#include "OgreStringConverter.h"
+#include "Threading/OgreThreads.h"
+
+#if !OGRE_NO_JSON
+#    if defined( __GNUC__ ) && !defined( __clang__ )
+#        pragma GCC diagnostic push
+#        pragma GCC diagnostic ignored "-Wclass-memaccess"
+#    endif
+#    if defined( __clang__ )
+#        pragma clang diagnostic push
+#        pragma clang diagnostic ignored "-Wimplicit-int-float-conversion"
+#        pragma clang diagnostic ignored "-Wdeprecated-copy"
+#    endif
+#    include "rapidjson/document.h"
+#    if defined( __clang__ )
+#        pragma clang diagnostic pop
+#    endif
+#    if defined( __GNUC__ ) && !defined( __clang__ )
+#        pragma GCC diagnostic pop
+#    endif
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+namespace Demo
+{
+    /// Sends & receives messages without doing anything else, so the timings
+    /// only reflect the cost of the transport.
+    class BenchmarkQueueSystem : public Mq::MessageQueueSystem
+    {
+    public:
+        std::atomic<size_t> mNumReceived;
+        size_t              mChecksum;
+        std::vector<size_t> mRemovalSlots;
+
+        BenchmarkQueueSystem() : mNumReceived( 0 ), mChecksum( 0 ) {}
+
+        void processIncomingMessage( Mq::MessageId messageId, const void *data ) override
+        {
+            if( messageId == Mq::GAME_ENTITY_ADDED )
+            {
+                // Touch the payload like GraphicsSystem::gameEntityAdded would.
+                const GameEntityManager::CreatedGameEntity *cge =
+                    reinterpret_cast<const GameEntityManager::CreatedGameEntity *>( data );
+                mChecksum += reinterpret_cast<size_t>( cge->gameEntity ) +
+                             static_cast<size_t>( cge->initialTransform.vPos.x );
+                mNumReceived.store( mNumReceived.load( std::memory_order_relaxed ) + 1u,
+                                    std::memory_order_release );
+            }
+            else if( messageId == Mq::GAME_ENTITY_SCHEDULED_FOR_REMOVAL_SLOT )
+            {
+                mRemovalSlots.push_back( *reinterpret_cast<const size_t *>( data ) );
+            }
+        }
+
+        void _processIncomingMessages() { this->processIncomingMessages(); }
+    };
+
+    struct MessageQueueFloodData
+    {
+        BenchmarkQueueSystem *sender;
+        BenchmarkQueueSystem *receiver;
+        Ogre::uint32          numMessagesPerFrame;
+        Ogre::uint32          numFrames;
+        Ogre::uint64          producerMicroseconds;
+    };
+
+    static const Ogre::uint32 cMaxFramesInFlight = 3u;
+
+    unsigned long messageQueueFloodProducer( Ogre::ThreadHandle *threadHandle );
+    THREAD_DECLARE( messageQueueFloodProducer );
+
+    unsigned long messageQueueFloodProducer( Ogre::ThreadHandle *threadHandle )
+    {
+        MessageQueueFloodData *floodData =
+            reinterpret_cast<MessageQueueFloodData *>( threadHandle->getUserParam() );
+
+        GameEntityManager::CreatedGameEntity cge;
+        cge.gameEntity = 0;
+        cge.initialTransform.vPos = Ogre::Vector3::ZERO;
+        cge.initialTransform.qRot = Ogre::Quaternion::IDENTITY;
+        cge.initialTransform.vScale = Ogre::Vector3::UNIT_SCALE;
+        cge.originEpoch = 0u;
+
+        Ogre::Timer timer;
+        floodData->producerMicroseconds = 0;
+
+        for( Ogre::uint32 frame = 0u; frame < floodData->numFrames; ++frame )
+        {
+            // Don't get too far ahead of the consumer. Logic can't either, since it
+            // runs out of transform buffers.
+            const size_t minReceived =
+                size_t( std::max( frame, cMaxFramesInFlight ) - cMaxFramesInFlight ) *
+                floodData->numMessagesPerFrame;
+            while( floodData->receiver->mNumReceived.load( std::memory_order_acquire ) < minReceived )
+                Ogre::Threads::Sleep( 0 );
+
+            const Ogre::uint64 startTime = timer.getMicroseconds();
+
+            for( Ogre::uint32 i = 0u; i < floodData->numMessagesPerFrame; ++i )
+            {
+                cge.gameEntity = reinterpret_cast<GameEntity *>( size_t( i ) );
+                cge.initialTransform.vPos.x = static_cast<Ogre::Real>( frame );
+                floodData->sender->queueSendMessage( floodData->receiver, Mq::GAME_ENTITY_ADDED, cge );
+            }
+            floodData->sender->flushQueuedMessages();
+
+            floodData->producerMicroseconds += timer.getMicroseconds() - startTime;
+        }
+
+        return 0;
+    }
+    //-------------------------------------------------------------------------
+    static void runMessageQueueFlood( const char *transportName, bool useSpscTransport,
+                                      Ogre::uint32 numMessagesPerFrame, Ogre::uint32 numFrames )
+    {
+        BenchmarkQueueSystem sender;
+        BenchmarkQueueSystem receiver;
+
+        if( useSpscTransport )
+        {
+            // Big enough to hold cMaxFramesInFlight worth of messages.
+            const size_t sizeOfMessage = 64u;
+            sender.connectSpscTransport( &receiver, sizeOfMessage * numMessagesPerFrame *
+                                                        ( cMaxFramesInFlight + 1u ) );
+        }
+
+        MessageQueueFloodData floodData;
+        floodData.sender = &sender;
+        floodData.receiver = &receiver;
+        floodData.numMessagesPerFrame = numMessagesPerFrame;
+        floodData.numFrames = numFrames;
+        floodData.producerMicroseconds = 0;
+
+        const size_t totalMessages = size_t( numMessagesPerFrame ) * numFrames;
+
+        Ogre::Timer timer;
+        const Ogre::uint64 startTime = timer.getMicroseconds();
+
+        Ogre::ThreadHandlePtr threadHandle =
+            Ogre::Threads::CreateThread( THREAD_GET( messageQueueFloodProducer ), 0, &floodData );
+
+        Ogre::uint64 consumerMicroseconds = 0;
+        while( receiver.mNumReceived.load( std::memory_order_relaxed ) < totalMessages )
+        {
+            const size_t numReceived = receiver.mNumReceived.load( std::memory_order_relaxed );
+            const Ogre::uint64 pumpStart = timer.getMicroseconds();
+            receiver._processIncomingMessages();
+            if( receiver.mNumReceived.load( std::memory_order_relaxed ) != numReceived )
+                consumerMicroseconds += timer.getMicroseconds() - pumpStart;
+        }
+
+        Ogre::Threads::WaitForThreads( 1u, &threadHandle );
+
+        const Ogre::uint64 totalMicroseconds = timer.getMicroseconds() - startTime;
+
+        std::cout << "[mq_flood] " << transportName << ": " << totalMessages << " msgs in "
+                  << double( totalMicroseconds ) / 1000.0 << " ms ("
+                  << double( totalMessages ) / std::max( double( totalMicroseconds ), 1.0 )
+                  << " Mmsg/s). Producer "
+                  << double( floodData.producerMicroseconds ) / 1000.0 / numFrames
+                  << " ms/frame, consumer " << double( consumerMicroseconds ) / 1000.0 / numFrames
+                  << " ms/frame, ring overflows " << sender.getNumRingOverflows()
+                  << ", checksum " << receiver.mChecksum << std::endl;
+    }
+    //-------------------------------------------------------------------------
+    void BenchmarkUtils::messageQueueFlood( Ogre::uint32 numMessagesPerFrame, Ogre::uint32 numFrames )
+    {
+        std::cout << "[mq_flood] " << numMessagesPerFrame << " GAME_ENTITY_ADDED per frame, "
+                  << numFrames << " frames" << std::endl;
+        runMessageQueueFlood( "Mutex + std::map", false, numMessagesPerFrame, numFrames );
+        runMessageQueueFlood( "SPSC ring       ", true, numMessagesPerFrame, numFrames );
+    }
+    //-------------------------------------------------------------------------
+    static void runEntityChurn( size_t numEntities, size_t numRemovalsPerFrame )
+    {
+        BenchmarkQueueSystem graphicsSystem;
+        LogicSystem logicSystem( 0 );
+        logicSystem._notifyGraphicsSystem( 0 );
+
+        MovableObjectDefinition moDefinition;
+        moDefinition.moType = MoTypeItem;
+
+        GameEntityVec gameEntities;
+        gameEntities.reserve( numEntities );
+
+        double removalMicroseconds = 0;
+        size_t numRemovals = 0;
+
+        {
+            GameEntityManager gameEntityManager( &graphicsSystem, &logicSystem );
+
+            for( size_t i = 0; i < numEntities; ++i )
+            {
+                gameEntities.push_back( gameEntityManager.addGameEntity(
+                    Ogre::SCENE_DYNAMIC, &moDefinition, Ogre::Vector3::ZERO,
+                    Ogre::Quaternion::IDENTITY, Ogre::Vector3::UNIT_SCALE ) );
+            }
+
+            // Short-lived entities die in no particular order.
+            std::mt19937 rng( 12345u );
+            std::shuffle( gameEntities.begin(), gameEntities.end(), rng );
+
+            Ogre::Timer timer;
+
+            for( size_t i = 0; i < numEntities; i += numRemovalsPerFrame )
+            {
+                const size_t numThisFrame = std::min( numEntities - i, numRemovalsPerFrame );
+
+                const Ogre::uint64 startTime = timer.getMicroseconds();
+                for( size_t j = 0; j < numThisFrame; ++j )
+                    gameEntityManager.removeGameEntity( gameEntities[i + j] );
+                removalMicroseconds += double( timer.getMicroseconds() - startTime );
+                numRemovals += numThisFrame;
+
+                // Emulate the round trip through the Graphics thread.
+                gameEntityManager.finishFrameParallel();
+                logicSystem.flushQueuedMessages();
+                graphicsSystem._processIncomingMessages();
+                for( size_t j = 0; j < graphicsSystem.mRemovalSlots.size(); ++j )
+                    gameEntityManager._notifyGameEntitiesRemoved( graphicsSystem.mRemovalSlots[j] );
+                graphicsSystem.mRemovalSlots.clear();
+            }
+        }
+
+        std::cout << "[entity_churn] " << numEntities << " entities: "
+                  << removalMicroseconds * 1000.0 / double( std::max<size_t>( numRemovals, 1u ) )
+                  << " ns per removeGameEntity" << std::endl;
+    }
+    //-------------------------------------------------------------------------
+    void BenchmarkUtils::entityChurn( size_t numRemovalsPerFrame )
+    {
+        for( size_t numEntities = 10000u; numEntities <= 160000u; numEntities *= 2u )
+            runEntityChurn( numEntities, numRemovalsPerFrame );
+    }
+    //-------------------------------------------------------------------------
+    static void printEntityIteration( const char *layoutName, Ogre::uint64 totalMicroseconds,
+                                      size_t numEntities, Ogre::uint32 numFrames )
+    {
+        const double msPerFrame = double( totalMicroseconds ) / 1000.0 / double( numFrames );
+        std::cout << "[entity_iteration] " << layoutName << ": " << msPerFrame << " ms/frame, "
+                  << msPerFrame * 1000000.0 / double( numEntities ) << " ns/entity" << std::endl;
+    }
+    //-------------------------------------------------------------------------
+    void BenchmarkUtils::entityIteration( size_t numEntities, Ogre::uint32 numFrames )
+    {
+        BenchmarkQueueSystem graphicsSystem;
+        LogicSystem logicSystem( 0 );
+        logicSystem._notifyGraphicsSystem( 0 );
+
+        MovableObjectDefinition moDefinition;
+        moDefinition.moType = MoTypeItem;
+
+        const Ogre::Vector3 cDelta( 0.001f, 0.002f, 0.003f );
+
+        std::cout << "[entity_iteration] " << numEntities << " dynamic entities, " << numFrames
+                  << " frames" << std::endl;
+
+        Ogre::Timer timer;
+        Ogre::Vector3 checksum( Ogre::Vector3::ZERO );
+
+        {
+            // The old layout: one heap allocation per GameEntity. In a running app other
+            // allocations (SceneNodes, strings, messages) land in between, so emulate them.
+            const size_t numArrayTransforms =
+                ( numEntities + ARRAY_PACKED_REALS - 1u ) / ARRAY_PACKED_REALS;
+            ArrayGameEntityTransform *transforms =
+                reinterpret_cast<ArrayGameEntityTransform *>( OGRE_MALLOC_SIMD(
+                    sizeof( ArrayGameEntityTransform ) * numArrayTransforms,
+                    Ogre::MEMCATEGORY_SCENE_OBJECTS ) );
+
+            std::mt19937 rng( 12345u );
+            GameEntityVec gameEntities;
+            std::vector<char *> otherAllocations;
+            gameEntities.reserve( numEntities );
+            otherAllocations.reserve( numEntities );
+
+            for( size_t i = 0; i < numEntities; ++i )
+            {
+                GameEntity *gameEntity = new GameEntity( static_cast<Ogre::uint32>( i ),
+                                                         GameEntityHandle(), 0, &moDefinition,
+                                                         Ogre::SCENE_DYNAMIC );
+                gameEntity->mTransform[0] = transforms + i / ARRAY_PACKED_REALS;
+                gameEntity->mTransformIndex = i % ARRAY_PACKED_REALS;
+                gameEntity->setPosition( 0u, Ogre::Vector3::ZERO );
+                gameEntities.push_back( gameEntity );
+                otherAllocations.push_back( new char[16u + rng() % 240u] );
+            }
+
+            const Ogre::uint64 startTime = timer.getMicroseconds();
+            for( Ogre::uint32 frame = 0u; frame < numFrames; ++frame )
+            {
+                GameEntityVec::const_iterator itor = gameEntities.begin();
+                GameEntityVec::const_iterator endt = gameEntities.end();
+                while( itor != endt )
+                {
+                    GameEntity *gameEntity = *itor++;
+                    gameEntity->setPosition( 0u, gameEntity->getPosition( 0u ) + cDelta );
+                }
+            }
+            printEntityIteration( "Heap allocated GameEntity*   ",
+                                  timer.getMicroseconds() - startTime, numEntities, numFrames );
+
+            checksum += gameEntities.back()->getPosition( 0u );
+
+            for( size_t i = 0; i < numEntities; ++i )
+            {
+                delete gameEntities[i];
+                delete[] otherAllocations[i];
+            }
+            OGRE_FREE_SIMD( transforms, Ogre::MEMCATEGORY_SCENE_OBJECTS );
+        }
+
+        {
+            GameEntityManager gameEntityManager( &graphicsSystem, &logicSystem );
+
+            std::vector<GameEntityTransform> initialTransforms( numEntities );
+            for( size_t i = 0; i < numEntities; ++i )
+            {
+                initialTransforms[i].vPos = Ogre::Vector3::ZERO;
+                initialTransforms[i].qRot = Ogre::Quaternion::IDENTITY;
+                initialTransforms[i].vScale = Ogre::Vector3::UNIT_SCALE;
+            }
+
+            GameEntityVec createdEntities;
+            gameEntityManager.addGameEntities( Ogre::SCENE_DYNAMIC, &moDefinition,
+                                               &initialTransforms[0], numEntities,
+                                               createdEntities );
+
+            std::vector<GameEntityHandle> handles;
+            handles.reserve( numEntities );
+            for( size_t i = 0; i < numEntities; ++i )
+                handles.push_back( createdEntities[i]->getHandle() );
+
+            const GameEntityVec &gameEntities =
+                gameEntityManager.getGameEntities( Ogre::SCENE_DYNAMIC );
+            const GameEntityManager::TransformLocationVec &transformLocations =
+                gameEntityManager.getTransformLocations( Ogre::SCENE_DYNAMIC );
+
+            Ogre::uint64 startTime = timer.getMicroseconds();
+            for( Ogre::uint32 frame = 0u; frame < numFrames; ++frame )
+            {
+                GameEntityVec::const_iterator itor = gameEntities.begin();
+                GameEntityVec::const_iterator endt = gameEntities.end();
+                while( itor != endt )
+                {
+                    GameEntity *gameEntity = *itor++;
+                    gameEntity->setPosition( 0u, gameEntity->getPosition( 0u ) + cDelta );
+                }
+            }
+            printEntityIteration( "Chunked GameEntity*          ",
+                                  timer.getMicroseconds() - startTime, numEntities, numFrames );
+
+            startTime = timer.getMicroseconds();
+            for( Ogre::uint32 frame = 0u; frame < numFrames; ++frame )
+            {
+                GameEntityManager::TransformLocationVec::const_iterator itor =
+                    transformLocations.begin();
+                GameEntityManager::TransformLocationVec::const_iterator endt =
+                    transformLocations.end();
+                while( itor != endt )
+                {
+                    ArrayGameEntityTransform *transform = itor->getTransform( 0u );
+                    const Ogre::Vector3 pos = transform->vPos.getAsVector3( itor->lane );
+                    transform->vPos.setFromVector3( pos + cDelta, itor->lane );
+                    ++itor;
+                }
+            }
+            printEntityIteration( "Dense TransformLocations     ",
+                                  timer.getMicroseconds() - startTime, numEntities, numFrames );
+
+            startTime = timer.getMicroseconds();
+            for( Ogre::uint32 frame = 0u; frame < numFrames; ++frame )
+            {
+                std::vector<GameEntityHandle>::const_iterator itor = handles.begin();
+                std::vector<GameEntityHandle>::const_iterator endt = handles.end();
+                while( itor != endt )
+                {
+                    GameEntity *gameEntity = gameEntityManager.getGameEntity( *itor++ );
+                    gameEntity->setPosition( 0u, gameEntity->getPosition( 0u ) + cDelta );
+                }
+            }
+            printEntityIteration( "Chunked, resolving handles   ",
+                                  timer.getMicroseconds() - startTime, numEntities, numFrames );
+
+            checksum += gameEntities.back()->getPosition( 0u );
+        }
+
+        std::cout << "[entity_iteration] checksum " << checksum << std::endl;
+    }
+    //-------------------------------------------------------------------------
+    static void runEntitySpawn( const char *modeName, bool bBatched, GraphicsSystem *graphicsSystem,
+                                LogicSystem *logicSystem, GameEntityManager *gameEntityManager,
+                                const MovableObjectDefinition *moDefinition,
+                                const std::vector<GameEntityTransform> &transforms )
+    {
+        const Ogre::uint32 cSpawnFrame = 10u;
+        const Ogre::uint32 cDespawnFrame = 70u;
+        const Ogre::uint32 cNumFrames = 130u;
+
+        const float frametime = static_cast<float>( MainEntryPoints::Frametime );
+
+        GameEntityVec gameEntities;
+        std::vector<Ogre::uint64> frameTimes;
+        frameTimes.reserve( cNumFrames );
+
+        Ogre::Timer timer;
+
+        for( Ogre::uint32 frame = 0u; frame < cNumFrames; ++frame )
+        {
+            const Ogre::uint64 startTime = timer.getMicroseconds();
+
+            logicSystem->beginFrameParallel();
+            if( frame == cSpawnFrame )
+            {
+                if( bBatched )
+                {
+                    gameEntityManager->addGameEntities( Ogre::SCENE_DYNAMIC, moDefinition,
+                                                        &transforms[0], transforms.size(),
+                                                        gameEntities );
+                }
+                else
+                {
+                    gameEntities.reserve( transforms.size() );
+                    for( size_t i = 0; i < transforms.size(); ++i )
+                    {
+                        gameEntities.push_back( gameEntityManager->addGameEntity(
+                            Ogre::SCENE_DYNAMIC, moDefinition, transforms[i].vPos,
+                            transforms[i].qRot, transforms[i].vScale ) );
+                    }
+                }
+            }
+            else if( frame == cDespawnFrame )
+            {
+                if( bBatched )
+                    gameEntityManager->removeGameEntities( &gameEntities[0], gameEntities.size() );
+                else
+                {
+                    for( size_t i = 0; i < gameEntities.size(); ++i )
+                        gameEntityManager->removeGameEntity( gameEntities[i] );
+                }
+                gameEntities.clear();
+            }
+            logicSystem->update( frametime );
+            logicSystem->finishFrameParallel();
+
+            logicSystem->finishFrame();
+            graphicsSystem->finishFrame();
+
+            graphicsSystem->beginFrameParallel();
+            graphicsSystem->update( frametime );
+            graphicsSystem->finishFrameParallel();
+
+            frameTimes.push_back( timer.getMicroseconds() - startTime );
+        }
+
+        const Ogre::uint64 spawnFrameTime = frameTimes[cSpawnFrame];
+        const Ogre::uint64 despawnFrameTime = frameTimes[cDespawnFrame];
+
+        Ogre::uint64 totalTime = 0;
+        for( size_t i = 0; i < frameTimes.size(); ++i )
+            totalTime += frameTimes[i];
+
+        std::sort( frameTimes.begin(), frameTimes.end() );
+
+        const Ogre::uint64 median = frameTimes[frameTimes.size() / 2u];
+        const Ogre::uint64 p99 = frameTimes[( frameTimes.size() * 99u ) / 100u];
+        const size_t numSpikes = static_cast<size_t>(
+            frameTimes.end() -
+            std::upper_bound( frameTimes.begin(), frameTimes.end(), median * 2u ) );
+
+        std::cout << "[spawn] " << modeName << ": spawn frame " << double( spawnFrameTime ) / 1000.0
+                  << " ms, despawn frame " << double( despawnFrameTime ) / 1000.0 << " ms. avg "
+                  << double( totalTime ) / 1000.0 / double( frameTimes.size() ) << " ms, median "
+                  << double( median ) / 1000.0 << " ms, p99 " << double( p99 ) / 1000.0
+                  << " ms, max " << double( frameTimes.back() ) / 1000.0 << " ms, spikes (> 2x median) "
+                  << numSpikes << "/" << frameTimes.size() << std::endl;
+    }
+    //-------------------------------------------------------------------------
+    /// Lays out numEntities cubes in a grid, like debris from a fracture.
+    static void generateDebris( size_t numEntities, MovableObjectDefinition &outMoDefinition,
+                                std::vector<GameEntityTransform> &outTransforms )
+    {
+        outMoDefinition.meshName = "Cube_d.mesh";
+        outMoDefinition.resourceGroup = Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME;
+        outMoDefinition.moType = MoTypeItem;
+
+        outTransforms.resize( numEntities );
+        const size_t gridSize = static_cast<size_t>( std::ceil( std::cbrt( double( numEntities ) ) ) );
+        for( size_t i = 0; i < numEntities; ++i )
+        {
+            outTransforms[i].vPos = Ogre::Vector3( Ogre::Real( i % gridSize ),
+                                                   Ogre::Real( ( i / gridSize ) % gridSize ),
+                                                   Ogre::Real( i / ( gridSize * gridSize ) ) ) *
+                                    2.0f;
+            outTransforms[i].qRot = Ogre::Quaternion::IDENTITY;
+            outTransforms[i].vScale = Ogre::Vector3( 0.5f );
+        }
+    }
+    //-------------------------------------------------------------------------
+    /// Ticks Logic & Graphics once, in lockstep.
+    static void tickFrame( GraphicsSystem *graphicsSystem, LogicSystem *logicSystem )
+    {
+        const float frametime = static_cast<float>( MainEntryPoints::Frametime );
+
+        logicSystem->beginFrameParallel();
+        logicSystem->update( frametime );
+        logicSystem->finishFrameParallel();
+
+        logicSystem->finishFrame();
+        graphicsSystem->finishFrame();
+
+        graphicsSystem->beginFrameParallel();
+        graphicsSystem->update( frametime );
+        graphicsSystem->finishFrameParallel();
+    }
+    //-------------------------------------------------------------------------
+    void BenchmarkUtils::entitySpawn( GraphicsSystem *graphicsSystem, LogicSystem *logicSystem,
+                                      size_t numEntities )
+    {
+        if( !logicSystem )
+        {
+            std::cout << "[spawn] Needs a LogicSystem. Skipping." << std::endl;
+            return;
+        }
+
+        GameEntityManager *gameEntityManager = logicSystem->getGameEntityManager();
+        GameEntityManager *ownedGameEntityManager = 0;
+        if( !gameEntityManager )
+        {
+            ownedGameEntityManager = new GameEntityManager( graphicsSystem, logicSystem );
+            gameEntityManager = ownedGameEntityManager;
+        }
+
+        MovableObjectDefinition moDefinition;
+        std::vector<GameEntityTransform> transforms;
+        generateDebris( numEntities, moDefinition, transforms );
+
+        std::cout << "[spawn] " << numEntities << " entities" << std::endl;
+        runEntitySpawn( "One message per entity", false, graphicsSystem, logicSystem,
+                        gameEntityManager, &moDefinition, transforms );
+        runEntitySpawn( "Batched               ", true, graphicsSystem, logicSystem,
+                        gameEntityManager, &moDefinition, transforms );
+
+        delete ownedGameEntityManager;
+    }
+    //-------------------------------------------------------------------------
+    void BenchmarkUtils::entityInterpolation( GraphicsSystem *graphicsSystem, LogicSystem *logicSystem,
+                                              size_t numEntities, Ogre::uint32 numFrames )
+    {
+        if( !logicSystem )
+        {
+            std::cout << "[interpolation] Needs a LogicSystem. Skipping." << std::endl;
+            return;
+        }
+
+        GameEntityManager *gameEntityManager = logicSystem->getGameEntityManager();
+        GameEntityManager *ownedGameEntityManager = 0;
+        if( !gameEntityManager )
+        {
+            ownedGameEntityManager = new GameEntityManager( graphicsSystem, logicSystem );
+            gameEntityManager = ownedGameEntityManager;
+        }
+
+        MovableObjectDefinition moDefinition;
+        std::vector<GameEntityTransform> transforms;
+        generateDebris( numEntities, moDefinition, transforms );
+
+        GameEntityVec gameEntities;
+        gameEntityManager->addGameEntities( Ogre::SCENE_DYNAMIC, &moDefinition, &transforms[0],
+                                            transforms.size(), gameEntities );
+
+        // Let Graphics create the SceneNodes.
+        for( size_t i = 0; i < logicSystem->getNumGameEntityBuffers(); ++i )
+            tickFrame( graphicsSystem, logicSystem );
+
+        const bool bUsedSimd = graphicsSystem->getUseSimdInterpolation();
+        const GameEntityVec &dynamicEntities = graphicsSystem->getGameEntities( Ogre::SCENE_DYNAMIC );
+
+        std::cout << "[interpolation] " << dynamicEntities.size() << " dynamic entities, " << numFrames
+                  << " frames" << std::endl;
+
+        Ogre::Timer timer;
+
+        for( int useSimd = 0; useSimd < 2; ++useSimd )
+        {
+            graphicsSystem->setUseSimdInterpolation( useSimd != 0 );
+
+            // Warm up the caches.
+            graphicsSystem->updateGameEntities( dynamicEntities, 0.5f );
+
+            const Ogre::uint64 startTime = timer.getMicroseconds();
+            for( Ogre::uint32 i = 0u; i < numFrames; ++i )
+            {
+                const float weight = static_cast<float>( i % 16u ) / 16.0f;
+                graphicsSystem->updateGameEntities( dynamicEntities, weight );
+            }
+            const Ogre::uint64 totalTime = timer.getMicroseconds() - startTime;
+
+            std::cout << "[interpolation] "
+                      << ( useSimd ? "SoA + SIMD, whole blocks" : "Scalar, one entity at a time" )
+                      << ": " << double( totalTime ) / 1000.0 / double( numFrames ) << " ms/frame"
+                      << std::endl;
+        }
+
+        graphicsSystem->setUseSimdInterpolation( bUsedSimd );
+
+        gameEntityManager->removeGameEntities( &gameEntities[0], gameEntities.size() );
+        for( size_t i = 0; i < logicSystem->getNumGameEntityBuffers(); ++i )
+            tickFrame( graphicsSystem, logicSystem );
+
+        delete ownedGameEntityManager;
+    }
+    //-------------------------------------------------------------------------
+    /// Stand-in for a game's simulation: a physics step, followed by AI and softbody
+    /// steps that only depend on physics. All of them are embarrassingly parallel.
+    struct JobScalingScene
+    {
+        std::vector<Ogre::Vector3> positions;
+        std::vector<Ogre::Vector3> velocities;
+        std::vector<Ogre::Vector3> steering;
+        std::vector<Ogre::Real>    springLengths;
+        std::vector<double>        partialSums;
+
+        void physics( size_t begin, size_t end, Ogre::Real dt )
+        {
+            const Ogre::Vector3 gravity( 0, -9.8f, 0 );
+            for( size_t i = begin; i < end; ++i )
+            {
+                velocities[i] += gravity * dt;
+                positions[i] += velocities[i] * dt;
+                if( positions[i].y < 0 )
+                {
+                    // Bounce off the floor, losing some energy.
+                    positions[i].y = -positions[i].y;
+                    velocities[i].y = -velocities[i].y * 0.8f;
+                }
+            }
+        }
+
+        void ai( size_t begin, size_t end )
+        {
+            for( size_t i = begin; i < end; ++i )
+            {
+                // Steer towards a few waypoints around the agent.
+                Ogre::Vector3 force( Ogre::Vector3::ZERO );
+                for( int j = 0; j < 8; ++j )
+                {
+                    const Ogre::Real angle = Ogre::Real( j ) * 0.785398f;
+                    const Ogre::Vector3 waypoint( std::cos( angle ) * 10.0f, 1.0f,
+                                                  std::sin( angle ) * 10.0f );
+                    const Ogre::Vector3 dir = waypoint - positions[i];
+                    force += dir / ( dir.length() + 1.0f );
+                }
+                steering[i] = force;
+            }
+        }
+
+        void softbody( size_t begin, size_t end )
+        {
+            // Relax springs between consecutive bodies, without crossing the range so
+            // chunks stay independent.
+            for( int iteration = 0; iteration < 4; ++iteration )
+            {
+                for( size_t i = begin + 1u; i < end; ++i )
+                {
+                    const Ogre::Real length = positions[i].distance( positions[i - 1u] );
+                    springLengths[i] += ( length - springLengths[i] ) * 0.5f;
+                }
+            }
+        }
+
+        void gather( size_t begin, size_t end, size_t chunkIdx )
+        {
+            double sum = 0;
+            for( size_t i = begin; i < end; ++i )
+                sum += double( springLengths[i] ) + double( steering[i].x );
+            partialSums[chunkIdx] = sum;
+        }
+    };
+    //-------------------------------------------------------------------------
+    static void resetJobScalingScene( JobScalingScene &scene, size_t numBodies )
+    {
+        std::mt19937 rng( 12345u );
+        std::uniform_real_distribution<float> distribution( -50.0f, 50.0f );
+
+        scene.positions.resize( numBodies );
+        scene.velocities.resize( numBodies );
+        scene.steering.resize( numBodies );
+        scene.springLengths.resize( numBodies );
+        for( size_t i = 0; i < numBodies; ++i )
+        {
+            scene.positions[i] = Ogre::Vector3( distribution( rng ), distribution( rng ) + 50.0f,
+                                                distribution( rng ) );
+            scene.velocities[i] = Ogre::Vector3::ZERO;
+            scene.steering[i] = Ogre::Vector3::ZERO;
+            scene.springLengths[i] = 1.0f;
+        }
+    }
+    //-------------------------------------------------------------------------
+    /// Builds the frame as a graph: each chunk runs physics, then AI & softbody in
+    /// parallel, then a gather step. Chunks don't wait for each other.
+    static void buildJobScalingGraph( JobScalingScene &scene, size_t numBodies, size_t chunkSize,
+                                      JobGraph &outGraph )
+    {
+        const Ogre::Real dt = static_cast<Ogre::Real>( MainEntryPoints::Frametime );
+        const size_t numChunks = ( numBodies + chunkSize - 1u ) / chunkSize;
+        scene.partialSums.resize( numChunks );
+
+        for( size_t chunkIdx = 0; chunkIdx < numChunks; ++chunkIdx )
+        {
+            const size_t begin = chunkIdx * chunkSize;
+            const size_t end = std::min( begin + chunkSize, numBodies );
+            JobScalingScene *s = &scene;
+
+            const size_t physicsJob =
+                outGraph.addJob( [s, begin, end, dt]( size_t ) { s->physics( begin, end, dt ); } );
+            const size_t aiJob = outGraph.addJob( [s, begin, end]( size_t ) { s->ai( begin, end ); } );
+            const size_t softbodyJob =
+                outGraph.addJob( [s, begin, end]( size_t ) { s->softbody( begin, end ); } );
+            const size_t gatherJob = outGraph.addJob(
+                [s, begin, end, chunkIdx]( size_t ) { s->gather( begin, end, chunkIdx ); } );
+
+            outGraph.addDependency( aiJob, physicsJob );
+            outGraph.addDependency( softbodyJob, physicsJob );
+            outGraph.addDependency( gatherJob, aiJob );
+            outGraph.addDependency( gatherJob, softbodyJob );
+        }
+    }
+    //-------------------------------------------------------------------------
+    void BenchmarkUtils::jobSystemScaling( size_t numBodies, Ogre::uint32 numFrames )
+    {
+        const size_t maxThreads =
+            std::max<size_t>( 1u, Ogre::PlatformInformation::getNumLogicalCores() );
+        const size_t cChunkSize = 2048u;
+        const Ogre::uint32 cWarmupFrames = 3u;
+        const Ogre::Real dt = static_cast<Ogre::Real>( MainEntryPoints::Frametime );
+
+        std::cout << "[jobs] " << numBodies << " bodies, " << numFrames << " frames, 1 to "
+                  << maxThreads << " threads" << std::endl;
+
+        double baselineParallelFor = 0;
+        double baselineGraph = 0;
+
+        JobScalingScene scene;
+
+        for( size_t numThreads = 1u; numThreads <= maxThreads; ++numThreads )
+        {
+            JobSystem jobSystem( numThreads - 1u );
+            Ogre::Timer timer;
+
+            // parallelFor: each stage is a barrier.
+            resetJobScalingScene( scene, numBodies );
+            scene.partialSums.resize( ( numBodies + cChunkSize - 1u ) / cChunkSize );
+            Ogre::uint64 parallelForMicroseconds = 0;
+            for( Ogre::uint32 frame = 0; frame < cWarmupFrames + numFrames; ++frame )
+            {
+                const Ogre::uint64 startTime = timer.getMicroseconds();
+                jobSystem.parallelFor( 0u, numBodies, cChunkSize,
+                                       [&scene, dt]( size_t begin, size_t end, size_t ) {
+                                           scene.physics( begin, end, dt );
+                                       } );
+                jobSystem.parallelFor(
+                    0u, numBodies, cChunkSize,
+                    [&scene]( size_t begin, size_t end, size_t ) { scene.ai( begin, end ); } );
+                jobSystem.parallelFor( 0u, numBodies, cChunkSize,
+                                       [&scene]( size_t begin, size_t end, size_t ) {
+                                           scene.softbody( begin, end );
+                                       } );
+                jobSystem.parallelFor( 0u, numBodies, cChunkSize,
+                                       [&scene, cChunkSize]( size_t begin, size_t end, size_t ) {
+                                           scene.gather( begin, end, begin / cChunkSize );
+                                       } );
+                if( frame >= cWarmupFrames )
+                    parallelForMicroseconds += timer.getMicroseconds() - startTime;
+            }
+            double checksum = 0;
+            for( size_t i = 0; i < scene.partialSums.size(); ++i )
+                checksum += scene.partialSums[i];
+
+            // Graph: chunks flow through the stages without global barriers.
+            resetJobScalingScene( scene, numBodies );
+            JobGraph graph;
+            buildJobScalingGraph( scene, numBodies, cChunkSize, graph );
+            Ogre::uint64 graphMicroseconds = 0;
+            for( Ogre::uint32 frame = 0; frame < cWarmupFrames + numFrames; ++frame )
+            {
+                const Ogre::uint64 startTime = timer.getMicroseconds();
+                jobSystem.run( graph );
+                if( frame >= cWarmupFrames )
+                    graphMicroseconds += timer.getMicroseconds() - startTime;
+            }
+            double graphChecksum = 0;
+            for( size_t i = 0; i < scene.partialSums.size(); ++i )
+                graphChecksum += scene.partialSums[i];
+
+            const double parallelForMs = double( parallelForMicroseconds ) / 1000.0 / numFrames;
+            const double graphMs = double( graphMicroseconds ) / 1000.0 / numFrames;
+            if( numThreads == 1u )
+            {
+                baselineParallelFor = parallelForMs;
+                baselineGraph = graphMs;
+            }
+
+            std::cout << "[jobs] " << numThreads << " threads: parallelFor " << parallelForMs
+                      << " ms/frame (x" << baselineParallelFor / std::max( parallelForMs, 1e-6 )
+                      << "), graph " << graphMs << " ms/frame (x"
+                      << baselineGraph / std::max( graphMs, 1e-6 ) << "), checksum " << checksum
+                      << " / " << graphChecksum << std::endl;
+        }
+    }
+    //-------------------------------------------------------------------------
+    /// Only does with LOGICFRAME_FINISHED what GraphicsSystem does: keeps the newest
+    /// index and the one before it, and hands the older one back to Logic.
+    class FrameQueueGraphics : public BaseSystem
+    {
+    public:
+        Mq::MessageQueueSystem *mLogicSystem;
+        Ogre::uint32            mNumGameEntityBuffers;
+        Ogre::uint32            mCurrentTransformIdx;
+        Ogre::uint32            mNumFramesReceived;
+
+        FrameQueueGraphics( GameState *gameState, Mq::MessageQueueSystem *logicSystem,
+                            Ogre::uint32 numBuffers ) :
+            BaseSystem( gameState ),
+            mLogicSystem( logicSystem ),
+            mNumGameEntityBuffers( numBuffers ),
+            mCurrentTransformIdx( 0 ),
+            mNumFramesReceived( 0 )
+        {
+        }
+
+        void processIncomingMessage( Mq::MessageId messageId, const void *data ) override
+        {
+            if( messageId != Mq::LOGICFRAME_FINISHED )
+                return;
+
+            const Ogre::uint32 newIdx = *reinterpret_cast<const Ogre::uint32 *>( data );
+            if( newIdx == Mq::cLogicFrameSkipped || newIdx == Mq::cLogicFrameExtrapolate )
+                return;
+
+            this->queueSendMessage(
+                mLogicSystem, Mq::LOGICFRAME_FINISHED,
+                ( mCurrentTransformIdx + mNumGameEntityBuffers - 1 ) % mNumGameEntityBuffers );
+            mCurrentTransformIdx = newIdx;
+            ++mNumFramesReceived;
+        }
+
+        void _processIncomingMessages() { this->processIncomingMessages(); }
+    };
+    //-------------------------------------------------------------------------
+    bool BenchmarkUtils::frameQueueHandshake( Ogre::uint32 numFrames )
+    {
+        bool bAllPublished = true;
+
+        for( long requested = 3; requested <= MAX_GAME_ENTITY_BUFFERS; ++requested )
+        {
+            // Same path as --game-entity-buffers=N
+            const Ogre::uint32 numBuffers = LogicSystem::clampNumGameEntityBuffers( requested );
+
+            GameState gameState;
+            LogicSystem logicSystem( &gameState );
+            logicSystem.setNumGameEntityBuffers( numBuffers );
+            logicSystem.setBackPressurePolicy( LogicSystem::BackPressureSkip );
+
+            FrameQueueGraphics graphicsSystem( &gameState, &logicSystem, numBuffers );
+            logicSystem._notifyGraphicsSystem( &graphicsSystem );
+
+            for( Ogre::uint32 i = 0; i < numFrames; ++i )
+            {
+                logicSystem.beginFrameParallel();
+                logicSystem.finishFrameParallel();
+                graphicsSystem._processIncomingMessages();
+                graphicsSystem.flushQueuedMessages();
+            }
+
+            const bool bPublishedAll = graphicsSystem.mNumFramesReceived == numFrames &&
+                                       logicSystem.getBackPressureStats().numSkipped == 0u;
+            bAllPublished &= bPublishedAll;
+
+            std::cout << "[frame_queue] --game-entity-buffers=" << requested << " -> " << numBuffers
+                      << " buffers: " << graphicsSystem.mNumFramesReceived << " / " << numFrames
+                      << " frames published " << ( bPublishedAll ? "OK" : "FAILED" ) << std::endl;
+        }
+
+        return bAllPublished;
+    }
+    //-------------------------------------------------------------------------
+    void BenchmarkUtils::framePacing( Ogre::uint32 numFrames, Ogre::uint64 workMicroseconds )
+    {
+        const char *modeNames[] = { "spin", "sleep+spin" };
+
+        for( int mode = 0; mode < 2; ++mode )
+        {
+            Ogre::Timer timer;
+            FramePacer framePacer( &timer );
+            framePacer.setSleepEnabled( mode != 0 );
+            framePacer.setMaxJitterMicroseconds( MainEntryPoints::MaxFrameJitterMicroseconds );
+
+            const std::clock_t cpuStart = std::clock();
+            const Ogre::uint64 wallStart = timer.getMicroseconds();
+
+            Ogre::uint64 startTime = timer.getMicroseconds();
+            for( Ogre::uint32 frame = 0; frame < numFrames; ++frame )
+            {
+                // Emulate the logic tick.
+                const Ogre::uint64 workStart = timer.getMicroseconds();
+                while( timer.getMicroseconds() - workStart < workMicroseconds )
+                {
+                }
+
+                startTime = framePacer.wait( MainEntryPoints::Frametime, startTime );
+            }
+
+            const double cpuSeconds = double( std::clock() - cpuStart ) / CLOCKS_PER_SEC;
+            const double wallSeconds = double( timer.getMicroseconds() - wallStart ) / 1000000.0;
+
+            const FramePacer::Stats &stats = framePacer.getStats();
+            std::cout << "[pacer] " << modeNames[mode] << ": CPU "
+                      << 100.0 * cpuSeconds / std::max( wallSeconds, 1e-6 ) << "% over "
+                      << wallSeconds << "s, avg overshoot "
+                      << double( stats.overshootMicroseconds ) / std::max( numFrames, 1u )
+                      << "us, max overshoot " << stats.maxOvershootMicroseconds << "us, "
+                      << stats.numJitterViolations << " ticks > "
+                      << framePacer.getMaxJitterMicroseconds() << "us, " << stats.numLateFrames
+                      << " late ticks, spin slice " << framePacer.getSpinMicroseconds() << "us"
+                      << std::endl;
+        }
+    }
+    //-------------------------------------------------------------------------
+#if !OGRE_NO_JSON
+    /// What GraphicsSystem::loadTextureCache + TextureGpuManager::importTextureMetadataCache
+    /// used to do at startup: read the whole file, parse it & build the map.
+    static void importTextureCacheJson( const char *path,
+                                        TextureMetadataCache::MetadataCacheMap &outEntries )
+    {
+        std::ifstream inFile( path, std::ios::binary | std::ios::in );
+        std::vector<char> fileData( ( std::istreambuf_iterator<char>( inFile ) ),
+                                    std::istreambuf_iterator<char>() );
+        fileData.push_back( '\0' );
+
+        rapidjson::Document d;
+        d.Parse( &fileData[0] );
+
+        rapidjson::Value::ConstMemberIterator itor = d.FindMember( "textures" );
+        if( d.HasParseError() || itor == d.MemberEnd() || !itor->value.IsObject() )
+            return;
+
+        rapidjson::Value::ConstMemberIterator itTex = itor->value.MemberBegin();
+        rapidjson::Value::ConstMemberIterator enTex = itor->value.MemberEnd();
+
+        while( itTex != enTex )
+        {
+            TextureMetadataCache::MetadataCacheEntry entry;
+            entry.aliasName = itTex->name.GetString();
+
+            itor = itTex->value.FindMember( "poolId" );
+            if( itor != itTex->value.MemberEnd() && itor->value.IsUint() )
+                entry.poolId = itor->value.GetUint();
+
+            itor = itTex->value.FindMember( "texture_type" );
+            if( itor != itTex->value.MemberEnd() && itor->value.IsUint() )
+            {
+                entry.textureType =
+                    static_cast<Ogre::TextureTypes::TextureTypes>( itor->value.GetUint() );
+            }
+
+            itor = itTex->value.FindMember( "resolution" );
+            if( itor != itTex->value.MemberEnd() && itor->value.IsArray() && itor->value.Size() >= 3u )
+            {
+                entry.width = itor->value[0].GetUint();
+                entry.height = itor->value[1].GetUint();
+                entry.depthOrSlices = itor->value[2].GetUint();
+            }
+
+            itor = itTex->value.FindMember( "mipmaps" );
+            if( itor != itTex->value.MemberEnd() && itor->value.IsUint() )
+                entry.numMipmaps = static_cast<Ogre::uint8>( itor->value.GetUint() );
+
+            itor = itTex->value.FindMember( "format" );
+            if( itor != itTex->value.MemberEnd() && itor->value.IsString() )
+            {
+                entry.pixelFormat =
+                    Ogre::PixelFormatGpuUtils::getFormatFromName( itor->value.GetString() );
+            }
+
+            outEntries[entry.aliasName] = entry;
+            ++itTex;
+        }
+    }
+#endif
+    //-------------------------------------------------------------------------
+    void BenchmarkUtils::textureMetadataCache( size_t numTextures )
+    {
+        const Ogre::PixelFormatGpu formats[] = { Ogre::PFG_RGBA8_UNORM_SRGB, Ogre::PFG_BC1_UNORM_SRGB,
+                                                 Ogre::PFG_BC3_UNORM_SRGB, Ogre::PFG_BC5_UNORM,
+                                                 Ogre::PFG_RGBA16_FLOAT };
+        const size_t numFormats = sizeof( formats ) / sizeof( formats[0] );
+
+        std::mt19937 rng( 101 );
+        std::vector<Ogre::String> names;
+        TextureMetadataCache::MetadataCacheMap sessionEntries;
+
+        // One session's worth of loaded textures, plus 1% the next one sees for the first time.
+        const size_t numNewTextures = std::max<size_t>( numTextures / 100u, 1u );
+        for( size_t i = 0u; i < numTextures + numNewTextures; ++i )
+        {
+            TextureMetadataCache::MetadataCacheEntry entry;
+            entry.aliasName = "Textures/Level" + Ogre::StringConverter::toString( i % 16u ) +
+                              "/Material" + Ogre::StringConverter::toString( i ) + "_Diffuse.dds";
+            const Ogre::uint8 log2Res = static_cast<Ogre::uint8>( 6u + rng() % 7u );
+            entry.width = 1u << log2Res;
+            entry.height = 1u << log2Res;
+            entry.depthOrSlices = 1u;
+            entry.numMipmaps = static_cast<Ogre::uint8>( log2Res + 1u );
+            entry.pixelFormat = formats[rng() % numFormats];
+            entry.textureType = Ogre::TextureTypes::Type2D;
+            entry.poolId = 0u;
+
+            names.push_back( entry.aliasName );
+            if( i < numTextures )
+                sessionEntries[entry.aliasName] = entry;
+        }
+
+        const char *binPath = "TextureMetadataCacheBenchmark.bin";
+        const char *jsonPath = "TextureMetadataCacheBenchmark.json";
+        remove( binPath );
+
+        Ogre::String jsonString;
+        {
+            TextureMetadataCache cache;
+            cache.save( binPath, sessionEntries );
+            cache.exportJson( jsonString );
+            std::ofstream file( jsonPath, std::ios::binary | std::ios::out );
+            file.write( jsonString.c_str(), static_cast<std::streamsize>( jsonString.size() ) );
+        }
+
+        Ogre::Timer timer;
+        Ogre::uint64 startTime;
+        size_t numFound = 0u;
+
+#if !OGRE_NO_JSON
+        {
+            startTime = timer.getMicroseconds();
+            TextureMetadataCache::MetadataCacheMap jsonEntries;
+            importTextureCacheJson( jsonPath, jsonEntries );
+            const Ogre::uint64 loadMicroseconds = timer.getMicroseconds() - startTime;
+
+            startTime = timer.getMicroseconds();
+            for( size_t i = 0u; i < names.size(); ++i )
+                numFound += jsonEntries.find( names[i] ) != jsonEntries.end() ? 1u : 0u;
+            const Ogre::uint64 lookupMicroseconds = timer.getMicroseconds() - startTime;
+
+            std::cout << "[texture_cache] json: " << jsonEntries.size() << " entries, "
+                      << jsonString.size() / 1024u << " KiB, startup " << loadMicroseconds / 1000.0
+                      << "ms, " << names.size() << " lookups " << lookupMicroseconds / 1000.0
+                      << "ms" << std::endl;
+        }
+#endif
+
+        TextureMetadataCache cache;
+        {
+            startTime = timer.getMicroseconds();
+            cache.open( binPath );
+            const Ogre::uint64 loadMicroseconds = timer.getMicroseconds() - startTime;
+
+            startTime = timer.getMicroseconds();
+            TextureMetadataCache::MetadataCacheEntry entry;
+            for( size_t i = 0u; i < names.size(); ++i )
+                numFound += cache.findMetadataCacheEntry( names[i], entry ) ? 1u : 0u;
+            const Ogre::uint64 lookupMicroseconds = timer.getMicroseconds() - startTime;
+
+            std::cout << "[texture_cache] binary: startup " << loadMicroseconds / 1000.0 << "ms, "
+                      << names.size() << " lookups " << lookupMicroseconds / 1000.0 << "ms"
+                      << std::endl;
+        }
+
+        // Shutdown: the old path re-serialized everything.
+        for( size_t i = numTextures; i < names.size(); ++i )
+        {
+            TextureMetadataCache::MetadataCacheEntry entry = sessionEntries.begin()->second;
+            entry.aliasName = names[i];
+            sessionEntries[names[i]] = entry;
+        }
+
+        startTime = timer.getMicroseconds();
+        {
+            Ogre::String newJsonString;
+            cache.exportJson( newJsonString );
+            std::ofstream file( jsonPath, std::ios::binary | std::ios::out );
+            file.write( newJsonString.c_str(), static_cast<std::streamsize>( newJsonString.size() ) );
+        }
+        const Ogre::uint64 jsonSaveMicroseconds = timer.getMicroseconds() - startTime;
+
+        startTime = timer.getMicroseconds();
+        cache.save( binPath, sessionEntries );
+        const Ogre::uint64 binSaveMicroseconds = timer.getMicroseconds() - startTime;
+
+        std::cout << "[texture_cache] shutdown with " << numNewTextures
+                  << " new textures: json rewrite " << jsonSaveMicroseconds / 1000.0
+                  << "ms, binary append " << binSaveMicroseconds / 1000.0 << "ms ("
+                  << cache.getNumSegments() << " segments). Checksum " << numFound << std::endl;
+
+        cache.close();
+        remove( binPath );
+        remove( jsonPath );
+    }
+    //-------------------------------------------------------------------------
+    bool BenchmarkUtils::runFromCmdLine( int nargs, const char *const *argv )
+    {
+        bool bRan = false;
+
+        for( int i = 1; i < nargs; ++i )
+        {
+            if( !strcmp( argv[i], "--benchmark=mq_flood" ) )
+            {
+                messageQueueFlood( 1000u, 600u );
+                messageQueueFlood( 10000u, 300u );
+                bRan = true;
+            }
+            else if( !strcmp( argv[i], "--benchmark=entity_churn" ) )
+            {
+                entityChurn( 1000u );
+                bRan = true;
+            }
+            else if( !strcmp( argv[i], "--benchmark=entity_iteration" ) )
+            {
+                entityIteration( 100000u, 100u );
+                bRan = true;
+            }
+            else if( !strcmp( argv[i], "--benchmark=jobs" ) )
+            {
+                jobSystemScaling( 200000u, 60u );
+                bRan = true;
+            }
+            else if( !strcmp( argv[i], "--benchmark=pacer" ) )
+            {
+                framePacing( 300u, 1000u );
+                bRan = true;
+            }
+            else if( !strcmp( argv[i], "--benchmark=frame_queue" ) )
+            {
+                frameQueueHandshake( 100u );
+                bRan = true;
+            }
+            else if( !strcmp( argv[i], "--benchmark=texture_cache" ) )
+            {
+                textureMetadataCache( 20000u );
+                bRan = true;
+            }
+        }
+
+        return bRan;
+    }
+    //-------------------------------------------------------------------------
+    bool BenchmarkUtils::runSceneBenchmarkFromCmdLine( int nargs, const char *const *argv )
+    {
+        bool bSpawn = false;
+        bool bInterpolation = false;
+
+        for( int i = 1; i < nargs; ++i )
+        {
+            if( !strcmp( argv[i], "--benchmark=spawn" ) )
+                bSpawn = true;
+            else if( !strcmp( argv[i], "--benchmark=interpolation" ) )
+                bInterpolation = true;
+        }
+
+        if( !bSpawn && !bInterpolation )
+            return false;
+
+        GameState graphicsGameState;
+        GameState logicGameState;
+        GraphicsSystem graphicsSystem( &graphicsGameState );
+        LogicSystem logicSystem( &logicGameState );
+
+        graphicsSystem._notifyLogicSystem( &logicSystem );
+        logicSystem._notifyGraphicsSystem( &graphicsSystem );
+
+        graphicsSystem.setHeadless( true );
+        graphicsSystem.setVSync( false );
+
+        graphicsSystem.initialize( "PRISM Benchmarks" );
+        logicSystem.initialize();
+
+        graphicsSystem.createScene01();
+        logicSystem.createScene01();
+        graphicsSystem.createScene02();
+        logicSystem.createScene02();
+
+        if( bSpawn )
+            entitySpawn( &graphicsSystem, &logicSystem, 100000u );
+        if( bInterpolation )
+            entityInterpolation( &graphicsSystem, &logicSystem, 50000u, 300u );
+
+        graphicsSystem.destroyScene();
+        logicSystem.destroyScene();
+        logicSystem.deinitialize();
+        graphicsSystem.deinitialize();
+
+        return true;
+    }
+}  // namespace Demo
@@ -0,0 +1,130 @@
+
+#ifndef _Demo_BenchmarkUtils_H_
+#define _Demo_BenchmarkUtils_H_
+
+#include "OgrePrerequisites.h"
+
+namespace Demo
+{
+    class GraphicsSystem;
+    class LogicSystem;
+
+    /** Micro benchmarks for the framework's internals. They don't need a window nor
+        a RenderSystem, and print their results to stdout.
+        They are built into their own executable, PRISM_Benchmarks (-DPRISM_BUILD_BENCHMARKS=ON),
+        not into the app. Correctness is covered by the tests in tests/, not by these.
+    @remarks
+        Usage:
+            PRISM_Benchmarks --benchmark=<name>
+        Where <name> is one of:
+            mq_flood        See BenchmarkUtils::messageQueueFlood
+            entity_churn    See BenchmarkUtils::entityChurn
+            entity_iteration See BenchmarkUtils::entityIteration
+            jobs            See BenchmarkUtils::jobSystemScaling
+            pacer           See BenchmarkUtils::framePacing
+            frame_queue     See BenchmarkUtils::frameQueueHandshake
+            texture_cache   See BenchmarkUtils::textureMetadataCache
+            spawn           See BenchmarkUtils::entitySpawn. Needs initialized systems,
+                            it's run via runSceneBenchmarkFromCmdLine
+            interpolation   See BenchmarkUtils::entityInterpolation. Same as spawn.
+    */
+    class BenchmarkUtils
+    {
+    public:
+        /** Looks for --benchmark=<name> in the command line and runs it.
+        @return
+            True if a benchmark was run, in which case the app should exit.
+        */
+        static bool runFromCmdLine( int nargs, const char *const *argv );
+
+        /** Same as runFromCmdLine, but for benchmarks that need initialized systems
+            and a created scene. Creates a headless GraphicsSystem (NULL RenderSystem) and
+            a LogicSystem for them, and destroys them afterwards.
+        @return
+            True if a benchmark was run.
+        */
+        static bool runSceneBenchmarkFromCmdLine( int nargs, const char *const *argv );
+
+        /** Floods a MessageQueueSystem with GAME_ENTITY_ADDED messages from another
+            thread, like the LogicSystem does when spawning lots of entities in one tick.
+            Runs once with the mutex-protected queues and once with the SPSC ring
+            transport and prints both timings.
+        @param numMessagesPerFrame
+            Number of messages queued before each flushQueuedMessages
+        @param numFrames
+            Number of flushes.
+        */
+        static void messageQueueFlood( Ogre::uint32 numMessagesPerFrame, Ogre::uint32 numFrames );
+
+        /** Creates a GameEntityManager with 10k, 20k, ... 160k entities and removes them
+            in random order, numRemovalsPerFrame per frame, printing the average cost of
+            removeGameEntity. It should stay flat regardless of the entity count.
+            Graphics is emulated; no SceneNodes are created.
+        */
+        static void entityChurn( size_t numRemovalsPerFrame );
+
+        /** Moves numEntities dynamic GameEntities a bit every frame, for numFrames frames,
+            like a trivial Logic system, and prints the cost per frame & per entity of:
+                - The old layout: every GameEntity allocated with new, with unrelated
+                  allocations in between, iterated through a GameEntityVec.
+                - GameEntityManager's chunked GameEntities, through getGameEntities.
+                - GameEntityManager::getTransformLocations, not touching the GameEntities.
+                - Resolving a GameEntityHandle per entity with getGameEntity.
+            Graphics is emulated; no SceneNodes are created.
+        */
+        static void entityIteration( size_t numEntities, Ogre::uint32 numFrames );
+
+        /** Runs a synthetic simulation (physics, then AI & softbody, then a gather step)
+            over numBodies through a JobSystem with 1, 2, ... up to one thread per logical
+            core, and prints the frame time & speedup of each. The frame is run once as a
+            sequence of parallelFor and once as a JobGraph.
+        */
+        static void jobSystemScaling( size_t numBodies, Ogre::uint32 numFrames );
+
+        /** Runs numFrames fixed timestep ticks of MainEntryPoints::Frametime, each doing
+            workMicroseconds of busy work, and waits for the next one with a FramePacer.
+            Runs once with FramePacer::setSleepEnabled( false ) and once with sleeping
+            enabled, and prints the CPU usage and how late each woke up (average, max & number of
+            ticks beyond MainEntryPoints::MaxFrameJitterMicroseconds).
+        */
+        static void framePacing( Ogre::uint32 numFrames, Ogre::uint64 workMicroseconds );
+
+        /** Not a benchmark but a check: for every --game-entity-buffers value from 3 up to
+            MAX_GAME_ENTITY_BUFFERS, ticks a LogicSystem numFrames times against an emulated
+            Graphics that hands transform indices back the way GraphicsSystem does, and
+            prints whether Logic managed to publish every tick without stalling.
+        @return
+            False if any buffer count stalled.
+        */
+        static bool frameQueueHandshake( Ogre::uint32 numFrames );
+
+        /** Writes a texture metadata cache with numTextures entries both as JSON and as a
+            TextureMetadataCache, then compares what startup costs with each (reading &
+            parsing the JSON into a map vs mapping the binary file) and the time to look up
+            every texture. Finally compares shutdown with 1% more textures: rewriting the
+            whole JSON vs appending to the binary file. Files are written to the working
+            directory and deleted afterwards.
+        */
+        static void textureMetadataCache( size_t numTextures );
+
+        /** Spawns numEntities GameEntities in a single logic tick, and despawns them all
+            some frames later, ticking Logic & Graphics in lockstep. Runs once calling
+            addGameEntity/removeGameEntity per entity and once with the batched
+            addGameEntities/removeGameEntities, and prints frame time stats of each
+            (average, median, p99, max & number of frames above 2x the median).
+        @param numEntities
+            Number of entities to spawn.
+        */
+        static void entitySpawn( GraphicsSystem *graphicsSystem, LogicSystem *logicSystem,
+                                 size_t numEntities );
+
+        /** Spawns numEntities dynamic GameEntities and measures the cost of
+            GraphicsSystem::updateGameEntities over numFrames, once interpolating one
+            entity at a time and once with SIMD (see GraphicsSystem::setUseSimdInterpolation).
+        */
+        static void entityInterpolation( GraphicsSystem *graphicsSystem, LogicSystem *logicSystem,
+                                         size_t numEntities, Ogre::uint32 numFrames );
+    };
+}  // namespace Demo
+
+#endif
@@ -2,6 +2,7 @@
 #ifndef _Demo_BaseSystem_H_
 #define _Demo_BaseSystem_H_
 
+#include "System/Telemetry.h"
 #include "Threading/MessageQueueSystem.h"
 
 namespace Demo
@@ -13,6 +14,11 @@ namespace Demo
     protected:
         GameState *mCurrentGameState;
 
+        /// What update & beginFrameParallel record (see Telemetry). Derived classes set
+        /// them; by default nothing is recorded.
+        Telemetry::Metric mTelemetryUpdateMetric;
+        Telemetry::Metric mTelemetryQueueDepthMetric;
+
     public:
         BaseSystem( GameState *gameState );
         ~BaseSystem() override;
@@ -6,9 +6,20 @@
 #include "OgreStringVector.h"
 #include "OgreVector3.h"
 
+#include "Math/Array/OgreArrayQuaternion.h"
+#include "Math/Array/OgreArrayVector3.h"
+
 namespace Demo
 {
-#define NUM_GAME_ENTITY_BUFFERS 4
+/// Default number of transform buffers shared by Logic & Graphics. The actual number is
+/// chosen at runtime, see LogicSystem::setNumGameEntityBuffers
+#define DEFAULT_GAME_ENTITY_BUFFERS 4
+/// Lower limit for the number of transform buffers. Graphics holds two (the previous and
+/// current logic frames it interpolates between), Logic holds the one it's writing, and
+/// Logic needs one more to move on to after publishing.
+#define MIN_GAME_ENTITY_BUFFERS 4
+/// Upper limit for the number of transform buffers
+#define MAX_GAME_ENTITY_BUFFERS 8
 
     enum MovableObjectType
     {
@@ -25,6 +36,38 @@ namespace Demo
         MovableObjectType  moType;
     };
 
+    /** Double precision position in the world. GameEntityTransform positions are single
+        precision and relative to an origin, see GameEntityManager::updateOrigin
+    */
+    struct WorldPosition
+    {
+        double x;
+        double y;
+        double z;
+
+        WorldPosition() : x( 0 ), y( 0 ), z( 0 ) {}
+        WorldPosition( double _x, double _y, double _z ) : x( _x ), y( _y ), z( _z ) {}
+
+        WorldPosition operator+( const Ogre::Vector3 &_r ) const
+        {
+            return WorldPosition( x + double( _r.x ), y + double( _r.y ), z + double( _r.z ) );
+        }
+
+        /// Single precision position relative to origin.
+        Ogre::Vector3 relativeTo( const WorldPosition &origin ) const
+        {
+            return Ogre::Vector3( static_cast<Ogre::Real>( x - origin.x ),
+                                  static_cast<Ogre::Real>( y - origin.y ),
+                                  static_cast<Ogre::Real>( z - origin.z ) );
+        }
+
+        double squaredDistance( const WorldPosition &_r ) const
+        {
+            return ( x - _r.x ) * ( x - _r.x ) + ( y - _r.y ) * ( y - _r.y ) +
+                   ( z - _r.z ) * ( z - _r.z );
+        }
+    };
+
     struct GameEntityTransform
     {
         Ogre::Vector3    vPos;
@@ -32,47 +75,170 @@ namespace Demo
         Ogre::Vector3    vScale;
     };
 
+    /** SoA version of GameEntityTransform, holding ARRAY_PACKED_REALS transforms.
+        Same layout as Ogre's Transform, so the Graphics thread can interpolate
+        ARRAY_PACKED_REALS entities at once and write them straight into the SceneNodes.
+        Each GameEntity owns one lane: GameEntity::mTransformIndex
+    */
+    struct ArrayGameEntityTransform
+    {
+        Ogre::ArrayVector3    vPos;
+        Ogre::ArrayQuaternion qRot;
+        Ogre::ArrayVector3    vScale;
+    };
+
+    /** Generational reference to a GameEntity. Unlike a GameEntity pointer, it's safe to
+        keep around: once the GameEntity is removed, GameEntityManager::getGameEntity
+        returns null for it, even if its slot was reused by a newer GameEntity.
+    */
+    struct GameEntityHandle
+    {
+        /// Where GameEntityManager constructed the GameEntity.
+        /// See GameEntityManager::mGameEntityChunks
+        Ogre::uint32 slot;
+        /// 0 is never a valid generation, so a default constructed handle is null.
+        Ogre::uint32 generation;
+
+        GameEntityHandle() : slot( 0 ), generation( 0 ) {}
+        GameEntityHandle( Ogre::uint32 _slot, Ogre::uint32 _generation ) :
+            slot( _slot ),
+            generation( _generation )
+        {
+        }
+
+        bool isNull() const { return generation == 0u; }
+
+        bool operator==( const GameEntityHandle &_r ) const
+        {
+            return slot == _r.slot && generation == _r.generation;
+        }
+        bool operator!=( const GameEntityHandle &_r ) const { return !( *this == _r ); }
+    };
+
+    /** The part of a GameEntity only the Graphics thread touches. GameEntityManager keeps
+        them in their own chunks, parallel to the GameEntities' (see
+        GameEntityManager::mGraphicsChunks), so the Graphics thread writing them never
+        shares cache lines with the Logic thread writing the GameEntities.
+    */
+    struct GameEntityGraphics
+    {
+        Ogre::SceneNode *    sceneNode;
+        Ogre::MovableObject *movableObject;  // Could be Entity, InstancedEntity, Item.
+        /// Floating origin: sceneNode's local transform is relative to this origin.
+        /// See GraphicsSystem::setFloatingOrigin
+        Ogre::uint32 originEpoch;
+
+        GameEntityGraphics() : sceneNode( 0 ), movableObject( 0 ), originEpoch( 0 ) {}
+    };
+
     struct GameEntity
     {
     private:
-        Ogre::uint32 mId;
+        Ogre::uint32     mId;
+        GameEntityHandle mHandle;
 
     public:
         //----------------------------------------
-        // Only used by Graphics thread
+        // Only used by Logic thread
         //----------------------------------------
-        Ogre::SceneNode *    mSceneNode;
-        Ogre::MovableObject *mMovableObject;  // Could be Entity, InstancedEntity, Item.
-
         // Your custom pointers go here, i.e. physics representation.
         // used only by Logic thread (hkpEntity, btRigidBody, etc)
 
+        /// Index in GameEntityManager's list of live entities, for O(1) removal.
+        /// Used only by Logic thread.
+        size_t mLogicIdx;
+
+        /// Dirty tracking (see GameEntityManager::markDirty). Used only by Logic thread.
+        /// Published frames left until every transform buffer holds the last transform
+        /// written; 0 means asleep.
+        Ogre::uint32 mAwakeFrames;
+        /// Transform buffer Logic wrote to last.
+        Ogre::uint32 mLastWrittenTransformIdx;
+        /// Index in GameEntityManager's list of awake entities. Only valid if awake.
+        size_t mAwakeIdx;
+
+        /// See GameEntityManager::setWorldPosition. Used only by Logic thread.
+        WorldPosition mWorldPosition;
+        /// Origin the transforms Logic writes from now on are relative to.
+        Ogre::uint32 mLogicOriginEpoch;
+
         //----------------------------------------
         // Used by both Logic and Graphics threads
         //----------------------------------------
-        GameEntityTransform *     mTransform[NUM_GAME_ENTITY_BUFFERS];
+        /// Only the first LogicSystem::getNumGameEntityBuffers are used
+        ArrayGameEntityTransform *mTransform[MAX_GAME_ENTITY_BUFFERS];
+        /// Origin the position in each mTransform[i] is relative to. Written by Logic
+        /// together with the transform. See GameEntityManager::updateOrigin
+        Ogre::uint32              mOriginEpoch[MAX_GAME_ENTITY_BUFFERS];
         Ogre::SceneMemoryMgrTypes mType;
 
         //----------------------------------------
         // Read-only
         //----------------------------------------
         MovableObjectDefinition const *mMoDefinition;
-        size_t                         mTransformBufferIdx;
-
-        GameEntity( Ogre::uint32 id, const MovableObjectDefinition *moDefinition,
-                    Ogre::SceneMemoryMgrTypes type ) :
+        /// Only dereferenced by the Graphics thread. See GameEntityGraphics
+        GameEntityGraphics *const mGraphics;
+        size_t                    mTransformBufferIdx;
+        /// Our lane in mTransform[i]. Range [0; ARRAY_PACKED_REALS)
+        size_t mTransformIndex;
+
+        GameEntity( Ogre::uint32 id, GameEntityHandle handle, GameEntityGraphics *graphics,
+                    const MovableObjectDefinition *moDefinition, Ogre::SceneMemoryMgrTypes type ) :
             mId( id ),
-            mSceneNode( 0 ),
-            mMovableObject( 0 ),
+            mHandle( handle ),
+            mLogicIdx( 0 ),
+            mAwakeFrames( 0 ),
+            mLastWrittenTransformIdx( 0 ),
+            mAwakeIdx( 0 ),
+            mLogicOriginEpoch( 0 ),
             mType( type ),
             mMoDefinition( moDefinition ),
-            mTransformBufferIdx( 0 )
+            mGraphics( graphics ),
+            mTransformBufferIdx( 0 ),
+            mTransformIndex( 0 )
         {
-            for( int i = 0; i < NUM_GAME_ENTITY_BUFFERS; ++i )
+            for( int i = 0; i < MAX_GAME_ENTITY_BUFFERS; ++i )
+            {
                 mTransform[i] = 0;
+                mOriginEpoch[i] = 0;
+            }
         }
 
         Ogre::uint32 getId() const { return mId; }
+        /// See GameEntityManager::getGameEntity
+        GameEntityHandle getHandle() const { return mHandle; }
+
+        // Accessors to our lane of mTransform[transformIdx]
+        Ogre::Vector3 getPosition( size_t transformIdx ) const
+        {
+            return mTransform[transformIdx]->vPos.getAsVector3( mTransformIndex );
+        }
+        Ogre::Quaternion getOrientation( size_t transformIdx ) const
+        {
+            return mTransform[transformIdx]->qRot.getAsQuaternion( mTransformIndex );
+        }
+        Ogre::Vector3 getScale( size_t transformIdx ) const
+        {
+            return mTransform[transformIdx]->vScale.getAsVector3( mTransformIndex );
+        }
+        void setPosition( size_t transformIdx, const Ogre::Vector3 &pos )
+        {
+            mTransform[transformIdx]->vPos.setFromVector3( pos, mTransformIndex );
+        }
+        void setOrientation( size_t transformIdx, const Ogre::Quaternion &rot )
+        {
+            mTransform[transformIdx]->qRot.setFromQuaternion( rot, mTransformIndex );
+        }
+        void setScale( size_t transformIdx, const Ogre::Vector3 &scale )
+        {
+            mTransform[transformIdx]->vScale.setFromVector3( scale, mTransformIndex );
+        }
+        void setTransform( size_t transformIdx, const GameEntityTransform &transform )
+        {
+            setPosition( transformIdx, transform.vPos );
+            setOrientation( transformIdx, transform.qRot );
+            setScale( transformIdx, transform.vScale );
+        }
 
         bool operator<( const GameEntity *_r ) const { return mId < _r->mId; }
 
@@ -17,31 +17,95 @@ namespace Demo
         {
             GameEntity *        gameEntity;
             GameEntityTransform initialTransform;
+            /// Origin initialTransform is relative to. See updateOrigin
+            Ogre::uint32 originEpoch;
         };
 
-        typedef std::vector<GameEntityVec> GameEntityVecVec;
+        /// Payload of Mq::ORIGIN_REBASED
+        struct OriginRebased
+        {
+            Ogre::uint32  epoch;
+            WorldPosition origin;
+        };
 
-    private:
-        struct Region
+        /// Where the transforms of a live GameEntity are. See getTransformLocations
+        struct TransformLocation
         {
-            size_t slotOffset;
-            size_t count;
-            size_t bufferIdx;
-
-            Region( size_t _slotOffset, size_t _count, size_t _bufferIdx ) :
-                slotOffset( _slotOffset ),
-                count( _count ),
-                bufferIdx( _bufferIdx )
+            /// GameEntity::getId
+            Ogre::uint32 id;
+            /// Our block in the first transform buffer. The block in buffer i is at
+            /// block + i * cNumArrayTransforms (see getTransform)
+            ArrayGameEntityTransform *block;
+            /// Our lane in the block. Range [0; ARRAY_PACKED_REALS)
+            size_t lane;
+
+            ArrayGameEntityTransform *getTransform( size_t transformIdx ) const
             {
+                return block + transformIdx * cNumArrayTransforms;
             }
         };
 
+        typedef std::vector<GameEntityVec>     GameEntityVecVec;
+        typedef std::vector<TransformLocation> TransformLocationVec;
+
+        /// Transforms per transform buffer. Must be multiple of ARRAY_PACKED_REALS
+        static const size_t cNumTransforms = 256u;
+        static const size_t cNumArrayTransforms = cNumTransforms / ARRAY_PACKED_REALS;
+        /// GameEntities per chunk of mGameEntityChunks
+        static const size_t cGameEntitiesPerChunk = 256u;
+
+    private:
         // We assume mCurrentId never wraps
-        Ogre::uint32  mCurrentId;
+        Ogre::uint32 mCurrentId;
+        /// Live entities. Unordered: removal swaps with the last element and pops,
+        /// see GameEntity::mLogicIdx
         GameEntityVec mGameEntities[Ogre::NUM_SCENE_MEMORY_MANAGER_TYPES];
+        /// Parallel to mGameEntities. Only used by Logic thread.
+        TransformLocationVec mTransformLocations[Ogre::NUM_SCENE_MEMORY_MANAGER_TYPES];
+
+        /// GameEntities are constructed in place, cGameEntitiesPerChunk per chunk, so
+        /// that consecutively created ones are contiguous in memory. Chunks are only freed
+        /// on destruction, so a GameEntity pointer stays valid until the Graphics thread
+        /// is done with it. A GameEntity's slot is its index across all chunks.
+        std::vector<GameEntity *> mGameEntityChunks;
+        /// Parallel to mGameEntityChunks: the GameEntityGraphics of each slot. Only the
+        /// Graphics thread touches them once the GameEntity is created.
+        std::vector<GameEntityGraphics *> mGraphicsChunks;
+        /// Generation of each slot. Bumped when its GameEntity gets removed, which
+        /// invalidates every GameEntityHandle to it.
+        std::vector<Ogre::uint32> mSlotGenerations;
+        /// Slots whose GameEntity has been destroyed, ready to be reused.
+        std::vector<Ogre::uint32> mAvailableSlots;
 
-        std::vector<GameEntityTransform *> mTransformBuffers;
-        std::vector<Region>                mAvailableTransforms;
+        /// Copy of LogicSystem::getDirtyTracking at creation time.
+        bool mDirtyTracking;
+        /// SCENE_DYNAMIC entities with mAwakeFrames > 0. Unordered, see GameEntity::mAwakeIdx
+        GameEntityVec mAwakeEntities;
+
+        /// Copy of LogicSystem::getFloatingOrigin at creation time.
+        bool mFloatingOrigin;
+        /// Origin of each epoch, indexed by epoch. back() is the current one.
+        std::vector<WorldPosition> mOrigins;
+        double                     mRebaseDistance;
+        size_t                     mRebaseEntitiesPerTick;
+        /// Where rebaseSomeEntities resumes looking in mGameEntities[SCENE_DYNAMIC]
+        size_t mRebaseCursor;
+        /// SCENE_DYNAMIC entities whose transforms are still relative to the previous origin.
+        size_t        mNumEntitiesToRebase;
+        GameEntityVec mTmpRebasedEntities;
+
+        /// Copy of LogicSystem::getNumGameEntityBuffers at creation time.
+        size_t mNumGameEntityBuffers;
+        /// Each buffer holds cNumTransforms transforms for each of the
+        /// mNumGameEntityBuffers, in blocks of ARRAY_PACKED_REALS.
+        std::vector<ArrayGameEntityTransform *> mTransformBuffers;
+        /// Free list of transform slots. Each value is
+        /// bufferIdx * cNumTransforms + slot inside that buffer.
+        std::vector<size_t> mAvailableTransforms;
+        /// Number of frames since compactTransformSlots was last called.
+        /// Only counts while mAvailableTransforms is dirty.
+        size_t mFramesSinceTransformCompaction;
+        bool   mAvailableTransformsDirty;
 
         GameEntityVecVec    mScheduledForRemoval;
         size_t              mScheduledForRemovalCurrentSlot;
@@ -50,11 +114,58 @@ namespace Demo
         Mq::MessageQueueSystem *mGraphicsSystem;
         LogicSystem *           mLogicSystem;
 
+        std::vector<CreatedGameEntity> mTmpCreatedGameEntities;
+
         size_t getScheduledForRemovalAvailableSlot();
         void   destroyAllGameEntitiesIn( GameEntityVec &container );
 
+        /// Creates the GameEntity and its transforms, but doesn't notify the Graphics thread.
+        GameEntity *createGameEntity( Ogre::SceneMemoryMgrTypes      type,
+                                      const MovableObjectDefinition *moDefinition,
+                                      const GameEntityTransform &initialTransform );
+
+        /// Removes from mGameEntities in O(1). Order is not preserved.
+        /// Bumps the generation of its slot, so getGameEntity returns null for its handles.
+        void removeFromLiveList( GameEntity *toRemove );
+
+        /// Removes from mAwakeEntities in O(1). Order is not preserved.
+        void removeFromAwakeList( GameEntity *gameEntity );
+
+        /** Copies the last transform written of every awake GameEntity that wasn't written
+            this tick into the current transform buffer, so that every buffer ends up
+            holding it before it falls asleep.
+        */
+        void carryAwakeTransforms();
+
+        /// Moves the GameEntity to the current origin if it's dynamic, and writes its
+        /// position in the given transform buffer relative to its origin.
+        void writeWorldPosition( GameEntity *gameEntity, size_t transformIdx );
+
+        /** Rewrites the transforms of up to mRebaseEntitiesPerTick dynamic GameEntities
+            that are still relative to the previous origin, in parallel if there's a
+            JobSystem. So a rebase is spread across several ticks instead of a hitch.
+        */
+        void rebaseSomeEntities();
+
+        Ogre::uint32 aquireGameEntitySlot();
+        GameEntity * getGameEntityInSlot( size_t slot ) const
+        {
+            return mGameEntityChunks[slot / cGameEntitiesPerChunk] + slot % cGameEntitiesPerChunk;
+        }
+        GameEntityGraphics *getGraphicsInSlot( size_t slot ) const
+        {
+            return mGraphicsChunks[slot / cGameEntitiesPerChunk] + slot % cGameEntitiesPerChunk;
+        }
+
         void aquireTransformSlot( size_t &outSlot, size_t &outBufferIdx );
-        void releaseTransformSlot( size_t bufferIdx, GameEntityTransform *transform );
+        void releaseTransformSlot( const GameEntity *gameEntity );
+
+        /** Sorts the free list so that the lowest slots are handed out first, which keeps
+            live transforms packed in the first buffers, and frees trailing buffers that
+            became completely unused (one spare is kept to avoid thrashing).
+            Called periodically from finishFrameParallel.
+        */
+        void compactTransformSlots();
 
     public:
         GameEntityManager( Mq::MessageQueueSystem *graphicsSystem, LogicSystem *logicSystem );
@@ -67,7 +178,7 @@ namespace Demo
             Whether this GameEntity is dynamic (going to change transform frequently), or
             static (will move/rotate/scale very, very infrequently)
         @param initialPos
-            Starting position of the GameEntity
+            Starting position of the GameEntity. Relative to getOrigin with floating origin
         @param initialRot
             Starting orientation of the GameEntity
         @param initialScale
@@ -82,6 +193,26 @@ namespace Demo
                                    const Ogre::Vector3 &initialPos, const Ogre::Quaternion &initialRot,
                                    const Ogre::Vector3 &initialScale );
 
+        /** Creates many GameEntities sharing the same definition at once. Much faster than
+            calling addGameEntity repeatedly: the Graphics thread receives one message
+            per batch and creates all the SceneNodes & Items in one go.
+            MUST BE CALLED FROM LOGIC THREAD.
+        @param type
+            See addGameEntity
+        @param moDefinition
+            See addGameEntity
+        @param initialTransforms
+            Array with the starting transform of each GameEntity
+        @param numEntities
+            Number of elements in initialTransforms
+        @param outGameEntities [out]
+            The created GameEntities are appended here, in the same order as initialTransforms
+        */
+        void addGameEntities( Ogre::SceneMemoryMgrTypes      type,
+                              const MovableObjectDefinition *moDefinition,
+                              const GameEntityTransform *initialTransforms, size_t numEntities,
+                              GameEntityVec &outGameEntities );
+
         /** Removes the GameEntity from the world. The pointer is not immediately destroyed,
             we first need to release data in other threads (i.e. Graphics).
             It will be destroyed after the Render thread confirms it is done with it
@@ -89,11 +220,116 @@ namespace Demo
         */
         void removeGameEntity( GameEntity *toRemove );
 
+        /// Removes many GameEntities at once, sending one message per batch to the
+        /// Graphics thread. See removeGameEntity
+        void removeGameEntities( GameEntity *const *toRemove, size_t numEntities );
+
+        /// Returns all the live GameEntities of the given type, for dense iteration.
+        /// The order is unspecified and changes when entities are removed.
+        const GameEntityVec &getGameEntities( Ogre::SceneMemoryMgrTypes type ) const
+        {
+            return mGameEntities[type];
+        }
+
+        /** Where the transforms of each live GameEntity of the given type are, in the same
+            order as getGameEntities. Logic systems that only need to read or write
+            transforms should iterate this instead (like hashTransforms does): it's
+            contiguous and doesn't touch the rest of the GameEntities' members.
+            MUST BE CALLED FROM LOGIC THREAD.
+        */
+        const TransformLocationVec &getTransformLocations( Ogre::SceneMemoryMgrTypes type ) const
+        {
+            return mTransformLocations[type];
+        }
+
+        /** Returns the GameEntity the handle refers to, or null if it's been removed
+            (or the handle is null). O(1).
+            MUST BE CALLED FROM LOGIC THREAD.
+        */
+        GameEntity *getGameEntity( GameEntityHandle handle ) const
+        {
+            if( handle.slot >= mSlotGenerations.size() ||
+                mSlotGenerations[handle.slot] != handle.generation )
+            {
+                return 0;
+            }
+            return getGameEntityInSlot( handle.slot );
+        }
+
+        /** Flags the GameEntity as changed this tick. Only needed with dirty tracking (see
+            LogicSystem::setDirtyTracking), where Graphics only interpolates the entities
+            that changed, and the rest are asleep: Logic keeps publishing the last transform
+            written for them, and their SceneNodes aren't touched.
+            Call it after writing the transform into LogicSystem::getCurrentTransformIdx.
+            Does nothing for SCENE_STATIC entities (Graphics never interpolates them).
+            MUST BE CALLED FROM LOGIC THREAD.
+        */
+        void markDirty( GameEntity *gameEntity );
+
+        /// Writes the transform into LogicSystem::getCurrentTransformIdx and calls markDirty.
+        /// transform.vPos is relative to getOrigin. See setWorldPosition
+        void setTransform( GameEntity *gameEntity, const GameEntityTransform &transform );
+
+        /** Floating origin only (see LogicSystem::setFloatingOrigin). LogicSystem calls it
+            at the beginning of each tick with the camera's world position, which Graphics
+            sends every frame (Mq::CAMERA_MOVED).
+            When focus is further than getRebaseDistance from the current origin, the
+            origin moves there: Graphics is told, and the dynamic GameEntities are migrated
+            to the new origin over the following ticks (see setRebaseEntitiesPerTick).
+            A new rebase won't start until the previous one finished.
+            Static GameEntities stay relative to the origin they were created in.
+            MUST BE CALLED FROM LOGIC THREAD.
+        */
+        void updateOrigin( const WorldPosition &focus );
+
+        /// Default is 4096 units.
+        void   setRebaseDistance( double distance ) { mRebaseDistance = distance; }
+        double getRebaseDistance() const { return mRebaseDistance; }
+
+        /// How many dynamic GameEntities each tick migrates to the new origin. Default is 8192
+        void   setRebaseEntitiesPerTick( size_t numEntities );
+        size_t getRebaseEntitiesPerTick() const { return mRebaseEntitiesPerTick; }
+
+        const WorldPosition &getOrigin() const { return mOrigins.back(); }
+        Ogre::uint32         getOriginEpoch() const
+        {
+            return static_cast<Ogre::uint32>( mOrigins.size() - 1u );
+        }
+        /// True while dynamic GameEntities are still being migrated to the current origin.
+        bool isRebasing() const { return mNumEntitiesToRebase != 0u; }
+
+        /** Sets the double precision position of the GameEntity and writes it, relative to
+            the origin, into LogicSystem::getCurrentTransformIdx. Then calls markDirty.
+            With floating origin, GameStates must move GameEntities through here (or
+            setTransform), since dynamic GameEntities are migrated to new origins from their
+            world position.
+            MUST BE CALLED FROM LOGIC THREAD.
+        */
+        void setWorldPosition( GameEntity *gameEntity, const WorldPosition &worldPosition );
+        const WorldPosition &getWorldPosition( const GameEntity *gameEntity ) const
+        {
+            return gameEntity->mWorldPosition;
+        }
+
+        /// Number of SCENE_DYNAMIC GameEntities whose transform changed in the last
+        /// getNumGameEntityBuffers published frames. Always 0 without dirty tracking.
+        size_t getNumAwakeEntities() const { return mAwakeEntities.size(); }
+
+        /** Hashes the id and the exact bits of the transform of every live GameEntity in
+            the given buffer. Two runs that produced the same world give the same hash.
+            See LogicReplay
+        */
+        Ogre::uint64 hashTransforms( size_t transformIdx ) const;
+
         /// Must be called by LogicSystem when Mq::GAME_ENTITY_SCHEDULED_FOR_REMOVAL_SLOT message arrives
         void _notifyGameEntitiesRemoved( size_t slot );
 
         /// Must be called every frame from the LOGIC THREAD.
         void finishFrameParallel();
+
+        /// Must be called by LogicSystem right before sending Mq::LOGICFRAME_FINISHED with a
+        /// new transform buffer. Sends the awake entities to Graphics.
+        void _notifyFramePublished();
     };
 }  // namespace Demo
 
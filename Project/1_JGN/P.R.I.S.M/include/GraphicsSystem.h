@@ -14,6 +14,12 @@
 #include "System/StaticPluginLoader.h"
 #include "Threading/OgreUniformScalableTask.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
 #if OGRE_USE_SDL2
 #    if defined( __clang__ )
 #        pragma clang diagnostic push
@@ -23,6 +29,7 @@
 #        pragma GCC diagnostic ignored "-Wimplicit-fallthrough"
 #    endif
 #    include <SDL.h>
+struct SDL_SysWMinfo;
 #    if defined( __clang__ )
 #        pragma clang diagnostic pop
 #    elif defined( __GNUC__ )
@@ -30,12 +37,52 @@
 #    endif
 #endif
 
+namespace Ogre
+{
+    class HlmsDiskCache;
+}
+
 namespace Demo
 {
     class SdlInputHandler;
+    class StreamingSceneLoader;
+    class TextureMetadataCache;
 
     class GraphicsSystem : public BaseSystem, public Ogre::UniformScalableTask
     {
+    public:
+        /// Accumulated timings of update(), see getFramePipelineStats
+        struct FramePipelineStats
+        {
+            Ogre::uint64 numFrames;
+            /// Whole update() call
+            Ogre::uint64 frameMicroseconds;
+            /// Pipelined: time the prepare thread was busy. Otherwise: SDL events
+            /// and GameState::update, right before renderOneFrame
+            Ogre::uint64 prepareMicroseconds;
+            /// Scene culling, command recording, submission & present
+            Ogre::uint64 submitMicroseconds;
+            /// Pipelined only: time the render thread waited for the prepare thread after
+            /// submitting. If it's high, preparing is the bottleneck.
+            Ogre::uint64 prepareWaitMicroseconds;
+            /// Time since Graphics received a logic frame, until the first frame that
+            /// shows it was submitted.
+            Ogre::uint64 latencyMicroseconds;
+            Ogre::uint64 numLatencySamples;
+            /// Time since an input event happened until the first frame whose logic
+            /// consumed it was submitted (input to photon, minus the display's scan out).
+            /// Needs a LogicSystem. See InputSnapshot
+            Ogre::uint64 inputLatencyMicroseconds;
+            Ogre::uint64 maxInputLatencyMicroseconds;
+            Ogre::uint64 numInputLatencySamples;
+            /// Time spent in updateGameEntities, how many times it was called, and the
+            /// GameEntities it interpolated vs the dynamic ones. See setDirtyTracking
+            Ogre::uint64 interpolateMicroseconds;
+            Ogre::uint64 numInterpolations;
+            Ogre::uint64 numInterpolatedEntities;
+            Ogre::uint64 numDynamicEntities;
+        };
+
     private:
         using BaseSystem::initialize;
 
@@ -58,6 +105,15 @@ namespace Demo
 
         Ogre::v1::OverlaySystem *mOverlaySystem;
 
+        /// See loadTextureCache
+        TextureMetadataCache *mTextureMetadataCache;
+
+        /// Null if meshes are loaded synchronously. See setNumMeshStreamingThreads
+        StreamingSceneLoader *mStreamingSceneLoader;
+        size_t                mNumMeshStreamingThreads;
+        /// GameEntities whose meshes StreamingSceneLoader finished this frame.
+        GameEntityVec mStreamedGameEntities;
+
         StaticPluginLoader mStaticPluginLoader;
         #ifdef AUTO_TESTING
             std::string renderer;
@@ -65,24 +121,143 @@ namespace Demo
         /// Tracks the amount of elapsed time since we last
         /// heard from the LogicSystem finishing a frame
         float                mAccumTimeSinceLastLogicFrame;
+        Ogre::uint32         mNumGameEntityBuffers;
         Ogre::uint32         mCurrentTransformIdx;
+        /// Logic couldn't publish its last frame and asked us to extrapolate.
+        /// See LogicSystem::BackPressureExtrapolate
+        bool                 mLogicRequestedExtrapolation;
+        Ogre::uint64         mNumExtrapolatedFrames;
         GameEntityVec        mGameEntities[Ogre::NUM_SCENE_MEMORY_MANAGER_TYPES];
         GameEntityVec const *mThreadGameEntityToUpdate;
         float                mThreadWeight;
+        bool                 mUseSimdInterpolation;
+        size_t               mNumSceneManagerThreads;
+
+        /// See setDirtyTracking
+        bool mDirtyTracking;
+        /// SCENE_DYNAMIC GameEntities that changed in the current logic frame, sorted like
+        /// mGameEntities. mPendingAwakeGameEntities is the list for the logic frame that
+        /// is arriving (see Mq::GAME_ENTITIES_AWAKE_BATCH)
+        GameEntityVec mAwakeGameEntities;
+        GameEntityVec mPendingAwakeGameEntities;
+
+        /// An origin Logic rebased to (see GameEntityManager::updateOrigin). The SceneNodes
+        /// of the GameEntities whose transforms are relative to it hang from its parents.
+        struct OriginEpoch
+        {
+            Ogre::uint32  epoch;
+            WorldPosition origin;
+            /// Created on demand, see getOriginSceneNode
+            Ogre::SceneNode *parents[Ogre::NUM_SCENE_MEMORY_MANAGER_TYPES];
+        };
+
+        /// See setFloatingOrigin
+        bool mFloatingOrigin;
+        /// Ascending. back() is the origin the scene is rendered around, i.e. it's at
+        /// (0, 0, 0) in Ogre's world space.
+        std::vector<OriginEpoch> mOriginEpochs;
+
+        /// See setPipelinedFrames
+        bool        mPipelinedFrames;
+        Ogre::uint8 mMaxFramesInFlight;
+
+        enum PrepareState
+        {
+            PrepareIdle,
+            PrepareKicked,
+            PrepareQuit
+        };
+        std::thread             mPrepareThread;
+        std::mutex              mPrepareMutex;
+        std::condition_variable mPrepareCondition;
+        PrepareState            mPrepareState;
+        float                   mPrepareTimeSinceLast;
+        /// True while the prepare thread is processing messages. Messages that
+        /// touch the scene get deferred until the render thread is done with it.
+        bool mDeferSceneMessages;
+
+        FramePipelineStats mFramePipelineStats;
+        /// When the newest logic frame was received, and when the one being
+        /// rendered was received. 0 if none. For FramePipelineStats::latencyMicroseconds
+        Ogre::uint64 mPendingLogicFrameArrival;
+        Ogre::uint64 mInFlightLogicFrameArrival;
+        /// Same, for the oldest input the logic frame consumed. mConsumedInputTime
+        /// is waiting for its logic frame to arrive (see Mq::INPUT_CONSUMED).
+        Ogre::uint64 mConsumedInputTime;
+        Ogre::uint64 mPendingLogicFrameInput;
+        Ogre::uint64 mInFlightLogicFrameInput;
+
+        /// See setHeadless
+        bool         mHeadless;
+        bool         mVSync;
+        Ogre::uint64 mMaxFrames;
+        Ogre::uint64 mNumFramesRendered;
+
+        /// See setFrameTimingsCsv. Not open if the path is empty.
+        Ogre::String  mFrameTimingsCsvPath;
+        std::ofstream mFrameTimingsCsv;
+        Ogre::uint64  mFrameLogicMicroseconds;
+
+        /// See setTelemetryCsv
+        Ogre::String mTelemetryCsvPath;
+        /// See setTraceCapturePath
+        Ogre::String mTraceCapturePath;
+
+        GameEntityVec mTmpGameEntities;
+        /// GameEntities removed by Logic this frame. They're all taken out of
+        /// mGameEntities in one pass; see destroyPendingGameEntities
+        GameEntityVec mPendingRemovals;
+
+        /// Cache files read by mHlmsCacheIoThread. See startHlmsCacheLoad
+        std::thread                      mHlmsCacheIoThread;
+        Ogre::DataStreamPtr              mPipelineCacheStream;
+        Ogre::DataStreamPtr              mMicrocodeCacheStream;
+        std::vector<Ogre::DataStreamPtr> mHlmsCacheStreams;
+
+        struct HlmsWarmUp
+        {
+            Ogre::Hlms          *hlms;
+            Ogre::HlmsDiskCache *diskCache;
+            Ogre::String         filename;
+        };
+        /// See warmUpHlmsCaches
+        std::vector<HlmsWarmUp> mHlmsWarmUps;
+
+        /// For getTimeToFirstFrame & co. SteadyClock microseconds
+        Ogre::uint64 mInitializeStart;
+        Ogre::uint64 mHlmsWarmUpStart;
+        Ogre::uint64 mTimeToFirstFrame;
+        Ogre::uint64 mTimeToFirstSceneFrame;
+        Ogre::uint64 mHlmsWarmUpMicroseconds;
 
         bool              mQuit;
         bool              mAlwaysAskForConfig;
         bool              mUseHlmsDiskCache;
         bool              mUseMicrocodeCache;
+        bool              mUseMeshCache;
+        bool              mExportTextureCacheJson;
         bool              mRequirePersistentDepthBuf;
         Ogre::ColourValue mBackgroundColour;
 
 #if OGRE_USE_SDL2
         void handleWindowEvent( const SDL_Event &evt );
+        /** Creates mSdlWindow and adds its native handle to params.
+        @param wmInfo [out]
+            On X11, params points into it, so it must outlive createRenderWindow.
+        */
+        void createSdlWindow( const Ogre::String &windowTitle, int width, int height,
+                              bool fullscreen, SDL_SysWMinfo &wmInfo,
+                              Ogre::NameValuePairList &params );
 #endif
 
         bool isWriteAccessFolder( const Ogre::String &folderPath, const Ogre::String &fileToSave );
 
+        /// Selects the NULL RenderSystem, loading its plugin if plugins.cfg didn't.
+        void selectHeadlessRenderSystem();
+
+        void writeFrameTimings( const FramePipelineStats &frameStartStats,
+                                Ogre::uint64 timeSinceLastMicroseconds );
+
         /// @see MessageQueueSystem::processIncomingMessage
         void processIncomingMessage( Mq::MessageId messageId, const void *data ) override;
 
@@ -91,9 +266,31 @@ namespace Demo
 
         void loadTextureCache();
         void saveTextureCache();
+
+        /// Reads the pipeline, microcode & HLMS caches from disk in mHlmsCacheIoThread,
+        /// while Ogre gets initialized. Nothing is applied yet.
+        void startHlmsCacheLoad();
+        void hlmsCacheIoThread();
+        /// Applies the pipeline & microcode caches and deserializes the HLMS ones into
+        /// mHlmsWarmUps. Their shaders are compiled later, by warmUpHlmsCaches.
         void loadHlmsDiskCache();
+        /// Compiles mHlmsWarmUps[warmUpIdx]'s shaders. See HlmsDiskCache::applyTo
+        void applyHlmsWarmUp( size_t warmUpIdx, size_t numThreads );
+        /** Compiles the HLMS caches one at a time, rendering a loading frame (see
+            createLoadingWorkspace) before each. Everything happens in this thread, since
+            applying a cache changes the Hlms and creates PSOs, which can't race with
+            rendering. Each compilation is spread across all cores by applyTo itself.
+            Must be called after loadResources (custom pieces files are looked up in the
+            ResourceGroupManager). The scene must not be touched before this returns.
+        */
+        void warmUpHlmsCaches();
+        void joinHlmsCacheThreads();
         void saveHlmsDiskCache();
 
+        /// Only clears the window, so it doesn't need any HLMS shader.
+        Ogre::CompositorWorkspace *createLoadingWorkspace();
+        void                       notifyFrameRendered( bool bSceneFrame );
+
         virtual void setupResources();
         virtual void registerHlms();
         /// Optional override method where you can perform resource group loading
@@ -112,9 +309,66 @@ namespace Demo
         /// Optional override method where you can create resource listeners (e.g. for loading screens)
         virtual void createResourceListener() {}
 
+        /// Creates the SceneNode & MovableObject, but doesn't add it to mGameEntities.
+        /// The MovableObject is created later if its mesh is being streamed.
+        void createSceneNodeAndObject( const GameEntityManager::CreatedGameEntity *cge );
+        void createMovableObject( GameEntity *gameEntity );
+        void destroySceneNodeAndObject( GameEntity *toRemove );
+
         void gameEntityAdded( const GameEntityManager::CreatedGameEntity *createdGameEntity );
         void gameEntityRemoved( GameEntity *toRemove );
 
+        /// Batched version. Instead of one sorted insert per entity (which is O(N) each),
+        /// all the SceneNodes are created in one pass and mGameEntities is sorted once.
+        void gameEntitiesAdded( const GameEntityManager::CreatedGameEntity *createdGameEntities,
+                                size_t numEntities );
+        void gameEntitiesRemoved( GameEntity *const *toRemove, size_t numEntities );
+
+        /// Dirty tracking: replaces mAwakeGameEntities with mPendingAwakeGameEntities when
+        /// a logic frame arrives. Entities without a SceneNode yet are left out.
+        void swapAwakeGameEntities();
+        /// Dirty tracking: new SCENE_DYNAMIC GameEntities are interpolated for the rest of
+        /// the logic frame, in case their creation got deferred past the frame that had
+        /// them awake (see setPipelinedFrames).
+        void insertAwakeGameEntities( const GameEntityManager::CreatedGameEntity *createdGameEntities,
+                                      size_t numEntities );
+
+        /** Removals are deferred until Logic tells us the frame's removal slot is done
+            (Mq::GAME_ENTITY_SCHEDULED_FOR_REMOVAL_SLOT), so that mGameEntities is compacted
+            once per frame instead of doing an O(N) erase per entity.
+            The GameEntity pointers are still valid at that point, since Logic won't
+            delete them until we acknowledge that message.
+        */
+        void destroyPendingGameEntities();
+
+        /// Floating origin: moves the camera & every origin's parents so that the new
+        /// origin ends up at (0, 0, 0). See Mq::ORIGIN_REBASED
+        void originRebased( const GameEntityManager::OriginRebased &originRebased );
+        /// Null if we haven't received it, or it was already discarded.
+        const OriginEpoch *findOriginEpoch( Ogre::uint32 epoch ) const;
+        /** Floating origin: moves the SceneNodes of the GameEntities about to be interpolated
+            whose transform is now relative to another origin, under that origin's parent.
+            Reparenting moves a node's memory, so they're taken out of mGameEntities (and
+            mAwakeGameEntities) and merged back in, to keep them sorted.
+            Must be called from the render thread while nobody is using the scene.
+        */
+        void rebaseSceneNodes();
+        /// Floating origin: Offsets to add to the positions in prevIdx and currIdx to make
+        /// them relative to the origin of gEnt's SceneNode. False if an origin is unknown.
+        bool getOriginOffsets( const GameEntity *gEnt, size_t prevIdx, size_t currIdx,
+                               Ogre::Vector3 &outPrevOffset, Ogre::Vector3 &outCurrOffset ) const;
+
+        void prepareThread();
+        void kickPrepareThread( float timeSinceLast );
+        void waitForPrepareThread();
+        /// Runs in the prepare thread while the render thread submits the current frame.
+        /// Processes incoming messages and interpolates the dynamic GameEntities.
+        void prepareNextFrame( float timeSinceLast );
+        /// Same as Root::renderOneFrame, but prepares the next frame in parallel
+        /// once the scene graph has been updated.
+        bool renderOneFramePipelined( float timeSinceLast );
+        void addLatencySample( Ogre::uint64 submitEndMicroseconds );
+
     public:
         GraphicsSystem( GameState *gameState, Ogre::String resourcePath = Ogre::String( "" ),
                         Ogre::ColourValue backgroundColour = Ogre::ColourValue( 0.2f, 0.4f, 0.6f ) );
@@ -137,6 +391,50 @@ namespace Demo
         */
         void updateGameEntities( const GameEntityVec &gameEntities, float weight );
 
+        /// Number of threads the SceneManager uses, render thread included.
+        /// 0 (default) means one per logical core. Must be called before initialize.
+        /// See JobSystem::partitionCores
+        void   setNumSceneManagerThreads( size_t numThreads ) { mNumSceneManagerThreads = numThreads; }
+        size_t getNumSceneManagerThreads() const { return mNumSceneManagerThreads; }
+
+        /** When true (default), updateGameEntities interpolates ARRAY_PACKED_REALS entities
+            at a time with SIMD, whenever they fill a whole block of their SceneNodes'
+            Transform. When false, every entity is interpolated and set one by one.
+        */
+        void setUseSimdInterpolation( bool bUseSimd ) { mUseSimdInterpolation = bUseSimd; }
+        bool getUseSimdInterpolation() const { return mUseSimdInterpolation; }
+
+        /** Must match LogicSystem::setDirtyTracking. When enabled, only the GameEntities
+            Logic flagged as changed (see GameEntityManager::markDirty) are interpolated,
+            and the SceneNodes of the rest aren't touched. Default is false.
+            See FramePipelineStats for how many were interpolated & the time it took.
+            Must be called before initialize.
+        */
+        void setDirtyTracking( bool bDirtyTracking );
+        bool getDirtyTracking() const { return mDirtyTracking; }
+
+        /// What to pass to updateGameEntities: the awake SCENE_DYNAMIC GameEntities with
+        /// dirty tracking, all of them otherwise.
+        const GameEntityVec &getGameEntitiesToInterpolate() const
+        {
+            return mDirtyTracking ? mAwakeGameEntities : mGameEntities[Ogre::SCENE_DYNAMIC];
+        }
+
+        /** Must match LogicSystem::setFloatingOrigin. The SceneNodes of GameEntities are
+            created under a parent per origin (see getOriginSceneNode) and the camera is
+            moved whenever Logic rebases, so that the scene is rendered around the latest
+            origin and stays in single precision range. Scene content that isn't a
+            GameEntity isn't moved: attach it to getOriginSceneNode( 0, type ) to keep it
+            where it was. Default is false. Must be called before initialize.
+        */
+        void setFloatingOrigin( bool bFloatingOrigin );
+        bool getFloatingOrigin() const { return mFloatingOrigin; }
+
+        /// Parent SceneNode of the given origin. Created if it doesn't exist yet.
+        /// Null if Graphics doesn't know that origin (yet), or it was discarded. Origin 0
+        /// and origins whose parents have children or attached objects are never discarded.
+        Ogre::SceneNode *getOriginSceneNode( Ogre::uint32 originEpoch, Ogre::SceneMemoryMgrTypes type );
+
         /// Overload Ogre::UniformScalableTask. @see updateGameEntities
         void execute( size_t threadId, size_t numThreads ) override;
 
@@ -167,6 +465,118 @@ namespace Demo
 
         float getAccumTimeSinceLastLogicFrame() const { return mAccumTimeSinceLastLogicFrame; }
 
+        /** Returns the weight to pass to updateGameEntities, based on
+            getAccumTimeSinceLastLogicFrame. It's in range [0; 1], unless Logic fell behind
+            and asked us to extrapolate (LogicSystem::BackPressureExtrapolate), in which
+            case it can go up to cMaxExtrapolationWeight.
+        @param frametime
+            Logic's fixed timestep, i.e. MainEntryPoints::Frametime
+        */
+        float getInterpolationWeight( double frametime ) const;
+
+        /// How far past the last logic frame we're allowed to extrapolate, in logic frames.
+        static const float cMaxExtrapolationWeight;
+
+        /// Number of rendered frames that had to be extrapolated.
+        /// See LogicSystem::BackPressureExtrapolate
+        Ogre::uint64 getNumExtrapolatedFrames() const { return mNumExtrapolatedFrames; }
+
+        /** When enabled, update() overlaps the next frame's message processing with
+            culling, command recording & submission of the current frame.
+            Costs one frame of latency. Must be called before initialize.
+        @remarks
+            The second thread never touches the scene: messages that create, destroy or
+            move scene objects are deferred and applied on the render thread once the
+            current frame has been submitted, followed by the SCENE_DYNAMIC GameEntities'
+            interpolation. GraphicsSystem does that by itself, so GameStates must not
+            call updateGameEntities.
+        */
+        void setPipelinedFrames( bool bPipelined );
+        bool getPipelinedFrames() const { return mPipelinedFrames; }
+
+        /// How many frames the GPU may lag behind the CPU (VaoManager's dynamic buffer
+        /// multiplier). 0 (default) keeps the RenderSystem's default, usually 3.
+        /// Must be called before initialize.
+        void        setMaxFramesInFlight( Ogre::uint8 numFrames ) { mMaxFramesInFlight = numFrames; }
+        Ogre::uint8 getMaxFramesInFlight() const { return mMaxFramesInFlight; }
+
+        /** Runs against Ogre's NULL RenderSystem, without creating a window nor initializing
+            SDL. The whole frame still runs on the CPU (scene graph update, culling, HLMS
+            & command generation) but nothing reaches a GPU, so it works on machines without
+            a GPU nor a display. There's no input; use setMaxFrames to end the run.
+            Must be called before initialize.
+        @remarks
+            The NULL RenderSystem's plugin (RenderSystem_NULL) is loaded if plugins.cfg
+            doesn't list it. Not available in static builds.
+        */
+        void setHeadless( bool bHeadless );
+        bool getHeadless() const { return mHeadless; }
+
+        /// When false, overrides ogre.cfg's VSync setting so rendering isn't capped
+        /// by the monitor's refresh rate. Must be called before initialize.
+        void setVSync( bool bVSync );
+        bool getVSync() const { return mVSync; }
+
+        /// Quits once numFrames frames have been rendered. 0 (default) means no limit.
+        void         setMaxFrames( Ogre::uint64 numFrames ) { mMaxFrames = numFrames; }
+        Ogre::uint64 getMaxFrames() const { return mMaxFrames; }
+
+        /** Writes the timings of every update() call as a CSV row, in microseconds:
+                frame,time_since_last,logic,prepare,submit,prepare_wait,frame_total
+            See FramePipelineStats for what each column measures. 'logic' is whatever
+            was passed to setFrameLogicMicroseconds since the previous frame (only the
+            single threaded loop does). The file is opened in initialize.
+        @param path
+            Empty to disable (default).
+        */
+        void                setFrameTimingsCsv( const Ogre::String &path );
+        const Ogre::String &getFrameTimingsCsv() const { return mFrameTimingsCsvPath; }
+
+        /** Exports the Telemetry percentiles to the given CSV file once per second, from
+            initialize to deinitialize. See Telemetry::setExportFile.
+        @param path
+            Empty to disable (default).
+        */
+        void                setTelemetryCsv( const Ogre::String &path );
+        const Ogre::String &getTelemetryCsv() const { return mTelemetryCsvPath; }
+
+        /** Where captureTrace writes the TraceRecorder's history. A capture is also
+            written there on deinitialize, if the TraceRecorder is enabled.
+        @param path
+            Empty (default) means PrismTrace.json in the write access folder.
+        */
+        void                setTraceCapturePath( const Ogre::String &path ) { mTraceCapturePath = path; }
+        const Ogre::String &getTraceCapturePath() const { return mTraceCapturePath; }
+
+        /// Writes the last TraceRecorder::getNumFrames frames to getTraceCapturePath
+        /// at the start of the next frame. Only works if the TraceRecorder is enabled.
+        void captureTrace();
+
+        /// Time spent in LogicSystem's updates since the last frame, for the CSV.
+        void setFrameLogicMicroseconds( Ogre::uint64 microseconds )
+        {
+            mFrameLogicMicroseconds = microseconds;
+        }
+
+        /// Time from the start of initialize until the first frame was presented, in
+        /// microseconds. That frame is a loading frame if HLMS caches were still being
+        /// compiled. 0 if nothing has been rendered yet.
+        Ogre::uint64 getTimeToFirstFrame() const { return mTimeToFirstFrame; }
+        /// Same as getTimeToFirstFrame, for the first frame that rendered the scene.
+        Ogre::uint64 getTimeToFirstSceneFrame() const { return mTimeToFirstSceneFrame; }
+        /// How long compiling the HLMS disk caches took, in microseconds.
+        Ogre::uint64 getHlmsWarmUpTime() const { return mHlmsWarmUpMicroseconds; }
+
+        const FramePipelineStats &getFramePipelineStats() const { return mFramePipelineStats; }
+        void                      resetFramePipelineStats();
+        /// Dumps getFramePipelineStats' averages to Ogre's log
+        void logFramePipelineStats() const;
+
+        /// Must match LogicSystem::setNumGameEntityBuffers.
+        /// Must be called before the first frame.
+        void         setNumGameEntityBuffers( Ogre::uint32 numBuffers );
+        Ogre::uint32 getNumGameEntityBuffers() const { return mNumGameEntityBuffers; }
+
         Ogre::Root                *getRoot() const { return mRoot; }
         Ogre::Window              *getRenderWindow() const { return mRenderWindow; }
         Ogre::SceneManager        *getSceneManager() const { return mSceneManager; }
@@ -174,6 +584,21 @@ namespace Demo
         Ogre::CompositorWorkspace *getCompositorWorkspace() const { return mWorkspace; }
         Ogre::v1::OverlaySystem   *getOverlaySystem() const { return mOverlaySystem; }
 
+        /// Also dumps the texture metadata cache as textureMetadataCache.json on shutdown,
+        /// for debugging. The binary textureMetadataCache.bin is what gets loaded.
+        void setExportTextureCacheJson( bool bExport ) { mExportTextureCacheJson = bExport; }
+        bool getExportTextureCacheJson() const { return mExportTextureCacheJson; }
+
+        /** Number of threads reading the meshes of new GameEntities in the background,
+            see StreamingSceneLoader. 0 (default) loads them synchronously when they're added.
+            Must be called before initialize.
+        */
+        void   setNumMeshStreamingThreads( size_t numThreads ) { mNumMeshStreamingThreads = numThreads; }
+        size_t getNumMeshStreamingThreads() const { return mNumMeshStreamingThreads; }
+
+        /// Null if meshes are loaded synchronously.
+        StreamingSceneLoader *getStreamingSceneLoader() const { return mStreamingSceneLoader; }
+
         void setAlwaysAskForConfig( bool alwaysAskForConfig );
         bool getAlwaysAskForConfig() const { return mAlwaysAskForConfig; }
 
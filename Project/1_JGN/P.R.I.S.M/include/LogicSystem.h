@@ -3,22 +3,88 @@
 #define _Demo_LogicSystem_H_
 
 #include "BaseSystem.h"
+#include "GameEntity.h"
 #include "OgrePrerequisites.h"
 
 #include <deque>
+#include <random>
 
 namespace Demo
 {
     class GameEntityManager;
+    class JobSystem;
+    class LogicReplay;
 
     class LogicSystem : public BaseSystem
     {
+    public:
+        /// What to do when Logic finishes a frame but Graphics hasn't released any
+        /// transform buffer yet (i.e. Graphics is falling behind).
+        enum BackPressurePolicy
+        {
+            /// Wait for Graphics to release a buffer, up to getMaxBlockMicroseconds.
+            /// If it times out, behaves like BackPressureSkip.
+            /// Only makes sense when Graphics runs in its own thread.
+            BackPressureBlock,
+            /// Don't publish the frame. Graphics keeps interpolating towards the last
+            /// frame it received, and Logic overwrites the same buffer next frame.
+            BackPressureSkip,
+            /// Like BackPressureSkip, but tells Graphics to extrapolate past the last
+            /// frame it received, so motion doesn't freeze.
+            BackPressureExtrapolate
+        };
+
+        /// How often each BackPressurePolicy fired. Use it to size the number of
+        /// buffers (see setNumGameEntityBuffers) against the measured Logic/Graphics skew.
+        struct BackPressureStats
+        {
+            Ogre::uint64 numFramesPublished;
+            Ogre::uint64 numBlocked;
+            Ogre::uint64 numBlockTimeouts;
+            Ogre::uint64 blockedMicroseconds;
+            Ogre::uint64 numSkipped;
+            Ogre::uint64 numExtrapolated;
+        };
+
     protected:
         BaseSystem *       mGraphicsSystem;
         GameEntityManager *mGameEntityManager;
 
+        Ogre::uint32             mNumGameEntityBuffers;
         Ogre::uint32             mCurrentTransformIdx;
         std::deque<Ogre::uint32> mAvailableTransformIdx;
+        bool                     mDirtyTracking;
+        bool                     mFloatingOrigin;
+        /// Latest Mq::CAMERA_MOVED. Where the origin follows with floating origin.
+        WorldPosition mCameraPosition;
+
+        size_t     mNumJobWorkerThreads;
+        JobSystem *mJobSystem;
+
+        BackPressurePolicy mBackPressurePolicy;
+        Ogre::uint64       mMaxBlockMicroseconds;
+        BackPressureStats  mBackPressureStats;
+        /// True while blockUntilTransformIdxAvailable waits. Only LOGICFRAME_FINISHED is
+        /// handled then; everything else is deferred to the next tick.
+        bool mDeferGameStateMessages;
+
+        Ogre::uint32 mRandomSeed;
+        std::mt19937 mRandom;
+
+        LogicReplay *mLogicReplay;
+        /// True while feeding the LogicReplay's recorded inputs to processIncomingMessage
+        bool mInjectingReplayInputs;
+
+        /// InputSnapshot::oldestEventTime of the oldest input received this tick. 0 if none.
+        /// Sent back in Mq::INPUT_CONSUMED
+        Ogre::uint64 mOldestInputTime;
+
+        void resetTransformIndices();
+
+        /// Waits for Graphics to release a transform buffer. Returns false on timeout.
+        /// The tick has already ended, so other messages that arrive meanwhile are
+        /// processed at the beginning of the next one.
+        bool blockUntilTransformIdxAvailable();
 
         /// @see MessageQueueSystem::processIncomingMessage
         void processIncomingMessage( Mq::MessageId messageId, const void *data ) override;
@@ -27,9 +93,89 @@ namespace Demo
         LogicSystem( GameState *gameState );
         ~LogicSystem() override;
 
+        void initialize() override;
+        void deinitialize() override;
+
+        /** Number of worker threads the JobSystem spawns, not counting the Logic thread
+            (which also runs jobs while it waits for them). Default is 0, i.e. all jobs run
+            serially in the Logic thread. See JobSystem::partitionCores.
+            Must be called before initialize.
+        */
+        void   setNumJobWorkerThreads( size_t numWorkerThreads );
+        size_t getNumJobWorkerThreads() const { return mNumJobWorkerThreads; }
+
+        /// GameStates can use it during update to run their simulation in parallel.
+        /// Only valid between initialize and deinitialize.
+        JobSystem *getJobSystem() { return mJobSystem; }
+
+        /** Sets how many transform buffers are shared between Logic & Graphics.
+            More buffers tolerate more skew between both threads, at the cost of latency
+            and memory. Must match GraphicsSystem::setNumGameEntityBuffers, and must be
+            called before the GameEntityManager is created.
+        @param numBuffers
+            Range [MIN_GAME_ENTITY_BUFFERS; MAX_GAME_ENTITY_BUFFERS].
+            Default is DEFAULT_GAME_ENTITY_BUFFERS. See clampNumGameEntityBuffers
+        */
+        void         setNumGameEntityBuffers( Ogre::uint32 numBuffers );
+        Ogre::uint32 getNumGameEntityBuffers() const { return mNumGameEntityBuffers; }
+
+        /// Clamps a user-provided number of buffers (e.g. from the command line)
+        /// to the range setNumGameEntityBuffers accepts.
+        static Ogre::uint32 clampNumGameEntityBuffers( long numBuffers );
+
+        /** When enabled, GameStates must call GameEntityManager::markDirty (or use
+            GameEntityManager::setTransform) for every dynamic GameEntity whose transform
+            they write, and only those are published as changed; Graphics doesn't interpolate
+            the rest. Worth it when most dynamic entities sit still on any given tick.
+            Default is false: every dynamic GameEntity is assumed to change every tick.
+            Must match GraphicsSystem::setDirtyTracking, and must be called before the
+            GameEntityManager is created.
+        */
+        void setDirtyTracking( bool bDirtyTracking );
+        bool getDirtyTracking() const { return mDirtyTracking; }
+
+        /** When enabled, GameEntity positions are double precision (see
+            GameEntityManager::setWorldPosition) and the transforms published to Graphics
+            are relative to an origin that follows the camera (see
+            GameEntityManager::updateOrigin), so huge worlds don't jitter far away from
+            (0, 0, 0). Default is false.
+            Must match GraphicsSystem::setFloatingOrigin, and must be called before the
+            GameEntityManager is created.
+        */
+        void setFloatingOrigin( bool bFloatingOrigin );
+        bool getFloatingOrigin() const { return mFloatingOrigin; }
+
+        /// Default is BackPressureSkip
+        void setBackPressurePolicy( BackPressurePolicy policy ) { mBackPressurePolicy = policy; }
+        BackPressurePolicy getBackPressurePolicy() const { return mBackPressurePolicy; }
+
+        /// Max time BackPressureBlock waits for Graphics. Default is 100ms.
+        void setMaxBlockMicroseconds( Ogre::uint64 microseconds )
+        {
+            mMaxBlockMicroseconds = microseconds;
+        }
+        Ogre::uint64 getMaxBlockMicroseconds() const { return mMaxBlockMicroseconds; }
+
+        const BackPressureStats &getBackPressureStats() const { return mBackPressureStats; }
+        void                     resetBackPressureStats();
+        /// Dumps getBackPressureStats to Ogre's log
+        void logBackPressureStats() const;
+
         void _notifyGraphicsSystem( BaseSystem *graphicsSystem ) { mGraphicsSystem = graphicsSystem; }
         void _notifyGameEntityManager( GameEntityManager *mgr ) { mGameEntityManager = mgr; }
 
+        /// Sets the seed getRandom is initialized with. Must be called before initialize.
+        void         setRandomSeed( Ogre::uint32 seed );
+        Ogre::uint32 getRandomSeed() const { return mRandomSeed; }
+
+        /// Logic GameStates must draw their random numbers from here for the simulation
+        /// to be reproducible (see LogicReplay). Reseeded with getRandomSeed in initialize.
+        std::mt19937 &getRandom() { return mRandom; }
+
+        /// See LogicReplay::attach
+        void _setLogicReplay( LogicReplay *logicReplay ) { mLogicReplay = logicReplay; }
+
+        void beginFrameParallel();
         void finishFrameParallel();
 
         GameEntityManager *getGameEntityManager() { return mGameEntityManager; }
@@ -25,8 +25,36 @@
 #        pragma GCC diagnostic pop
 #    endif
 
+namespace Ogre
+{
+    class Timer;
+}
+
 namespace Demo
 {
+    /** What Graphics sends to Logic in Mq::SDL_EVENT: the input events of a frame, after
+        merging the ones that only matter for their accumulated result:
+            * Consecutive SDL_MOUSEMOTION: relative motion is added up, the rest is
+              taken from the newest.
+            * Consecutive SDL_MOUSEWHEEL and SDL_JOYAXISMOTION (same axis).
+            * SDL_KEYDOWN repeats of a key that already has a repeat in the snapshot.
+        Events that change state (buttons, keys, text) are never merged, nor is motion
+        merged across them, so ordering is preserved (i.e. drags).
+        If a frame has more than cMaxEvents events after merging, more snapshots are sent.
+    */
+    struct InputSnapshot
+    {
+        static const Ogre::uint32 cMaxEvents = 16u;
+
+        /// When the oldest event in the snapshot happened, in Graphics' Root timer
+        /// microseconds. Logic returns it in Mq::INPUT_CONSUMED to measure the latency.
+        Ogre::uint64 oldestEventTime;
+        Ogre::uint32 numEvents;
+        /// Number of events that were merged into the ones in events[].
+        Ogre::uint32 numCoalesced;
+        SDL_Event    events[cMaxEvents];
+    };
+
     class MouseListener;
     class KeyboardListener;
     class JoystickListener;
@@ -64,6 +92,18 @@ namespace Demo
         int  mWarpY;
         bool mWarpCompensate;
 
+        /// See _setLogicSystem
+        Ogre::Timer  *mTimer;
+        InputSnapshot mInputSnapshot;
+        /// SDL_GetTicks timestamp of the oldest event in mInputSnapshot.
+        Ogre::uint32 mOldestEventTicks;
+        Ogre::uint64 mNumEventsForwarded;
+        Ogre::uint64 mNumEventsCoalesced;
+        Ogre::uint64 mNumSnapshotsSent;
+
+        /// Adds the event to mInputSnapshot, merging it if possible.
+        void forwardToLogic( const SDL_Event &evt );
+
         void updateMouseSettings();
 
         void handleWindowEvent( const SDL_Event &evt );
@@ -85,6 +125,24 @@ namespace Demo
 
         void _handleSdlEvents( const SDL_Event &evt );
 
+        /** Input events will be forwarded to logicSystem as well, see InputSnapshot.
+        @param graphicsSystem
+            The system that owns us. Messages are sent from it.
+        @param timer
+            To timestamp the events, Root's.
+        */
+        void _setLogicSystem( BaseSystem *graphicsSystem, BaseSystem *logicSystem,
+                              Ogre::Timer *timer );
+
+        /// Sends what _handleSdlEvents gathered this frame to Logic.
+        /// Call it once per frame, after all the events have been handled.
+        void _flushInputToLogic();
+
+        /// Ratio of events that got merged tells how well coalescing works.
+        Ogre::uint64 getNumEventsForwarded() const { return mNumEventsForwarded; }
+        Ogre::uint64 getNumEventsCoalesced() const { return mNumEventsCoalesced; }
+        Ogre::uint64 getNumSnapshotsSent() const { return mNumSnapshotsSent; }
+
         /// Locks the pointer to the window
         void setGrabMousePointer( bool grab );
 
@@ -0,0 +1,153 @@
+
+#ifndef _Demo_LogicReplay_H_
+#define _Demo_LogicReplay_H_
+
+#include "OgrePrerequisites.h"
+
+#include "Threading/MqMessages.h"
+
+#include "OgreTimer.h"
+
+#include <vector>
+
+namespace Demo
+{
+    class GameEntityManager;
+    class LogicSystem;
+
+    /** Records everything that feeds LogicSystem's ticks (the random seed, the fixed
+        timestep and the input messages received each tick) so the exact same simulation
+        can be replayed later, as fast as possible. After every tick the transforms of all
+        GameEntities are hashed (GameEntityManager::hashTransforms); on playback each hash
+        is compared against the recorded one, proving an optimization didn't change results.
+    @remarks
+        Usage:
+            To record:
+                --logic_record=/home/username/Ogre/run.replay
+            To playback:
+                --logic_playback=/home/username/Ogre/run.replay
+            Combine playback with --headless to benchmark the logic path on its own.
+    @par
+        Logic GameStates must be deterministic given their inputs: they must draw random
+        numbers from LogicSystem::getRandom and not from the wall clock.
+        While recording or playing back, LogicSystem blocks instead of skipping frames
+        (see LogicSystem::BackPressurePolicy), so the previous frame's transforms a tick
+        reads from never depend on timing.
+        Because of that, mainAppSingleThreaded runs exactly one logic tick per graphics
+        frame while recording instead of catching up: a second tick in the same frame
+        would wait for a transform buffer that Graphics can't release until it renders. If
+        rendering is slower than MainEntryPoints::Frametime, the simulation runs slower
+        than real time while recording. On playback, ticks aren't paced.
+        Input messages are delivered at the start of the tick they arrived in.
+    */
+    class LogicReplay
+    {
+    public:
+        enum Mode
+        {
+            ModeOff,
+            ModeRecord,
+            ModePlayback
+        };
+
+        struct Stats
+        {
+            Ogre::uint64 numTicks;
+            Ogre::uint64 numMismatches;
+            /// Only valid if numMismatches > 0
+            Ogre::uint64 firstMismatchTick;
+            /// Time spent inside the ticks, excluding hashing
+            Ogre::uint64 tickMicroseconds;
+        };
+
+    protected:
+        struct InputMessage
+        {
+            Ogre::uint32 messageId;
+            Ogre::uint32 size;
+            /// Into mInputData
+            size_t offset;
+        };
+
+        struct Tick
+        {
+            Ogre::uint64 stateHash;
+            /// Range into mInputMessages
+            size_t firstInput;
+            size_t numInputs;
+        };
+
+        Mode         mMode;
+        Ogre::String mPath;
+        Ogre::uint32 mRandomSeed;
+        double       mFrametime;
+
+        std::vector<Tick>          mTicks;
+        std::vector<InputMessage>  mInputMessages;
+        std::vector<unsigned char> mInputData;
+
+        /// Tick we're currently running.
+        size_t mCurrentTick;
+        /// Recording: first input of mCurrentTick, i.e. the first one received
+        /// after the previous tick ended
+        size_t mCurrentTickFirstInput;
+
+        Ogre::Timer  mTimer;
+        Ogre::uint64 mTickStart;
+        Stats        mStats;
+
+        /// Prints why to stderr and returns false if the file can't be played back.
+        bool load();
+        void save() const;
+
+    public:
+        LogicReplay();
+
+        /** Looks for --logic_record=path and --logic_playback=path, and loads the
+            recording to play back. Doesn't need Ogre to be initialized.
+        @return
+            False if the recording couldn't be loaded; the reason is printed to stderr.
+        */
+        bool parseCmdLine( int nargs, const char *const *argv );
+
+        Mode getMode() const { return mMode; }
+        bool isActive() const { return mMode != ModeOff; }
+        bool isRecording() const { return mMode == ModeRecord; }
+        bool isPlayback() const { return mMode == ModePlayback; }
+
+        /** Hooks into logicSystem. Must be called after createSystems and before
+            LogicSystem::initialize.
+            When playing back, the recorded seed is applied to logicSystem, and
+            getFrametime returns the recorded timestep, which the main loop must use.
+        @param frametime
+            The timestep in use. Saved when recording.
+        */
+        void attach( LogicSystem *logicSystem, double frametime );
+
+        double getFrametime() const { return mFrametime; }
+
+        /// All the recorded ticks have been played back.
+        bool isPlaybackFinished() const
+        {
+            return mMode == ModePlayback && mCurrentTick >= mTicks.size();
+        }
+
+        /// Called by LogicSystem when a tick starts.
+        void _beginTick();
+        /// Called by LogicSystem for every input message it receives while recording.
+        void _recordInput( Mq::MessageId messageId, const void *data, size_t size );
+        /// Playback: number of input messages to inject in the current tick.
+        size_t _getNumTickInputs() const;
+        /// Playback: idx in range [0; _getNumTickInputs)
+        const void *_getTickInput( size_t idx, Mq::MessageId &outMessageId ) const;
+        /// Called by LogicSystem once the tick has written its transforms.
+        void _endTick( const GameEntityManager *gameEntityManager, size_t transformIdx );
+
+        const Stats &getStats() const { return mStats; }
+
+        /// Saves the recording if we were recording, and logs getStats.
+        void finish();
+    };
+}  // namespace Demo
+
+#endif
@@ -111,6 +111,95 @@ namespace Demo
         /// physics at 60hz; set it to Frametime = 1 / 60.0). The default is 60hz
         static double Frametime;
 
+        /// When true (default), mainAppMultiThreaded connects GraphicsSystem and LogicSystem
+        /// through lock-free rings (see MessageQueueSystem::connectSpscTransport) instead of
+        /// the mutex-protected message queues.
+        static bool UseSpscMessageTransport;
+
+        /// mainAppMultiThreaded's Logic thread waits for the next tick with a FramePacer.
+        /// See FramePacer::setMaxJitterMicroseconds. Default is 250us.
+        static Ogre::uint64 MaxFrameJitterMicroseconds;
+        /// See FramePacer::setSleepEnabled. Default is true.
+        static bool FrameSleepEnabled;
+
+        /** Splits the cores between SceneManager's threads and LogicSystem's JobSystem
+            (see JobSystem::partitionCores). Must be called right after createSystems.
+                --job-workers=N
+                    Overrides the number of JobSystem worker threads.
+        @param bMultithreaded
+            True if Logic & Graphics run in different threads.
+        */
+        static void applyCoreSettings( int nargs, const char *const *argv,
+                                       GraphicsSystem *graphicsSystem, LogicSystem *logicSystem,
+                                       bool bMultithreaded );
+
+        /** Looks in the command line for the settings that control the logic -> graphics
+            -> GPU frame queue, and applies them to both systems. Must be called right after
+            createSystems, before any GameEntityManager is created.
+                --game-entity-buffers=N
+                    See LogicSystem::setNumGameEntityBuffers. Range [4; 8]
+                --back-pressure=block|skip|extrapolate
+                    See LogicSystem::setBackPressurePolicy
+                --pipelined-frames
+                    See GraphicsSystem::setPipelinedFrames
+                --frames-in-flight=N
+                    See GraphicsSystem::setMaxFramesInFlight
+                --max-frame-jitter-us=N
+                    Sets MaxFrameJitterMicroseconds
+                --no-frame-sleep
+                    Sets FrameSleepEnabled = false
+                --dirty-tracking
+                    See LogicSystem::setDirtyTracking
+                --floating-origin
+                    See LogicSystem::setFloatingOrigin
+        @param bMultithreaded
+            When false, 'block' is treated as 'skip' since there's no graphics thread
+            that could unblock us.
+        */
+        static void applyFrameQueueSettings( int nargs, const char *const *argv,
+                                             GraphicsSystem *graphicsSystem,
+                                             LogicSystem *logicSystem, bool bMultithreaded );
+
+        /** Looks in the command line for the settings used to benchmark without a GPU nor a
+            display (e.g. on CI machines). Must be called right after createSystems.
+                --headless
+                    See GraphicsSystem::setHeadless. Implies --no-vsync and writes the frame
+                    timings to FrameTimings.csv in the write access folder, unless
+                    --frame-timings-csv says otherwise.
+                --frames=N
+                    See GraphicsSystem::setMaxFrames
+                --no-vsync
+                    See GraphicsSystem::setVSync
+                --frame-timings-csv=path
+                    See GraphicsSystem::setFrameTimingsCsv
+        */
+        static void applyHeadlessSettings( int nargs, const char *const *argv,
+                                           GraphicsSystem *graphicsSystem );
+
+        /** Looks in the command line for the settings of the on-disk caches & resource loading.
+            Must be called right after createSystems.
+                --texture-cache-json
+                    See GraphicsSystem::setExportTextureCacheJson
+                --mesh-streaming-threads=N
+                    See GraphicsSystem::setNumMeshStreamingThreads
+        */
+        static void applyCacheSettings( int nargs, const char *const *argv,
+                                        GraphicsSystem *graphicsSystem );
+
+        /** Looks in the command line for the Telemetry & TraceRecorder settings. Must be
+            called right after createSystems.
+                --no-telemetry
+                    See Telemetry::setEnabled
+                --telemetry-csv=path
+                    See GraphicsSystem::setTelemetryCsv
+                --trace-frames=N
+                    See TraceRecorder::setNumFrames. Off by default.
+                --trace-file=path
+                    See GraphicsSystem::setTraceCapturePath
+        */
+        static void applyTelemetrySettings( int nargs, const char *const *argv,
+                                            GraphicsSystem *graphicsSystem );
+
 #if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
         static INT WINAPI mainAppSingleThreaded( HINSTANCE hInst, HINSTANCE hPrevInstance,
                                                  LPSTR strCmdLine, INT nCmdShow );
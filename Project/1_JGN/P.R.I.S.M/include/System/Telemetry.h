@@ -0,0 +1,154 @@
+
+#ifndef _Demo_Telemetry_H_
+#define _Demo_Telemetry_H_
+
+#include "OgrePrerequisites.h"
+
+#include <atomic>
+
+/// Define to 0 to compile the telemetry out. Recording becomes a no-op.
+#ifndef PRISM_TELEMETRY
+#    define PRISM_TELEMETRY 1
+#endif
+
+namespace Demo
+{
+    /** Process-wide frame time & latency telemetry. Any thread can record samples; the
+        render thread aggregates them into percentiles for the debug overlay and
+        periodically appends them to a CSV file.
+    @remarks
+        Each thread writes its samples into its own lock-free single producer ring, created
+        on its first sample. Recording never locks nor allocates after that. If the render
+        thread doesn't drain a ring in time, new samples are dropped (see getNumDroppedSamples).
+    @par
+        Percentiles are computed from the last cHistorySize samples of each Metric, every
+        cAggregateMicroseconds, so they're not computed every frame.
+    @par
+        While disabled (see setEnabled), recording costs one relaxed atomic load.
+        With PRISM_TELEMETRY == 0 it costs nothing.
+    */
+    class Telemetry
+    {
+    public:
+        enum Metric
+        {
+            /// Whole Logic tick, without the wait for the next one. Microseconds.
+            LogicTick,
+            /// Logic's GameState::update. Microseconds.
+            LogicUpdate,
+            /// Bytes of messages Logic received per tick.
+            LogicQueueDepth,
+            /// Time Logic waited for Graphics to release a transform buffer.
+            /// 0 if it didn't have to. Microseconds.
+            TransformStall,
+            /// GameEntityManager::finishFrameParallel. Microseconds.
+            GameEntityFinish,
+            /// Whole render loop iteration. Microseconds.
+            RenderFrame,
+            /// Graphics' GameState::update. Microseconds.
+            RenderUpdate,
+            /// CPU time preparing the frame (see GraphicsSystem::FramePipelineStats).
+            RenderPrepare,
+            /// CPU time submitting the frame to the GPU. Microseconds.
+            RenderSubmit,
+            /// GraphicsSystem::updateGameEntities. Microseconds.
+            RenderInterpolate,
+            /// Bytes of messages Graphics received per frame.
+            RenderQueueDepth,
+            /// From a logic frame arriving to the frame that shows it being submitted.
+            LogicToSubmitLatency,
+            /// From an input event to the frame that shows its effects being submitted.
+            InputToSubmitLatency,
+            NumMetrics
+        };
+
+        struct Percentiles
+        {
+            Ogre::uint32 p50;
+            Ogre::uint32 p95;
+            Ogre::uint32 p99;
+            Ogre::uint32 max;
+            /// How many samples the percentiles were computed from.
+            Ogre::uint32 numSamples;
+        };
+
+        /// Samples per Metric the percentiles are computed from.
+        static const size_t cHistorySize = 1024u;
+        static const Ogre::uint64 cAggregateMicroseconds = 500000u;
+
+        /// Measures the lifetime of the object.
+        class ScopedSample
+        {
+            Metric       mMetric;
+            Ogre::uint64 mStart;
+
+        public:
+            ScopedSample( Metric metric ) : mMetric( metric ), mStart( isEnabled() ? now() : 0u ) {}
+            ~ScopedSample()
+            {
+                if( mStart )
+                    record( mMetric, now() - mStart );
+            }
+        };
+
+    protected:
+        static std::atomic<bool> msEnabled;
+
+        static void pushSample( Metric metric, Ogre::uint64 value );
+
+    public:
+        /// Default is true. Can be toggled at any time, from any thread.
+        static void setEnabled( bool bEnabled );
+        static bool isEnabled()
+        {
+#if PRISM_TELEMETRY
+            return msEnabled.load( std::memory_order_relaxed );
+#else
+            return false;
+#endif
+        }
+
+        /// Can be called from any thread.
+        static void record( Metric metric, Ogre::uint64 value )
+        {
+            if( isEnabled() )
+                pushSample( metric, value );
+        }
+
+        /// Microseconds, from a clock shared by all threads.
+        static Ogre::uint64 now();
+
+        /** Drains the rings & recomputes the percentiles when due. Writes to the export
+            file when due. Must be called from one thread only, once per frame
+            (GraphicsSystem::update does it).
+        */
+        static void update();
+
+        /// Only valid in the thread that calls update.
+        static const Percentiles &getPercentiles( Metric metric );
+
+        static const char *getMetricName( Metric metric );
+        /// "us" or "bytes"
+        static const char *getMetricUnits( Metric metric );
+
+        /** Appends the percentiles of every Metric to a CSV file every intervalMicroseconds.
+            The file is overwritten. Call from the thread that calls update.
+        @param path
+            Empty to stop exporting.
+        */
+        static void setExportFile( const Ogre::String &path,
+                                   Ogre::uint64 intervalMicroseconds = 1000000u );
+
+        /// Text for the debug overlay: one line per Metric with samples.
+        static void generateOverlayText( Ogre::String &outText );
+
+        /// Samples lost because a ring was full, across all threads.
+        static Ogre::uint64 getNumDroppedSamples();
+
+        /// Aggregates what's left, writes the last export row and closes the file.
+        /// Dumps the percentiles to Ogre's log.
+        static void shutdown();
+    };
+}  // namespace Demo
+
+#endif
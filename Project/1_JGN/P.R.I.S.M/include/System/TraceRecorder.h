@@ -0,0 +1,88 @@
+
+#ifndef _Demo_TraceRecorder_H_
+#define _Demo_TraceRecorder_H_
+
+#include "OgrePrerequisites.h"
+
+#include <atomic>
+
+namespace Demo
+{
+    /** Flight recorder that keeps the last N frames of what every PRISM thread was doing,
+        and writes them on demand in the Trace Event Format, so that captures can be opened
+        in chrome://tracing or Perfetto's timeline and cross-thread overlap becomes visible.
+    @remarks
+        Works like Telemetry: each thread writes its events into its own lock-free ring,
+        and the thread calling update (the render thread) drains them into a history,
+        discarding events older than the last getNumFrames frames.
+    @par
+        When Ogre is built with OGRE_PROFILING_INTERNAL_OFFLINE, the OfflineProfiler's
+        samples (which include SceneManager's worker threads) are merged into the capture,
+        aligned to our clock. Unlike ours, those span the whole session, since
+        OfflineProfiler doesn't discard old samples.
+    @par
+        Disabled by default (see setNumFrames). While disabled, a ScopedEvent costs one
+        relaxed atomic load.
+    */
+    class TraceRecorder
+    {
+    public:
+        /// Records an event lasting the object's lifetime.
+        class ScopedEvent
+        {
+            const char  *mName;
+            Ogre::uint64 mStart;
+
+        public:
+            /// name must outlive the TraceRecorder (i.e. use a string literal)
+            ScopedEvent( const char *name ) : mName( name ), mStart( isEnabled() ? now() : 0u ) {}
+            ~ScopedEvent()
+            {
+                if( mStart )
+                    record( mName, mStart, now() );
+            }
+        };
+
+    protected:
+        static std::atomic<bool> msEnabled;
+
+    public:
+        /** How many frames the history keeps. 0 disables recording (default).
+            Call from the thread that calls update.
+        */
+        static void   setNumFrames( size_t numFrames );
+        static size_t getNumFrames();
+
+        static bool isEnabled() { return msEnabled.load( std::memory_order_relaxed ); }
+
+        /// Name the calling thread will have in captures.
+        static void setThreadName( const Ogre::String &name );
+
+        /** Records an event of the calling thread. Events of a thread must be recorded
+            in the order they end (ScopedEvent takes care of it).
+        @param name
+            Must outlive the TraceRecorder (i.e. use a string literal)
+        @param start, end
+            In microseconds, as returned by now()
+        */
+        static void record( const char *name, Ogre::uint64 start, Ogre::uint64 end );
+
+        /// Microseconds, from a clock shared by all threads.
+        static Ogre::uint64 now();
+
+        /** Starts a new frame: drains the rings, discards events older than getNumFrames
+            frames & writes the pending capture, if any. Must be called from one thread
+            only, once per frame (GraphicsSystem::update does it).
+        */
+        static void update();
+
+        /// The history is written to 'path' (a .json file) in the next update.
+        /// Can be called from any thread.
+        static void requestCapture( const Ogre::String &path );
+
+        /// Writes the history to 'path' right away. Call from the thread that calls update.
+        static void capture( const Ogre::String &path );
+    };
+}  // namespace Demo
+
+#endif
@@ -0,0 +1,92 @@
+
+#ifndef _Demo_FramePacer_H_
+#define _Demo_FramePacer_H_
+
+#include "OgrePrerequisites.h"
+
+namespace Ogre
+{
+    class Timer;
+}
+
+namespace Demo
+{
+    /** Waits until the next fixed timestep tick. Sleeps with the OS' high resolution timers
+        for most of the interval and only spins (yielding) for the last slice, whose length
+        is calibrated from how much the OS oversleeps.
+    @remarks
+        Ticks are scheduled on a fixed grid (startTime + frameTime), so overshooting one
+        tick doesn't delay the following ones. If we fall more than a whole frame behind,
+        the grid is reset to the current time.
+    */
+    class FramePacer
+    {
+    public:
+        struct Stats
+        {
+            Ogre::uint64 numFrames;
+            /// Frames whose deadline had already passed when wait was called.
+            Ogre::uint64 numLateFrames;
+            /// Frames that woke up later than getMaxJitterMicroseconds after the deadline.
+            Ogre::uint64 numJitterViolations;
+            /// How late we woke up after the deadline. Sum and max.
+            Ogre::uint64 overshootMicroseconds;
+            Ogre::uint64 maxOvershootMicroseconds;
+            Ogre::uint64 sleptMicroseconds;
+            Ogre::uint64 spunMicroseconds;
+        };
+
+    protected:
+        Ogre::Timer *mTimer;
+        /// Win32 only. High resolution waitable timer used by sleepMicroseconds,
+        /// created once since it's used every frame. Null if unavailable.
+        void *mWaitableTimer;
+
+        bool         mSleepEnabled;
+        Ogre::uint64 mMaxJitterMicroseconds;
+        Ogre::uint64 mMinSpinMicroseconds;
+        /// How much the OS has been oversleeping lately. Decays slowly, and never goes
+        /// above a fraction of the frame.
+        double mSleepOvershootEstimate;
+
+        Stats mStats;
+
+        /// Sleeps for about 'microseconds'. Platform specific.
+        void sleepMicroseconds( Ogre::uint64 microseconds );
+
+    public:
+        FramePacer( Ogre::Timer *timer );
+        ~FramePacer();
+
+        /** Waits until startTime + frameTime.
+        @param frameTime
+            In seconds. Typically MainEntryPoints::Frametime
+        @param startTime
+            In microseconds, as returned by the Timer. Start of the current tick.
+        @return
+            The start of the next tick, to be passed in the next call.
+        */
+        Ogre::uint64 wait( double frameTime, Ogre::uint64 startTime );
+
+        /// When false, never sleeps and spins for the whole interval, trading CPU usage
+        /// for the lowest jitter. Default is true.
+        void setSleepEnabled( bool bEnabled ) { mSleepEnabled = bEnabled; }
+        bool getSleepEnabled() const { return mSleepEnabled; }
+
+        /** How late we tolerate waking up after the deadline. Whenever it's exceeded, the
+            spin slice grows to absorb it. Smaller values spin more. Default is 250us.
+        */
+        void         setMaxJitterMicroseconds( Ogre::uint64 microseconds );
+        Ogre::uint64 getMaxJitterMicroseconds() const { return mMaxJitterMicroseconds; }
+
+        /// Length of the slice we'll spin for at the end of the next tick.
+        Ogre::uint64 getSpinMicroseconds() const;
+
+        const Stats &getStats() const { return mStats; }
+        void         resetStats();
+        /// Dumps getStats to Ogre's log
+        void logStats() const;
+    };
+}  // namespace Demo
+
+#endif
@@ -0,0 +1,186 @@
+
+#ifndef _Demo_JobSystem_H_
+#define _Demo_JobSystem_H_
+
+#include "OgrePrerequisites.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Demo
+{
+    class JobSystem;
+
+    /** Counts jobs that haven't finished yet. Pass it to JobSystem::submit and
+        JobSystem::wait on it. Must outlive the jobs it tracks.
+    */
+    class JobCounter
+    {
+        friend class JobSystem;
+        std::atomic<size_t> mPending;
+
+    public:
+        JobCounter() : mPending( 0 ) {}
+        bool isDone() const { return mPending.load( std::memory_order_acquire ) == 0u; }
+    };
+
+    /** A set of jobs and the dependencies between them. A job runs once all the jobs it
+        depends on have finished. Build it once and run it every frame with JobSystem::run.
+    @remarks
+        Not thread safe. Don't modify it while JobSystem::run is executing it.
+    */
+    class JobGraph
+    {
+        friend class JobSystem;
+
+    public:
+        /// threadIdx is in range [0; JobSystem::getNumThreads)
+        typedef std::function<void( size_t threadIdx )> JobFunc;
+
+    protected:
+        struct Node
+        {
+            JobFunc             func;
+            std::vector<size_t> successors;
+            size_t              numDependencies;
+            std::atomic<size_t> pendingDependencies;
+
+            Node( const JobFunc &_func ) :
+                func( _func ),
+                numDependencies( 0 ),
+                pendingDependencies( 0 )
+            {
+            }
+            Node( const Node &other ) :
+                func( other.func ),
+                successors( other.successors ),
+                numDependencies( other.numDependencies ),
+                pendingDependencies( 0 )
+            {
+            }
+        };
+
+        std::vector<Node> mNodes;
+
+    public:
+        /// Returns the job's handle, to be used with addDependency.
+        size_t addJob( const JobFunc &func );
+
+        /// jobIdx won't start until dependsOnIdx has finished.
+        void addDependency( size_t jobIdx, size_t dependsOnIdx );
+
+        size_t getNumJobs() const { return mNodes.size(); }
+    };
+
+    /** Work stealing scheduler. Each worker has its own queue; jobs pushed by a worker go
+        to its own queue and idle workers steal from the opposite end of the others'.
+    @remarks
+        The thread that owns the JobSystem (i.e. Logic's) isn't a worker, but it takes
+        part in the work while it waits inside wait(), parallelFor() & run(), as thread 0.
+        Thus getNumThreads() == numWorkerThreads + 1 and numWorkerThreads = 0 runs
+        everything serially in the calling thread.
+    @par
+        Idle workers sleep on a condition variable, so a JobSystem only uses CPU while
+        there's work. Nonetheless if the work overlaps with Ogre's SceneManager
+        worker threads (i.e. Logic and Graphics in different threads), see partitionCores
+        to avoid having more busy threads than cores.
+    @par
+        Only the owner thread and the jobs themselves may submit work.
+    */
+    class JobSystem
+    {
+    public:
+        typedef std::function<void( size_t threadIdx )> JobFunc;
+        /// Processes elements in range [begin; end)
+        typedef std::function<void( size_t begin, size_t end, size_t threadIdx )> RangeFunc;
+
+    protected:
+        struct Job
+        {
+            void ( *execute )( JobSystem *jobSystem, const Job &job, size_t threadIdx );
+            const void *userData;
+            size_t      begin;
+            size_t      end;
+            JobCounter *counter;
+        };
+
+        /// Mutex-protected deque. Jobs are tiny and contention only happens
+        /// when stealing, so a lock is cheap enough.
+        struct WorkQueue
+        {
+            std::mutex      mutex;
+            std::deque<Job> jobs;
+        };
+
+        std::vector<WorkQueue *> mQueues;
+        std::vector<std::thread> mWorkers;
+
+        std::atomic<size_t>     mNumQueuedJobs;
+        std::mutex              mWakeMutex;
+        std::condition_variable mWakeCondition;
+        bool                    mQuit;
+
+        /// Index of the queue the current thread owns. 0 if it's not one of our workers.
+        size_t getCurrentThreadIdx() const;
+
+        void push( const Job &job, size_t threadIdx );
+        void pushBatch( const Job *jobs, size_t numJobs, size_t threadIdx );
+        bool tryPop( size_t threadIdx, Job &outJob );
+        bool trySteal( size_t threadIdx, Job &outJob );
+        /// Runs one job, if there's any. Returns false if there was nothing to do.
+        bool tryRunOne( size_t threadIdx );
+
+        void workerThread( size_t threadIdx );
+
+        static void executeJobFunc( JobSystem *jobSystem, const Job &job, size_t threadIdx );
+        static void executeRangeFunc( JobSystem *jobSystem, const Job &job, size_t threadIdx );
+        static void executeGraphNode( JobSystem *jobSystem, const Job &job, size_t threadIdx );
+
+    public:
+        JobSystem( size_t numWorkerThreads );
+        ~JobSystem();
+
+        /// Number of threads that execute jobs, i.e. workers + the owner thread.
+        size_t getNumThreads() const { return mQueues.size(); }
+        size_t getNumWorkerThreads() const { return mWorkers.size(); }
+
+        /// Runs func asynchronously. counter gets incremented now and decremented once
+        /// func finishes; use wait( counter ) to sync.
+        void submit( const JobFunc &func, JobCounter *counter );
+
+        /// Runs queued jobs in the calling thread until all jobs tracked by counter are done.
+        void wait( JobCounter *counter );
+
+        /** Splits [begin; end) in chunks of at most grainSize elements and processes them
+            in parallel. Blocks until all of them are done.
+        @param grainSize
+            Max number of elements per job. 0 picks one that creates ~4 jobs per thread.
+            Use big values for cheap per-element work.
+        */
+        void parallelFor( size_t begin, size_t end, size_t grainSize, const RangeFunc &func );
+
+        /// Runs every job in graph respecting its dependencies. Blocks until all are done.
+        void run( JobGraph &graph );
+
+        /** Splits the machine's cores between Ogre's SceneManager threads and the
+            JobSystem, so that when both are busy at the same time (i.e. Logic & Graphics
+            in different threads) there aren't more busy threads than cores.
+        @param bLogicAndGraphicsOverlap
+            True for mainAppMultiThreaded. False for mainAppSingleThreaded, in which case
+            Logic & Graphics take turns and both get all the cores.
+        @param outSceneManagerThreads [out]
+            Value to use for SceneManager's numWorkerThreads (render thread included).
+        @param outJobWorkerThreads [out]
+            Value to use for JobSystem's numWorkerThreads (Logic thread excluded).
+        */
+        static void partitionCores( bool bLogicAndGraphicsOverlap, size_t &outSceneManagerThreads,
+                                    size_t &outJobWorkerThreads );
+    };
+}  // namespace Demo
+
+#endif
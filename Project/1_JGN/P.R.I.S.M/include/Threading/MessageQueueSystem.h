@@ -6,7 +6,9 @@
 #include "OgreCommon.h"
 #include "OgreFastArray.h"
 #include "Threading/OgreLightweightMutex.h"
+#include "Threading/SpscMessageRing.h"
 
+#include <atomic>
 #include <map>
 
 namespace Demo
@@ -20,35 +22,158 @@ namespace Demo
             typedef Ogre::FastArray<unsigned char>               MessageArray;
             typedef std::map<MessageQueueSystem *, MessageArray> PendingMessageMap;
 
+            /// A destination that was paired via connectSpscTransport.
+            struct OutgoingRing
+            {
+                MessageQueueSystem *dstSystem;
+                SpscMessageRing    *ring;
+                /// Messages that didn't fit in the ring. Kept in order and moved into the
+                /// ring on the next flush. While non-empty, new messages must go here too.
+                MessageArray overflow;
+
+                OutgoingRing( MessageQueueSystem *_dstSystem, SpscMessageRing *_ring ) :
+                    dstSystem( _dstSystem ),
+                    ring( _ring )
+                {
+                }
+            };
+
+            typedef Ogre::FastArray<OutgoingRing>      OutgoingRingArray;
+            typedef Ogre::FastArray<SpscMessageRing *> IncomingRingArray;
+
             Ogre::LightweightMutex mMessageQueueMutex;
 
             PendingMessageMap mPendingOutgoingMessages;
             MessageArray      mIncomingMessages[2];
+            /// Set when mIncomingMessages[0] received something, so that
+            /// processIncomingMessages can skip the lock when there's nothing to do.
+            std::atomic<bool> mHasIncomingMessages;
 
-            template <typename T>
-            static void storeMessageToQueue( MessageArray &queue, Mq::MessageId messageId, const T &msg )
+            /// Only a handful of entries (one per connected system). Linear search is
+            /// faster than any map lookup at this size.
+            OutgoingRingArray mOutgoingRings;
+            /// Rings other systems write to. We own them.
+            IncomingRingArray mIncomingRings;
+
+            size_t mNumRingOverflows;
+            /// See getLastIncomingBytes
+            size_t mLastIncomingBytes;
+
+            /// See deferIncomingMessage
+            MessageArray mDeferredMessages;
+
+            /// Writes the header: the Size and the MessageId.
+            /// Returns where the actual message must be written.
+            static unsigned char *writeHeader( unsigned char *dst, size_t totalSize,
+                                               Mq::MessageId messageId )
+            {
+                *reinterpret_cast<Ogre::uint32 *>( dst ) = (Ogre::uint32)totalSize;
+                *reinterpret_cast<Ogre::uint32 *>( dst + sizeof( Ogre::uint32 ) ) = messageId;
+                return dst + cSizeOfHeader;
+            }
+
+            static unsigned char *allocateMessageInQueue( MessageArray &queue, Mq::MessageId messageId,
+                                                          size_t payloadSize,
+                                                          size_t alignment = sizeof( size_t ) )
             {
                 // Save the current offset.
                 const size_t startOffset = queue.size();
 
                 // Enlarge the queue. Preserve alignment.
                 const size_t totalSize =
-                    Ogre::alignToNextMultiple( cSizeOfHeader + sizeof( T ), sizeof( size_t ) );
+                    Ogre::alignToNextMultiple( cSizeOfHeader + payloadSize, alignment );
                 queue.resize( queue.size() + totalSize );
 
-                // Write the header: the Size and the MessageId
-                *reinterpret_cast<Ogre::uint32 *>( queue.begin() + startOffset ) =
-                    (Ogre::uint32)totalSize;
-                *reinterpret_cast<Ogre::uint32 *>( queue.begin() + startOffset +
-                                                   sizeof( Ogre::uint32 ) ) = messageId;
+                return writeHeader( queue.begin() + startOffset, totalSize, messageId );
+            }
+
+            unsigned char *allocateMessageInRing( OutgoingRing &outgoingRing, Mq::MessageId messageId,
+                                                  size_t payloadSize )
+            {
+                // Ring records must be multiple of the header size, so that there's always
+                // room for a padding header at the end of the buffer.
+                const size_t totalSize =
+                    Ogre::alignToNextMultiple( cSizeOfHeader + payloadSize, cSizeOfHeader );
 
-                // Write the actual message.
-                T *dstPtr = reinterpret_cast<T *>( queue.begin() + startOffset + cSizeOfHeader );
-                memcpy( dstPtr, &msg, sizeof( T ) );
+                unsigned char *dst = 0;
+                if( outgoingRing.overflow.empty() )
+                    dst = outgoingRing.ring->reserve( totalSize );
+
+                if( dst )
+                {
+                    // Fast path: the message gets written straight where the consumer reads it.
+                    return writeHeader( dst, totalSize, messageId );
+                }
+
+                if( outgoingRing.overflow.empty() )
+                    ++mNumRingOverflows;
+                return allocateMessageInQueue( outgoingRing.overflow, messageId, payloadSize,
+                                               cSizeOfHeader );
             }
 
+            /// Returns where to write a message of payloadSize bytes that must be sent
+            /// to dstSystem on the next flush.
+            unsigned char *allocateOutgoingMessage( MessageQueueSystem *dstSystem,
+                                                    Mq::MessageId messageId, size_t payloadSize )
+            {
+                OutgoingRing *outgoingRing = findOutgoingRing( dstSystem );
+                if( outgoingRing )
+                    return allocateMessageInRing( *outgoingRing, messageId, payloadSize );
+                return allocateMessageInQueue( mPendingOutgoingMessages[dstSystem], messageId,
+                                               payloadSize );
+            }
+
+            OutgoingRing *findOutgoingRing( MessageQueueSystem *dstSystem )
+            {
+                OutgoingRingArray::iterator itor = mOutgoingRings.begin();
+                OutgoingRingArray::iterator endt = mOutgoingRings.end();
+
+                while( itor != endt && itor->dstSystem != dstSystem )
+                    ++itor;
+
+                return itor != endt ? itor : 0;
+            }
+
+            /// Moves as many whole messages as possible from the overflow queue into the ring.
+            static void drainOverflow( OutgoingRing &outgoingRing );
+
         public:
-            virtual ~MessageQueueSystem() {}
+            MessageQueueSystem();
+            virtual ~MessageQueueSystem();
+
+            /** Switches all messages sent from 'this' to 'dstSystem' to a lock-free
+                single-producer/single-consumer ring, instead of the mutex-protected queue.
+                The ring is owned by 'dstSystem'.
+            @remarks
+                Must be called before 'this' and 'dstSystem' start exchanging messages
+                (i.e. before spawning the threads).
+                It is a one way connection. Call dstSystem->connectSpscTransport( this )
+                as well if you want the replies to go through a ring too.
+            @par
+                Only the thread that owns 'this' may send messages to 'dstSystem' after
+                this call. receiveMessageImmediately still goes through the locked queue.
+            @par
+                Messages are only guaranteed to arrive in the order they were sent within
+                the same transport. processIncomingMessages drains the rings before the
+                locked queue, so a message sent via receiveMessageImmediately (or by a
+                system that isn't connected) may be processed before ring messages that
+                were sent earlier. Don't mix both transports for messages whose order matters.
+            @param dstSystem
+                The MessageQueueSystem we will send messages to.
+            @param capacityBytes
+                Size of the ring. Messages that don't fit are kept in a local overflow
+                queue (see getNumRingOverflows) and retried on the next flush, so this
+                only needs to be large enough for a typical frame's worth of messages.
+            */
+            void connectSpscTransport( MessageQueueSystem *dstSystem, size_t capacityBytes = 1u << 20u );
+
+            /// Number of times a ring ran out of space and messages had to be
+            /// queued in the overflow queue. If this grows steadily, use a bigger ring.
+            size_t getNumRingOverflows() const { return mNumRingOverflows; }
+
+            /// Bytes of messages (headers & padding included) the last call to
+            /// processIncomingMessages went through. I.e. how deep the queues were.
+            size_t getLastIncomingBytes() const { return mLastIncomingBytes; }
 
             /** Queues message 'msg' to be sent to a destination MessageQueueSystem.
                 This function *must* be called from the thread that owns 'this'
@@ -64,28 +189,75 @@ namespace Demo
             template <typename T>
             void queueSendMessage( MessageQueueSystem *dstSystem, Mq::MessageId messageId, const T &msg )
             {
-                storeMessageToQueue( mPendingOutgoingMessages[dstSystem], messageId, msg );
+                unsigned char *dst = allocateOutgoingMessage( dstSystem, messageId, sizeof( T ) );
+                memcpy( dst, &msg, sizeof( T ) );
+            }
+
+            /** Same as queueSendMessage, but sends 'numMsgs' elements as a single message.
+                Use getMessageArray on the receiving end to read them.
+            @remarks
+                When 'dstSystem' is connected via connectSpscTransport, the whole array
+                must fit in the ring. Split big arrays into smaller batches.
+            @param msgs
+                Array of elements. Structure must be POD.
+            @param numMsgs
+                Number of elements in msgs. Can be 0.
+            */
+            template <typename T>
+            void queueSendMessageArray( MessageQueueSystem *dstSystem, Mq::MessageId messageId,
+                                        const T *msgs, size_t numMsgs )
+            {
+                // Elements start after a header-sized slot with the count, to preserve alignment.
+                unsigned char *dst = allocateOutgoingMessage( dstSystem, messageId,
+                                                              cSizeOfHeader + sizeof( T ) * numMsgs );
+                *reinterpret_cast<Ogre::uint32 *>( dst ) = static_cast<Ogre::uint32>( numMsgs );
+                memcpy( dst + cSizeOfHeader, msgs, sizeof( T ) * numMsgs );
+            }
+
+            /// Retrieves the array sent via queueSendMessageArray from the 'data'
+            /// argument of processIncomingMessage
+            template <typename T>
+            static const T *getMessageArray( const void *data, size_t &outNumMsgs )
+            {
+                const unsigned char *src = reinterpret_cast<const unsigned char *>( data );
+                outNumMsgs = *reinterpret_cast<const Ogre::uint32 *>( src );
+                return reinterpret_cast<const T *>( src + cSizeOfHeader );
             }
 
             /// Sends all the messages queued via see queueSendMessage();
             /// Must be called from the thread that owns 'this'
             void flushQueuedMessages()
             {
+                OutgoingRingArray::iterator itRing = mOutgoingRings.begin();
+                OutgoingRingArray::iterator enRing = mOutgoingRings.end();
+
+                while( itRing != enRing )
+                {
+                    if( !itRing->overflow.empty() )
+                        drainOverflow( *itRing );
+                    itRing->ring->publish();
+                    ++itRing;
+                }
+
                 PendingMessageMap::iterator itMap = mPendingOutgoingMessages.begin();
                 PendingMessageMap::iterator enMap = mPendingOutgoingMessages.end();
 
                 while( itMap != enMap )
                 {
-                    MessageQueueSystem *dstSystem = itMap->first;
+                    if( !itMap->second.empty() )
+                    {
+                        MessageQueueSystem *dstSystem = itMap->first;
 
-                    dstSystem->mMessageQueueMutex.lock();
+                        dstSystem->mMessageQueueMutex.lock();
 
-                    dstSystem->mIncomingMessages[0].appendPOD( itMap->second.begin(),
-                                                               itMap->second.end() );
+                        dstSystem->mIncomingMessages[0].appendPOD( itMap->second.begin(),
+                                                                   itMap->second.end() );
+                        dstSystem->mHasIncomingMessages.store( true, std::memory_order_relaxed );
 
-                    dstSystem->mMessageQueueMutex.unlock();
+                        dstSystem->mMessageQueueMutex.unlock();
 
-                    itMap->second.clear();
+                        itMap->second.clear();
+                    }
 
                     ++itMap;
                 }
@@ -98,23 +270,43 @@ namespace Demo
             /// MessageQueueSystem class.
             /// Abusing this function can degrade performance as it would perform
             /// frequent locking. See queueSendMessage
+            /// Not ordered relative to messages received through a ring; see connectSpscTransport
             template <typename T>
             void receiveMessageImmediately( Mq::MessageId messageId, const T &msg )
             {
                 mMessageQueueMutex.lock();
-                storeMessageToQueue( mIncomingMessages[0], messageId, msg );
+                unsigned char *dst =
+                    allocateMessageInQueue( mIncomingMessages[0], messageId, sizeof( T ) );
+                memcpy( dst, &msg, sizeof( T ) );
+                mHasIncomingMessages.store( true, std::memory_order_relaxed );
                 mMessageQueueMutex.unlock();
             }
 
         protected:
             /// Processes all incoming messages received from other threads.
             /// Should be called from the thread that owns 'this'
+            /// Ring messages are processed first, then the locked queue's. Order is only
+            /// preserved within each transport; see connectSpscTransport
             void processIncomingMessages()
             {
+                IncomingRingArray::const_iterator itRing = mIncomingRings.begin();
+                IncomingRingArray::const_iterator enRing = mIncomingRings.end();
+
+                mLastIncomingBytes = 0u;
+                while( itRing != enRing )
+                    mLastIncomingBytes += processIncomingRing( *itRing++ );
+
+                // Clear the flag *before* swapping. If a sender sets it again after our
+                // swap, we'll just pick its messages up next time.
+                if( !mHasIncomingMessages.exchange( false, std::memory_order_relaxed ) )
+                    return;
+
                 mMessageQueueMutex.lock();
                 mIncomingMessages[0].swap( mIncomingMessages[1] );
                 mMessageQueueMutex.unlock();
 
+                mLastIncomingBytes += mIncomingMessages[1].size();
+
                 MessageArray::const_iterator itor = mIncomingMessages[1].begin();
                 MessageArray::const_iterator end = mIncomingMessages[1].end();
 
@@ -136,6 +328,82 @@ namespace Demo
                 mIncomingMessages[1].clear();
             }
 
+            /// Processes all messages published to the given ring. Messages are read
+            /// in place, without copying them out of the ring. Returns the bytes read.
+            size_t processIncomingRing( SpscMessageRing *ring )
+            {
+                const size_t startPos = ring->getReadPos();
+                size_t readPos = startPos;
+                const size_t writePos = ring->getPublishedWritePos();
+
+                while( readPos != writePos )
+                {
+                    const unsigned char *record = ring->getRecordAt( readPos );
+                    Ogre::uint32 totalSize = *reinterpret_cast<const Ogre::uint32 *>( record );
+                    Ogre::uint32 messageId =
+                        *reinterpret_cast<const Ogre::uint32 *>( record + sizeof( Ogre::uint32 ) );
+
+                    assert( totalSize <= writePos - readPos && "SpscMessageRing corrupted!" );
+
+                    if( messageId != SpscMessageRing::cPaddingMessageId )
+                    {
+                        assert( messageId < Mq::NUM_MESSAGE_IDS &&
+                                "SpscMessageRing corrupted or invalid message!" );
+                        processIncomingMessage( static_cast<Mq::MessageId>( messageId ),
+                                                record + cSizeOfHeader );
+                    }
+
+                    readPos += totalSize;
+                }
+
+                ring->release( readPos );
+                return readPos - startPos;
+            }
+
+            /** Copies a message received in processIncomingMessage so that it can be
+                processed later, from processDeferredMessages. Useful when a message
+                can't be handled from the thread that is currently receiving messages.
+            @param data
+                The 'data' argument received in processIncomingMessage
+            */
+            void deferIncomingMessage( const void *data )
+            {
+                const unsigned char *record = reinterpret_cast<const unsigned char *>( data ) -
+                                              cSizeOfHeader;
+                const Ogre::uint32 totalSize = *reinterpret_cast<const Ogre::uint32 *>( record );
+                mDeferredMessages.appendPOD( record, record + totalSize );
+            }
+
+            /// Processes, in order, the messages saved via deferIncomingMessage.
+            void processDeferredMessages()
+            {
+                if( mDeferredMessages.empty() )
+                    return;
+
+                MessageArray deferredMessages;
+                deferredMessages.swap( mDeferredMessages );
+
+                MessageArray::const_iterator itor = deferredMessages.begin();
+                MessageArray::const_iterator end = deferredMessages.end();
+
+                while( itor != end )
+                {
+                    Ogre::uint32 totalSize = *reinterpret_cast<const Ogre::uint32 *>( itor );
+                    Ogre::uint32 messageId =
+                        *reinterpret_cast<const Ogre::uint32 *>( itor + sizeof( Ogre::uint32 ) );
+                    processIncomingMessage( static_cast<Mq::MessageId>( messageId ),
+                                            itor + cSizeOfHeader );
+                    itor += totalSize;
+                }
+
+                // Keep the capacity around for next time.
+                if( mDeferredMessages.empty() )
+                {
+                    deferredMessages.clear();
+                    deferredMessages.swap( mDeferredMessages );
+                }
+            }
+
             /// Derived classes must implement this function to process the incoming message
             virtual void processIncomingMessage( Mq::MessageId messageId, const void *data ) = 0;
         };
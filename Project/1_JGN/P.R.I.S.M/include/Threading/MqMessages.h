@@ -2,6 +2,8 @@
 #ifndef _Mq_MqMessages_H_
 #define _Mq_MqMessages_H_
 
+#include "OgrePlatform.h"
+
 #include <assert.h>
 #include <vector>
 
@@ -15,13 +17,35 @@ namespace Demo
             LOGICFRAME_FINISHED,
             GAME_ENTITY_ADDED,
             GAME_ENTITY_REMOVED,
+            /// Same as GAME_ENTITY_ADDED/REMOVED, sent via queueSendMessageArray
+            GAME_ENTITY_ADDED_BATCH,
+            GAME_ENTITY_REMOVED_BATCH,
+            /// Array of the GameEntities whose transform changed in the logic frame about
+            /// to be sent, via queueSendMessageArray. Only with dirty tracking, see
+            /// GameEntityManager::markDirty
+            GAME_ENTITIES_AWAKE_BATCH,
+            /// GameEntityManager::OriginRebased. See GameEntityManager::updateOrigin
+            ORIGIN_REBASED,
+            /// Ogre::uint64 InputSnapshot::oldestEventTime of the oldest input that went
+            /// into the logic frame about to be sent. For the input to present latency.
+            INPUT_CONSUMED,
             // Graphics <-> Logic
             GAME_ENTITY_SCHEDULED_FOR_REMOVAL_SLOT,
             // Graphics  -> Logic
+            /// An InputSnapshot
             SDL_EVENT,
+            /// WorldPosition of the camera, sent every frame. Only with floating origin,
+            /// see GameEntityManager::updateOrigin
+            CAMERA_MOVED,
 
             NUM_MESSAGE_IDS
         };
+
+        /// Sent in LOGICFRAME_FINISHED instead of a buffer index when Logic had no free
+        /// transform buffer to publish its frame. See LogicSystem::BackPressurePolicy
+        static const Ogre::uint32 cLogicFrameSkipped = 0xFFFFFFFFu;
+        /// Same as cLogicFrameSkipped, but Graphics should extrapolate past the last frame.
+        static const Ogre::uint32 cLogicFrameExtrapolate = 0xFFFFFFFEu;
     }
 }  // namespace Demo
 
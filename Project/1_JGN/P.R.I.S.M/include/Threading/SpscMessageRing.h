@@ -0,0 +1,87 @@
+
+#ifndef _Mq_SpscMessageRing_H_
+#define _Mq_SpscMessageRing_H_
+
+#include "OgrePrerequisites.h"
+
+#include <atomic>
+
+namespace Demo
+{
+    namespace Mq
+    {
+        /** Bounded, lock-free byte ring for exactly one producer thread and exactly one
+            consumer thread. MessageQueueSystem uses it to deliver messages between two
+            systems that have been paired via MessageQueueSystem::connectSpscTransport.
+        @remarks
+            Positions are free-running counters; the actual byte offset is (pos & mask).
+            A record is never split across the end of the buffer: when it doesn't fit,
+            the producer writes a padding record up to the end and starts again at 0.
+        @par
+            Written bytes are not visible to the consumer until publish() is called,
+            which mirrors the batching semantics of MessageQueueSystem::flushQueuedMessages.
+        */
+        class SpscMessageRing
+        {
+        public:
+            /// Message Id stored in the header of padding records. Consumer must skip them.
+            static const Ogre::uint32 cPaddingMessageId;
+
+        private:
+            unsigned char *mBuffer;
+            size_t         mCapacity;
+            size_t         mMask;
+
+            // Padding keeps the consumer's and producer's members in different cache
+            // lines to prevent false sharing. We don't use alignas because operator new
+            // ignores over-alignment in C++11.
+            char mPadding0[64];
+
+            // Touched by the consumer thread.
+            std::atomic<size_t> mReadPos;
+
+            char mPadding1[64];
+
+            // Touched by the producer thread.
+            std::atomic<size_t> mWritePos;
+            size_t mPendingWritePos;
+            size_t mCachedReadPos;
+
+            /// PRODUCER THREAD ONLY.
+            bool hasFreeSpace( size_t numBytes );
+
+        public:
+            /// capacityBytes is rounded up to the next power of 2
+            SpscMessageRing( size_t capacityBytes );
+            ~SpscMessageRing();
+
+            size_t getCapacity() const { return mCapacity; }
+
+            /** Reserves totalSize contiguous bytes for writing. PRODUCER THREAD ONLY.
+            @param totalSize
+                Size of the record, header included. Must be a multiple of
+                MessageQueueSystem's header size.
+            @return
+                Pointer where to write the record. Null if the ring is full; in which
+                case nothing was reserved (though a padding record may have been written
+                so the next attempt starts at offset 0).
+            */
+            unsigned char *reserve( size_t totalSize );
+
+            /// Makes all records reserved so far visible to the consumer. PRODUCER THREAD ONLY.
+            void publish() { mWritePos.store( mPendingWritePos, std::memory_order_release ); }
+
+            /// Returns the position up to which the consumer can read. CONSUMER THREAD ONLY.
+            size_t getPublishedWritePos() const { return mWritePos.load( std::memory_order_acquire ); }
+            /// CONSUMER THREAD ONLY.
+            size_t getReadPos() const { return mReadPos.load( std::memory_order_relaxed ); }
+
+            const unsigned char *getRecordAt( size_t pos ) const { return mBuffer + ( pos & mMask ); }
+
+            /// Gives back to the producer everything before newReadPos. CONSUMER THREAD ONLY.
+            void release( size_t newReadPos ) { mReadPos.store( newReadPos, std::memory_order_release ); }
+        };
+    }  // namespace Mq
+}  // namespace Demo
+
+#endif
@@ -0,0 +1,176 @@
+
+#ifndef _Demo_StreamingSceneLoader_H_
+#define _Demo_StreamingSceneLoader_H_
+
+#include "GameEntity.h"
+
+#include "OgreResourceGroupManager.h"
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace Demo
+{
+    /** Loads the meshes of GameEntities in the background, so that adding a lot of them
+        doesn't stall the render thread. The GameEntity's SceneNode is created right away
+        as a placeholder and its Item gets attached once the mesh is ready.
+    @remarks
+        Ogre's VaoManager isn't thread safe, so meshes are split the same way Ogre's
+        Resource::prepare & Resource::load do:
+            1. I/O threads read the whole .mesh file into memory. Closest meshes first.
+            2. The render thread deserializes it & creates the GPU buffers (Mesh::load),
+               but only for up to getLoadBudget microseconds per frame.
+        Step 2 gets the data from step 1 through ResourceLoadingListener::resourceLoading.
+        Textures are already streamed by TextureGpuManager once the Items use them.
+    @par
+        Only meshes in "FileSystem" archives are read in the I/O threads (Ogre's Zip
+        archives aren't thread safe); the rest are read by Mesh::load as usual.
+    @par
+        Except for the I/O threads, everything must be called from the render thread.
+    */
+    class StreamingSceneLoader : public Ogre::ResourceLoadingListener
+    {
+    public:
+        /// Render thread only.
+        struct Stats
+        {
+            size_t numMeshesRequested;
+            size_t numMeshesLoaded;
+            size_t numMeshesFailed;
+            /// GameEntities waiting for their mesh.
+            size_t numEntitiesPending;
+            size_t numEntitiesAttached;
+
+            Ogre::uint64 bytesRead;
+            /// Added across I/O threads.
+            Ogre::uint64 readMicroseconds;
+            /// Spent in the render thread deserializing & uploading.
+            Ogre::uint64 loadMicroseconds;
+            /// From the first request to the last mesh getting loaded, while busy.
+            Ogre::uint64 busyMicroseconds;
+        };
+
+    protected:
+        /// Render thread only. Which I/O stage a pending mesh is in is given
+        /// by the queue it's in.
+        enum MeshState
+        {
+            MeshPending,
+            MeshLoaded,
+            MeshFailed
+        };
+
+        struct MeshRequest
+        {
+            Ogre::String name;
+            Ogre::String group;
+            /// Null if it can't be read from the I/O threads.
+            Ogre::Archive *archive;
+            MeshState      state;
+            /// Squared distance to the camera of the closest waiting entity. Lower goes first.
+            Ogre::Real          priority;
+            Ogre::DataStreamPtr data;
+            /// Time the I/O thread took to read data.
+            Ogre::uint64  readMicroseconds;
+            GameEntityVec waitingEntities;
+        };
+
+        typedef std::map<std::pair<Ogre::String, Ogre::String>, MeshRequest *> MeshRequestMap;
+        typedef std::vector<MeshRequest *>                                       MeshRequestVec;
+
+        MeshRequestMap mMeshRequests;
+
+        std::vector<std::thread> mThreads;
+        std::mutex               mMutex;
+        std::condition_variable  mCondition;
+        bool                     mQuit;
+
+        /// Protected by mMutex. Sorted by priority, highest priority at the back.
+        MeshRequestVec mReadQueue;
+        /// Protected by mMutex. Meshes the I/O threads finished with.
+        MeshRequestVec mReadDone;
+
+        /// Render thread only. Read, waiting for their turn to be loaded.
+        MeshRequestVec mLoadQueue;
+
+        /// The mesh being loaded. Feeds resourceLoading
+        MeshRequest *mCurrentLoad;
+
+        Ogre::ResourceLoadingListener *mPrevLoadingListener;
+
+        Ogre::uint64 mLoadBudgetMicroseconds;
+        /// Offscreen meshes get their distance multiplied by this.
+        Ogre::Real mOffscreenPenalty;
+
+        /// See SteadyClock
+        Ogre::uint64 mBusyStart;
+        Stats        mStats;
+
+        void ioThread();
+
+        Ogre::Real getPriority( const MeshRequest *request, const Ogre::Camera *camera ) const;
+        void       updatePriorities( const Ogre::Camera *camera );
+
+        /// Returns false if it failed.
+        bool loadMesh( MeshRequest *request );
+
+        void attachEntities( MeshRequest *request, GameEntityVec &outReadyEntities );
+
+    public:
+        /**
+        @param numThreads
+            I/O threads. Must be > 0.
+        */
+        StreamingSceneLoader( size_t numThreads );
+        ~StreamingSceneLoader() override;
+
+        /** Requests the mesh of the given GameEntity.
+        @return
+            False if its mesh is already loaded, in which case the caller should create
+            its Item now. Otherwise it will be returned by update once it's ready.
+        */
+        bool addGameEntity( GameEntity *gameEntity );
+
+        /// The GameEntity got removed before its mesh was ready.
+        void removeGameEntity( GameEntity *gameEntity );
+
+        /** Call every frame, before rendering.
+        @param camera
+            To prioritize the meshes of visible & closest entities.
+        @param outReadyEntities [out]
+            GameEntities whose meshes are now loaded. Their Items should be created & attached.
+            The vector isn't cleared.
+        */
+        void update( const Ogre::Camera *camera, GameEntityVec &outReadyEntities );
+
+        /// True if there's nothing pending.
+        bool isIdle() const;
+
+        /// In range [0; 1]
+        float getProgress() const;
+
+        const Stats &getStats() const { return mStats; }
+        void         logStats() const;
+
+        /// Max time per frame the render thread spends in Mesh::load. At least one mesh
+        /// gets loaded per frame, even if it takes longer.
+        void         setLoadBudget( Ogre::uint64 microseconds );
+        Ogre::uint64 getLoadBudget() const { return mLoadBudgetMicroseconds; }
+
+        /// @copydoc Ogre::ResourceLoadingListener::resourceLoading
+        Ogre::DataStreamPtr resourceLoading( const Ogre::String &name, const Ogre::String &group,
+                                             Ogre::Resource *resource ) override;
+        bool                grouplessResourceExists( const Ogre::String &name ) override;
+        Ogre::DataStreamPtr grouplessResourceLoading( const Ogre::String &name ) override;
+        Ogre::DataStreamPtr grouplessResourceOpened( const Ogre::String &name, Ogre::Archive *archive,
+                                                     Ogre::DataStreamPtr &dataStream ) override;
+        void resourceStreamOpened( const Ogre::String &name, const Ogre::String &group,
+                                   Ogre::Resource *resource, Ogre::DataStreamPtr &dataStream ) override;
+        bool resourceCollision( Ogre::Resource        *resource,
+                                Ogre::ResourceManager *resourceManager ) override;
+    };
+}  // namespace Demo
+
+#endif
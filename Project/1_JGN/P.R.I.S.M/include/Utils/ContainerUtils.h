@@ -0,0 +1,91 @@
+
+#ifndef _Demo_ContainerUtils_H_
+#define _Demo_ContainerUtils_H_
+
+#include <algorithm>
+#include <stddef.h>
+#include <vector>
+
+namespace Demo
+{
+    /// Removal & insertion helpers shared by GameEntityManager (unordered vectors, where
+    /// each element knows its index) and GraphicsSystem (vectors kept sorted).
+    class ContainerUtils
+    {
+    public:
+        /// Removes container[idx] in O(1) by moving the last element into its place.
+        /// Doesn't preserve order.
+        template <typename T>
+        static void swapAndPop( std::vector<T> &container, size_t idx )
+        {
+            container[idx] = container.back();
+            container.pop_back();
+        }
+
+        /** Same as swapAndPop, for vectors of pointers to objects that store their own
+            index in the vector. Updates the index of the element that got moved.
+        @param idxMember
+            The member that stores the index, e.g. &GameEntity::mLogicIdx
+        */
+        template <typename T>
+        static void swapAndPop( std::vector<T *> &container, size_t idx, size_t T::*idxMember )
+        {
+            T *lastElement = container.back();
+            container[idx] = lastElement;
+            lastElement->*idxMember = idx;
+            container.pop_back();
+        }
+
+        /** Removes from container the elements in toRemove, in a single compaction pass.
+            Elements of toRemove that aren't in container are ignored.
+        @remarks
+            Both must be sorted with cmp.
+        @return
+            The number of elements that were removed.
+        */
+        template <typename T, typename Cmp>
+        static size_t removeSorted( std::vector<T> &container, const std::vector<T> &toRemove,
+                                    Cmp cmp )
+        {
+            if( toRemove.empty() )
+                return 0u;
+
+            typename std::vector<T>::const_iterator itRemove = toRemove.begin();
+            typename std::vector<T>::const_iterator enRemove = toRemove.end();
+            typename std::vector<T>::iterator itor =
+                std::lower_bound( container.begin(), container.end(), *itRemove, cmp );
+            typename std::vector<T>::iterator endt = container.end();
+            typename std::vector<T>::iterator dst = itor;
+
+            while( itor != endt )
+            {
+                while( itRemove != enRemove && cmp( *itRemove, *itor ) )
+                    ++itRemove;
+                if( itRemove != enRemove && *itor == *itRemove )
+                    ++itRemove;
+                else
+                    *dst++ = *itor;
+                ++itor;
+            }
+
+            const size_t numRemoved = static_cast<size_t>( endt - dst );
+            container.erase( dst, endt );
+            return numRemoved;
+        }
+
+        /** Sorts the elements from firstNew onwards and merges them with the ones before,
+            which must already be sorted with cmp. Cheaper than sorting everything again
+            when only a few elements were appended.
+        */
+        template <typename T, typename Cmp>
+        static void mergeSorted( std::vector<T> &container, size_t firstNew, Cmp cmp )
+        {
+            typename std::vector<T>::iterator itNew =
+                container.begin() + static_cast<ptrdiff_t>( firstNew );
+            std::sort( itNew, container.end(), cmp );
+            std::inplace_merge( container.begin(), itNew, container.end(), cmp );
+        }
+    };
+}  // namespace Demo
+
+#endif
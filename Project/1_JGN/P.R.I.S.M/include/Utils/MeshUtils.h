@@ -5,15 +5,30 @@ namespace Demo
 {
     class MeshUtils
     {
+        static Ogre::String msMeshCacheFolder;
+
     public:
         /** Opens a v1 mesh with the given name and imports it to a v2 mesh
             using the same name.
             The v1 mesh will be unloaded.
+        @remarks
+            When a mesh cache folder is set, the converted mesh is saved there (in the v2
+            format) keyed by a hash of the source .mesh file and the conversion settings.
+            The next time, the v2 mesh is loaded straight from the cache and the v1 mesh
+            isn't even opened. See setMeshCacheFolder.
         @param meshName
             Name of the mesh to open.
         @param groupName
             Group of the mesh it resides in.
         */
         static void importV1Mesh( const Ogre::String &meshName, const Ogre::String &groupName );
+
+        /** Sets where converted meshes are cached (e.g. the write access folder, next to
+            the HLMS caches). Empty to disable caching, which is the default.
+            Cached files are named meshCache_<meshName>_<hash>.mesh; the ones left over from
+            an older version of a source mesh are deleted when it gets converted again.
+        */
+        static void setMeshCacheFolder( const Ogre::String &folder );
+        static const Ogre::String &getMeshCacheFolder() { return msMeshCacheFolder; }
     };
 }  // namespace Demo
@@ -0,0 +1,22 @@
+
+#ifndef _Demo_SteadyClock_H_
+#define _Demo_SteadyClock_H_
+
+#include "OgrePrerequisites.h"
+
+namespace Demo
+{
+    /** Monotonic clock for timings taken from several threads (I/O threads, the prepare
+        thread, the job system's workers...). Ogre::Timer can't be used for those: on
+        Windows it may read a different core's counter than the one it was reset on,
+        and a Timer shared between threads is a data race.
+    */
+    class SteadyClock
+    {
+    public:
+        /// Microseconds since the first call in the process. Can be called from any thread.
+        static Ogre::uint64 getMicroseconds();
+    };
+}  // namespace Demo
+
+#endif
@@ -0,0 +1,146 @@
+
+#ifndef _Demo_TextureMetadataCache_H_
+#define _Demo_TextureMetadataCache_H_
+
+#include "OgreTextureGpuManager.h"
+
+#include <set>
+
+namespace Demo
+{
+    /** Binary replacement for textureMetadataCache.json. The file is memory mapped and
+        TextureGpuManager queries it directly (see TextureGpuManager::MetadataCacheSource)
+        when a texture gets loaded, so startup doesn't pay for parsing thousands of entries
+        nor building a map out of them.
+    @remarks
+        File layout (native endianness; the file is rejected if the version, endianness
+        or the size of IdString's hash don't match):
+            FileHeader
+            Segment 0: SegmentHeader, Entry[numEntries] sorted by key, alias strings
+            Segment 1: ...
+        Saving only appends a new segment with the entries that were added or changed
+        during the session; a lookup binary searches each segment, newest first.
+        Once there are cMaxSegments the whole file is rewritten as a single one.
+    @par
+        Reserved pools aren't stored. Use exportJson for a human readable dump.
+    */
+    class TextureMetadataCache : public Ogre::TextureGpuManager::MetadataCacheSource
+    {
+    public:
+        typedef Ogre::TextureGpuManager::MetadataCacheEntry MetadataCacheEntry;
+        typedef Ogre::TextureGpuManager::MetadataCacheMap   MetadataCacheMap;
+
+        static const Ogre::uint32 cMaxSegments = 8u;
+
+    protected:
+        struct FileHeader
+        {
+            Ogre::uint32 magic;
+            Ogre::uint16 version;
+            Ogre::uint16 keySize;
+            Ogre::uint32 numSegments;
+            Ogre::uint32 padding;
+        };
+
+        struct SegmentHeader
+        {
+            Ogre::uint32 numEntries;
+            Ogre::uint32 stringBytes;
+        };
+
+        struct Entry
+        {
+            /// IdString::mHash, zero padded.
+            Ogre::uint32 key[4];
+            Ogre::uint32 width;
+            Ogre::uint32 height;
+            Ogre::uint32 depthOrSlices;
+            Ogre::uint32 poolId;
+            /// Into the segment's strings
+            Ogre::uint32 aliasOffset;
+            Ogre::uint16 aliasLength;
+            Ogre::uint16 pixelFormat;
+            Ogre::uint8  textureType;
+            Ogre::uint8  numMipmaps;
+            /// When true, the entry was found to be out of date & older segments must be ignored
+            Ogre::uint8 removed;
+            Ogre::uint8 padding[5];
+        };
+
+        typedef std::vector<const SegmentHeader *> SegmentVec;
+
+        struct PendingEntry
+        {
+            Ogre::IdString     name;
+            MetadataCacheEntry entry;
+            bool               removed;
+        };
+        typedef std::vector<PendingEntry> PendingEntryVec;
+
+        Ogre::String mPath;
+
+        const Ogre::uint8 *mData;
+        size_t             mDataSize;
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+        void *mFileHandle;
+        void *mMappingHandle;
+#endif
+        /// Newest first
+        SegmentVec mSegments;
+
+        /// Entries reported out of date during this session.
+        std::set<Ogre::IdString> mRemoved;
+
+        static void toKey( Ogre::IdString name, Ogre::uint32 outKey[4] );
+        static bool keyLess( const Entry &a, const Entry &b );
+
+        const Entry *findEntry( Ogre::IdString name, const SegmentHeader **outSegment ) const;
+        void         toMetadataCacheEntry( const Entry &entry, const SegmentHeader *segment,
+                                           bool bWithAlias, MetadataCacheEntry &outEntry ) const;
+
+        /// Every live entry in the file, newest version of each.
+        void getAllEntries( PendingEntryVec &outEntries ) const;
+
+        static bool writeSegment( std::ostream &outFile, PendingEntryVec &entries );
+
+    public:
+        TextureMetadataCache();
+        ~TextureMetadataCache() override;
+
+        /** Maps the file at the given path. If it was truncated, the segments that are
+            still whole are kept.
+        @return
+            False if it doesn't exist, isn't valid or has no whole segment, in which case
+            the cache is empty.
+        */
+        bool open( const Ogre::String &path );
+        void close();
+
+        bool isOpen() const { return mData != 0; }
+
+        /// Number of lookups that will be made, worst case, per texture.
+        size_t getNumSegments() const { return mSegments.size(); }
+
+        /** Appends the session entries that are new or differ from the ones in the file,
+            and marks the ones that were removed. Nothing is written if nothing changed.
+            The file is reopened afterwards.
+        @param path
+            Where to save. If it isn't the opened file, it's written from scratch.
+        @param sessionEntries
+            See TextureGpuManager::getMetadataCache
+        */
+        void save( const Ogre::String &path, const MetadataCacheMap &sessionEntries );
+
+        /// Writes the live entries in the same format as
+        /// TextureGpuManager::exportTextureMetadataCache, for debugging.
+        void exportJson( Ogre::String &outJson ) const;
+
+        /// @copydoc TextureGpuManager::MetadataCacheSource::findMetadataCacheEntry
+        bool findMetadataCacheEntry( Ogre::IdString name, MetadataCacheEntry &outEntry ) override;
+
+        /// @copydoc TextureGpuManager::MetadataCacheSource::removeMetadataCacheEntry
+        void removeMetadataCacheEntry( Ogre::IdString name ) override;
+    };
+}  // namespace Demo
+
+#endif
@@ -1,10 +1,16 @@
 
 #include "BaseSystem.h"
 #include "GameState.h"
+#include "System/TraceRecorder.h"
 
 namespace Demo
 {
-    BaseSystem::BaseSystem( GameState *gameState ) : mCurrentGameState( gameState ) {}
+    BaseSystem::BaseSystem( GameState *gameState ) :
+        mCurrentGameState( gameState ),
+        mTelemetryUpdateMetric( Telemetry::NumMetrics ),
+        mTelemetryQueueDepthMetric( Telemetry::NumMetrics )
+    {
+    }
     //-----------------------------------------------------------------------------------
     BaseSystem::~BaseSystem() {}
     //-----------------------------------------------------------------------------------
@@ -18,9 +24,30 @@ namespace Demo
     //-----------------------------------------------------------------------------------
     void BaseSystem::destroyScene() { mCurrentGameState->destroyScene(); }
     //-----------------------------------------------------------------------------------
-    void BaseSystem::beginFrameParallel() { this->processIncomingMessages(); }
+    void BaseSystem::beginFrameParallel()
+    {
+        {
+            TraceRecorder::ScopedEvent messagesEvent( "Process incoming messages" );
+            this->processIncomingMessages();
+        }
+
+        if( mTelemetryQueueDepthMetric != Telemetry::NumMetrics )
+            Telemetry::record( mTelemetryQueueDepthMetric, getLastIncomingBytes() );
+    }
     //-----------------------------------------------------------------------------------
-    void BaseSystem::update( float timeSinceLast ) { mCurrentGameState->update( timeSinceLast ); }
+    void BaseSystem::update( float timeSinceLast )
+    {
+        TraceRecorder::ScopedEvent updateEvent( "GameState::update" );
+
+        if( mTelemetryUpdateMetric == Telemetry::NumMetrics )
+        {
+            mCurrentGameState->update( timeSinceLast );
+            return;
+        }
+
+        Telemetry::ScopedSample updateSample( mTelemetryUpdateMetric );
+        mCurrentGameState->update( timeSinceLast );
+    }
     //-----------------------------------------------------------------------------------
     void BaseSystem::finishFrameParallel()
     {
@@ -3,14 +3,39 @@
 #include "GameEntity.h"
 
 #include "LogicSystem.h"
+#include "System/Telemetry.h"
+#include "Threading/JobSystem.h"
+#include "Utils/ContainerUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <new>
 
 namespace Demo
 {
-    const size_t cNumTransforms = 250;
+    /// Batches are split in messages of up to this many entities,
+    /// so they always fit in the message queue's ring.
+    const size_t cMaxEntitiesPerBatchMessage = 1024u;
+    /// How often (in frames) compactTransformSlots runs, if there were releases.
+    const size_t cTransformCompactionPeriod = 60u;
+    /// GameEntities per job when rebasing them in parallel.
+    const size_t cRebaseGrainSize = 1024u;
 
     GameEntityManager::GameEntityManager( Mq::MessageQueueSystem *graphicsSystem,
                                           LogicSystem *logicSystem ) :
         mCurrentId( 0 ),
+        mDirtyTracking( logicSystem->getDirtyTracking() ),
+        mFloatingOrigin( logicSystem->getFloatingOrigin() ),
+        mOrigins( 1u, WorldPosition() ),
+        mRebaseDistance( 4096.0 ),
+        mRebaseEntitiesPerTick( 8192u ),
+        mRebaseCursor( 0 ),
+        mNumEntitiesToRebase( 0 ),
+        mNumGameEntityBuffers( logicSystem->getNumGameEntityBuffers() ),
+        mFramesSinceTransformCompaction( 0 ),
+        mAvailableTransformsDirty( false ),
         mScheduledForRemovalCurrentSlot( std::numeric_limits<size_t>::max() ),
         mGraphicsSystem( graphicsSystem ),
         mLogicSystem( logicSystem )
@@ -34,8 +59,25 @@ namespace Demo
         destroyAllGameEntitiesIn( mGameEntities[Ogre::SCENE_DYNAMIC] );
         destroyAllGameEntitiesIn( mGameEntities[Ogre::SCENE_STATIC] );
 
-        std::vector<GameEntityTransform *>::const_iterator itor = mTransformBuffers.begin();
-        std::vector<GameEntityTransform *>::const_iterator end = mTransformBuffers.end();
+        {
+            std::vector<GameEntity *>::const_iterator itor = mGameEntityChunks.begin();
+            std::vector<GameEntity *>::const_iterator end = mGameEntityChunks.end();
+            while( itor != end )
+                OGRE_FREE( *itor++, Ogre::MEMCATEGORY_SCENE_OBJECTS );
+            mGameEntityChunks.clear();
+
+            std::vector<GameEntityGraphics *>::const_iterator itGraphics = mGraphicsChunks.begin();
+            std::vector<GameEntityGraphics *>::const_iterator enGraphics = mGraphicsChunks.end();
+            while( itGraphics != enGraphics )
+                OGRE_FREE( *itGraphics++, Ogre::MEMCATEGORY_SCENE_OBJECTS );
+            mGraphicsChunks.clear();
+
+            mSlotGenerations.clear();
+            mAvailableSlots.clear();
+        }
+
+        std::vector<ArrayGameEntityTransform *>::const_iterator itor = mTransformBuffers.begin();
+        std::vector<ArrayGameEntityTransform *>::const_iterator end = mTransformBuffers.end();
 
         while( itor != end )
         {
@@ -47,49 +89,381 @@ namespace Demo
         mAvailableTransforms.clear();
     }
     //-----------------------------------------------------------------------------------
+    GameEntity *GameEntityManager::createGameEntity( Ogre::SceneMemoryMgrTypes type,
+                                                     const MovableObjectDefinition *moDefinition,
+                                                     const GameEntityTransform &initialTransform )
+    {
+        const Ogre::uint32 entitySlot = aquireGameEntitySlot();
+        GameEntityGraphics *graphics = new( getGraphicsInSlot( entitySlot ) ) GameEntityGraphics();
+        GameEntity *gameEntity = new( getGameEntityInSlot( entitySlot ) )
+            GameEntity( mCurrentId++, GameEntityHandle( entitySlot, mSlotGenerations[entitySlot] ),
+                        graphics, moDefinition, type );
+
+        size_t slot, bufferIdx;
+        aquireTransformSlot( slot, bufferIdx );
+
+        gameEntity->mWorldPosition = getOrigin() + initialTransform.vPos;
+        gameEntity->mLogicOriginEpoch = getOriginEpoch();
+
+        gameEntity->mTransformBufferIdx = bufferIdx;
+        gameEntity->mTransformIndex = slot % ARRAY_PACKED_REALS;
+        for( size_t i = 0; i < mNumGameEntityBuffers; ++i )
+        {
+            gameEntity->mTransform[i] = mTransformBuffers[bufferIdx] + slot / ARRAY_PACKED_REALS +
+                                        cNumArrayTransforms * i;
+            gameEntity->setTransform( i, initialTransform );
+            gameEntity->mOriginEpoch[i] = gameEntity->mLogicOriginEpoch;
+        }
+
+        TransformLocation location;
+        location.id = gameEntity->getId();
+        location.block = gameEntity->mTransform[0];
+        location.lane = gameEntity->mTransformIndex;
+
+        gameEntity->mLogicIdx = mGameEntities[type].size();
+        mGameEntities[type].push_back( gameEntity );
+        mTransformLocations[type].push_back( location );
+
+        return gameEntity;
+    }
+    //-----------------------------------------------------------------------------------
     GameEntity *GameEntityManager::addGameEntity( Ogre::SceneMemoryMgrTypes type,
                                                   const MovableObjectDefinition *moDefinition,
                                                   const Ogre::Vector3 &initialPos,
                                                   const Ogre::Quaternion &initialRot,
                                                   const Ogre::Vector3 &initialScale )
     {
-        GameEntity *gameEntity = new GameEntity( mCurrentId++, moDefinition, type );
-
         CreatedGameEntity cge;
-        cge.gameEntity = gameEntity;
         cge.initialTransform.vPos = initialPos;
         cge.initialTransform.qRot = initialRot;
         cge.initialTransform.vScale = initialScale;
+        cge.gameEntity = createGameEntity( type, moDefinition, cge.initialTransform );
+        cge.originEpoch = getOriginEpoch();
 
-        size_t slot, bufferIdx;
-        aquireTransformSlot( slot, bufferIdx );
+        mLogicSystem->queueSendMessage( mGraphicsSystem, Mq::GAME_ENTITY_ADDED, cge );
 
-        gameEntity->mTransformBufferIdx = bufferIdx;
-        for( size_t i = 0; i < NUM_GAME_ENTITY_BUFFERS; ++i )
+        return cge.gameEntity;
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::addGameEntities( Ogre::SceneMemoryMgrTypes type,
+                                             const MovableObjectDefinition *moDefinition,
+                                             const GameEntityTransform *initialTransforms,
+                                             size_t numEntities, GameEntityVec &outGameEntities )
+    {
+        mGameEntities[type].reserve( mGameEntities[type].size() + numEntities );
+        mTransformLocations[type].reserve( mTransformLocations[type].size() + numEntities );
+        outGameEntities.reserve( outGameEntities.size() + numEntities );
+
+        for( size_t i = 0; i < numEntities; i += cMaxEntitiesPerBatchMessage )
         {
-            gameEntity->mTransform[i] = mTransformBuffers[bufferIdx] + slot + cNumTransforms * i;
-            memcpy( gameEntity->mTransform[i], &cge.initialTransform, sizeof( GameEntityTransform ) );
+            const size_t numInBatch = std::min( numEntities - i, cMaxEntitiesPerBatchMessage );
+
+            mTmpCreatedGameEntities.resize( numInBatch );
+            for( size_t j = 0; j < numInBatch; ++j )
+            {
+                CreatedGameEntity &cge = mTmpCreatedGameEntities[j];
+                cge.initialTransform = initialTransforms[i + j];
+                cge.gameEntity = createGameEntity( type, moDefinition, cge.initialTransform );
+                cge.originEpoch = getOriginEpoch();
+                outGameEntities.push_back( cge.gameEntity );
+            }
+
+            mLogicSystem->queueSendMessageArray( mGraphicsSystem, Mq::GAME_ENTITY_ADDED_BATCH,
+                                                 &mTmpCreatedGameEntities[0], numInBatch );
         }
 
-        mGameEntities[type].push_back( gameEntity );
+        mTmpCreatedGameEntities.clear();
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::removeFromLiveList( GameEntity *toRemove )
+    {
+        GameEntityVec &gameEntities = mGameEntities[toRemove->mType];
+        const size_t idx = toRemove->mLogicIdx;
 
-        mLogicSystem->queueSendMessage( mGraphicsSystem, Mq::GAME_ENTITY_ADDED, cge );
+        assert( idx < gameEntities.size() && gameEntities[idx] == toRemove &&
+                "GameEntity removed twice or not from this manager!" );
 
-        return gameEntity;
+        ContainerUtils::swapAndPop( gameEntities, idx, &GameEntity::mLogicIdx );
+        ContainerUtils::swapAndPop( mTransformLocations[toRemove->mType], idx );
+
+        if( toRemove->mAwakeFrames )
+            removeFromAwakeList( toRemove );
+
+        if( toRemove->mType == Ogre::SCENE_DYNAMIC && toRemove->mLogicOriginEpoch != getOriginEpoch() )
+            --mNumEntitiesToRebase;
+
+        // Invalidate the handles. The slot is reused once the GameEntity is destroyed.
+        Ogre::uint32 &generation = mSlotGenerations[toRemove->getHandle().slot];
+        if( ++generation == 0u )
+            generation = 1u;
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::removeFromAwakeList( GameEntity *gameEntity )
+    {
+        const size_t idx = gameEntity->mAwakeIdx;
+        assert( idx < mAwakeEntities.size() && mAwakeEntities[idx] == gameEntity );
+
+        ContainerUtils::swapAndPop( mAwakeEntities, idx, &GameEntity::mAwakeIdx );
+
+        gameEntity->mAwakeFrames = 0;
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::markDirty( GameEntity *gameEntity )
+    {
+        if( !mDirtyTracking || gameEntity->mType != Ogre::SCENE_DYNAMIC )
+            return;
+
+        if( !gameEntity->mAwakeFrames )
+        {
+            gameEntity->mAwakeIdx = mAwakeEntities.size();
+            mAwakeEntities.push_back( gameEntity );
+        }
+
+        // It needs to be published once into each buffer before it can fall asleep.
+        gameEntity->mAwakeFrames = static_cast<Ogre::uint32>( mNumGameEntityBuffers );
+        gameEntity->mLastWrittenTransformIdx = mLogicSystem->getCurrentTransformIdx();
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::setTransform( GameEntity *gameEntity,
+                                          const GameEntityTransform &transform )
+    {
+        const size_t currIdx = mLogicSystem->getCurrentTransformIdx();
+        gameEntity->setTransform( currIdx, transform );
+        if( mFloatingOrigin )
+        {
+            gameEntity->mWorldPosition = getOrigin() + transform.vPos;
+            writeWorldPosition( gameEntity, currIdx );
+        }
+        markDirty( gameEntity );
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::setWorldPosition( GameEntity *gameEntity,
+                                              const WorldPosition &worldPosition )
+    {
+        gameEntity->mWorldPosition = worldPosition;
+        writeWorldPosition( gameEntity, mLogicSystem->getCurrentTransformIdx() );
+        markDirty( gameEntity );
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::writeWorldPosition( GameEntity *gameEntity, size_t transformIdx )
+    {
+        if( gameEntity->mType == Ogre::SCENE_DYNAMIC &&
+            gameEntity->mLogicOriginEpoch != getOriginEpoch() )
+        {
+            gameEntity->mLogicOriginEpoch = getOriginEpoch();
+            --mNumEntitiesToRebase;
+        }
+
+        const Ogre::uint32 originEpoch = gameEntity->mLogicOriginEpoch;
+        gameEntity->setPosition( transformIdx,
+                                 gameEntity->mWorldPosition.relativeTo( mOrigins[originEpoch] ) );
+        gameEntity->mOriginEpoch[transformIdx] = originEpoch;
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::setRebaseEntitiesPerTick( size_t numEntities )
+    {
+        assert( numEntities > 0u );
+        mRebaseEntitiesPerTick = numEntities;
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::updateOrigin( const WorldPosition &focus )
+    {
+        if( !mFloatingOrigin || isRebasing() ||
+            focus.squaredDistance( getOrigin() ) < mRebaseDistance * mRebaseDistance )
+        {
+            return;
+        }
+
+        // Snap to whole units so the offset between any two origins is exact in single
+        // precision (as long as it's below 2^24), which is what Graphics works with.
+        const WorldPosition origin( std::floor( focus.x + 0.5 ), std::floor( focus.y + 0.5 ),
+                                    std::floor( focus.z + 0.5 ) );
+        mOrigins.push_back( origin );
+
+        mNumEntitiesToRebase = mGameEntities[Ogre::SCENE_DYNAMIC].size();
+        mRebaseCursor = 0u;
+
+        OriginRebased originRebased;
+        originRebased.epoch = getOriginEpoch();
+        originRebased.origin = origin;
+        mLogicSystem->queueSendMessage( mGraphicsSystem, Mq::ORIGIN_REBASED, originRebased );
+    }
+    //-----------------------------------------------------------------------------------
+    /// Writes the whole transform of each GameEntity in the range into transformIdx,
+    /// relative to origin. srcIdx is where their latest rotation & scale are, or
+    /// std::numeric_limits<size_t>::max() to use each one's mLastWrittenTransformIdx
+    static void rebaseGameEntities( GameEntity *const *gameEntities, size_t begin, size_t end,
+                                    size_t transformIdx, size_t srcIdx, const WorldPosition &origin,
+                                    Ogre::uint32 originEpoch )
+    {
+        for( size_t i = begin; i < end; ++i )
+        {
+            GameEntity *gameEntity = gameEntities[i];
+
+            const size_t lastIdx = srcIdx == std::numeric_limits<size_t>::max()
+                                       ? gameEntity->mLastWrittenTransformIdx
+                                       : srcIdx;
+            if( lastIdx != transformIdx )
+            {
+                gameEntity->setOrientation( transformIdx, gameEntity->getOrientation( lastIdx ) );
+                gameEntity->setScale( transformIdx, gameEntity->getScale( lastIdx ) );
+            }
+            gameEntity->setPosition( transformIdx, gameEntity->mWorldPosition.relativeTo( origin ) );
+            gameEntity->mOriginEpoch[transformIdx] = originEpoch;
+            gameEntity->mLogicOriginEpoch = originEpoch;
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::rebaseSomeEntities()
+    {
+        const GameEntityVec &gameEntities = mGameEntities[Ogre::SCENE_DYNAMIC];
+        const Ogre::uint32   originEpoch = getOriginEpoch();
+        const size_t numToCollect = std::min( mRebaseEntitiesPerTick, mNumEntitiesToRebase );
+
+        // Removals swap entities around, so the cursor may wrap before finding them all.
+        mTmpRebasedEntities.clear();
+        size_t numScanned = 0u;
+        while( mTmpRebasedEntities.size() < numToCollect && numScanned < gameEntities.size() )
+        {
+            if( mRebaseCursor >= gameEntities.size() )
+                mRebaseCursor = 0u;
+            GameEntity *gameEntity = gameEntities[mRebaseCursor++];
+            if( gameEntity->mLogicOriginEpoch != originEpoch )
+                mTmpRebasedEntities.push_back( gameEntity );
+            ++numScanned;
+        }
+
+        const size_t numEntities = mTmpRebasedEntities.size();
+        if( !numEntities )
+            return;
+
+        // Without dirty tracking every dynamic entity is written each tick, so the current
+        // buffer already has its latest rotation & scale.
+        const size_t transformIdx = mLogicSystem->getCurrentTransformIdx();
+        const size_t srcIdx = mDirtyTracking ? std::numeric_limits<size_t>::max() : transformIdx;
+        const WorldPosition &origin = getOrigin();
+        GameEntity *const *  entities = &mTmpRebasedEntities[0];
+
+        JobSystem *jobSystem = mLogicSystem->getJobSystem();
+        if( jobSystem )
+        {
+            jobSystem->parallelFor(
+                0u, numEntities, cRebaseGrainSize,
+                [entities, transformIdx, srcIdx, &origin, originEpoch]( size_t begin, size_t end,
+                                                                       size_t ) {
+                    rebaseGameEntities( entities, begin, end, transformIdx, srcIdx, origin,
+                                        originEpoch );
+                } );
+        }
+        else
+        {
+            rebaseGameEntities( entities, 0u, numEntities, transformIdx, srcIdx, origin,
+                                originEpoch );
+        }
+
+        for( size_t i = 0u; i < numEntities; ++i )
+            markDirty( entities[i] );
+        mNumEntitiesToRebase -= numEntities;
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::carryAwakeTransforms()
+    {
+        const Ogre::uint32 currIdx = mLogicSystem->getCurrentTransformIdx();
+
+        GameEntityVec::const_iterator itor = mAwakeEntities.begin();
+        GameEntityVec::const_iterator endt = mAwakeEntities.end();
+        while( itor != endt )
+        {
+            GameEntity *gameEntity = *itor++;
+
+            const Ogre::uint32 lastIdx = gameEntity->mLastWrittenTransformIdx;
+            if( lastIdx != currIdx )
+            {
+                GameEntityTransform transform;
+                transform.vPos = gameEntity->getPosition( lastIdx );
+                transform.qRot = gameEntity->getOrientation( lastIdx );
+                transform.vScale = gameEntity->getScale( lastIdx );
+                gameEntity->setTransform( currIdx, transform );
+                gameEntity->mOriginEpoch[currIdx] = gameEntity->mOriginEpoch[lastIdx];
+                gameEntity->mLastWrittenTransformIdx = currIdx;
+            }
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::_notifyFramePublished()
+    {
+        if( !mDirtyTracking || mAwakeEntities.empty() )
+            return;
+
+        const size_t numEntities = mAwakeEntities.size();
+        for( size_t i = 0; i < numEntities; i += cMaxEntitiesPerBatchMessage )
+        {
+            const size_t numInBatch = std::min( numEntities - i, cMaxEntitiesPerBatchMessage );
+            mLogicSystem->queueSendMessageArray( mGraphicsSystem, Mq::GAME_ENTITIES_AWAKE_BATCH,
+                                                 &mAwakeEntities[i], numInBatch );
+        }
+
+        // Backwards, since removal swaps with the last (already visited) entity.
+        for( size_t i = numEntities; i--; )
+        {
+            GameEntity *gameEntity = mAwakeEntities[i];
+            if( !--gameEntity->mAwakeFrames )
+                removeFromAwakeList( gameEntity );
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::uint32 GameEntityManager::aquireGameEntitySlot()
+    {
+        if( mAvailableSlots.empty() )
+        {
+            GameEntity *chunk = reinterpret_cast<GameEntity *>( OGRE_MALLOC(
+                sizeof( GameEntity ) * cGameEntitiesPerChunk, Ogre::MEMCATEGORY_SCENE_OBJECTS ) );
+            mGameEntityChunks.push_back( chunk );
+            mGraphicsChunks.push_back( reinterpret_cast<GameEntityGraphics *>(
+                OGRE_MALLOC( sizeof( GameEntityGraphics ) * cGameEntitiesPerChunk,
+                             Ogre::MEMCATEGORY_SCENE_OBJECTS ) ) );
+
+            const size_t firstSlot = mSlotGenerations.size();
+            mSlotGenerations.resize( firstSlot + cGameEntitiesPerChunk, 1u );
+
+            // Push them backwards so they get handed out in ascending order.
+            for( size_t i = cGameEntitiesPerChunk; i--; )
+                mAvailableSlots.push_back( static_cast<Ogre::uint32>( firstSlot + i ) );
+        }
+
+        const Ogre::uint32 slot = mAvailableSlots.back();
+        mAvailableSlots.pop_back();
+        return slot;
     }
     //-----------------------------------------------------------------------------------
     void GameEntityManager::removeGameEntity( GameEntity *toRemove )
     {
         const size_t slot = getScheduledForRemovalAvailableSlot();
         mScheduledForRemoval[slot].push_back( toRemove );
-        GameEntityVec::iterator itor =
-            std::lower_bound( mGameEntities[toRemove->mType].begin(),
-                              mGameEntities[toRemove->mType].end(), toRemove, GameEntity::OrderById );
-        assert( itor != mGameEntities[toRemove->mType].end() && *itor == toRemove );
-        mGameEntities[toRemove->mType].erase( itor );
+        removeFromLiveList( toRemove );
         mLogicSystem->queueSendMessage( mGraphicsSystem, Mq::GAME_ENTITY_REMOVED, toRemove );
     }
     //-----------------------------------------------------------------------------------
+    void GameEntityManager::removeGameEntities( GameEntity *const *toRemove, size_t numEntities )
+    {
+        if( !numEntities )
+            return;
+
+        const size_t slot = getScheduledForRemovalAvailableSlot();
+        mScheduledForRemoval[slot].insert( mScheduledForRemoval[slot].end(), toRemove,
+                                           toRemove + numEntities );
+
+        for( size_t i = 0; i < numEntities; ++i )
+            removeFromLiveList( toRemove[i] );
+
+        for( size_t i = 0; i < numEntities; i += cMaxEntitiesPerBatchMessage )
+        {
+            const size_t numInBatch = std::min( numEntities - i, cMaxEntitiesPerBatchMessage );
+            mLogicSystem->queueSendMessageArray( mGraphicsSystem, Mq::GAME_ENTITY_REMOVED_BATCH,
+                                                 toRemove + i, numInBatch );
+        }
+    }
+    //-----------------------------------------------------------------------------------
     void GameEntityManager::_notifyGameEntitiesRemoved( size_t slot )
     {
         destroyAllGameEntitiesIn( mScheduledForRemoval[slot] );
@@ -105,8 +479,10 @@ namespace Demo
 
         while( itor != end )
         {
-            releaseTransformSlot( ( *itor )->mTransformBufferIdx, ( *itor )->mTransform[0] );
-            delete *itor;
+            GameEntity *gameEntity = *itor;
+            releaseTransformSlot( gameEntity );
+            mAvailableSlots.push_back( gameEntity->getHandle().slot );
+            gameEntity->~GameEntity();
             ++itor;
         }
     }
@@ -115,54 +491,55 @@ namespace Demo
     {
         if( mAvailableTransforms.empty() )
         {
-            GameEntityTransform *buffer = reinterpret_cast<GameEntityTransform *>( OGRE_MALLOC_SIMD(
-                sizeof( GameEntityTransform ) * cNumTransforms * NUM_GAME_ENTITY_BUFFERS,
-                Ogre::MEMCATEGORY_SCENE_OBJECTS ) );
+            ArrayGameEntityTransform *buffer =
+                reinterpret_cast<ArrayGameEntityTransform *>( OGRE_MALLOC_SIMD(
+                    sizeof( ArrayGameEntityTransform ) * cNumArrayTransforms * mNumGameEntityBuffers,
+                    Ogre::MEMCATEGORY_SCENE_OBJECTS ) );
             mTransformBuffers.push_back( buffer );
-            mAvailableTransforms.push_back( Region( 0, cNumTransforms, mTransformBuffers.size() - 1 ) );
+
+            // Push them backwards so they get handed out in ascending order.
+            const size_t firstSlot = ( mTransformBuffers.size() - 1u ) * cNumTransforms;
+            for( size_t i = cNumTransforms; i--; )
+                mAvailableTransforms.push_back( firstSlot + i );
         }
 
-        Region &region = mAvailableTransforms.back();
-        outSlot = region.slotOffset++;
-        --region.count;
-        outBufferIdx = region.bufferIdx;
+        const size_t globalSlot = mAvailableTransforms.back();
+        mAvailableTransforms.pop_back();
 
-        if( region.count == 0 )
-            mAvailableTransforms.pop_back();
+        outSlot = globalSlot % cNumTransforms;
+        outBufferIdx = globalSlot / cNumTransforms;
     }
     //-----------------------------------------------------------------------------------
-    void GameEntityManager::releaseTransformSlot( size_t bufferIdx, GameEntityTransform *transform )
+    void GameEntityManager::releaseTransformSlot( const GameEntity *gameEntity )
     {
-        // Try to prevent a lot of fragmentation by adding the slot to an existing region.
-        // It won't fully avoid it, but this is good/simple enough. If you want to fully
-        // prevent fragmentation, see StagingBuffer::mergeContiguousBlocks implementation.
-        const size_t slot = static_cast<size_t>( transform - mTransformBuffers[bufferIdx] );
-
-        std::vector<Region>::iterator itor = mAvailableTransforms.begin();
-        std::vector<Region>::iterator end = mAvailableTransforms.end();
+        const size_t bufferIdx = gameEntity->mTransformBufferIdx;
+        const size_t slot =
+            static_cast<size_t>( gameEntity->mTransform[0] - mTransformBuffers[bufferIdx] ) *
+                ARRAY_PACKED_REALS +
+            gameEntity->mTransformIndex;
+        mAvailableTransforms.push_back( bufferIdx * cNumTransforms + slot );
+        mAvailableTransformsDirty = true;
+    }
+    //-----------------------------------------------------------------------------------
+    void GameEntityManager::compactTransformSlots()
+    {
+        // Descending, since slots are handed out from the back.
+        std::sort( mAvailableTransforms.begin(), mAvailableTransforms.end(),
+                   std::greater<size_t>() );
 
-        while( itor != end )
+        // The free slots of the last buffer are now at the front. If all of them are free
+        // (and the buffer before it as well, so we keep one spare) we can release it.
+        while( mTransformBuffers.size() > 1u && mAvailableTransforms.size() >= cNumTransforms * 2u &&
+               mAvailableTransforms[cNumTransforms * 2u - 1u] >=
+                   ( mTransformBuffers.size() - 2u ) * cNumTransforms )
         {
-            if( itor->bufferIdx == bufferIdx &&
-                ( itor->slotOffset == slot + 1 || slot == itor->slotOffset + itor->count ) )
-            {
-                break;
-            }
-
-            ++itor;
+            mAvailableTransforms.erase( mAvailableTransforms.begin(),
+                                        mAvailableTransforms.begin() + cNumTransforms );
+            OGRE_FREE_SIMD( mTransformBuffers.back(), Ogre::MEMCATEGORY_SCENE_OBJECTS );
+            mTransformBuffers.pop_back();
         }
 
-        if( itor != end )
-        {
-            if( itor->slotOffset == slot + 1 )
-                --itor->slotOffset;
-            else  // if( slot == itor->slot + itor->count )
-                ++itor->count;
-        }
-        else
-        {
-            mAvailableTransforms.push_back( Region( slot, 1, bufferIdx ) );
-        }
+        mAvailableTransformsDirty = false;
     }
     //-----------------------------------------------------------------------------------
     size_t GameEntityManager::getScheduledForRemovalAvailableSlot()
@@ -182,8 +559,59 @@ namespace Demo
         return mScheduledForRemovalCurrentSlot;
     }
     //-----------------------------------------------------------------------------------
+    /// FNV-1a
+    static inline Ogre::uint64 hashBytes( Ogre::uint64 hash, const void *data, size_t numBytes )
+    {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>( data );
+        for( size_t i = 0u; i < numBytes; ++i )
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::uint64 GameEntityManager::hashTransforms( size_t transformIdx ) const
+    {
+        assert( transformIdx < mNumGameEntityBuffers );
+
+        Ogre::uint64 hash = 0xCBF29CE484222325ull;
+
+        for( size_t i = 0u; i < Ogre::NUM_SCENE_MEMORY_MANAGER_TYPES; ++i )
+        {
+            // Same order as mGameEntities, without touching them.
+            TransformLocationVec::const_iterator itor = mTransformLocations[i].begin();
+            TransformLocationVec::const_iterator endt = mTransformLocations[i].end();
+            while( itor != endt )
+            {
+                const ArrayGameEntityTransform *arrayTransform = itor->getTransform( transformIdx );
+
+                GameEntityTransform transform;
+                transform.vPos = arrayTransform->vPos.getAsVector3( itor->lane );
+                transform.qRot = arrayTransform->qRot.getAsQuaternion( itor->lane );
+                transform.vScale = arrayTransform->vScale.getAsVector3( itor->lane );
+
+                hash = hashBytes( hash, &itor->id, sizeof( itor->id ) );
+                hash = hashBytes( hash, transform.vPos.ptr(), sizeof( Ogre::Real ) * 3u );
+                hash = hashBytes( hash, transform.qRot.ptr(), sizeof( Ogre::Real ) * 4u );
+                hash = hashBytes( hash, transform.vScale.ptr(), sizeof( Ogre::Real ) * 3u );
+                ++itor;
+            }
+        }
+
+        return hash;
+    }
+    //-----------------------------------------------------------------------------------
     void GameEntityManager::finishFrameParallel()
     {
+        Telemetry::ScopedSample finishSample( Telemetry::GameEntityFinish );
+
+        if( mNumEntitiesToRebase )
+            rebaseSomeEntities();
+
+        if( mDirtyTracking )
+            carryAwakeTransforms();
+
         if( mScheduledForRemovalCurrentSlot < mScheduledForRemoval.size() )
         {
             mLogicSystem->queueSendMessage( mGraphicsSystem, Mq::GAME_ENTITY_SCHEDULED_FOR_REMOVAL_SLOT,
@@ -191,5 +619,12 @@ namespace Demo
 
             mScheduledForRemovalCurrentSlot = std::numeric_limits<size_t>::max();
         }
+
+        if( mAvailableTransformsDirty &&
+            ++mFramesSinceTransformCompaction >= cTransformCompactionPeriod )
+        {
+            compactTransformSlots();
+            mFramesSinceTransformCompaction = 0;
+        }
     }
 }  // namespace Demo
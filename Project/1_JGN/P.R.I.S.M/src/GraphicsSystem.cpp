@@ -5,6 +5,13 @@
 #    include "SdlInputHandler.h"
 #endif
 #include "GameEntity.h"
+#include "System/MainEntryPoints.h"
+#include "System/TraceRecorder.h"
+#include "Threading/StreamingSceneLoader.h"
+#include "Utils/ContainerUtils.h"
+#include "Utils/MeshUtils.h"
+#include "Utils/SteadyClock.h"
+#include "Utils/TextureMetadataCache.h"
 
 #include "OgreAbiUtils.h"
 #include "OgreConfigFile.h"
@@ -20,6 +27,10 @@
 #include "OgreHlmsUnlit.h"
 
 #include "Compositor/OgreCompositorManager2.h"
+#include "Compositor/OgreCompositorNodeDef.h"
+#include "Compositor/OgreCompositorWorkspace.h"
+#include "Compositor/OgreCompositorWorkspaceDef.h"
+#include "Compositor/Pass/PassClear/OgreCompositorPassClearDef.h"
 
 #include "OgreOverlayManager.h"
 #include "OgreOverlaySystem.h"
@@ -34,7 +45,9 @@
 #include "OgreGpuProgramManager.h"
 #include "OgreHlmsDiskCache.h"
 
+#include "OgreFrameStats.h"
 #include "OgreLogManager.h"
+#include "OgreTimer.h"
 
 #include "OgrePlatformInformation.h"
 
@@ -46,6 +59,7 @@
 #endif
 
 #include <fstream>
+#include <string.h>
 
 #if OGRE_USE_SDL2
 #    include <SDL_syswm.h>
@@ -62,6 +76,8 @@
 
 namespace Demo
 {
+    const float GraphicsSystem::cMaxExtrapolationWeight = 2.0f;
+
     GraphicsSystem::GraphicsSystem( GameState *gameState, Ogre::String resourcePath,
                                     Ogre::ColourValue backgroundColour ) :
         BaseSystem( gameState ),
@@ -78,14 +94,46 @@ namespace Demo
         mPluginsFolder( "./" ),
         mResourcePath( resourcePath ),
         mOverlaySystem( 0 ),
+        mTextureMetadataCache( 0 ),
+        mStreamingSceneLoader( 0 ),
+        mNumMeshStreamingThreads( 0u ),
         mAccumTimeSinceLastLogicFrame( 0 ),
+        mNumGameEntityBuffers( DEFAULT_GAME_ENTITY_BUFFERS ),
         mCurrentTransformIdx( 0 ),
+        mLogicRequestedExtrapolation( false ),
+        mNumExtrapolatedFrames( 0 ),
         mThreadGameEntityToUpdate( 0 ),
         mThreadWeight( 0 ),
+        mUseSimdInterpolation( true ),
+        mNumSceneManagerThreads( 0 ),
+        mDirtyTracking( false ),
+        mFloatingOrigin( false ),
+        mPipelinedFrames( false ),
+        mMaxFramesInFlight( 0 ),
+        mPrepareState( PrepareIdle ),
+        mPrepareTimeSinceLast( 0 ),
+        mDeferSceneMessages( false ),
+        mPendingLogicFrameArrival( 0 ),
+        mInFlightLogicFrameArrival( 0 ),
+        mConsumedInputTime( 0 ),
+        mPendingLogicFrameInput( 0 ),
+        mInFlightLogicFrameInput( 0 ),
+        mHeadless( false ),
+        mVSync( true ),
+        mMaxFrames( 0 ),
+        mNumFramesRendered( 0 ),
+        mFrameLogicMicroseconds( 0 ),
+        mInitializeStart( 0 ),
+        mHlmsWarmUpStart( 0 ),
+        mTimeToFirstFrame( 0 ),
+        mTimeToFirstSceneFrame( 0 ),
+        mHlmsWarmUpMicroseconds( 0 ),
         mQuit( false ),
         mAlwaysAskForConfig( true ),
         mUseHlmsDiskCache( true ),
         mUseMicrocodeCache( true ),
+        mUseMeshCache( true ),
+        mExportTextureCacheJson( false ),
         mBackgroundColour( backgroundColour )
     {
 #if OGRE_PLATFORM == OGRE_PLATFORM_APPLE
@@ -104,6 +152,17 @@ namespace Demo
             Ogre::FileSystemLayer filesystemLayer( OGRE_VERSION_NAME );
             mWriteAccessFolder = filesystemLayer.getWritablePath( "" );
         }
+
+        resetFramePipelineStats();
+
+        OriginEpoch firstOrigin;
+        firstOrigin.epoch = 0u;
+        for( size_t i = 0u; i < Ogre::NUM_SCENE_MEMORY_MANAGER_TYPES; ++i )
+            firstOrigin.parents[i] = 0;
+        mOriginEpochs.push_back( firstOrigin );
+
+        mTelemetryUpdateMetric = Telemetry::RenderUpdate;
+        mTelemetryQueueDepthMetric = Telemetry::RenderQueueDepth;
     }
     //-----------------------------------------------------------------------------------
     GraphicsSystem::~GraphicsSystem()
@@ -134,11 +193,145 @@ namespace Demo
         return true;
     }
     //-----------------------------------------------------------------------------------
+    void GraphicsSystem::setHeadless( bool bHeadless )
+    {
+        assert( !mRoot && "Must be called before initialize()" );
+        mHeadless = bHeadless;
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::setVSync( bool bVSync )
+    {
+        assert( !mRoot && "Must be called before initialize()" );
+        mVSync = bVSync;
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::setFrameTimingsCsv( const Ogre::String &path )
+    {
+        assert( !mRoot && "Must be called before initialize()" );
+        mFrameTimingsCsvPath = path;
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::setTelemetryCsv( const Ogre::String &path )
+    {
+        assert( !mRoot && "Must be called before initialize()" );
+        mTelemetryCsvPath = path;
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::captureTrace()
+    {
+        if( !TraceRecorder::isEnabled() )
+        {
+            Ogre::LogManager::getSingleton().logMessage(
+                "Can't capture a trace: TraceRecorder is disabled. See --trace-frames" );
+            return;
+        }
+        TraceRecorder::requestCapture( mTraceCapturePath );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::selectHeadlessRenderSystem()
+    {
+        const Ogre::String nullRenderSystemName = "NULL Rendering Subsystem";
+
+        Ogre::RenderSystem *renderSystem = mRoot->getRenderSystemByName( nullRenderSystemName );
+#ifndef OGRE_STATIC_LIB
+        if( !renderSystem )
+        {
+            // plugins.cfg usually only lists it for the tools
+            mRoot->loadPlugin( "RenderSystem_NULL" OGRE_BUILD_SUFFIX, true, 0 );
+            renderSystem = mRoot->getRenderSystemByName( nullRenderSystemName );
+        }
+#endif
+        if( !renderSystem )
+        {
+            OGRE_EXCEPT( Ogre::Exception::ERR_ITEM_NOT_FOUND,
+                         "Headless mode needs the NULL RenderSystem (RenderSystem_NULL)",
+                         "GraphicsSystem::selectHeadlessRenderSystem" );
+        }
+
+        mRoot->setRenderSystem( renderSystem );
+    }
+    //-----------------------------------------------------------------------------------
+#if OGRE_USE_SDL2
+    void GraphicsSystem::createSdlWindow( const Ogre::String &windowTitle, int width, int height,
+                                          bool fullscreen, SDL_SysWMinfo &wmInfo,
+                                          Ogre::NameValuePairList &params )
+    {
+        unsigned int screen = 0;
+        unsigned int posX = SDL_WINDOWPOS_CENTERED_DISPLAY( screen );
+        unsigned int posY = SDL_WINDOWPOS_CENTERED_DISPLAY( screen );
+
+        if( fullscreen )
+        {
+            posX = SDL_WINDOWPOS_UNDEFINED_DISPLAY( screen );
+            posY = SDL_WINDOWPOS_UNDEFINED_DISPLAY( screen );
+        }
+
+        mSdlWindow = SDL_CreateWindow(
+            windowTitle.c_str(),       // window title
+            static_cast<int>( posX ),  // initial x position
+            static_cast<int>( posY ),  // initial y position
+            width,                     // width, in pixels
+            height,                    // height, in pixels
+            SDL_WINDOW_SHOWN | ( fullscreen ? SDL_WINDOW_FULLSCREEN : 0 ) | SDL_WINDOW_RESIZABLE );
+
+        // Get the native whnd
+        SDL_VERSION( &wmInfo.version );
+
+        if( SDL_GetWindowWMInfo( mSdlWindow, &wmInfo ) == SDL_FALSE )
+        {
+            OGRE_EXCEPT( Ogre::Exception::ERR_INTERNAL_ERROR, "Couldn't get WM Info! (SDL2)",
+                         "GraphicsSystem::createSdlWindow" );
+        }
+
+        Ogre::String winHandle;
+        switch( wmInfo.subsystem )
+        {
+#    if defined( SDL_VIDEO_DRIVER_WINDOWS )
+        case SDL_SYSWM_WINDOWS:
+            // Windows code
+            winHandle = Ogre::StringConverter::toString( (uintptr_t)wmInfo.info.win.window );
+            break;
+#    endif
+#    if defined( SDL_VIDEO_DRIVER_WINRT )
+        case SDL_SYSWM_WINRT:
+            // Windows code
+            winHandle = Ogre::StringConverter::toString( (uintptr_t)wmInfo.info.winrt.window );
+            break;
+#    endif
+#    if defined( SDL_VIDEO_DRIVER_COCOA )
+        case SDL_SYSWM_COCOA:
+            winHandle = Ogre::StringConverter::toString( WindowContentViewHandle( wmInfo ) );
+            break;
+#    endif
+#    if defined( SDL_VIDEO_DRIVER_X11 )
+        case SDL_SYSWM_X11:
+            winHandle = Ogre::StringConverter::toString( (uintptr_t)wmInfo.info.x11.window );
+            params.insert( std::make_pair(
+                "SDL2x11", Ogre::StringConverter::toString( (uintptr_t)&wmInfo.info.x11 ) ) );
+            break;
+#    endif
+        default:
+            OGRE_EXCEPT( Ogre::Exception::ERR_NOT_IMPLEMENTED, "Unexpected WM! (SDL2)",
+                         "GraphicsSystem::createSdlWindow" );
+            break;
+        }
+
+#    if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
+        params.insert( std::make_pair( "externalWindowHandle", winHandle ) );
+#    else
+        params.insert( std::make_pair( "parentWindowHandle", winHandle ) );
+#    endif
+    }
+    //-----------------------------------------------------------------------------------
+#endif
     void GraphicsSystem::initialize( const Ogre::String &windowTitle )
     {
+        mInitializeStart = SteadyClock::getMicroseconds();
+
 #if OGRE_USE_SDL2
         // if( SDL_Init( SDL_INIT_EVERYTHING ) != 0 )
-        if( SDL_Init( SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER |
+        if( !mHeadless &&
+            SDL_Init( SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER |
                       SDL_INIT_EVENTS ) != 0 )
         {
             OGRE_EXCEPT( Ogre::Exception::ERR_INTERNAL_ERROR, "Cannot initialize SDL2!",
@@ -185,7 +378,9 @@ namespace Demo
             ++itor;
         }
 
-        if( mAlwaysAskForConfig || !mRoot->restoreConfig() )
+        if( mHeadless )
+            selectHeadlessRenderSystem();
+        else if( mAlwaysAskForConfig || !mRoot->restoreConfig() )
         {
 #ifdef AUTO_TESTING
             Ogre::RenderSystem *rs;
@@ -230,6 +425,9 @@ namespace Demo
 
         mRoot->initialise( false, windowTitle );
 
+        // Reading the caches from disk overlaps with creating the window & loading resources
+        startHlmsCacheLoad();
+
         Ogre::ConfigOptionMap &cfgOpts = mRoot->getRenderSystem()->getConfigOptions();
 
         int width = 1280;
@@ -260,73 +458,13 @@ namespace Demo
 
         Ogre::NameValuePairList params;
         bool fullscreen = Ogre::StringConverter::parseBool( cfgOpts["Full Screen"].currentValue );
+        if( mHeadless )
+            fullscreen = false;
 #if OGRE_USE_SDL2
-        unsigned int screen = 0;
-        unsigned int posX = SDL_WINDOWPOS_CENTERED_DISPLAY( screen );
-        unsigned int posY = SDL_WINDOWPOS_CENTERED_DISPLAY( screen );
-
-        if( fullscreen )
-        {
-            posX = SDL_WINDOWPOS_UNDEFINED_DISPLAY( screen );
-            posY = SDL_WINDOWPOS_UNDEFINED_DISPLAY( screen );
-        }
-
-        mSdlWindow = SDL_CreateWindow(
-            windowTitle.c_str(),       // window title
-            static_cast<int>( posX ),  // initial x position
-            static_cast<int>( posY ),  // initial y position
-            width,                     // width, in pixels
-            height,                    // height, in pixels
-            SDL_WINDOW_SHOWN | ( fullscreen ? SDL_WINDOW_FULLSCREEN : 0 ) | SDL_WINDOW_RESIZABLE );
-
-        // Get the native whnd
+        // params may point into it, until createRenderWindow returns.
         SDL_SysWMinfo wmInfo;
-        SDL_VERSION( &wmInfo.version );
-
-        if( SDL_GetWindowWMInfo( mSdlWindow, &wmInfo ) == SDL_FALSE )
-        {
-            OGRE_EXCEPT( Ogre::Exception::ERR_INTERNAL_ERROR, "Couldn't get WM Info! (SDL2)",
-                         "GraphicsSystem::initialize" );
-        }
-
-        Ogre::String winHandle;
-        switch( wmInfo.subsystem )
-        {
-#    if defined( SDL_VIDEO_DRIVER_WINDOWS )
-        case SDL_SYSWM_WINDOWS:
-            // Windows code
-            winHandle = Ogre::StringConverter::toString( (uintptr_t)wmInfo.info.win.window );
-            break;
-#    endif
-#    if defined( SDL_VIDEO_DRIVER_WINRT )
-        case SDL_SYSWM_WINRT:
-            // Windows code
-            winHandle = Ogre::StringConverter::toString( (uintptr_t)wmInfo.info.winrt.window );
-            break;
-#    endif
-#    if defined( SDL_VIDEO_DRIVER_COCOA )
-        case SDL_SYSWM_COCOA:
-            winHandle = Ogre::StringConverter::toString( WindowContentViewHandle( wmInfo ) );
-            break;
-#    endif
-#    if defined( SDL_VIDEO_DRIVER_X11 )
-        case SDL_SYSWM_X11:
-            winHandle = Ogre::StringConverter::toString( (uintptr_t)wmInfo.info.x11.window );
-            params.insert( std::make_pair(
-                "SDL2x11", Ogre::StringConverter::toString( (uintptr_t)&wmInfo.info.x11 ) ) );
-            break;
-#    endif
-        default:
-            OGRE_EXCEPT( Ogre::Exception::ERR_NOT_IMPLEMENTED, "Unexpected WM! (SDL2)",
-                         "GraphicsSystem::initialize" );
-            break;
-        }
-
-#    if OGRE_PLATFORM == OGRE_PLATFORM_WIN32 || OGRE_PLATFORM == OGRE_PLATFORM_WINRT
-        params.insert( std::make_pair( "externalWindowHandle", winHandle ) );
-#    else
-        params.insert( std::make_pair( "parentWindowHandle", winHandle ) );
-#    endif
+        if( !mHeadless )
+            createSdlWindow( windowTitle, width, height, fullscreen, wmInfo, params );
 #endif
 
 #if OGRE_PLATFORM == OGRE_PLATFORM_ANDROID
@@ -343,7 +481,7 @@ namespace Demo
         if( cfgOpts.find( "VSync Method" ) != cfgOpts.end() )
             params.insert( std::make_pair( "vsync_method", cfgOpts["VSync Method"].currentValue ) );
         params.insert( std::make_pair( "FSAA", cfgOpts["FSAA"].currentValue ) );
-        params.insert( std::make_pair( "vsync", cfgOpts["VSync"].currentValue ) );
+        params.insert( std::make_pair( "vsync", mVSync ? cfgOpts["VSync"].currentValue : "No" ) );
         params.insert( std::make_pair( "reverse_depth", "Yes" ) );
 
         if( mRequirePersistentDepthBuf )
@@ -355,6 +493,12 @@ namespace Demo
             params.insert( std::make_pair( "memoryless_depth_buffer", "Yes" ) );
         }
 
+        if( mMaxFramesInFlight )
+        {
+            params.insert( std::make_pair( "VaoManager::mDynamicBufferMultiplier",
+                                           Ogre::StringConverter::toString( mMaxFramesInFlight ) ) );
+        }
+
         initMiscParamsListener( params );
 
         mRenderWindow = Ogre::Root::getSingleton().createRenderWindow(
@@ -366,17 +510,51 @@ namespace Demo
 
         setupResources();
         loadResources();
+
+        if( mNumMeshStreamingThreads > 0u )
+            mStreamingSceneLoader = new StreamingSceneLoader( mNumMeshStreamingThreads );
         chooseSceneManager();
         createCamera();
         mWorkspace = setupCompositor();
+        warmUpHlmsCaches();
 
 #if OGRE_USE_SDL2
-        mInputHandler =
-            new SdlInputHandler( mSdlWindow, mCurrentGameState, mCurrentGameState, mCurrentGameState );
+        if( !mHeadless )
+        {
+            mInputHandler = new SdlInputHandler( mSdlWindow, mCurrentGameState, mCurrentGameState,
+                                                 mCurrentGameState );
+            if( mLogicSystem )
+                mInputHandler->_setLogicSystem( this, mLogicSystem, mRoot->getTimer() );
+        }
 #endif
 
         BaseSystem::initialize();
 
+        if( !mFrameTimingsCsvPath.empty() )
+        {
+            mFrameTimingsCsv.open( mFrameTimingsCsvPath.c_str(), std::ios::out | std::ios::trunc );
+            if( mFrameTimingsCsv )
+            {
+                mFrameTimingsCsv
+                    << "frame,time_since_last,logic,prepare,submit,prepare_wait,frame_total\n";
+            }
+            else
+            {
+                Ogre::LogManager::getSingleton().logMessage(
+                    "Could not open " + mFrameTimingsCsvPath + " to write frame timings",
+                    Ogre::LML_CRITICAL );
+            }
+        }
+
+        if( !mTelemetryCsvPath.empty() )
+            Telemetry::setExportFile( mTelemetryCsvPath );
+
+        if( mTraceCapturePath.empty() )
+            mTraceCapturePath = mWriteAccessFolder + "PrismTrace.json";
+
+        if( mPipelinedFrames )
+            mPrepareThread = std::thread( &GraphicsSystem::prepareThread, this );
+
 #if OGRE_PROFILING
         Ogre::Profiler::getSingleton().setEnabled( true );
 #    if OGRE_PROFILING == OGRE_PROFILING_INTERNAL
@@ -391,11 +569,43 @@ namespace Demo
     //-----------------------------------------------------------------------------------
     void GraphicsSystem::deinitialize()
     {
+        if( mPrepareThread.joinable() )
+        {
+            {
+                std::lock_guard<std::mutex> lock( mPrepareMutex );
+                mPrepareState = PrepareQuit;
+            }
+            mPrepareCondition.notify_all();
+            mPrepareThread.join();
+            mPrepareState = PrepareIdle;
+        }
+
         BaseSystem::deinitialize();
 
+        // Logs the percentiles, while we still have a log.
+        Telemetry::shutdown();
+        if( TraceRecorder::isEnabled() )
+            TraceRecorder::capture( mTraceCapturePath );
+
+        delete mStreamingSceneLoader;
+        mStreamingSceneLoader = 0;
+
+        if( mFrameTimingsCsv.is_open() )
+            mFrameTimingsCsv.close();
+
+        joinHlmsCacheThreads();
+
         saveTextureCache();
         saveHlmsDiskCache();
 
+        if( mTextureMetadataCache )
+        {
+            if( mRoot->getRenderSystem() )
+                mRoot->getRenderSystem()->getTextureGpuManager()->setMetadataCacheSource( 0 );
+            delete mTextureMetadataCache;
+            mTextureMetadataCache = 0;
+        }
+
         if( mSceneManager )
         {
             Ogre::AtmosphereComponent *atmosphere = mSceneManager->getAtmosphereRaw();
@@ -424,17 +634,34 @@ namespace Demo
             mSdlWindow = 0;
         }
 
-        SDL_Quit();
+        if( !mHeadless )
+            SDL_Quit();
 #endif
     }
     //-----------------------------------------------------------------------------------
     void GraphicsSystem::update( float timeSinceLast )
     {
+        Ogre::Timer *timer = mRoot->getTimer();
+        const Ogre::uint64 frameStart = timer->getMicroseconds();
+        const FramePipelineStats frameStartStats = mFramePipelineStats;
+
+        // Before the GameState's update, so the debug overlay gets fresh percentiles.
+        Telemetry::update();
+        TraceRecorder::update();
+
+        if( !mPipelinedFrames )
+        {
+            mInFlightLogicFrameArrival = mPendingLogicFrameArrival;
+            mPendingLogicFrameArrival = 0;
+            mInFlightLogicFrameInput = mPendingLogicFrameInput;
+            mPendingLogicFrameInput = 0;
+        }
+
         Ogre::WindowEventUtilities::messagePump();
 
 #if OGRE_USE_SDL2
         SDL_Event evt;
-        while( SDL_PollEvent( &evt ) )
+        while( !mHeadless && SDL_PollEvent( &evt ) )
         {
             switch( evt.type )
             {
@@ -451,20 +678,331 @@ namespace Demo
             mInputHandler->_handleSdlEvents( evt );
             handleRawSdlEvent( evt );
         }
+
+        // One message with this frame's input, rather than one per event
+        if( mInputHandler )
+            mInputHandler->_flushInputToLogic();
 #endif
 
         BaseSystem::update( timeSinceLast );
 
-        if( mRenderWindow->isVisible() )
-            mQuit |= !mRoot->renderOneFrame();
+        if( mFloatingOrigin && mLogicSystem )
+        {
+            // The camera is relative to the newest origin we know of.
+            const WorldPosition cameraPosition =
+                mOriginEpochs.back().origin + mCamera->getDerivedPosition();
+            this->queueSendMessage( mLogicSystem, Mq::CAMERA_MOVED, cameraPosition );
+        }
 
-        mAccumTimeSinceLastLogicFrame += timeSinceLast;
+        if( mStreamingSceneLoader )
+        {
+            TraceRecorder::ScopedEvent streamingEvent( "StreamingSceneLoader::update" );
+            mStreamingSceneLoader->update( mCamera, mStreamedGameEntities );
+            for( GameEntity *gameEntity : mStreamedGameEntities )
+                createMovableObject( gameEntity );
+            mStreamedGameEntities.clear();
+        }
+
+        const Ogre::uint64 prepareEnd = timer->getMicroseconds();
+
+        if( mRenderWindow->isVisible() && mPipelinedFrames )
+        {
+            // The prepare thread already advanced mAccumTimeSinceLastLogicFrame.
+            mQuit |= !renderOneFramePipelined( timeSinceLast );
+        }
+        else
+        {
+            if( mRenderWindow->isVisible() )
+            {
+                {
+                    TraceRecorder::ScopedEvent renderEvent( "Root::renderOneFrame" );
+                    mQuit |= !mRoot->renderOneFrame();
+                }
+
+                const Ogre::uint64 submitEnd = timer->getMicroseconds();
+                mFramePipelineStats.prepareMicroseconds += prepareEnd - frameStart;
+                mFramePipelineStats.submitMicroseconds += submitEnd - prepareEnd;
+                Telemetry::record( Telemetry::RenderPrepare, prepareEnd - frameStart );
+                Telemetry::record( Telemetry::RenderSubmit, submitEnd - prepareEnd );
+                addLatencySample( submitEnd );
+            }
+
+            mAccumTimeSinceLastLogicFrame += timeSinceLast;
+        }
+
+        if( !mTimeToFirstSceneFrame && mRenderWindow->isVisible() )
+            notifyFrameRendered( true );
+
+        if( mLogicRequestedExtrapolation )
+            ++mNumExtrapolatedFrames;
+
+        ++mFramePipelineStats.numFrames;
+        mFramePipelineStats.frameMicroseconds += timer->getMicroseconds() - frameStart;
+
+        if( mFrameTimingsCsv.is_open() )
+        {
+            writeFrameTimings( frameStartStats,
+                               static_cast<Ogre::uint64>( double( timeSinceLast ) * 1000000.0 ) );
+        }
+
+        ++mNumFramesRendered;
+        if( mMaxFrames && mNumFramesRendered >= mMaxFrames )
+            mQuit = true;
 
         // SDL_SetWindowPosition( mSdlWindow, 0, 0 );
         /*SDL_Rect rect;
         SDL_GetDisplayBounds( 0, &rect );
         SDL_GetDisplayBounds( 0, &rect );*/
     }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::writeFrameTimings( const FramePipelineStats &frameStartStats,
+                                            Ogre::uint64 timeSinceLastMicroseconds )
+    {
+        const FramePipelineStats &stats = mFramePipelineStats;
+        mFrameTimingsCsv << mNumFramesRendered << ',' << timeSinceLastMicroseconds << ','
+                         << mFrameLogicMicroseconds << ','
+                         << stats.prepareMicroseconds - frameStartStats.prepareMicroseconds << ','
+                         << stats.submitMicroseconds - frameStartStats.submitMicroseconds << ','
+                         << stats.prepareWaitMicroseconds - frameStartStats.prepareWaitMicroseconds
+                         << ',' << stats.frameMicroseconds - frameStartStats.frameMicroseconds
+                         << '\n';
+        mFrameLogicMicroseconds = 0;
+    }
+    //-----------------------------------------------------------------------------------
+    bool GraphicsSystem::renderOneFramePipelined( float timeSinceLast )
+    {
+        // Mirrors Root::renderOneFrame, with the next frame's messages being received
+        // in parallel with _updateAllRenderTargets.
+        if( !mRoot->_fireFrameStarted() )
+            return false;
+
+        Ogre::SceneManagerEnumerator::SceneManagerIterator itor = mRoot->getSceneManagerIterator();
+        {
+            TraceRecorder::ScopedEvent sceneGraphEvent( "SceneManager::updateSceneGraph" );
+            while( itor.hasMoreElements() )
+                itor.getNext()->updateSceneGraph();
+        }
+
+        // The prepare thread doesn't touch the scene: it defers the messages that
+        // would, and the SceneNodes are only written once rendering is done, below.
+        kickPrepareThread( timeSinceLast );
+
+        Ogre::Timer *timer = mRoot->getTimer();
+        const Ogre::uint64 submitStart = timer->getMicroseconds();
+
+        bool retVal;
+        {
+            TraceRecorder::ScopedEvent renderTargetsEvent( "Root::_updateAllRenderTargets" );
+            retVal = mRoot->_updateAllRenderTargets();
+        }
+        if( retVal )
+        {
+            itor = mRoot->getSceneManagerIterator();
+            while( itor.hasMoreElements() )
+                itor.getNext()->clearFrameData();
+
+            // Root::renderOneFrame feeds these, which we're replacing.
+            mRoot->_addFrameStatsSample( timer->getMicroseconds() );
+
+            retVal = mRoot->_fireFrameEnded();
+        }
+
+        const Ogre::uint64 submitEnd = timer->getMicroseconds();
+        mFramePipelineStats.submitMicroseconds += submitEnd - submitStart;
+        Telemetry::record( Telemetry::RenderSubmit, submitEnd - submitStart );
+        addLatencySample( submitEnd );
+
+        {
+            TraceRecorder::ScopedEvent waitEvent( "Wait for prepare thread" );
+            waitForPrepareThread();
+        }
+        mFramePipelineStats.prepareWaitMicroseconds += timer->getMicroseconds() - submitEnd;
+
+        // Rendering is done, so the scene can be written again: apply the scene messages
+        // the prepare thread deferred, then set the SceneNodes for the next frame.
+        processDeferredMessages();
+        updateGameEntities( getGameEntitiesToInterpolate(),
+                            getInterpolationWeight( MainEntryPoints::Frametime ) );
+
+        // The logic frame the prepare thread received will be shown next frame.
+        mInFlightLogicFrameArrival = mPendingLogicFrameArrival;
+        mPendingLogicFrameArrival = 0;
+        mInFlightLogicFrameInput = mPendingLogicFrameInput;
+        mPendingLogicFrameInput = 0;
+
+        return retVal;
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::prepareNextFrame( float timeSinceLast )
+    {
+        Ogre::Timer *timer = mRoot->getTimer();
+        const Ogre::uint64 startTime = timer->getMicroseconds();
+
+        // Same order as the non-pipelined path: the end of this frame's update,
+        // followed by the next frame's beginFrameParallel.
+        mAccumTimeSinceLastLogicFrame += timeSinceLast;
+
+        mDeferSceneMessages = true;
+        this->processIncomingMessages();
+        mDeferSceneMessages = false;
+
+        // This is where most messages arrive when pipelining. See setPipelinedFrames
+        Telemetry::record( Telemetry::RenderQueueDepth, getLastIncomingBytes() );
+
+        const Ogre::uint64 prepareMicroseconds = timer->getMicroseconds() - startTime;
+        mFramePipelineStats.prepareMicroseconds += prepareMicroseconds;
+        Telemetry::record( Telemetry::RenderPrepare, prepareMicroseconds );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::prepareThread()
+    {
+        TraceRecorder::setThreadName( "Prepare" );
+
+        std::unique_lock<std::mutex> lock( mPrepareMutex );
+
+        while( true )
+        {
+            while( mPrepareState == PrepareIdle )
+                mPrepareCondition.wait( lock );
+
+            if( mPrepareState == PrepareQuit )
+                break;
+
+            const float timeSinceLast = mPrepareTimeSinceLast;
+            lock.unlock();
+            {
+                TraceRecorder::ScopedEvent prepareEvent( "Prepare next frame" );
+                prepareNextFrame( timeSinceLast );
+            }
+            lock.lock();
+
+            mPrepareState = PrepareIdle;
+            mPrepareCondition.notify_all();
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::kickPrepareThread( float timeSinceLast )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mPrepareMutex );
+            mPrepareTimeSinceLast = timeSinceLast;
+            mPrepareState = PrepareKicked;
+        }
+        mPrepareCondition.notify_all();
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::waitForPrepareThread()
+    {
+        std::unique_lock<std::mutex> lock( mPrepareMutex );
+        while( mPrepareState == PrepareKicked )
+            mPrepareCondition.wait( lock );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::addLatencySample( Ogre::uint64 submitEndMicroseconds )
+    {
+        if( mInFlightLogicFrameArrival )
+        {
+            mFramePipelineStats.latencyMicroseconds +=
+                submitEndMicroseconds - mInFlightLogicFrameArrival;
+            ++mFramePipelineStats.numLatencySamples;
+            Telemetry::record( Telemetry::LogicToSubmitLatency,
+                               submitEndMicroseconds - mInFlightLogicFrameArrival );
+            mInFlightLogicFrameArrival = 0;
+        }
+
+        if( mInFlightLogicFrameInput )
+        {
+            const Ogre::uint64 latency = submitEndMicroseconds > mInFlightLogicFrameInput
+                                             ? submitEndMicroseconds - mInFlightLogicFrameInput
+                                             : 0u;
+            mFramePipelineStats.inputLatencyMicroseconds += latency;
+            mFramePipelineStats.maxInputLatencyMicroseconds =
+                std::max( mFramePipelineStats.maxInputLatencyMicroseconds, latency );
+            ++mFramePipelineStats.numInputLatencySamples;
+            Telemetry::record( Telemetry::InputToSubmitLatency, latency );
+            mInFlightLogicFrameInput = 0;
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::setPipelinedFrames( bool bPipelined )
+    {
+        assert( !mRoot && "Must be called before initialize" );
+        mPipelinedFrames = bPipelined;
+        // prepareNextFrame records it instead, otherwise we'd get two samples per frame.
+        mTelemetryQueueDepthMetric = bPipelined ? Telemetry::NumMetrics : Telemetry::RenderQueueDepth;
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::setDirtyTracking( bool bDirtyTracking )
+    {
+        assert( !mRoot && "Must be called before initialize" );
+        mDirtyTracking = bDirtyTracking;
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::setFloatingOrigin( bool bFloatingOrigin )
+    {
+        assert( !mRoot && "Must be called before initialize" );
+        mFloatingOrigin = bFloatingOrigin;
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::resetFramePipelineStats()
+    {
+        memset( &mFramePipelineStats, 0, sizeof( mFramePipelineStats ) );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::logFramePipelineStats() const
+    {
+        const FramePipelineStats &stats = mFramePipelineStats;
+        const double numFrames = double( std::max<Ogre::uint64>( stats.numFrames, 1u ) );
+        const double numLatencySamples =
+            double( std::max<Ogre::uint64>( stats.numLatencySamples, 1u ) );
+        const double numInputLatencySamples =
+            double( std::max<Ogre::uint64>( stats.numInputLatencySamples, 1u ) );
+
+        Ogre::LogManager::getSingleton().logMessage(
+            Ogre::String( "GraphicsSystem frame pipeline (" ) +
+            ( mPipelinedFrames ? "pipelined" : "serial" ) + ") over " +
+            Ogre::StringConverter::toString( stats.numFrames ) + " frames. Avg ms per frame: " +
+            Ogre::StringConverter::toString( double( stats.frameMicroseconds ) / numFrames / 1000.0 ) +
+            " Prepare: " +
+            Ogre::StringConverter::toString( double( stats.prepareMicroseconds ) / numFrames / 1000.0 ) +
+            " Submit: " +
+            Ogre::StringConverter::toString( double( stats.submitMicroseconds ) / numFrames / 1000.0 ) +
+            " Wait for prepare: " +
+            Ogre::StringConverter::toString( double( stats.prepareWaitMicroseconds ) / numFrames /
+                                             1000.0 ) +
+            " Logic to submit latency: " +
+            Ogre::StringConverter::toString( double( stats.latencyMicroseconds ) /
+                                             numLatencySamples / 1000.0 ) +
+            " Input to submit latency: " +
+            Ogre::StringConverter::toString( double( stats.inputLatencyMicroseconds ) /
+                                             numInputLatencySamples / 1000.0 ) +
+            " (max " +
+            Ogre::StringConverter::toString( double( stats.maxInputLatencyMicroseconds ) / 1000.0 ) +
+            ", " + Ogre::StringConverter::toString( stats.numInputLatencySamples ) + " samples)" );
+
+        if( !stats.numInterpolations )
+            return;
+
+        const double numInterpolations = double( stats.numInterpolations );
+        const double numInterpolated = double( stats.numInterpolatedEntities ) / numInterpolations;
+        const double numDynamic = double( stats.numDynamicEntities ) / numInterpolations;
+        const double interpolateMs = double( stats.interpolateMicroseconds ) / numInterpolations /
+                                     1000.0;
+        // What skipping the sleeping ones saved, at the measured cost per entity.
+        const double savedMs =
+            numInterpolated > 0.0 ? interpolateMs / numInterpolated * ( numDynamic - numInterpolated )
+                                  : 0.0;
+
+        Ogre::LogManager::getSingleton().logMessage(
+            Ogre::String( "GraphicsSystem interpolation (dirty tracking " ) +
+            ( mDirtyTracking ? "on" : "off" ) + "). Avg entities interpolated: " +
+            Ogre::StringConverter::toString( numInterpolated ) + " of " +
+            Ogre::StringConverter::toString( numDynamic ) + " dynamic (" +
+            Ogre::StringConverter::toString(
+                numDynamic > 0.0 ? ( 1.0 - numInterpolated / numDynamic ) * 100.0 : 0.0 ) +
+            "% asleep). Avg ms: " + Ogre::StringConverter::toString( interpolateMs ) +
+            " Est. saved: " + Ogre::StringConverter::toString( savedMs ) );
+    }
 //-----------------------------------------------------------------------------------
 #if OGRE_USE_SDL2
     void GraphicsSystem::handleWindowEvent( const SDL_Event &evt )
@@ -513,35 +1051,94 @@ namespace Demo
     //-----------------------------------------------------------------------------------
     void GraphicsSystem::processIncomingMessage( Mq::MessageId messageId, const void *data )
     {
+        if( mDeferSceneMessages && messageId != Mq::LOGICFRAME_FINISHED &&
+            messageId != Mq::INPUT_CONSUMED && messageId != Mq::GAME_ENTITIES_AWAKE_BATCH )
+        {
+            // Everything else creates or destroys scene objects, which the render thread
+            // may be using right now. See setPipelinedFrames.
+            deferIncomingMessage( data );
+            return;
+        }
+
         switch( messageId )
         {
         case Mq::LOGICFRAME_FINISHED:
         {
             Ogre::uint32 newIdx = *reinterpret_cast<const Ogre::uint32 *>( data );
 
-            if( newIdx != std::numeric_limits<Ogre::uint32>::max() )
+            if( newIdx == Mq::cLogicFrameExtrapolate )
+            {
+                mLogicRequestedExtrapolation = true;
+            }
+            else if( newIdx != Mq::cLogicFrameSkipped )
             {
                 mAccumTimeSinceLastLogicFrame = 0;
+                mLogicRequestedExtrapolation = false;
                 // Tell the LogicSystem we're no longer using the index previous to the current one.
                 this->queueSendMessage(
                     mLogicSystem, Mq::LOGICFRAME_FINISHED,
-                    ( mCurrentTransformIdx + NUM_GAME_ENTITY_BUFFERS - 1 ) % NUM_GAME_ENTITY_BUFFERS );
+                    ( mCurrentTransformIdx + mNumGameEntityBuffers - 1 ) % mNumGameEntityBuffers );
 
-                assert( ( mCurrentTransformIdx + 1 ) % NUM_GAME_ENTITY_BUFFERS == newIdx &&
+                assert( ( mCurrentTransformIdx + 1 ) % mNumGameEntityBuffers == newIdx &&
                         "Graphics is receiving indices out of order!!!" );
 
                 // Get the new index the LogicSystem is telling us to use.
                 mCurrentTransformIdx = newIdx;
+
+                if( mDirtyTracking )
+                    swapAwakeGameEntities();
+
+                if( !mPendingLogicFrameArrival && mRoot )
+                    mPendingLogicFrameArrival = mRoot->getTimer()->getMicroseconds();
+
+                // Keep the oldest if the previous frame hasn't been rendered yet
+                if( mConsumedInputTime && !mPendingLogicFrameInput )
+                    mPendingLogicFrameInput = mConsumedInputTime;
+                mConsumedInputTime = 0;
             }
         }
         break;
+        case Mq::INPUT_CONSUMED:
+        {
+            const Ogre::uint64 inputTime = *reinterpret_cast<const Ogre::uint64 *>( data );
+            if( !mConsumedInputTime || inputTime < mConsumedInputTime )
+                mConsumedInputTime = inputTime;
+        }
+        break;
         case Mq::GAME_ENTITY_ADDED:
             gameEntityAdded( reinterpret_cast<const GameEntityManager::CreatedGameEntity *>( data ) );
             break;
         case Mq::GAME_ENTITY_REMOVED:
             gameEntityRemoved( *reinterpret_cast<GameEntity *const *>( data ) );
             break;
+        case Mq::GAME_ENTITY_ADDED_BATCH:
+        {
+            size_t numEntities;
+            const GameEntityManager::CreatedGameEntity *cges =
+                getMessageArray<GameEntityManager::CreatedGameEntity>( data, numEntities );
+            gameEntitiesAdded( cges, numEntities );
+        }
+        break;
+        case Mq::GAME_ENTITY_REMOVED_BATCH:
+        {
+            size_t numEntities;
+            GameEntity *const *toRemove = getMessageArray<GameEntity *>( data, numEntities );
+            gameEntitiesRemoved( toRemove, numEntities );
+        }
+        break;
+        case Mq::GAME_ENTITIES_AWAKE_BATCH:
+        {
+            size_t numEntities;
+            GameEntity *const *awake = getMessageArray<GameEntity *>( data, numEntities );
+            mPendingAwakeGameEntities.insert( mPendingAwakeGameEntities.end(), awake,
+                                              awake + numEntities );
+        }
+        break;
+        case Mq::ORIGIN_REBASED:
+            originRebased( *reinterpret_cast<const GameEntityManager::OriginRebased *>( data ) );
+            break;
         case Mq::GAME_ENTITY_SCHEDULED_FOR_REMOVAL_SLOT:
+            destroyPendingGameEntities();
             // Acknowledge/notify back that we're done with this slot.
             this->queueSendMessage( mLogicSystem, Mq::GAME_ENTITY_SCHEDULED_FOR_REMOVAL_SLOT,
                                     *reinterpret_cast<const Ogre::uint32 *>( data ) );
@@ -567,7 +1164,19 @@ namespace Demo
     //-----------------------------------------------------------------------------------
     void GraphicsSystem::loadTextureCache()
     {
+        Ogre::TextureGpuManager *textureManager = mRoot->getRenderSystem()->getTextureGpuManager();
+
+        // The binary cache is memory mapped and queried as textures get loaded; nothing
+        // to parse. See TextureMetadataCache
+        mTextureMetadataCache = new TextureMetadataCache();
+        if( mTextureMetadataCache->open( mWriteAccessFolder + "/textureMetadataCache.bin" ) )
+        {
+            textureManager->setMetadataCacheSource( mTextureMetadataCache );
+            return;
+        }
+
 #if !OGRE_NO_JSON
+        // Import the old JSON cache, if any. It gets converted on shutdown.
         Ogre::ArchiveManager &archiveManager = Ogre::ArchiveManager::getSingleton();
         Ogre::Archive *rwAccessFolderArchive =
             archiveManager.load( mWriteAccessFolder, "FileSystem", true );
@@ -584,8 +1193,6 @@ namespace Demo
                     stream->read( &fileData[0], stream->size() );
                     // Add null terminator just in case (to prevent bad input)
                     fileData.back() = '\0';
-                    Ogre::TextureGpuManager *textureManager =
-                        mRoot->getRenderSystem()->getTextureGpuManager();
                     textureManager->importTextureMetadataCache( stream->getName(), &fileData[0], false );
                 }
             }
@@ -593,7 +1200,7 @@ namespace Demo
             {
                 Ogre::LogManager::getSingleton().logMessage( "[INFO] Texture cache not found at " +
                                                              mWriteAccessFolder +
-                                                             "/textureMetadataCache.json" );
+                                                             "/textureMetadataCache.bin" );
             }
         }
         catch( Ogre::Exception &e )
@@ -603,94 +1210,274 @@ namespace Demo
 
         archiveManager.unload( rwAccessFolderArchive );
 #endif
+
+        textureManager->setMetadataCacheSource( mTextureMetadataCache );
     }
     //-----------------------------------------------------------------------------------
     void GraphicsSystem::saveTextureCache()
     {
-        if( mRoot->getRenderSystem() )
+        if( mRoot->getRenderSystem() && mTextureMetadataCache )
+        {
+            Ogre::TextureGpuManager *textureManager = mRoot->getRenderSystem()->getTextureGpuManager();
+            if( textureManager )
+            {
+                mTextureMetadataCache->save( mWriteAccessFolder + "/textureMetadataCache.bin",
+                                             textureManager->getMetadataCache() );
+
+                if( mExportTextureCacheJson )
+                {
+                    Ogre::String jsonString;
+                    mTextureMetadataCache->exportJson( jsonString );
+                    const Ogre::String path = mWriteAccessFolder + "/textureMetadataCache.json";
+                    std::ofstream file( path.c_str(), std::ios::binary | std::ios::out );
+                    if( file.is_open() )
+                    {
+                        file.write( jsonString.c_str(),
+                                    static_cast<std::streamsize>( jsonString.size() ) );
+                    }
+                    file.close();
+                }
+            }
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    static Ogre::DataStreamPtr readCacheFile( const Ogre::String &folder, const Ogre::String &filename )
+    {
+        std::ifstream file( ( folder + "/" + filename ).c_str(),
+                            std::ios::binary | std::ios::in | std::ios::ate );
+        if( !file.is_open() )
+            return Ogre::DataStreamPtr();
+
+        const std::streamoff fileSize = file.tellg();
+        if( fileSize <= 0 )
+            return Ogre::DataStreamPtr();
+        file.seekg( 0 );
+
+        Ogre::DataStreamPtr stream( OGRE_NEW Ogre::MemoryDataStream(
+            filename, static_cast<size_t>( fileSize ) ) );
+        file.read( reinterpret_cast<char *>(
+                       static_cast<Ogre::MemoryDataStream *>( stream.get() )->getPtr() ),
+                   static_cast<std::streamsize>( fileSize ) );
+
+        // A short read (e.g. the file is being rewritten) would feed garbage to the
+        // cache loaders. Behave as if there was no cache.
+        if( file.fail() || file.gcount() != static_cast<std::streamsize>( fileSize ) )
+            return Ogre::DataStreamPtr();
+
+        return stream;
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::startHlmsCacheLoad()
+    {
+        if( !mUseMicrocodeCache && !mUseHlmsDiskCache )
+            return;
+
+        mHlmsCacheIoThread = std::thread( &GraphicsSystem::hlmsCacheIoThread, this );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::hlmsCacheIoThread()
+    {
+        // Plain file I/O. Ogre isn't thread safe, the caches are applied from the main thread.
+        if( mUseMicrocodeCache /* mUsePipelineCache */ )
+            mPipelineCacheStream = readCacheFile( mWriteAccessFolder, "pipelineCache.cache" );
+        if( mUseMicrocodeCache )
+            mMicrocodeCacheStream = readCacheFile( mWriteAccessFolder, "microcodeCodeCache.cache" );
+
+        mHlmsCacheStreams.resize( Ogre::HLMS_MAX );
+        if( mUseHlmsDiskCache )
+        {
+            for( size_t i = Ogre::HLMS_LOW_LEVEL + 1u; i < Ogre::HLMS_MAX; ++i )
+            {
+                mHlmsCacheStreams[i] = readCacheFile(
+                    mWriteAccessFolder,
+                    "hlmsDiskCache" + Ogre::StringConverter::toString( i ) + ".bin" );
+            }
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::loadHlmsDiskCache()
+    {
+        if( !mHlmsCacheIoThread.joinable() )
+            return;
+
+        mHlmsCacheIoThread.join();
+
+        if( mPipelineCacheStream )
+            mRoot->getRenderSystem()->loadPipelineCache( mPipelineCacheStream );
+
+        if( mUseMicrocodeCache )
+        {
+            // Make sure the microcode cache is enabled.
+            Ogre::GpuProgramManager::getSingleton().setSaveMicrocodesToCache( true );
+            if( mMicrocodeCacheStream )
+                Ogre::GpuProgramManager::getSingleton().loadMicrocodeCache( mMicrocodeCacheStream );
+        }
+
+        mPipelineCacheStream.reset();
+        mMicrocodeCacheStream.reset();
+
+        Ogre::HlmsManager *hlmsManager = mRoot->getHlmsManager();
+
+        for( size_t i = Ogre::HLMS_LOW_LEVEL + 1u; i < mHlmsCacheStreams.size(); ++i )
+        {
+            Ogre::Hlms *hlms = hlmsManager->getHlms( static_cast<Ogre::HlmsTypes>( i ) );
+            if( hlms && mHlmsCacheStreams[i] )
+            {
+                HlmsWarmUp warmUp;
+                warmUp.hlms = hlms;
+                warmUp.diskCache = new Ogre::HlmsDiskCache( hlmsManager );
+                warmUp.filename = mHlmsCacheStreams[i]->getName();
+
+                try
+                {
+                    // Touches the HlmsManager's blocks; can't be done in the background.
+                    warmUp.diskCache->loadFrom( mHlmsCacheStreams[i] );
+                    mHlmsWarmUps.push_back( warmUp );
+                }
+                catch( Ogre::Exception & )
+                {
+                    Ogre::LogManager::getSingleton().logMessage(
+                        "Error loading cache from " + mWriteAccessFolder + "/" + warmUp.filename +
+                        "! If you have issues, try deleting the file "
+                        "and restarting the app" );
+                    delete warmUp.diskCache;
+                }
+            }
+        }
+        mHlmsCacheStreams.clear();
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::applyHlmsWarmUp( size_t warmUpIdx, size_t numThreads )
+    {
+        const HlmsWarmUp &warmUp = mHlmsWarmUps[warmUpIdx];
+        try
         {
-            Ogre::TextureGpuManager *textureManager = mRoot->getRenderSystem()->getTextureGpuManager();
-            if( textureManager )
-            {
-                Ogre::String jsonString;
-                textureManager->exportTextureMetadataCache( jsonString );
-                const Ogre::String path = mWriteAccessFolder + "/textureMetadataCache.json";
-                std::ofstream file( path.c_str(), std::ios::binary | std::ios::out );
-                if( file.is_open() )
-                    file.write( jsonString.c_str(), static_cast<std::streamsize>( jsonString.size() ) );
-                file.close();
-            }
+            warmUp.diskCache->applyTo( warmUp.hlms, numThreads );
+        }
+        catch( Ogre::Exception & )
+        {
+            Ogre::LogManager::getSingleton().logMessage(
+                "Error loading cache from " + mWriteAccessFolder + "/" + warmUp.filename +
+                "! If you have issues, try deleting the file "
+                "and restarting the app" );
         }
     }
     //-----------------------------------------------------------------------------------
-    void GraphicsSystem::loadHlmsDiskCache()
+    void GraphicsSystem::warmUpHlmsCaches()
     {
-        if( !mUseMicrocodeCache && !mUseHlmsDiskCache )
+        if( mHlmsWarmUps.empty() )
             return;
 
-        Ogre::HlmsManager *hlmsManager = mRoot->getHlmsManager();
-        Ogre::HlmsDiskCache diskCache( hlmsManager );
+        mHlmsWarmUpStart = SteadyClock::getMicroseconds();
 
-        Ogre::ArchiveManager &archiveManager = Ogre::ArchiveManager::getSingleton();
+        Ogre::CompositorWorkspace *loadingWorkspace = createLoadingWorkspace();
+        const bool bWorkspaceEnabled = mWorkspace && mWorkspace->getEnabled();
+        if( bWorkspaceEnabled )
+            mWorkspace->setEnabled( false );
 
-        Ogre::Archive *rwAccessFolderArchive =
-            archiveManager.load( mWriteAccessFolder, "FileSystem", true );
+        // applyTo falls back to a single thread if the RenderSystem can't compile
+        // shaders from other threads (e.g. GL).
+        const size_t numThreads =
+            std::max<size_t>( 1u, Ogre::PlatformInformation::getNumLogicalCores() );
 
-        if( mUseMicrocodeCache /* mUsePipelineCache */ )
-        {
-            const Ogre::String filename = "pipelineCache.cache";
-            if( rwAccessFolderArchive->exists( filename ) )
-            {
-                Ogre::DataStreamPtr pipelineCacheFile = rwAccessFolderArchive->open( filename );
-                mRoot->getRenderSystem()->loadPipelineCache( pipelineCacheFile );
-            }
-        }
+        const size_t numCaches = mHlmsWarmUps.size();
+        size_t numLoadingFrames = 0u;
 
-        if( mUseMicrocodeCache )
+        for( size_t i = 0u; i < numCaches; ++i )
         {
-            // Make sure the microcode cache is enabled.
-            Ogre::GpuProgramManager::getSingleton().setSaveMicrocodesToCache( true );
-            const Ogre::String filename = "microcodeCodeCache.cache";
-            if( rwAccessFolderArchive->exists( filename ) )
+            Ogre::WindowEventUtilities::messagePump();
+#if OGRE_USE_SDL2
+            // Keep the window responsive. Events stay queued until update() processes them.
+            if( !mHeadless )
+                SDL_PumpEvents();
+#endif
+            if( mRenderWindow->isVisible() )
             {
-                Ogre::DataStreamPtr shaderCacheFile = rwAccessFolderArchive->open( filename );
-                Ogre::GpuProgramManager::getSingleton().loadMicrocodeCache( shaderCacheFile );
+                mRoot->renderOneFrame();
+                notifyFrameRendered( false );
+                ++numLoadingFrames;
             }
+
+            applyHlmsWarmUp( i, numThreads );
         }
 
-        if( mUseHlmsDiskCache )
+        joinHlmsCacheThreads();
+
+        mRoot->getCompositorManager2()->removeWorkspace( loadingWorkspace );
+        if( bWorkspaceEnabled )
+            mWorkspace->setEnabled( true );
+
+        mHlmsWarmUpMicroseconds = SteadyClock::getMicroseconds() - mHlmsWarmUpStart;
+
+        Ogre::LogManager::getSingleton().logMessage(
+            "HLMS disk caches (" + Ogre::StringConverter::toString( numCaches ) +
+            ") compiled in " + Ogre::StringConverter::toString( mHlmsWarmUpMicroseconds / 1000u ) +
+            "ms. " + Ogre::StringConverter::toString( numLoadingFrames ) +
+            " loading frames were shown." );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::joinHlmsCacheThreads()
+    {
+        if( mHlmsCacheIoThread.joinable() )
+            mHlmsCacheIoThread.join();
+
+        for( size_t i = 0u; i < mHlmsWarmUps.size(); ++i )
+            delete mHlmsWarmUps[i].diskCache;
+        mHlmsWarmUps.clear();
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::CompositorWorkspace *GraphicsSystem::createLoadingWorkspace()
+    {
+        Ogre::CompositorManager2 *compositorManager = mRoot->getCompositorManager2();
+
+        const Ogre::String workspaceName( "Demo Loading Workspace" );
+        if( !compositorManager->hasWorkspaceDefinition( workspaceName ) )
         {
-            const size_t numThreads =
-                std::max<size_t>( 1u, Ogre::PlatformInformation::getNumLogicalCores() );
-            for( size_t i = Ogre::HLMS_LOW_LEVEL + 1u; i < Ogre::HLMS_MAX; ++i )
+            // Like CompositorManager2::createBasicWorkspaceDef, with a clear instead of
+            // a scene pass.
+            Ogre::CompositorNodeDef *nodeDef =
+                compositorManager->addNodeDefinition( workspaceName + "/Node" );
+            nodeDef->addTextureSourceName( "WindowRT", 0,
+                                           Ogre::TextureDefinitionBase::TEXTURE_INPUT );
+            nodeDef->setNumTargetPass( 1 );
             {
-                Ogre::Hlms *hlms = hlmsManager->getHlms( static_cast<Ogre::HlmsTypes>( i ) );
-                if( hlms )
+                Ogre::CompositorTargetDef *targetDef = nodeDef->addTargetPass( "WindowRT" );
+                targetDef->setNumPasses( 1 );
                 {
-                    Ogre::String filename =
-                        "hlmsDiskCache" + Ogre::StringConverter::toString( i ) + ".bin";
-
-                    try
-                    {
-                        if( rwAccessFolderArchive->exists( filename ) )
-                        {
-                            Ogre::DataStreamPtr diskCacheFile = rwAccessFolderArchive->open( filename );
-                            diskCache.loadFrom( diskCacheFile );
-                            diskCache.applyTo( hlms, numThreads );
-                        }
-                    }
-                    catch( Ogre::Exception & )
-                    {
-                        Ogre::LogManager::getSingleton().logMessage(
-                            "Error loading cache from " + mWriteAccessFolder + "/" + filename +
-                            "! If you have issues, try deleting the file "
-                            "and restarting the app" );
-                    }
+                    Ogre::CompositorPassClearDef *passClear =
+                        static_cast<Ogre::CompositorPassClearDef *>(
+                            targetDef->addPass( Ogre::PASS_CLEAR ) );
+                    passClear->setAllClearColours( mBackgroundColour );
                 }
             }
+
+            Ogre::CompositorWorkspaceDef *workDef =
+                compositorManager->addWorkspaceDefinition( workspaceName );
+            workDef->connectExternal( 0, nodeDef->getName(), 0 );
         }
 
-        archiveManager.unload( mWriteAccessFolder );
+        return compositorManager->addWorkspace( mSceneManager, mRenderWindow->getTexture(), mCamera,
+                                                workspaceName, true );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::notifyFrameRendered( bool bSceneFrame )
+    {
+        const Ogre::uint64 elapsed = SteadyClock::getMicroseconds() - mInitializeStart;
+
+        if( !mTimeToFirstFrame )
+        {
+            mTimeToFirstFrame = std::max<Ogre::uint64>( elapsed, 1u );
+            Ogre::LogManager::getSingleton().logMessage(
+                "Time to first frame: " + Ogre::StringConverter::toString( elapsed / 1000u ) +
+                "ms" );
+        }
+        if( bSceneFrame && !mTimeToFirstSceneFrame )
+        {
+            mTimeToFirstSceneFrame = std::max<Ogre::uint64>( elapsed, 1u );
+            Ogre::LogManager::getSingleton().logMessage(
+                "Time to first scene frame: " + Ogre::StringConverter::toString( elapsed / 1000u ) +
+                "ms" );
+        }
     }
     //-----------------------------------------------------------------------------------
     void GraphicsSystem::saveHlmsDiskCache()
@@ -871,6 +1658,9 @@ namespace Demo
         loadTextureCache();
         loadHlmsDiskCache();
 
+        // Converted v1 meshes are cached next to the HLMS caches. See MeshUtils::importV1Mesh
+        MeshUtils::setMeshCacheFolder( mUseMeshCache ? mWriteAccessFolder : Ogre::String() );
+
         // Initialise, parse scripts etc
         Ogre::ResourceGroupManager::getSingleton().initialiseAllResourceGroups( true );
 
@@ -910,7 +1700,10 @@ namespace Demo
         const size_t numThreads = 1;
 #else
         // getNumLogicalCores() may return 0 if couldn't detect
-        const size_t numThreads = std::max<size_t>( 1, Ogre::PlatformInformation::getNumLogicalCores() );
+        const size_t numThreads =
+            mNumSceneManagerThreads
+                ? mNumSceneManagerThreads
+                : std::max<size_t>( 1, Ogre::PlatformInformation::getNumLogicalCores() );
 #endif
         // Create the SceneManager, in this case a generic one
         mSceneManager = mRoot->createSceneManager( Ogre::ST_GENERIC, numThreads, "ExampleSMInstance" );
@@ -1017,127 +1810,602 @@ namespace Demo
     {
         bool operator()( const GameEntity *_l, const Ogre::Matrix4 *RESTRICT_ALIAS _r ) const
         {
-            const Ogre::Transform &transform = _l->mSceneNode->_getTransform();
+            const Ogre::Transform &transform = _l->mGraphics->sceneNode->_getTransform();
             return &transform.mDerivedTransform[transform.mIndex] < _r;
         }
 
         bool operator()( const Ogre::Matrix4 *RESTRICT_ALIAS _r, const GameEntity *_l ) const
         {
-            const Ogre::Transform &transform = _l->mSceneNode->_getTransform();
+            const Ogre::Transform &transform = _l->mGraphics->sceneNode->_getTransform();
             return _r < &transform.mDerivedTransform[transform.mIndex];
         }
 
         bool operator()( const GameEntity *_l, const GameEntity *_r ) const
         {
-            const Ogre::Transform &lTransform = _l->mSceneNode->_getTransform();
-            const Ogre::Transform &rTransform = _r->mSceneNode->_getTransform();
+            const Ogre::Transform &lTransform = _l->mGraphics->sceneNode->_getTransform();
+            const Ogre::Transform &rTransform = _r->mGraphics->sceneNode->_getTransform();
             return &lTransform.mDerivedTransform[lTransform.mIndex] <
                    &rTransform.mDerivedTransform[rTransform.mIndex];
         }
     };
     //-----------------------------------------------------------------------------------
-    void GraphicsSystem::gameEntityAdded( const GameEntityManager::CreatedGameEntity *cge )
+    void GraphicsSystem::createSceneNodeAndObject( const GameEntityManager::CreatedGameEntity *cge )
     {
-        Ogre::SceneNode *sceneNode =
-            mSceneManager->getRootSceneNode( cge->gameEntity->mType )
-                ->createChildSceneNode( cge->gameEntity->mType, cge->initialTransform.vPos,
-                                        cge->initialTransform.qRot );
+        Ogre::SceneNode *parentNode = mSceneManager->getRootSceneNode( cge->gameEntity->mType );
+        if( mFloatingOrigin )
+        {
+            parentNode = getOriginSceneNode( cge->originEpoch, cge->gameEntity->mType );
+            assert( parentNode && "Mq::ORIGIN_REBASED must arrive before its GameEntities!" );
+        }
+
+        Ogre::SceneNode *sceneNode = parentNode->createChildSceneNode(
+            cge->gameEntity->mType, cge->initialTransform.vPos, cge->initialTransform.qRot );
 
         sceneNode->setScale( cge->initialTransform.vScale );
 
-        cge->gameEntity->mSceneNode = sceneNode;
+        GameEntityGraphics *graphics = cge->gameEntity->mGraphics;
+        graphics->sceneNode = sceneNode;
+        graphics->originEpoch = cge->originEpoch;
 
-        if( cge->gameEntity->mMoDefinition->moType == MoTypeItem )
+        // The SceneNode stays as a placeholder until the mesh is loaded.
+        if( mStreamingSceneLoader && mStreamingSceneLoader->addGameEntity( cge->gameEntity ) )
+            return;
+
+        createMovableObject( cge->gameEntity );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::createMovableObject( GameEntity *gameEntity )
+    {
+        GameEntityGraphics *graphics = gameEntity->mGraphics;
+
+        if( gameEntity->mMoDefinition->moType == MoTypeItem )
         {
-            Ogre::Item *item = mSceneManager->createItem( cge->gameEntity->mMoDefinition->meshName,
-                                                          cge->gameEntity->mMoDefinition->resourceGroup,
-                                                          cge->gameEntity->mType );
+            Ogre::Item *item = mSceneManager->createItem( gameEntity->mMoDefinition->meshName,
+                                                          gameEntity->mMoDefinition->resourceGroup,
+                                                          gameEntity->mType );
 
-            Ogre::StringVector materialNames = cge->gameEntity->mMoDefinition->submeshMaterials;
+            const Ogre::StringVector &materialNames = gameEntity->mMoDefinition->submeshMaterials;
             size_t minMaterials = std::min( materialNames.size(), item->getNumSubItems() );
 
             for( size_t i = 0; i < minMaterials; ++i )
             {
                 item->getSubItem( i )->setDatablockOrMaterialName(
-                    materialNames[i], cge->gameEntity->mMoDefinition->resourceGroup );
+                    materialNames[i], gameEntity->mMoDefinition->resourceGroup );
             }
 
-            cge->gameEntity->mMovableObject = item;
+            graphics->movableObject = item;
+        }
+
+        graphics->sceneNode->attachObject( graphics->movableObject );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::destroySceneNodeAndObject( GameEntity *toRemove )
+    {
+        GameEntityGraphics *graphics = toRemove->mGraphics;
+
+        graphics->sceneNode->getParentSceneNode()->removeAndDestroyChild( graphics->sceneNode );
+        graphics->sceneNode = 0;
+
+        if( !graphics->movableObject )
+        {
+            // Its mesh was still being streamed (or failed to load)
+            if( mStreamingSceneLoader )
+                mStreamingSceneLoader->removeGameEntity( toRemove );
+            return;
         }
 
-        sceneNode->attachObject( cge->gameEntity->mMovableObject );
+        assert( dynamic_cast<Ogre::Item *>( graphics->movableObject ) );
+
+        mSceneManager->destroyItem( static_cast<Ogre::Item *>( graphics->movableObject ) );
+        graphics->movableObject = 0;
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::gameEntityAdded( const GameEntityManager::CreatedGameEntity *cge )
+    {
+        createSceneNodeAndObject( cge );
 
         // Keep them sorted on how Ogre's internal memory manager assigned them memory,
         // to avoid false cache sharing when we update the nodes concurrently.
-        const Ogre::Transform &transform = sceneNode->_getTransform();
+        const Ogre::Transform &transform = cge->gameEntity->mGraphics->sceneNode->_getTransform();
         GameEntityVec::iterator itGameEntity = std::lower_bound(
             mGameEntities[cge->gameEntity->mType].begin(), mGameEntities[cge->gameEntity->mType].end(),
             &transform.mDerivedTransform[transform.mIndex], GameEntityCmp() );
         mGameEntities[cge->gameEntity->mType].insert( itGameEntity, cge->gameEntity );
+
+        insertAwakeGameEntities( cge, 1u );
     }
     //-----------------------------------------------------------------------------------
     void GraphicsSystem::gameEntityRemoved( GameEntity *toRemove )
     {
-        const Ogre::Transform &transform = toRemove->mSceneNode->_getTransform();
-        GameEntityVec::iterator itGameEntity = std::lower_bound(
-            mGameEntities[toRemove->mType].begin(), mGameEntities[toRemove->mType].end(),
-            &transform.mDerivedTransform[transform.mIndex], GameEntityCmp() );
+        mPendingRemovals.push_back( toRemove );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::gameEntitiesAdded( const GameEntityManager::CreatedGameEntity *cges,
+                                            size_t numEntities )
+    {
+        // Create all the nodes first, back to back. Ogre's NodeMemoryManager doesn't expose
+        // a way to reserve memory upfront, but creating them in one go means it grows at
+        // most once per batch, and the new nodes end up contiguous in memory.
+        for( size_t i = 0; i < numEntities; ++i )
+            createSceneNodeAndObject( &cges[i] );
+
+        for( size_t i = 0; i < Ogre::NUM_SCENE_MEMORY_MANAGER_TYPES; ++i )
+        {
+            GameEntityVec &gameEntities = mGameEntities[i];
+            const size_t oldSize = gameEntities.size();
+
+            for( size_t j = 0; j < numEntities; ++j )
+            {
+                if( cges[j].gameEntity->mType == static_cast<Ogre::SceneMemoryMgrTypes>( i ) )
+                    gameEntities.push_back( cges[j].gameEntity );
+            }
+
+            // Keep them sorted on how Ogre's internal memory manager assigned them memory
+            // (see gameEntityAdded). Sort the new ones, then merge with the existing.
+            if( gameEntities.size() != oldSize )
+                ContainerUtils::mergeSorted( gameEntities, oldSize, GameEntityCmp() );
+        }
+
+        insertAwakeGameEntities( cges, numEntities );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::swapAwakeGameEntities()
+    {
+        mAwakeGameEntities.clear();
+
+        GameEntityVec::const_iterator itor = mPendingAwakeGameEntities.begin();
+        GameEntityVec::const_iterator endt = mPendingAwakeGameEntities.end();
+        while( itor != endt )
+        {
+            // Its Mq::GAME_ENTITY_ADDED got deferred. See insertAwakeGameEntities
+            if( ( *itor )->mGraphics->sceneNode )
+                mAwakeGameEntities.push_back( *itor );
+            ++itor;
+        }
+        mPendingAwakeGameEntities.clear();
+
+        // Same order as mGameEntities, so updateGameEntities can still interpolate
+        // whole node blocks at once.
+        std::sort( mAwakeGameEntities.begin(), mAwakeGameEntities.end(), GameEntityCmp() );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::insertAwakeGameEntities( const GameEntityManager::CreatedGameEntity *cges,
+                                                  size_t numEntities )
+    {
+        if( !mDirtyTracking )
+            return;
+
+        const size_t oldSize = mAwakeGameEntities.size();
+        for( size_t i = 0; i < numEntities; ++i )
+        {
+            if( cges[i].gameEntity->mType == Ogre::SCENE_DYNAMIC )
+                mAwakeGameEntities.push_back( cges[i].gameEntity );
+        }
+
+        if( mAwakeGameEntities.size() != oldSize )
+            ContainerUtils::mergeSorted( mAwakeGameEntities, oldSize, GameEntityCmp() );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::gameEntitiesRemoved( GameEntity *const *toRemove, size_t numEntities )
+    {
+        mPendingRemovals.insert( mPendingRemovals.end(), toRemove, toRemove + numEntities );
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::destroyPendingGameEntities()
+    {
+        if( mPendingRemovals.empty() )
+            return;
+
+        GameEntity *const *toRemove = &mPendingRemovals[0];
+        const size_t numEntities = mPendingRemovals.size();
+
+        for( size_t i = 0; i < Ogre::NUM_SCENE_MEMORY_MANAGER_TYPES; ++i )
+        {
+            mTmpGameEntities.clear();
+            for( size_t j = 0; j < numEntities; ++j )
+            {
+                if( toRemove[j]->mType == static_cast<Ogre::SceneMemoryMgrTypes>( i ) )
+                    mTmpGameEntities.push_back( toRemove[j] );
+            }
+
+            if( mTmpGameEntities.empty() )
+                continue;
 
-        assert( itGameEntity != mGameEntities[toRemove->mType].end() && *itGameEntity == toRemove );
-        mGameEntities[toRemove->mType].erase( itGameEntity );
+            std::sort( mTmpGameEntities.begin(), mTmpGameEntities.end(), GameEntityCmp() );
 
-        toRemove->mSceneNode->getParentSceneNode()->removeAndDestroyChild( toRemove->mSceneNode );
-        toRemove->mSceneNode = 0;
+            // Both are sorted the same way; remove them all with a single compaction pass.
+            const size_t numRemoved =
+                ContainerUtils::removeSorted( mGameEntities[i], mTmpGameEntities, GameEntityCmp() );
+            assert( numRemoved == mTmpGameEntities.size() &&
+                    "Removing a GameEntity we don't know about!" );
+            (void)numRemoved;
 
-        assert( dynamic_cast<Ogre::Item *>( toRemove->mMovableObject ) );
+            // Same, but not all of them are awake.
+            if( i == Ogre::SCENE_DYNAMIC && !mAwakeGameEntities.empty() )
+                ContainerUtils::removeSorted( mAwakeGameEntities, mTmpGameEntities, GameEntityCmp() );
+        }
+
+        mTmpGameEntities.clear();
+
+        for( size_t i = 0; i < numEntities; ++i )
+            destroySceneNodeAndObject( toRemove[i] );
+
+        mPendingRemovals.clear();
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::originRebased( const GameEntityManager::OriginRebased &originRebased )
+    {
+        assert( originRebased.epoch > mOriginEpochs.back().epoch );
+
+        // Everything shifts by the same amount, so the new origin lands at (0, 0, 0).
+        const Ogre::Vector3 shift = mOriginEpochs.back().origin.relativeTo( originRebased.origin );
+
+        OriginEpoch newOrigin;
+        newOrigin.epoch = originRebased.epoch;
+        newOrigin.origin = originRebased.origin;
+        for( size_t i = 0u; i < Ogre::NUM_SCENE_MEMORY_MANAGER_TYPES; ++i )
+            newOrigin.parents[i] = 0;
+        mOriginEpochs.push_back( newOrigin );
+
+        // Old origins that nothing hangs from anymore. Keep the last few, since the
+        // transform buffers Logic already published may still be relative to them.
+        // Epoch 0 is never discarded: getOriginSceneNode( 0, type ) is how content
+        // that isn't a GameEntity stays where it was.
+        const size_t cNumOriginEpochsKept = 4u;
+        size_t epochIdx = 1u;
+        while( epochIdx + cNumOriginEpochsKept < mOriginEpochs.size() )
+        {
+            OriginEpoch &originEpoch = mOriginEpochs[epochIdx];
+
+            bool bInUse = false;
+            for( size_t i = 0u; i < Ogre::NUM_SCENE_MEMORY_MANAGER_TYPES; ++i )
+            {
+                const Ogre::SceneNode *parent = originEpoch.parents[i];
+                bInUse |= parent && ( parent->numChildren() != 0u ||
+                                      parent->numAttachedObjects() != 0u );
+            }
+
+            if( !bInUse )
+            {
+                for( size_t i = 0u; i < Ogre::NUM_SCENE_MEMORY_MANAGER_TYPES; ++i )
+                {
+                    if( originEpoch.parents[i] )
+                        mSceneManager->destroySceneNode( originEpoch.parents[i] );
+                }
+                mOriginEpochs.erase( mOriginEpochs.begin() + static_cast<ptrdiff_t>( epochIdx ) );
+            }
+            else
+            {
+                ++epochIdx;
+            }
+        }
+
+        std::vector<OriginEpoch>::iterator itor = mOriginEpochs.begin();
+        std::vector<OriginEpoch>::iterator endt = mOriginEpochs.end();
+        while( itor != endt )
+        {
+            const Ogre::Vector3 parentPos = itor->origin.relativeTo( originRebased.origin );
+            if( itor->parents[Ogre::SCENE_DYNAMIC] )
+                itor->parents[Ogre::SCENE_DYNAMIC]->setPosition( parentPos );
+            if( itor->parents[Ogre::SCENE_STATIC] )
+            {
+                itor->parents[Ogre::SCENE_STATIC]->setPosition( parentPos );
+                mSceneManager->notifyStaticDirty( itor->parents[Ogre::SCENE_STATIC] );
+            }
+            ++itor;
+        }
+
+        Ogre::Node *cameraNode = mCamera->getParentNode();
+        if( cameraNode && cameraNode != mSceneManager->getRootSceneNode( Ogre::SCENE_DYNAMIC ) )
+            cameraNode->translate( shift );
+        else
+            mCamera->move( shift );
+    }
+    //-----------------------------------------------------------------------------------
+    const GraphicsSystem::OriginEpoch *GraphicsSystem::findOriginEpoch( Ogre::uint32 epoch ) const
+    {
+        // Almost always one of the newest.
+        std::vector<OriginEpoch>::const_reverse_iterator itor = mOriginEpochs.rbegin();
+        std::vector<OriginEpoch>::const_reverse_iterator endt = mOriginEpochs.rend();
+        while( itor != endt && itor->epoch > epoch )
+            ++itor;
+        return itor != endt && itor->epoch == epoch ? &( *itor ) : 0;
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::SceneNode *GraphicsSystem::getOriginSceneNode( Ogre::uint32 originEpoch,
+                                                         Ogre::SceneMemoryMgrTypes type )
+    {
+        OriginEpoch *originEpochPtr = const_cast<OriginEpoch *>( findOriginEpoch( originEpoch ) );
+        if( !originEpochPtr )
+            return 0;
+
+        if( !originEpochPtr->parents[type] )
+        {
+            const Ogre::Vector3 parentPos =
+                originEpochPtr->origin.relativeTo( mOriginEpochs.back().origin );
+            originEpochPtr->parents[type] =
+                mSceneManager->getRootSceneNode( type )->createChildSceneNode( type, parentPos );
+        }
+
+        return originEpochPtr->parents[type];
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::rebaseSceneNodes()
+    {
+        if( mOriginEpochs.size() < 2u )
+            return;
+
+        // Early out if all the dynamic nodes already hang from the newest origin.
+        bool bAnyOldNodes = false;
+        for( size_t i = 0u; i < mOriginEpochs.size() - 1u && !bAnyOldNodes; ++i )
+        {
+            const Ogre::SceneNode *parent = mOriginEpochs[i].parents[Ogre::SCENE_DYNAMIC];
+            bAnyOldNodes = parent && parent->numChildren() != 0u;
+        }
+        if( !bAnyOldNodes )
+            return;
+
+        mTmpGameEntities.clear();
+
+        const GameEntityVec &gameEntities = getGameEntitiesToInterpolate();
+        GameEntityVec::const_iterator itor = gameEntities.begin();
+        GameEntityVec::const_iterator endt = gameEntities.end();
+        while( itor != endt )
+        {
+            GameEntity *gameEntity = *itor++;
+            const Ogre::uint32 epoch = gameEntity->mOriginEpoch[mCurrentTransformIdx];
+            if( epoch != gameEntity->mGraphics->originEpoch && findOriginEpoch( epoch ) )
+                mTmpGameEntities.push_back( gameEntity );
+        }
+
+        if( mTmpGameEntities.empty() )
+            return;
+
+        // Already sorted, since gameEntities is.
+        ContainerUtils::removeSorted( mGameEntities[Ogre::SCENE_DYNAMIC], mTmpGameEntities,
+                                      GameEntityCmp() );
+        if( mDirtyTracking )
+            ContainerUtils::removeSorted( mAwakeGameEntities, mTmpGameEntities, GameEntityCmp() );
+
+        itor = mTmpGameEntities.begin();
+        endt = mTmpGameEntities.end();
+        while( itor != endt )
+        {
+            GameEntity *gameEntity = *itor++;
+            Ogre::SceneNode *sceneNode = gameEntity->mGraphics->sceneNode;
+
+            const Ogre::uint32 epoch = gameEntity->mOriginEpoch[mCurrentTransformIdx];
+            const WorldPosition &oldOrigin =
+                findOriginEpoch( gameEntity->mGraphics->originEpoch )->origin;
+            const WorldPosition &newOrigin = findOriginEpoch( epoch )->origin;
+
+            sceneNode->getParentSceneNode()->removeChild( sceneNode );
+            getOriginSceneNode( epoch, Ogre::SCENE_DYNAMIC )->addChild( sceneNode );
+            // Stay in place until it's interpolated.
+            sceneNode->setPosition( sceneNode->getPosition() + oldOrigin.relativeTo( newOrigin ) );
+            gameEntity->mGraphics->originEpoch = epoch;
+        }
+
+        // Their memory moved with the new parent; merge them back where they now belong.
+        GameEntityVec &dynamicEntities = mGameEntities[Ogre::SCENE_DYNAMIC];
+        size_t oldSize = dynamicEntities.size();
+        dynamicEntities.insert( dynamicEntities.end(), mTmpGameEntities.begin(),
+                                mTmpGameEntities.end() );
+        ContainerUtils::mergeSorted( dynamicEntities, oldSize, GameEntityCmp() );
+        if( mDirtyTracking )
+        {
+            oldSize = mAwakeGameEntities.size();
+            mAwakeGameEntities.insert( mAwakeGameEntities.end(), mTmpGameEntities.begin(),
+                                       mTmpGameEntities.end() );
+            ContainerUtils::mergeSorted( mAwakeGameEntities, oldSize, GameEntityCmp() );
+        }
+
+        mTmpGameEntities.clear();
+    }
+    //-----------------------------------------------------------------------------------
+    bool GraphicsSystem::getOriginOffsets( const GameEntity *gEnt, size_t prevIdx, size_t currIdx,
+                                           Ogre::Vector3 &outPrevOffset,
+                                           Ogre::Vector3 &outCurrOffset ) const
+    {
+        const OriginEpoch *nodeOrigin = findOriginEpoch( gEnt->mGraphics->originEpoch );
+        const OriginEpoch *prevOrigin = findOriginEpoch( gEnt->mOriginEpoch[prevIdx] );
+        const OriginEpoch *currOrigin = findOriginEpoch( gEnt->mOriginEpoch[currIdx] );
+        if( !nodeOrigin || !prevOrigin || !currOrigin )
+            return false;
 
-        mSceneManager->destroyItem( static_cast<Ogre::Item *>( toRemove->mMovableObject ) );
-        toRemove->mMovableObject = 0;
+        outPrevOffset = prevOrigin->origin.relativeTo( nodeOrigin->origin );
+        outCurrOffset = currOrigin->origin.relativeTo( nodeOrigin->origin );
+        return true;
+    }
+    //-----------------------------------------------------------------------------------
+    void GraphicsSystem::setNumGameEntityBuffers( Ogre::uint32 numBuffers )
+    {
+        assert( numBuffers >= MIN_GAME_ENTITY_BUFFERS && numBuffers <= MAX_GAME_ENTITY_BUFFERS );
+        mNumGameEntityBuffers = numBuffers;
+        mCurrentTransformIdx = 0;
+    }
+    //-----------------------------------------------------------------------------------
+    float GraphicsSystem::getInterpolationWeight( double frametime ) const
+    {
+        const float maxWeight = mLogicRequestedExtrapolation ? cMaxExtrapolationWeight : 1.0f;
+        const float weight = static_cast<float>( mAccumTimeSinceLastLogicFrame / frametime );
+        return std::max( 0.0f, std::min( weight, maxWeight ) );
     }
     //-----------------------------------------------------------------------------------
     void GraphicsSystem::updateGameEntities( const GameEntityVec &gameEntities, float weight )
     {
+        const Ogre::uint64 startTime = Telemetry::now();
+
+        if( mFloatingOrigin )
+            rebaseSceneNodes();
+
         mThreadGameEntityToUpdate = &gameEntities;
         mThreadWeight = weight;
 
-        // Note: You could execute a non-blocking scalable task and do something else, you should
-        // wait for the task to finish right before calling renderOneFrame or before trying to
-        // execute another UserScalableTask (you would have to be careful, but it could work).
-        mSceneManager->executeUserScalableTask( this, true );
+        if( !gameEntities.empty() )
+        {
+            // Note: You could execute a non-blocking scalable task and do something else, you
+            // should wait for the task to finish right before calling renderOneFrame or before
+            // trying to execute another UserScalableTask (you would have to be careful, but it
+            // could work).
+            mSceneManager->executeUserScalableTask( this, true );
+        }
+
+        const Ogre::uint64 interpolateMicroseconds = Telemetry::now() - startTime;
+        Telemetry::record( Telemetry::RenderInterpolate, interpolateMicroseconds );
+
+        mFramePipelineStats.interpolateMicroseconds += interpolateMicroseconds;
+        ++mFramePipelineStats.numInterpolations;
+        mFramePipelineStats.numInterpolatedEntities += gameEntities.size();
+        mFramePipelineStats.numDynamicEntities += mGameEntities[Ogre::SCENE_DYNAMIC].size();
+    }
+    //-----------------------------------------------------------------------------------
+    /// Interpolates a single GameEntity and sets its SceneNode.
+    /// The offsets are added to the positions, see GraphicsSystem::getOriginOffsets
+    static void interpolateGameEntity( GameEntity *gEnt, size_t prevIdx, size_t currIdx, float weight,
+                                       const Ogre::Vector3 &prevOffset,
+                                       const Ogre::Vector3 &currOffset )
+    {
+        Ogre::Vector3 interpVec = Ogre::Math::lerp( gEnt->getPosition( prevIdx ) + prevOffset,
+                                                    gEnt->getPosition( currIdx ) + currOffset, weight );
+        gEnt->mGraphics->sceneNode->setPosition( interpVec );
+
+        interpVec = Ogre::Math::lerp( gEnt->getScale( prevIdx ), gEnt->getScale( currIdx ), weight );
+        gEnt->mGraphics->sceneNode->setScale( interpVec );
+
+        Ogre::Quaternion interpQ = Ogre::Quaternion::nlerp( weight, gEnt->getOrientation( prevIdx ),
+                                                            gEnt->getOrientation( currIdx ), true );
+        gEnt->mGraphics->sceneNode->setOrientation( interpQ );
+    }
+    //-----------------------------------------------------------------------------------
+    /// Returns true if gEnts[0..ARRAY_PACKED_REALS) own, in order, every lane of the
+    /// same block of the SceneNodes' Transform; so we can overwrite the whole block.
+    static bool ownsWholeNodeBlock( GameEntity *const *gEnts )
+    {
+        const Ogre::Transform &first = gEnts[0]->mGraphics->sceneNode->_getTransform();
+        bool retVal = first.mIndex == 0u;
+        for( size_t i = 1u; i < ARRAY_PACKED_REALS && retVal; ++i )
+        {
+            const Ogre::Transform &transform = gEnts[i]->mGraphics->sceneNode->_getTransform();
+            retVal = transform.mPosition == first.mPosition && transform.mIndex == i;
+        }
+        return retVal;
+    }
+    //-----------------------------------------------------------------------------------
+    /// Same as ownsWholeNodeBlock, but for the GameEntities' own transforms.
+    static bool ownsWholeTransformBlock( GameEntity *const *gEnts )
+    {
+        bool retVal = gEnts[0]->mTransformIndex == 0u;
+        for( size_t i = 1u; i < ARRAY_PACKED_REALS && retVal; ++i )
+        {
+            retVal = gEnts[i]->mTransform[0] == gEnts[0]->mTransform[0] &&
+                     gEnts[i]->mTransformIndex == i;
+        }
+        return retVal;
+    }
+    //-----------------------------------------------------------------------------------
+    /// Floating origin: true if the transforms of gEnts[0..ARRAY_PACKED_REALS) in both
+    /// buffers are relative to the same origin as their SceneNodes, so no offset is needed.
+    static bool sameOriginEpochs( GameEntity *const *gEnts, size_t prevIdx, size_t currIdx )
+    {
+        bool retVal = true;
+        for( size_t i = 0u; i < ARRAY_PACKED_REALS && retVal; ++i )
+        {
+            const Ogre::uint32 nodeEpoch = gEnts[i]->mGraphics->originEpoch;
+            retVal = gEnts[i]->mOriginEpoch[prevIdx] == nodeEpoch &&
+                     gEnts[i]->mOriginEpoch[currIdx] == nodeEpoch;
+        }
+        return retVal;
+    }
+    //-----------------------------------------------------------------------------------
+    static void gatherTransforms( GameEntity *const *gEnts, size_t transformIdx,
+                                  ArrayGameEntityTransform &outTransform )
+    {
+        for( size_t i = 0u; i < ARRAY_PACKED_REALS; ++i )
+        {
+            outTransform.vPos.setFromVector3( gEnts[i]->getPosition( transformIdx ), i );
+            outTransform.qRot.setFromQuaternion( gEnts[i]->getOrientation( transformIdx ), i );
+            outTransform.vScale.setFromVector3( gEnts[i]->getScale( transformIdx ), i );
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    /// Interpolates ARRAY_PACKED_REALS GameEntities at once, writing straight into
+    /// the SoA memory of their SceneNodes. See ownsWholeNodeBlock
+    static void interpolateGameEntityBlock( GameEntity *const *gEnts, size_t prevIdx, size_t currIdx,
+                                            Ogre::ArrayReal weight )
+    {
+        const ArrayGameEntityTransform *prev;
+        const ArrayGameEntityTransform *curr;
+        ArrayGameEntityTransform tmpPrev;
+        ArrayGameEntityTransform tmpCurr;
+
+        if( ownsWholeTransformBlock( gEnts ) )
+        {
+            // Common case when entities were spawned together (see gameEntitiesAdded)
+            prev = gEnts[0]->mTransform[prevIdx];
+            curr = gEnts[0]->mTransform[currIdx];
+        }
+        else
+        {
+            gatherTransforms( gEnts, prevIdx, tmpPrev );
+            gatherTransforms( gEnts, currIdx, tmpCurr );
+            prev = &tmpPrev;
+            curr = &tmpCurr;
+        }
+
+        Ogre::Transform &transform = gEnts[0]->mGraphics->sceneNode->_getTransform();
+        *transform.mPosition = prev->vPos + ( curr->vPos - prev->vPos ) * weight;
+        *transform.mScale = prev->vScale + ( curr->vScale - prev->vScale ) * weight;
+        *transform.mOrientation = Ogre::ArrayQuaternion::nlerpShortest( weight, prev->qRot, curr->qRot );
+
+#if OGRE_DEBUG_MODE >= OGRE_DEBUG_MEDIUM
+        for( size_t i = 0u; i < ARRAY_PACKED_REALS; ++i )
+            gEnts[i]->mGraphics->sceneNode->_setCachedTransformOutOfDate();
+#endif
     }
     //-----------------------------------------------------------------------------------
     void GraphicsSystem::execute( size_t threadId, size_t numThreads )
     {
         size_t currIdx = mCurrentTransformIdx;
         size_t prevIdx =
-            ( mCurrentTransformIdx + NUM_GAME_ENTITY_BUFFERS - 1 ) % NUM_GAME_ENTITY_BUFFERS;
+            ( mCurrentTransformIdx + mNumGameEntityBuffers - 1 ) % mNumGameEntityBuffers;
 
-        const size_t objsPerThread =
-            ( mThreadGameEntityToUpdate->size() + ( numThreads - 1 ) ) / numThreads;
-        const size_t toAdvance = std::min( threadId * objsPerThread, mThreadGameEntityToUpdate->size() );
+        const GameEntityVec &gameEntities = *mThreadGameEntityToUpdate;
 
-        GameEntityVec::const_iterator itor =
-            mThreadGameEntityToUpdate->begin() + static_cast<ptrdiff_t>( toAdvance );
-        GameEntityVec::const_iterator end =
-            mThreadGameEntityToUpdate->begin() +
-            static_cast<ptrdiff_t>(
-                std::min( toAdvance + objsPerThread, mThreadGameEntityToUpdate->size() ) );
-        while( itor != end )
-        {
-            GameEntity *gEnt = *itor;
-            Ogre::Vector3 interpVec = Ogre::Math::lerp( gEnt->mTransform[prevIdx]->vPos,
-                                                        gEnt->mTransform[currIdx]->vPos, mThreadWeight );
-            gEnt->mSceneNode->setPosition( interpVec );
+        // Split on multiples of ARRAY_PACKED_REALS, so threads don't share node blocks
+        // when the entities are tightly packed.
+        const size_t objsPerThread = Ogre::alignToNextMultiple(
+            ( gameEntities.size() + ( numThreads - 1 ) ) / numThreads, size_t( ARRAY_PACKED_REALS ) );
+        const size_t begin = std::min( threadId * objsPerThread, gameEntities.size() );
+        const size_t end = std::min( begin + objsPerThread, gameEntities.size() );
 
-            interpVec = Ogre::Math::lerp( gEnt->mTransform[prevIdx]->vScale,
-                                          gEnt->mTransform[currIdx]->vScale, mThreadWeight );
-            gEnt->mSceneNode->setScale( interpVec );
+        const Ogre::ArrayReal weight = Ogre::Mathlib::SetAll( mThreadWeight );
 
-            Ogre::Quaternion interpQ = Ogre::Quaternion::nlerp(
-                mThreadWeight, gEnt->mTransform[prevIdx]->qRot, gEnt->mTransform[currIdx]->qRot, true );
-            gEnt->mSceneNode->setOrientation( interpQ );
+        size_t i = begin;
+        while( i < end )
+        {
+            GameEntity *const *gEnts = &gameEntities[i];
 
-            ++itor;
+            if( mUseSimdInterpolation && end - i >= ARRAY_PACKED_REALS && ownsWholeNodeBlock( gEnts ) &&
+                ( !mFloatingOrigin || sameOriginEpochs( gEnts, prevIdx, currIdx ) ) )
+            {
+                interpolateGameEntityBlock( gEnts, prevIdx, currIdx, weight );
+                i += ARRAY_PACKED_REALS;
+            }
+            else
+            {
+                Ogre::Vector3 prevOffset( Ogre::Vector3::ZERO );
+                Ogre::Vector3 currOffset( Ogre::Vector3::ZERO );
+                // Its SceneNode is left as is for now if an origin is unknown
+                // (i.e. its Mq::ORIGIN_REBASED got deferred).
+                if( !mFloatingOrigin ||
+                    getOriginOffsets( *gEnts, prevIdx, currIdx, prevOffset, currOffset ) )
+                {
+                    interpolateGameEntity( *gEnts, prevIdx, currIdx, mThreadWeight, prevOffset,
+                                           currOffset );
+                }
+                ++i;
+            }
         }
     }
 #ifdef AUTO_TESTING
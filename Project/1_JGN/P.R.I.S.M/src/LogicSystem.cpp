@@ -3,6 +3,9 @@
 #include "GameEntityManager.h"
 #include "GameState.h"
 #include "SdlInputHandler.h"
+#include "System/LogicReplay.h"
+#include "System/TraceRecorder.h"
+#include "Threading/JobSystem.h"
 
 #include "OgreConfigFile.h"
 #include "OgreException.h"
@@ -19,6 +22,14 @@
 
 #include "OgreOverlaySystem.h"
 
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+#include "OgreTimer.h"
+#include "Threading/OgreThreads.h"
+
+#include <algorithm>
+#include <string.h>
+
 #if OGRE_USE_SDL2
 #    include <SDL_syswm.h>
 #endif
@@ -29,32 +40,262 @@ namespace Demo
         BaseSystem( gameState ),
         mGraphicsSystem( 0 ),
         mGameEntityManager( 0 ),
-        mCurrentTransformIdx( 1 )
+        mNumGameEntityBuffers( DEFAULT_GAME_ENTITY_BUFFERS ),
+        mCurrentTransformIdx( 1 ),
+        mDirtyTracking( false ),
+        mFloatingOrigin( false ),
+        mNumJobWorkerThreads( 0 ),
+        mJobSystem( 0 ),
+        mBackPressurePolicy( BackPressureSkip ),
+        mMaxBlockMicroseconds( 100000u ),
+        mDeferGameStateMessages( false ),
+        mRandomSeed( std::mt19937::default_seed ),
+        mLogicReplay( 0 ),
+        mInjectingReplayInputs( false ),
+        mOldestInputTime( 0 )
+    {
+        resetTransformIndices();
+        resetBackPressureStats();
+
+        mTelemetryUpdateMetric = Telemetry::LogicUpdate;
+        mTelemetryQueueDepthMetric = Telemetry::LogicQueueDepth;
+    }
+    //-----------------------------------------------------------------------------------
+#if OGRE_USE_SDL2
+    /// Same as SdlInputHandler::_handleSdlEvents, except key repeats are delivered
+    /// (check SDL_KeyboardEvent::repeat). InputSnapshot keeps at most one per key per frame.
+    static void dispatchSdlEvent( GameState *gameState, const SDL_Event &evt )
     {
-        // mCurrentTransformIdx is 1, 0 and NUM_GAME_ENTITY_BUFFERS - 1 are taken by GraphicsSytem at
-        // startup The range to fill is then [2; NUM_GAME_ENTITY_BUFFERS-1]
-        for( Ogre::uint32 i = 2; i < NUM_GAME_ENTITY_BUFFERS - 1; ++i )
+        switch( evt.type )
+        {
+        case SDL_MOUSEMOTION:
+        case SDL_MOUSEWHEEL:
+            gameState->mouseMoved( evt );
+            break;
+        case SDL_MOUSEBUTTONDOWN:
+            gameState->mousePressed( evt.button, evt.button.button );
+            break;
+        case SDL_MOUSEBUTTONUP:
+            gameState->mouseReleased( evt.button, evt.button.button );
+            break;
+        case SDL_KEYDOWN:
+            gameState->keyPressed( evt.key );
+            break;
+        case SDL_KEYUP:
+            gameState->keyReleased( evt.key );
+            break;
+        case SDL_TEXTEDITING:
+            gameState->textEditing( evt.edit );
+            break;
+        case SDL_TEXTINPUT:
+            gameState->textInput( evt.text );
+            break;
+        case SDL_JOYAXISMOTION:
+            gameState->joyAxisMoved( evt.jaxis, evt.jaxis.axis );
+            break;
+        case SDL_JOYBUTTONDOWN:
+            gameState->joyButtonPressed( evt.jbutton, evt.jbutton.button );
+            break;
+        case SDL_JOYBUTTONUP:
+            gameState->joyButtonReleased( evt.jbutton, evt.jbutton.button );
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+    //-----------------------------------------------------------------------------------
+    LogicSystem::~LogicSystem() { assert( !mJobSystem && "deinitialize not called!" ); }
+    //-----------------------------------------------------------------------------------
+    void LogicSystem::initialize()
+    {
+        // Create it first, so GameStates can use it from the very beginning.
+        mJobSystem = new JobSystem( mNumJobWorkerThreads );
+        mRandom.seed( mRandomSeed );
+        BaseSystem::initialize();
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicSystem::deinitialize()
+    {
+        BaseSystem::deinitialize();
+        delete mJobSystem;
+        mJobSystem = 0;
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicSystem::setRandomSeed( Ogre::uint32 seed )
+    {
+        assert( !mJobSystem && "Must be called before initialize" );
+        mRandomSeed = seed;
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicSystem::setNumJobWorkerThreads( size_t numWorkerThreads )
+    {
+        assert( !mJobSystem && "Must be called before initialize" );
+        mNumJobWorkerThreads = numWorkerThreads;
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicSystem::resetTransformIndices()
+    {
+        // mCurrentTransformIdx is 1, 0 and mNumGameEntityBuffers - 1 are taken by GraphicsSytem at
+        // startup The range to fill is then [2; mNumGameEntityBuffers-1)
+        mCurrentTransformIdx = 1;
+        mAvailableTransformIdx.clear();
+        for( Ogre::uint32 i = 2; i < mNumGameEntityBuffers - 1; ++i )
             mAvailableTransformIdx.push_back( i );
+
+        // Otherwise we could never publish a frame, see MIN_GAME_ENTITY_BUFFERS
+        assert( !mAvailableTransformIdx.empty() );
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::uint32 LogicSystem::clampNumGameEntityBuffers( long numBuffers )
+    {
+        numBuffers = std::max( numBuffers, static_cast<long>( MIN_GAME_ENTITY_BUFFERS ) );
+        numBuffers = std::min( numBuffers, static_cast<long>( MAX_GAME_ENTITY_BUFFERS ) );
+        return static_cast<Ogre::uint32>( numBuffers );
     }
     //-----------------------------------------------------------------------------------
-    LogicSystem::~LogicSystem() {}
+    void LogicSystem::setNumGameEntityBuffers( Ogre::uint32 numBuffers )
+    {
+        assert( numBuffers >= MIN_GAME_ENTITY_BUFFERS && numBuffers <= MAX_GAME_ENTITY_BUFFERS );
+        assert( !mGameEntityManager && "Must be called before creating the GameEntityManager" );
+        mNumGameEntityBuffers = numBuffers;
+        resetTransformIndices();
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicSystem::setDirtyTracking( bool bDirtyTracking )
+    {
+        assert( !mGameEntityManager && "Must be called before creating the GameEntityManager" );
+        mDirtyTracking = bDirtyTracking;
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicSystem::setFloatingOrigin( bool bFloatingOrigin )
+    {
+        assert( !mGameEntityManager && "Must be called before creating the GameEntityManager" );
+        mFloatingOrigin = bFloatingOrigin;
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicSystem::resetBackPressureStats()
+    {
+        memset( &mBackPressureStats, 0, sizeof( mBackPressureStats ) );
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicSystem::logBackPressureStats() const
+    {
+        Ogre::LogManager::getSingleton().logMessage(
+            "LogicSystem back pressure with " +
+            Ogre::StringConverter::toString( mNumGameEntityBuffers ) + " buffers. Published: " +
+            Ogre::StringConverter::toString( mBackPressureStats.numFramesPublished ) +
+            " Blocked: " + Ogre::StringConverter::toString( mBackPressureStats.numBlocked ) + " (" +
+            Ogre::StringConverter::toString( mBackPressureStats.blockedMicroseconds / 1000u ) +
+            " ms, " + Ogre::StringConverter::toString( mBackPressureStats.numBlockTimeouts ) +
+            " timeouts) Skipped: " + Ogre::StringConverter::toString( mBackPressureStats.numSkipped ) +
+            " Extrapolated: " + Ogre::StringConverter::toString( mBackPressureStats.numExtrapolated ) );
+    }
+    //-----------------------------------------------------------------------------------
+    bool LogicSystem::blockUntilTransformIdxAvailable()
+    {
+        ++mBackPressureStats.numBlocked;
+
+        TraceRecorder::ScopedEvent stallEvent( "Transform buffer stall" );
+
+        Ogre::Timer timer;
+        const Ogre::uint64 startTime = timer.getMicroseconds();
+        Ogre::uint64 elapsed = 0;
+
+        // Graphics returns buffers via LOGICFRAME_FINISHED, which we process here.
+        // Anything else must wait: this tick's transforms are already written.
+        mDeferGameStateMessages = true;
+        this->processIncomingMessages();
+        while( mAvailableTransformIdx.empty() && elapsed < mMaxBlockMicroseconds )
+        {
+            Ogre::Threads::Sleep( 0 );
+            this->processIncomingMessages();
+            elapsed = timer.getMicroseconds() - startTime;
+        }
+        mDeferGameStateMessages = false;
+
+        mBackPressureStats.blockedMicroseconds += elapsed;
+        Telemetry::record( Telemetry::TransformStall, elapsed );
+
+        if( mAvailableTransformIdx.empty() )
+        {
+            ++mBackPressureStats.numBlockTimeouts;
+            return false;
+        }
+
+        return true;
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicSystem::beginFrameParallel()
+    {
+        // Messages that arrived while we were blocked (see blockUntilTransformIdxAvailable)
+        // go before the new ones.
+        processDeferredMessages();
+        BaseSystem::beginFrameParallel();
+
+        if( mLogicReplay )
+        {
+            mLogicReplay->_beginTick();
+
+            // Feed the recorded inputs as if they had just arrived.
+            mInjectingReplayInputs = true;
+            const size_t numInputs = mLogicReplay->_getNumTickInputs();
+            for( size_t i = 0u; i < numInputs; ++i )
+            {
+                Mq::MessageId messageId;
+                const void *data = mLogicReplay->_getTickInput( i, messageId );
+                processIncomingMessage( messageId, data );
+            }
+            mInjectingReplayInputs = false;
+        }
+
+        // Before the GameState's update, so it already writes relative to the new origin.
+        if( mFloatingOrigin && mGameEntityManager )
+            mGameEntityManager->updateOrigin( mCameraPosition );
+    }
     //-----------------------------------------------------------------------------------
     void LogicSystem::finishFrameParallel()
     {
+        // The GameState has written this tick's transforms by now.
+        // GameEntityManager fills in those of the awake entities that weren't written.
         if( mGameEntityManager )
             mGameEntityManager->finishFrameParallel();
 
+        if( mLogicReplay )
+            mLogicReplay->_endTick( mGameEntityManager, mCurrentTransformIdx );
+
         // Notify the GraphicsSystem we're done rendering this frame.
         if( mGraphicsSystem )
         {
-            size_t idxToSend = mCurrentTransformIdx;
+            if( mOldestInputTime )
+            {
+                // Must arrive before the frame it applies to.
+                this->queueSendMessage( mGraphicsSystem, Mq::INPUT_CONSUMED, mOldestInputTime );
+                mOldestInputTime = 0;
+            }
+
+            Ogre::uint32 idxToSend = mCurrentTransformIdx;
+
+            if( mAvailableTransformIdx.empty() && mBackPressurePolicy == BackPressureBlock )
+                blockUntilTransformIdxAvailable();
+            else
+                Telemetry::record( Telemetry::TransformStall, 0u );
 
             if( mAvailableTransformIdx.empty() )
             {
                 // Don't relinquish our only ID left.
                 // If you end up here too often, Graphics' thread is too slow,
-                // or you need to increase NUM_GAME_ENTITY_BUFFERS
-                idxToSend = std::numeric_limits<Ogre::uint32>::max();
+                // or you need to increase the number of buffers (see getBackPressureStats)
+                if( mBackPressurePolicy == BackPressureExtrapolate )
+                {
+                    idxToSend = Mq::cLogicFrameExtrapolate;
+                    ++mBackPressureStats.numExtrapolated;
+                }
+                else
+                {
+                    idxToSend = Mq::cLogicFrameSkipped;
+                    ++mBackPressureStats.numSkipped;
+                }
             }
             else
             {
@@ -62,6 +303,10 @@ namespace Demo
                 // to transform data that may be in use by the other thread (race condition)
                 mCurrentTransformIdx = mAvailableTransformIdx.front();
                 mAvailableTransformIdx.pop_front();
+                ++mBackPressureStats.numFramesPublished;
+
+                if( mGameEntityManager )
+                    mGameEntityManager->_notifyFramePublished();
             }
 
             this->queueSendMessage( mGraphicsSystem, Mq::LOGICFRAME_FINISHED, idxToSend );
@@ -72,13 +317,19 @@ namespace Demo
     //-----------------------------------------------------------------------------------
     void LogicSystem::processIncomingMessage( Mq::MessageId messageId, const void *data )
     {
+        if( mDeferGameStateMessages && messageId != Mq::LOGICFRAME_FINISHED )
+        {
+            deferIncomingMessage( data );
+            return;
+        }
+
         switch( messageId )
         {
         case Mq::LOGICFRAME_FINISHED:
         {
             Ogre::uint32 newIdx = *reinterpret_cast<const Ogre::uint32 *>( data );
             assert( ( mAvailableTransformIdx.empty() ||
-                      newIdx == ( mAvailableTransformIdx.back() + 1 ) % NUM_GAME_ENTITY_BUFFERS ) &&
+                      newIdx == ( mAvailableTransformIdx.back() + 1 ) % mNumGameEntityBuffers ) &&
                     "Indices are arriving out of order!!!" );
 
             mAvailableTransformIdx.push_back( newIdx );
@@ -89,7 +340,42 @@ namespace Demo
                 *reinterpret_cast<const Ogre::uint32 *>( data ) );
             break;
         case Mq::SDL_EVENT:
-            // TODO
+#if OGRE_USE_SDL2
+        {
+            if( mLogicReplay && !mInjectingReplayInputs )
+            {
+                // On playback, the live input is ignored in favour of the recorded one.
+                if( mLogicReplay->isPlayback() )
+                    break;
+                mLogicReplay->_recordInput( messageId, data, sizeof( InputSnapshot ) );
+            }
+
+            const InputSnapshot *snapshot = reinterpret_cast<const InputSnapshot *>( data );
+
+            // Recorded timestamps are from another run
+            if( !mInjectingReplayInputs &&
+                ( !mOldestInputTime || snapshot->oldestEventTime < mOldestInputTime ) )
+            {
+                mOldestInputTime = snapshot->oldestEventTime;
+            }
+
+            if( mCurrentGameState )
+            {
+                for( size_t i = 0u; i < snapshot->numEvents; ++i )
+                    dispatchSdlEvent( mCurrentGameState, snapshot->events[i] );
+            }
+        }
+#endif
+        break;
+        case Mq::CAMERA_MOVED:
+            if( mLogicReplay && !mInjectingReplayInputs )
+            {
+                // It decides when the origin moves, which changes the published transforms.
+                if( mLogicReplay->isPlayback() )
+                    break;
+                mLogicReplay->_recordInput( messageId, data, sizeof( WorldPosition ) );
+            }
+            mCameraPosition = *reinterpret_cast<const WorldPosition *>( data );
             break;
         default:
             break;
@@ -7,14 +7,19 @@
 
 #if OGRE_USE_SDL2
 
+#    include "OgreTimer.h"
+
 #    include <SDL_syswm.h>
 
+#    include <algorithm>
+
 namespace Demo
 {
     SdlInputHandler::SdlInputHandler( SDL_Window *sdlWindow, MouseListener *mouseListener,
                                       KeyboardListener *keyboardListener,
                                       JoystickListener *joystickListener ) :
         mSdlWindow( sdlWindow ),
+        mGraphicsSystem( 0 ),
         mLogicSystem( 0 ),
         mMouseListener( mouseListener ),
         mKeyboardListener( keyboardListener ),
@@ -29,8 +34,16 @@ namespace Demo
         mWindowHasFocus( true ),
         mWarpX( 0 ),
         mWarpY( 0 ),
-        mWarpCompensate( false )
+        mWarpCompensate( false ),
+        mTimer( 0 ),
+        mOldestEventTicks( 0 ),
+        mNumEventsForwarded( 0 ),
+        mNumEventsCoalesced( 0 ),
+        mNumSnapshotsSent( 0 )
     {
+        mInputSnapshot.oldestEventTime = 0;
+        mInputSnapshot.numEvents = 0;
+        mInputSnapshot.numCoalesced = 0;
     }
     //-----------------------------------------------------------------------------------
     SdlInputHandler::~SdlInputHandler() {}
@@ -75,7 +88,7 @@ namespace Demo
                     wrapMousePointer( evt.motion );
 
                 if( mLogicSystem )
-                    mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, evt );
+                    forwardToLogic( evt );
             }
             break;
         case SDL_MOUSEWHEEL:
@@ -84,7 +97,7 @@ namespace Demo
                 mMouseListener->mouseMoved( evt );
 
             if( mLogicSystem )
-                mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, evt );
+                forwardToLogic( evt );
         }
         break;
         case SDL_MOUSEBUTTONDOWN:
@@ -93,7 +106,7 @@ namespace Demo
                 mMouseListener->mousePressed( evt.button, evt.button.button );
 
             if( mLogicSystem )
-                mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, evt );
+                forwardToLogic( evt );
         }
         break;
         case SDL_MOUSEBUTTONUP:
@@ -102,7 +115,7 @@ namespace Demo
                 mMouseListener->mouseReleased( evt.button, evt.button.button );
 
             if( mLogicSystem )
-                mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, evt );
+                forwardToLogic( evt );
         }
         break;
         case SDL_KEYDOWN:
@@ -111,7 +124,7 @@ namespace Demo
                 mKeyboardListener->keyPressed( evt.key );
 
             if( mLogicSystem )
-                mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, evt );
+                forwardToLogic( evt );
         }
         break;
         case SDL_KEYUP:
@@ -120,7 +133,7 @@ namespace Demo
                 mKeyboardListener->keyReleased( evt.key );
 
             if( mLogicSystem )
-                mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, evt );
+                forwardToLogic( evt );
         }
         break;
         case SDL_TEXTEDITING:
@@ -129,7 +142,7 @@ namespace Demo
                 mKeyboardListener->textEditing( evt.edit );
 
             if( mLogicSystem )
-                mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, evt );
+                forwardToLogic( evt );
         }
         break;
         case SDL_TEXTINPUT:
@@ -138,7 +151,7 @@ namespace Demo
                 mKeyboardListener->textInput( evt.text );
 
             if( mLogicSystem )
-                mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, evt );
+                forwardToLogic( evt );
         }
         break;
         case SDL_JOYAXISMOTION:
@@ -147,7 +160,7 @@ namespace Demo
                 mJoystickListener->joyAxisMoved( evt.jaxis, evt.jaxis.axis );
 
             if( mLogicSystem )
-                mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, evt );
+                forwardToLogic( evt );
         }
         break;
         case SDL_JOYBUTTONDOWN:
@@ -156,7 +169,7 @@ namespace Demo
                 mJoystickListener->joyButtonPressed( evt.jbutton, evt.jbutton.button );
 
             if( mLogicSystem )
-                mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, evt );
+                forwardToLogic( evt );
         }
         break;
         case SDL_JOYBUTTONUP:
@@ -165,7 +178,7 @@ namespace Demo
                 mJoystickListener->joyButtonReleased( evt.jbutton, evt.jbutton.button );
 
             if( mLogicSystem )
-                mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, evt );
+                forwardToLogic( evt );
         }
         break;
         case SDL_JOYDEVICEADDED:
@@ -185,6 +198,106 @@ namespace Demo
         }
     }
     //-----------------------------------------------------------------------------------
+    void SdlInputHandler::_setLogicSystem( BaseSystem *graphicsSystem, BaseSystem *logicSystem,
+                                           Ogre::Timer *timer )
+    {
+        mGraphicsSystem = graphicsSystem;
+        mLogicSystem = logicSystem;
+        mTimer = timer;
+    }
+    //-----------------------------------------------------------------------------------
+    void SdlInputHandler::forwardToLogic( const SDL_Event &evt )
+    {
+        ++mNumEventsForwarded;
+
+        InputSnapshot &snapshot = mInputSnapshot;
+
+        if( snapshot.numEvents )
+        {
+            SDL_Event &last = snapshot.events[snapshot.numEvents - 1u];
+
+            bool bMerged = false;
+            if( evt.type == SDL_MOUSEMOTION && last.type == SDL_MOUSEMOTION &&
+                evt.motion.which == last.motion.which )
+            {
+                const Sint32 xrel = last.motion.xrel + evt.motion.xrel;
+                const Sint32 yrel = last.motion.yrel + evt.motion.yrel;
+                last.motion = evt.motion;
+                last.motion.xrel = xrel;
+                last.motion.yrel = yrel;
+                bMerged = true;
+            }
+            else if( evt.type == SDL_MOUSEWHEEL && last.type == SDL_MOUSEWHEEL &&
+                     evt.wheel.which == last.wheel.which &&
+                     evt.wheel.direction == last.wheel.direction )
+            {
+                const Sint32 x = last.wheel.x + evt.wheel.x;
+                const Sint32 y = last.wheel.y + evt.wheel.y;
+                last.wheel = evt.wheel;
+                last.wheel.x = x;
+                last.wheel.y = y;
+                bMerged = true;
+            }
+            else if( evt.type == SDL_JOYAXISMOTION && last.type == SDL_JOYAXISMOTION &&
+                     evt.jaxis.which == last.jaxis.which && evt.jaxis.axis == last.jaxis.axis )
+            {
+                // Absolute value. Only the newest matters
+                last.jaxis = evt.jaxis;
+                bMerged = true;
+            }
+            else if( evt.type == SDL_KEYDOWN && evt.key.repeat )
+            {
+                // Look for the last event of this key. If it's a repeat, the key is still
+                // being held and this one tells nothing new.
+                for( size_t i = snapshot.numEvents; i-- && !bMerged; )
+                {
+                    const SDL_Event &other = snapshot.events[i];
+                    if( ( other.type == SDL_KEYDOWN || other.type == SDL_KEYUP ) &&
+                        other.key.keysym.scancode == evt.key.keysym.scancode )
+                    {
+                        bMerged = other.type == SDL_KEYDOWN && other.key.repeat;
+                        break;
+                    }
+                }
+            }
+
+            if( bMerged )
+            {
+                ++snapshot.numCoalesced;
+                ++mNumEventsCoalesced;
+                return;
+            }
+
+            if( snapshot.numEvents == InputSnapshot::cMaxEvents )
+                _flushInputToLogic();
+        }
+
+        if( !snapshot.numEvents )
+            mOldestEventTicks = evt.common.timestamp;
+        snapshot.events[snapshot.numEvents++] = evt;
+    }
+    //-----------------------------------------------------------------------------------
+    void SdlInputHandler::_flushInputToLogic()
+    {
+        InputSnapshot &snapshot = mInputSnapshot;
+        if( !snapshot.numEvents || !mLogicSystem )
+            return;
+
+        // Translate SDL's millisecond ticks to our timer. The event may have
+        // been sitting in the OS queue since the previous frame.
+        const Ogre::uint64 now = mTimer->getMicroseconds();
+        const Ogre::uint32 ticksNow = SDL_GetTicks();
+        const Ogre::uint64 age =
+            ticksNow >= mOldestEventTicks ? Ogre::uint64( ticksNow - mOldestEventTicks ) * 1000u : 0u;
+        snapshot.oldestEventTime = now - std::min( age, now );
+
+        mGraphicsSystem->queueSendMessage( mLogicSystem, Mq::SDL_EVENT, snapshot );
+        ++mNumSnapshotsSent;
+
+        snapshot.numEvents = 0;
+        snapshot.numCoalesced = 0;
+    }
+    //-----------------------------------------------------------------------------------
     void SdlInputHandler::setGrabMousePointer( bool grab )
     {
         mWantMouseGrab = grab;
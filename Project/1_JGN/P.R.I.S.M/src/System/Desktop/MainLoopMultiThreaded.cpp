@@ -36,7 +36,10 @@ THE SOFTWARE.
 #include "LogicSystem.h"
 #include "SdlInputHandler.h"
 
-#include "Threading/YieldTimer.h"
+#include "System/LogicReplay.h"
+#include "System/Telemetry.h"
+#include "System/TraceRecorder.h"
+#include "Threading/FramePacer.h"
 #include "TutorialGameState.h"
 
 #include "OgreTimer.h"
@@ -58,6 +61,7 @@ struct ThreadData
 {
     GraphicsSystem *graphicsSystem;
     LogicSystem *logicSystem;
+    LogicReplay *logicReplay;
     Ogre::Barrier *barrier;
 };
 
@@ -75,7 +79,34 @@ int Demo::MainEntryPoints::mainAppMultiThreaded( int argc, const char *argv[] )
 
     Ogre::Barrier barrier( 2 );
 
+    LogicReplay logicReplay;
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+    if( !logicReplay.parseCmdLine( __argc, __argv ) )
+#else
+    if( !logicReplay.parseCmdLine( argc, argv ) )
+#endif
+        return 1;
+
     MainEntryPoints::createSystems( &graphicsGameState, &graphicsSystem, &logicGameState, &logicSystem );
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+    applyCoreSettings( __argc, __argv, graphicsSystem, logicSystem, true );
+    applyFrameQueueSettings( __argc, __argv, graphicsSystem, logicSystem, true );
+    applyHeadlessSettings( __argc, __argv, graphicsSystem );
+    applyCacheSettings( __argc, __argv, graphicsSystem );
+    applyTelemetrySettings( __argc, __argv, graphicsSystem );
+#else
+    applyCoreSettings( argc, argv, graphicsSystem, logicSystem, true );
+    applyFrameQueueSettings( argc, argv, graphicsSystem, logicSystem, true );
+    applyHeadlessSettings( argc, argv, graphicsSystem );
+    applyCacheSettings( argc, argv, graphicsSystem );
+    applyTelemetrySettings( argc, argv, graphicsSystem );
+#endif
+    if( logicSystem )
+    {
+        logicReplay.attach( logicSystem, MainEntryPoints::Frametime );
+        if( logicReplay.isPlayback() )
+            MainEntryPoints::Frametime = logicReplay.getFrametime();
+    }
 #ifdef AUTO_TESTING
     if( argv[1] )
     {
@@ -91,11 +122,19 @@ int Demo::MainEntryPoints::mainAppMultiThreaded( int argc, const char *argv[] )
     }
 #endif
 
+    if( MainEntryPoints::UseSpscMessageTransport && logicSystem )
+    {
+        // Must happen before the threads start exchanging messages.
+        graphicsSystem->connectSpscTransport( logicSystem );
+        logicSystem->connectSpscTransport( graphicsSystem );
+    }
+
     GameEntityManager gameEntityManager( graphicsSystem, logicSystem );
 
     ThreadData threadData;
     threadData.graphicsSystem = graphicsSystem;
     threadData.logicSystem = logicSystem;
+    threadData.logicReplay = &logicReplay;
     threadData.barrier = &barrier;
 
     Ogre::ThreadHandlePtr threadHandles[2];
@@ -106,7 +145,8 @@ int Demo::MainEntryPoints::mainAppMultiThreaded( int argc, const char *argv[] )
 
     MainEntryPoints::destroySystems( graphicsGameState, graphicsSystem, logicGameState, logicSystem );
 
-    return 0;
+    // Lets CI scripts detect a replay that diverged.
+    return logicReplay.getStats().numMismatches ? 1 : 0;
 }
 
 //---------------------------------------------------------------------
@@ -116,6 +156,8 @@ unsigned long renderThreadApp( Ogre::ThreadHandle *threadHandle )
     GraphicsSystem *graphicsSystem = threadData->graphicsSystem;
     Ogre::Barrier *barrier = threadData->barrier;
 
+    TraceRecorder::setThreadName( "Render" );
+
     graphicsSystem->initialize( "Tutorial 06: Multithreading" );
     barrier->sync();
 
@@ -132,7 +174,7 @@ unsigned long renderThreadApp( Ogre::ThreadHandle *threadHandle )
     barrier->sync();
 
 #if OGRE_USE_SDL2
-    if( graphicsSystem->getGrabMousePointerOnStartup() )
+    if( graphicsSystem->getGrabMousePointerOnStartup() && graphicsSystem->getInputHandler() )
     {
         // Do this after creating the scene for easier the debugging (the mouse doesn't hide itself).
         SdlInputHandler *inputHandler = graphicsSystem->getInputHandler();
@@ -152,9 +194,13 @@ unsigned long renderThreadApp( Ogre::ThreadHandle *threadHandle )
 
     while( !graphicsSystem->getQuit() )
     {
-        graphicsSystem->beginFrameParallel();
-        graphicsSystem->update( static_cast<float>( timeSinceLast ) );
-        graphicsSystem->finishFrameParallel();
+        {
+            Telemetry::ScopedSample renderFrameSample( Telemetry::RenderFrame );
+            TraceRecorder::ScopedEvent renderFrameEvent( "Render frame" );
+            graphicsSystem->beginFrameParallel();
+            graphicsSystem->update( static_cast<float>( timeSinceLast ) );
+            graphicsSystem->finishFrameParallel();
+        }
 
         if( !renderWindow->isVisible() )
         {
@@ -170,6 +216,7 @@ unsigned long renderThreadApp( Ogre::ThreadHandle *threadHandle )
 
     barrier->sync();
 
+    graphicsSystem->logFramePipelineStats();
     graphicsSystem->destroyScene();
     barrier->sync();
 
@@ -207,8 +254,11 @@ unsigned long logicThread( Ogre::ThreadHandle *threadHandle )
     ThreadData *threadData = reinterpret_cast<ThreadData *>( threadHandle->getUserParam() );
     GraphicsSystem *graphicsSystem = threadData->graphicsSystem;
     LogicSystem *logicSystem = threadData->logicSystem;
+    LogicReplay *logicReplay = threadData->logicReplay;
     Ogre::Barrier *barrier = threadData->barrier;
 
+    TraceRecorder::setThreadName( "Logic" );
+
     logicSystem->initialize();
     barrier->sync();
 
@@ -227,17 +277,23 @@ unsigned long logicThread( Ogre::ThreadHandle *threadHandle )
     Ogre::Window *renderWindow = graphicsSystem->getRenderWindow();
 
     Ogre::Timer timer;
-    YieldTimer yieldTimer( &timer );
+    FramePacer framePacer( &timer );
+    framePacer.setSleepEnabled( MainEntryPoints::FrameSleepEnabled );
+    framePacer.setMaxJitterMicroseconds( MainEntryPoints::MaxFrameJitterMicroseconds );
 
     Ogre::uint64 startTime = timer.getMicroseconds();
 
     while( !graphicsSystem->getQuit() )
     {
-        logicSystem->beginFrameParallel();
-        logicSystem->update( static_cast<float>( MainEntryPoints::Frametime ) );
-        logicSystem->finishFrameParallel();
+        {
+            Telemetry::ScopedSample logicTickSample( Telemetry::LogicTick );
+            TraceRecorder::ScopedEvent logicTickEvent( "Logic tick" );
+            logicSystem->beginFrameParallel();
+            logicSystem->update( static_cast<float>( MainEntryPoints::Frametime ) );
+            logicSystem->finishFrameParallel();
 
-        logicSystem->finishFrame();
+            logicSystem->finishFrame();
+        }
 
         if( !renderWindow->isVisible() )
         {
@@ -245,12 +301,25 @@ unsigned long logicThread( Ogre::ThreadHandle *threadHandle )
             Ogre::Threads::Sleep( 500 );
         }
 
-        // YieldTimer will wait until the current time is greater than startTime + cFrametime
-        startTime = yieldTimer.yield( MainEntryPoints::Frametime, startTime );
+        if( logicReplay->isPlayback() )
+        {
+            // Uncapped. LogicSystem still blocks when Graphics falls behind.
+            startTime = timer.getMicroseconds();
+            if( logicReplay->isPlaybackFinished() )
+                graphicsSystem->setQuit();
+        }
+        else
+        {
+            // Sleeps, then spins, until the current time is greater than startTime + cFrametime
+            startTime = framePacer.wait( MainEntryPoints::Frametime, startTime );
+        }
     }
 
     barrier->sync();
 
+    framePacer.logStats();
+    logicReplay->finish();
+    logicSystem->logBackPressureStats();
     logicSystem->destroyScene();
     barrier->sync();
 
@@ -32,6 +32,9 @@ THE SOFTWARE.
 #include "System/MainEntryPoints.h"
 
 #include "System/Desktop/UnitTesting.h"
+#include "System/LogicReplay.h"
+#include "System/Telemetry.h"
+#include "System/TraceRecorder.h"
 #include "TutorialGameState.h"
 
 #include "GameState.h"
@@ -39,6 +42,7 @@ THE SOFTWARE.
 #include "LogicSystem.h"
 #include "SdlInputHandler.h"
 
+#include "OgreLogManager.h"
 #include "OgreTimer.h"
 #include "OgreWindow.h"
 
@@ -60,6 +64,14 @@ int Demo::MainEntryPoints::mainAppSingleThreaded( int argc, const char *argv[] )
     unitTest.parseCmdLine( argc, argv );
 #endif
 
+    LogicReplay logicReplay;
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+    if( !logicReplay.parseCmdLine( __argc, __argv ) )
+#else
+    if( !logicReplay.parseCmdLine( argc, argv ) )
+#endif
+        return 1;
+
     if( unitTest.getParams().isPlayback() )
     {
         return unitTest.loadFromJson( unitTest.getParams().recordPath.c_str(),
@@ -72,6 +84,25 @@ int Demo::MainEntryPoints::mainAppSingleThreaded( int argc, const char *argv[] )
     LogicSystem *logicSystem = 0;
 
     MainEntryPoints::createSystems( &graphicsGameState, &graphicsSystem, &logicGameState, &logicSystem );
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+    applyCoreSettings( __argc, __argv, graphicsSystem, logicSystem, false );
+    applyFrameQueueSettings( __argc, __argv, graphicsSystem, logicSystem, false );
+    applyHeadlessSettings( __argc, __argv, graphicsSystem );
+    applyCacheSettings( __argc, __argv, graphicsSystem );
+    applyTelemetrySettings( __argc, __argv, graphicsSystem );
+#else
+    applyCoreSettings( argc, argv, graphicsSystem, logicSystem, false );
+    applyFrameQueueSettings( argc, argv, graphicsSystem, logicSystem, false );
+    applyHeadlessSettings( argc, argv, graphicsSystem );
+    applyCacheSettings( argc, argv, graphicsSystem );
+    applyTelemetrySettings( argc, argv, graphicsSystem );
+#endif
+    if( logicSystem )
+    {
+        logicReplay.attach( logicSystem, MainEntryPoints::Frametime );
+        if( logicReplay.isPlayback() )
+            MainEntryPoints::Frametime = logicReplay.getFrametime();
+    }
 #ifdef AUTO_TESTING
     if( argv[1] )
     {
@@ -88,6 +119,8 @@ int Demo::MainEntryPoints::mainAppSingleThreaded( int argc, const char *argv[] )
 #endif
     try
     {
+        TraceRecorder::setThreadName( "Main" );
+
         graphicsSystem->initialize( getWindowTitle() );
         if( logicSystem )
             logicSystem->initialize();
@@ -118,7 +151,7 @@ int Demo::MainEntryPoints::mainAppSingleThreaded( int argc, const char *argv[] )
             logicSystem->createScene02();
 
 #if OGRE_USE_SDL2
-        if( graphicsSystem->getGrabMousePointerOnStartup() )
+        if( graphicsSystem->getGrabMousePointerOnStartup() && graphicsSystem->getInputHandler() )
         {
             // Do this after creating the scene for easier the debugging (the mouse doesn't hide itself).
             SdlInputHandler *inputHandler = graphicsSystem->getInputHandler();
@@ -134,29 +167,65 @@ int Demo::MainEntryPoints::mainAppSingleThreaded( int argc, const char *argv[] )
 
         double timeSinceLast = 1.0 / 60.0;
 
+        // Recording or playing back blocks Logic on Graphics' transform buffers, so we can't
+        // catch up with several ticks per frame. See LogicReplay
+        const bool bOneTickPerFrame = logicSystem && logicReplay.isActive();
+        if( bOneTickPerFrame )
+        {
+            Ogre::LogManager::getSingleton().logMessage(
+                "LogicReplay: running one logic tick per frame. The simulation will run "
+                "slower than real time if rendering can't keep up." );
+        }
+
         while( !graphicsSystem->getQuit() )
         {
-            while( accumulator >= MainEntryPoints::Frametime && logicSystem )
+            if( logicReplay.isPlayback() )
             {
-                logicSystem->beginFrameParallel();
-                logicSystem->update( static_cast<float>( MainEntryPoints::Frametime ) );
-                logicSystem->finishFrameParallel();
+                // Uncapped: one tick per frame, as fast as we can go.
+                accumulator = MainEntryPoints::Frametime;
+            }
 
-                logicSystem->finishFrame();
+            const Ogre::uint64 logicStart = timer.getMicroseconds();
+            while( accumulator >= MainEntryPoints::Frametime && logicSystem )
+            {
+                {
+                    Telemetry::ScopedSample logicTickSample( Telemetry::LogicTick );
+                    TraceRecorder::ScopedEvent logicTickEvent( "Logic tick" );
+                    logicSystem->beginFrameParallel();
+                    logicSystem->update( static_cast<float>( MainEntryPoints::Frametime ) );
+                    logicSystem->finishFrameParallel();
+
+                    logicSystem->finishFrame();
+                }
                 graphicsSystem->finishFrame();
 
                 accumulator -= MainEntryPoints::Frametime;
+
+                if( bOneTickPerFrame )
+                {
+                    // Drop the time we can't catch up with, rather than accumulating it.
+                    accumulator = std::min( accumulator, MainEntryPoints::Frametime );
+                    break;
+                }
             }
+            graphicsSystem->setFrameLogicMicroseconds( timer.getMicroseconds() - logicStart );
 
-            graphicsSystem->beginFrameParallel();
-            graphicsSystem->update( static_cast<float>( timeSinceLast ) );
-            graphicsSystem->finishFrameParallel();
-            if( !logicSystem )
-                graphicsSystem->finishFrame();
+            {
+                Telemetry::ScopedSample renderFrameSample( Telemetry::RenderFrame );
+                TraceRecorder::ScopedEvent renderFrameEvent( "Render frame" );
+                graphicsSystem->beginFrameParallel();
+                graphicsSystem->update( static_cast<float>( timeSinceLast ) );
+                graphicsSystem->finishFrameParallel();
+                if( !logicSystem )
+                    graphicsSystem->finishFrame();
+            }
 
             if( unitTest.getParams().isRecording() )
                 unitTest.notifyRecordingNewFrame( graphicsSystem );
 
+            if( logicReplay.isPlaybackFinished() )
+                graphicsSystem->setQuit();
+
             if( !renderWindow->isVisible() )
             {
                 // Don't burn CPU cycles unnecessary when we're minimized.
@@ -176,9 +245,12 @@ int Demo::MainEntryPoints::mainAppSingleThreaded( int argc, const char *argv[] )
                                  unitTest.getParams().bCompressDuration );
         }
 
+        graphicsSystem->logFramePipelineStats();
         graphicsSystem->destroyScene();
         if( logicSystem )
         {
+            logicReplay.finish();
+            logicSystem->logBackPressureStats();
             logicSystem->destroyScene();
             logicSystem->deinitialize();
         }
@@ -199,5 +271,6 @@ int Demo::MainEntryPoints::mainAppSingleThreaded( int argc, const char *argv[] )
                                          logicSystem );
     }
 
-    return 0;
+    // Lets CI scripts detect a replay that diverged.
+    return logicReplay.getStats().numMismatches ? 1 : 0;
 }
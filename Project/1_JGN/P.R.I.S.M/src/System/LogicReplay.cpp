@@ -0,0 +1,311 @@
+
+#include "System/LogicReplay.h"
+
+#include "GameEntityManager.h"
+#include "LogicSystem.h"
+
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string.h>
+
+namespace Demo
+{
+    static const Ogre::uint32 cReplayMagic = 0x524C5250u;  // 'PRLR'
+    /// 2: Mq::SDL_EVENT carries an InputSnapshot instead of a single SDL_Event
+    /// 3: Mq::GAME_ENTITIES_AWAKE_BATCH shifted the ids of the messages sent to Logic
+    /// 4: Same, for Mq::ORIGIN_REBASED
+    static const Ogre::uint32 cReplayVersion = 4u;
+    /// Smallest possible tick on disk: its hash and number of inputs
+    static const size_t cMinTickBytes = sizeof( Ogre::uint64 ) + sizeof( Ogre::uint32 );
+    /// Smallest possible input on disk: its id and size
+    static const size_t cMinInputBytes = 2u * sizeof( Ogre::uint32 );
+
+    LogicReplay::LogicReplay() :
+        mMode( ModeOff ),
+        mRandomSeed( 0 ),
+        mFrametime( 0 ),
+        mCurrentTick( 0 ),
+        mCurrentTickFirstInput( 0 ),
+        mTickStart( 0 )
+    {
+        memset( &mStats, 0, sizeof( mStats ) );
+    }
+    //-----------------------------------------------------------------------------------
+    bool LogicReplay::parseCmdLine( int nargs, const char *const *argv )
+    {
+        const char *recordArg = "--logic_record=";
+        const char *playbackArg = "--logic_playback=";
+        const size_t recordArgLen = strlen( recordArg );
+        const size_t playbackArgLen = strlen( playbackArg );
+
+        for( int i = 1; i < nargs; ++i )
+        {
+            if( !strncmp( argv[i], recordArg, recordArgLen ) )
+            {
+                mMode = ModeRecord;
+                mPath = argv[i] + recordArgLen;
+            }
+            else if( !strncmp( argv[i], playbackArg, playbackArgLen ) )
+            {
+                mMode = ModePlayback;
+                mPath = argv[i] + playbackArgLen;
+            }
+        }
+
+        if( mMode == ModePlayback && !load() )
+        {
+            mMode = ModeOff;
+            return false;
+        }
+
+        return true;
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicReplay::attach( LogicSystem *logicSystem, double frametime )
+    {
+        if( mMode == ModeOff )
+            return;
+
+        if( mMode == ModePlayback )
+            logicSystem->setRandomSeed( mRandomSeed );
+        else
+        {
+            mRandomSeed = logicSystem->getRandomSeed();
+            mFrametime = frametime;
+        }
+
+        // Never skip a frame; what the next tick reads must not depend on timing.
+        logicSystem->setBackPressurePolicy( LogicSystem::BackPressureBlock );
+        logicSystem->setMaxBlockMicroseconds( 10000000u );
+        logicSystem->_setLogicReplay( this );
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicReplay::_beginTick() { mTickStart = mTimer.getMicroseconds(); }
+    //-----------------------------------------------------------------------------------
+    void LogicReplay::_recordInput( Mq::MessageId messageId, const void *data, size_t size )
+    {
+        assert( mMode == ModeRecord );
+
+        InputMessage inputMessage;
+        inputMessage.messageId = static_cast<Ogre::uint32>( messageId );
+        inputMessage.size = static_cast<Ogre::uint32>( size );
+        inputMessage.offset = mInputData.size();
+        mInputMessages.push_back( inputMessage );
+
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>( data );
+        mInputData.insert( mInputData.end(), bytes, bytes + size );
+    }
+    //-----------------------------------------------------------------------------------
+    size_t LogicReplay::_getNumTickInputs() const
+    {
+        if( mMode != ModePlayback || mCurrentTick >= mTicks.size() )
+            return 0u;
+        return mTicks[mCurrentTick].numInputs;
+    }
+    //-----------------------------------------------------------------------------------
+    const void *LogicReplay::_getTickInput( size_t idx, Mq::MessageId &outMessageId ) const
+    {
+        assert( idx < _getNumTickInputs() );
+        const InputMessage &inputMessage = mInputMessages[mTicks[mCurrentTick].firstInput + idx];
+        outMessageId = static_cast<Mq::MessageId>( inputMessage.messageId );
+        return &mInputData[inputMessage.offset];
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicReplay::_endTick( const GameEntityManager *gameEntityManager, size_t transformIdx )
+    {
+        mStats.tickMicroseconds += mTimer.getMicroseconds() - mTickStart;
+
+        if( mMode == ModePlayback && mCurrentTick >= mTicks.size() )
+            return;  // The main loop hasn't noticed we're done yet
+
+        const Ogre::uint64 stateHash =
+            gameEntityManager ? gameEntityManager->hashTransforms( transformIdx ) : 0u;
+
+        if( mMode == ModeRecord )
+        {
+            Tick tick;
+            tick.stateHash = stateHash;
+            tick.firstInput = mCurrentTickFirstInput;
+            tick.numInputs = mInputMessages.size() - mCurrentTickFirstInput;
+            mTicks.push_back( tick );
+            // Whatever arrives from now on belongs to the next tick.
+            mCurrentTickFirstInput = mInputMessages.size();
+        }
+        else if( stateHash != mTicks[mCurrentTick].stateHash )
+        {
+            if( !mStats.numMismatches )
+            {
+                mStats.firstMismatchTick = mCurrentTick;
+                Ogre::LogManager::getSingleton().logMessage(
+                    "LogicReplay: state diverged from the recording at tick " +
+                        Ogre::StringConverter::toString( mCurrentTick ),
+                    Ogre::LML_CRITICAL );
+            }
+            ++mStats.numMismatches;
+        }
+
+        ++mCurrentTick;
+        ++mStats.numTicks;
+    }
+    //-----------------------------------------------------------------------------------
+    bool LogicReplay::load()
+    {
+        // Called before Ogre is initialized: errors can't go to the Ogre.log
+        std::ifstream inFile( mPath.c_str(), std::ios::in | std::ios::binary );
+        if( !inFile )
+        {
+            std::cerr << "LogicReplay: could not open " << mPath << std::endl;
+            return false;
+        }
+
+        inFile.seekg( 0, std::ios::end );
+        const Ogre::uint64 fileSize = static_cast<Ogre::uint64>( inFile.tellg() );
+        inFile.seekg( 0, std::ios::beg );
+
+        Ogre::uint32 magic = 0, version = 0;
+        Ogre::uint64 numTicks = 0;
+        inFile.read( reinterpret_cast<char *>( &magic ), sizeof( magic ) );
+        inFile.read( reinterpret_cast<char *>( &version ), sizeof( version ) );
+        inFile.read( reinterpret_cast<char *>( &mRandomSeed ), sizeof( mRandomSeed ) );
+        inFile.read( reinterpret_cast<char *>( &mFrametime ), sizeof( mFrametime ) );
+        inFile.read( reinterpret_cast<char *>( &numTicks ), sizeof( numTicks ) );
+
+        if( !inFile || magic != cReplayMagic || version != cReplayVersion )
+        {
+            std::cerr << "LogicReplay: " << mPath
+                      << " is not a logic replay or was saved by another version" << std::endl;
+            return false;
+        }
+
+        // Don't trust the header: a corrupt count must not make us allocate gigabytes.
+        Ogre::uint64 bytesLeft = fileSize - static_cast<Ogre::uint64>( inFile.tellg() );
+        if( numTicks > bytesLeft / cMinTickBytes || !( mFrametime > 0.0 ) )
+        {
+            std::cerr << "LogicReplay: " << mPath << " is corrupt" << std::endl;
+            return false;
+        }
+
+        mTicks.resize( static_cast<size_t>( numTicks ) );
+        for( size_t i = 0u; i < mTicks.size() && inFile; ++i )
+        {
+            Ogre::uint32 numInputs = 0;
+            inFile.read( reinterpret_cast<char *>( &mTicks[i].stateHash ), sizeof( Ogre::uint64 ) );
+            inFile.read( reinterpret_cast<char *>( &numInputs ), sizeof( numInputs ) );
+            mTicks[i].firstInput = mInputMessages.size();
+            mTicks[i].numInputs = numInputs;
+
+            bytesLeft -= std::min<Ogre::uint64>( bytesLeft, cMinTickBytes );
+            if( numInputs > bytesLeft / cMinInputBytes )
+                inFile.setstate( std::ios::failbit );
+
+            for( Ogre::uint32 j = 0u; j < numInputs && inFile; ++j )
+            {
+                InputMessage inputMessage;
+                inFile.read( reinterpret_cast<char *>( &inputMessage.messageId ),
+                             sizeof( inputMessage.messageId ) );
+                inFile.read( reinterpret_cast<char *>( &inputMessage.size ),
+                             sizeof( inputMessage.size ) );
+
+                bytesLeft -= std::min<Ogre::uint64>( bytesLeft, cMinInputBytes );
+                if( inputMessage.size > bytesLeft )
+                {
+                    inFile.setstate( std::ios::failbit );
+                    break;
+                }
+                bytesLeft -= inputMessage.size;
+
+                inputMessage.offset = mInputData.size();
+                mInputData.resize( mInputData.size() + inputMessage.size );
+                if( inputMessage.size )
+                {
+                    inFile.read( reinterpret_cast<char *>( &mInputData[inputMessage.offset] ),
+                                 inputMessage.size );
+                }
+                mInputMessages.push_back( inputMessage );
+            }
+        }
+
+        if( !inFile )
+        {
+            std::cerr << "LogicReplay: " << mPath << " is truncated or corrupt" << std::endl;
+            mTicks.clear();
+            mInputMessages.clear();
+            mInputData.clear();
+            return false;
+        }
+
+        return true;
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicReplay::save() const
+    {
+        std::ofstream outFile( mPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+        if( !outFile )
+        {
+            Ogre::LogManager::getSingleton().logMessage( "LogicReplay: could not write " + mPath,
+                                                         Ogre::LML_CRITICAL );
+            return;
+        }
+
+        const Ogre::uint64 numTicks = mTicks.size();
+        outFile.write( reinterpret_cast<const char *>( &cReplayMagic ), sizeof( cReplayMagic ) );
+        outFile.write( reinterpret_cast<const char *>( &cReplayVersion ), sizeof( cReplayVersion ) );
+        outFile.write( reinterpret_cast<const char *>( &mRandomSeed ), sizeof( mRandomSeed ) );
+        outFile.write( reinterpret_cast<const char *>( &mFrametime ), sizeof( mFrametime ) );
+        outFile.write( reinterpret_cast<const char *>( &numTicks ), sizeof( numTicks ) );
+
+        std::vector<Tick>::const_iterator itor = mTicks.begin();
+        std::vector<Tick>::const_iterator endt = mTicks.end();
+        while( itor != endt )
+        {
+            const Ogre::uint32 numInputs = static_cast<Ogre::uint32>( itor->numInputs );
+            outFile.write( reinterpret_cast<const char *>( &itor->stateHash ),
+                           sizeof( itor->stateHash ) );
+            outFile.write( reinterpret_cast<const char *>( &numInputs ), sizeof( numInputs ) );
+
+            for( size_t i = 0u; i < itor->numInputs; ++i )
+            {
+                const InputMessage &inputMessage = mInputMessages[itor->firstInput + i];
+                outFile.write( reinterpret_cast<const char *>( &inputMessage.messageId ),
+                               sizeof( inputMessage.messageId ) );
+                outFile.write( reinterpret_cast<const char *>( &inputMessage.size ),
+                               sizeof( inputMessage.size ) );
+                if( inputMessage.size )
+                {
+                    outFile.write( reinterpret_cast<const char *>( &mInputData[inputMessage.offset] ),
+                                   inputMessage.size );
+                }
+            }
+            ++itor;
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void LogicReplay::finish()
+    {
+        if( mMode == ModeOff )
+            return;
+
+        if( mMode == ModeRecord )
+            save();
+
+        const double numTicks = double( std::max<Ogre::uint64>( mStats.numTicks, 1u ) );
+        Ogre::String summary =
+            ( mMode == ModeRecord ? "LogicReplay recorded " : "LogicReplay played back " ) +
+            Ogre::StringConverter::toString( mStats.numTicks ) + " ticks. Avg tick: " +
+            Ogre::StringConverter::toString( double( mStats.tickMicroseconds ) / numTicks /
+                                             1000.0 ) +
+            " ms";
+        if( mMode == ModePlayback )
+        {
+            summary += ". Recorded: " + Ogre::StringConverter::toString( mTicks.size() ) +
+                       " Mismatches: " + Ogre::StringConverter::toString( mStats.numMismatches );
+        }
+
+        Ogre::LogManager::getSingleton().logMessage(
+            summary, mStats.numMismatches ? Ogre::LML_CRITICAL : Ogre::LML_NORMAL );
+    }
+}  // namespace Demo
@@ -32,7 +32,195 @@ THE SOFTWARE.
 
 #include "System/MainEntryPoints.h"
 
+#include "GameEntity.h"
+#include "GraphicsSystem.h"
+#include "LogicSystem.h"
+#include "System/Telemetry.h"
+#include "System/TraceRecorder.h"
+#include "Threading/JobSystem.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
 namespace Demo
 {
     double MainEntryPoints::Frametime = 1.0 / 60.0;
-}
+    bool MainEntryPoints::UseSpscMessageTransport = true;
+    Ogre::uint64 MainEntryPoints::MaxFrameJitterMicroseconds = 250u;
+    bool MainEntryPoints::FrameSleepEnabled = true;
+
+    void MainEntryPoints::applyCoreSettings( int nargs, const char *const *argv,
+                                             GraphicsSystem *graphicsSystem,
+                                             LogicSystem *logicSystem, bool bMultithreaded )
+    {
+        size_t numSceneManagerThreads = 0;
+        size_t numJobWorkerThreads = 0;
+        JobSystem::partitionCores( bMultithreaded && logicSystem, numSceneManagerThreads,
+                                   numJobWorkerThreads );
+
+        const char *workersArg = "--job-workers=";
+        const size_t workersArgLen = strlen( workersArg );
+
+        for( int i = 1; i < nargs; ++i )
+        {
+            if( !strncmp( argv[i], workersArg, workersArgLen ) )
+            {
+                const long numWorkers = strtol( argv[i] + workersArgLen, 0, 10 );
+                numJobWorkerThreads = static_cast<size_t>( std::max( numWorkers, 0l ) );
+            }
+        }
+
+        graphicsSystem->setNumSceneManagerThreads( numSceneManagerThreads );
+        if( logicSystem )
+            logicSystem->setNumJobWorkerThreads( numJobWorkerThreads );
+    }
+    //-----------------------------------------------------------------------------------
+    void MainEntryPoints::applyFrameQueueSettings( int nargs, const char *const *argv,
+                                                   GraphicsSystem *graphicsSystem,
+                                                   LogicSystem *logicSystem, bool bMultithreaded )
+    {
+        const char *buffersArg = "--game-entity-buffers=";
+        const char *policyArg = "--back-pressure=";
+        const char *framesInFlightArg = "--frames-in-flight=";
+        const size_t buffersArgLen = strlen( buffersArg );
+        const size_t policyArgLen = strlen( policyArg );
+        const char *jitterArg = "--max-frame-jitter-us=";
+        const size_t framesInFlightArgLen = strlen( framesInFlightArg );
+        const size_t jitterArgLen = strlen( jitterArg );
+
+        for( int i = 1; i < nargs; ++i )
+        {
+            if( !strcmp( argv[i], "--pipelined-frames" ) )
+                graphicsSystem->setPipelinedFrames( true );
+            else if( !strncmp( argv[i], framesInFlightArg, framesInFlightArgLen ) )
+            {
+                long numFrames = strtol( argv[i] + framesInFlightArgLen, 0, 10 );
+                numFrames = std::min( std::max( numFrames, 1l ), 255l );
+                graphicsSystem->setMaxFramesInFlight( static_cast<Ogre::uint8>( numFrames ) );
+            }
+            else if( !strcmp( argv[i], "--no-frame-sleep" ) )
+                FrameSleepEnabled = false;
+            else if( !strncmp( argv[i], jitterArg, jitterArgLen ) )
+            {
+                const long jitter = strtol( argv[i] + jitterArgLen, 0, 10 );
+                MaxFrameJitterMicroseconds = static_cast<Ogre::uint64>( std::max( jitter, 0l ) );
+            }
+            else if( !logicSystem )
+                continue;
+            else if( !strcmp( argv[i], "--dirty-tracking" ) )
+            {
+                logicSystem->setDirtyTracking( true );
+                graphicsSystem->setDirtyTracking( true );
+            }
+            else if( !strcmp( argv[i], "--floating-origin" ) )
+            {
+                logicSystem->setFloatingOrigin( true );
+                graphicsSystem->setFloatingOrigin( true );
+            }
+            else if( !strncmp( argv[i], buffersArg, buffersArgLen ) )
+            {
+                const Ogre::uint32 numBuffers = LogicSystem::clampNumGameEntityBuffers(
+                    strtol( argv[i] + buffersArgLen, 0, 10 ) );
+                logicSystem->setNumGameEntityBuffers( numBuffers );
+                graphicsSystem->setNumGameEntityBuffers( numBuffers );
+            }
+            else if( !strncmp( argv[i], policyArg, policyArgLen ) )
+            {
+                const char *policy = argv[i] + policyArgLen;
+                if( !strcmp( policy, "block" ) )
+                {
+                    logicSystem->setBackPressurePolicy( bMultithreaded
+                                                            ? LogicSystem::BackPressureBlock
+                                                            : LogicSystem::BackPressureSkip );
+                }
+                else if( !strcmp( policy, "skip" ) )
+                    logicSystem->setBackPressurePolicy( LogicSystem::BackPressureSkip );
+                else if( !strcmp( policy, "extrapolate" ) )
+                    logicSystem->setBackPressurePolicy( LogicSystem::BackPressureExtrapolate );
+            }
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void MainEntryPoints::applyHeadlessSettings( int nargs, const char *const *argv,
+                                                 GraphicsSystem *graphicsSystem )
+    {
+        const char *framesArg = "--frames=";
+        const char *csvArg = "--frame-timings-csv=";
+        const size_t framesArgLen = strlen( framesArg );
+        const size_t csvArgLen = strlen( csvArg );
+
+        bool bHeadless = false;
+        Ogre::String csvPath;
+
+        for( int i = 1; i < nargs; ++i )
+        {
+            if( !strcmp( argv[i], "--headless" ) )
+                bHeadless = true;
+            else if( !strcmp( argv[i], "--no-vsync" ) )
+                graphicsSystem->setVSync( false );
+            else if( !strncmp( argv[i], framesArg, framesArgLen ) )
+            {
+                const long long numFrames = strtoll( argv[i] + framesArgLen, 0, 10 );
+                graphicsSystem->setMaxFrames( static_cast<Ogre::uint64>( std::max( numFrames, 0ll ) ) );
+            }
+            else if( !strncmp( argv[i], csvArg, csvArgLen ) )
+                csvPath = argv[i] + csvArgLen;
+        }
+
+        if( bHeadless )
+        {
+            graphicsSystem->setHeadless( true );
+            graphicsSystem->setVSync( false );
+            if( csvPath.empty() )
+                csvPath = graphicsSystem->getWriteAccessFolder() + "FrameTimings.csv";
+        }
+
+        graphicsSystem->setFrameTimingsCsv( csvPath );
+    }
+    //-----------------------------------------------------------------------------------
+    void MainEntryPoints::applyCacheSettings( int nargs, const char *const *argv,
+                                              GraphicsSystem *graphicsSystem )
+    {
+        const char *streamingArg = "--mesh-streaming-threads=";
+        const size_t streamingArgLen = strlen( streamingArg );
+
+        for( int i = 1; i < nargs; ++i )
+        {
+            if( !strcmp( argv[i], "--texture-cache-json" ) )
+                graphicsSystem->setExportTextureCacheJson( true );
+            else if( !strncmp( argv[i], streamingArg, streamingArgLen ) )
+            {
+                const long numThreads = strtol( argv[i] + streamingArgLen, 0, 10 );
+                if( numThreads >= 0 )
+                    graphicsSystem->setNumMeshStreamingThreads( static_cast<size_t>( numThreads ) );
+            }
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void MainEntryPoints::applyTelemetrySettings( int nargs, const char *const *argv,
+                                                  GraphicsSystem *graphicsSystem )
+    {
+        const char *csvArg = "--telemetry-csv=";
+        const char *traceFramesArg = "--trace-frames=";
+        const char *traceFileArg = "--trace-file=";
+        const size_t csvArgLen = strlen( csvArg );
+        const size_t traceFramesArgLen = strlen( traceFramesArg );
+        const size_t traceFileArgLen = strlen( traceFileArg );
+
+        for( int i = 1; i < nargs; ++i )
+        {
+            if( !strcmp( argv[i], "--no-telemetry" ) )
+                Telemetry::setEnabled( false );
+            else if( !strncmp( argv[i], csvArg, csvArgLen ) )
+                graphicsSystem->setTelemetryCsv( argv[i] + csvArgLen );
+            else if( !strncmp( argv[i], traceFramesArg, traceFramesArgLen ) )
+            {
+                const long numFrames = strtol( argv[i] + traceFramesArgLen, 0, 10 );
+                TraceRecorder::setNumFrames( static_cast<size_t>( std::max( numFrames, 0l ) ) );
+            }
+            else if( !strncmp( argv[i], traceFileArg, traceFileArgLen ) )
+                graphicsSystem->setTraceCapturePath( argv[i] + traceFileArgLen );
+        }
+    }
+}  // namespace Demo
@@ -0,0 +1,354 @@
+
+#include "System/Telemetry.h"
+
+#include "Utils/SteadyClock.h"
+
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace Demo
+{
+    namespace
+    {
+        struct Sample
+        {
+            Ogre::uint32 metric;
+            Ogre::uint32 value;
+        };
+
+        /// Written only by the thread that created it, read only by Telemetry::update.
+        /// Positions are free-running counters, like SpscMessageRing's.
+        struct SampleRing
+        {
+            /// Must be a power of 2. A few seconds worth of samples at 60hz.
+            static const size_t cCapacity = 4096u;
+
+            Sample samples[cCapacity];
+
+            // Keeps the producer's and consumer's positions in different cache lines.
+            char padding0[64];
+            std::atomic<size_t> readPos;
+            char padding1[64];
+            std::atomic<size_t> writePos;
+            std::atomic<Ogre::uint64> numDropped;
+
+            SampleRing() : readPos( 0u ), writePos( 0u ), numDropped( 0u ) {}
+        };
+
+        /// Circular buffer with the last cHistorySize samples of a Metric.
+        struct MetricHistory
+        {
+            Ogre::uint32 values[Telemetry::cHistorySize];
+            size_t       numValues;
+            size_t       nextIdx;
+        };
+
+        struct TelemetryState
+        {
+            std::mutex                ringsMutex;
+            std::vector<SampleRing *> rings;
+
+            // Everything below is only touched by the thread calling Telemetry::update.
+            MetricHistory          history[Telemetry::NumMetrics];
+            Telemetry::Percentiles percentiles[Telemetry::NumMetrics];
+            /// Per Metric, whether it got samples since the last aggregation.
+            bool                      dirty[Telemetry::NumMetrics];
+            std::vector<Ogre::uint32> scratch;
+            Ogre::uint64              nextAggregate;
+
+            std::ofstream exportFile;
+            Ogre::uint64  exportInterval;
+            Ogre::uint64  nextExport;
+
+            TelemetryState() :
+                nextAggregate( 0u ),
+                exportInterval( 0u ),
+                nextExport( 0u )
+            {
+                memset( history, 0, sizeof( history ) );
+                memset( percentiles, 0, sizeof( percentiles ) );
+                memset( dirty, 0, sizeof( dirty ) );
+                scratch.reserve( Telemetry::cHistorySize );
+            }
+
+            ~TelemetryState()
+            {
+                std::vector<SampleRing *>::const_iterator itor = rings.begin();
+                std::vector<SampleRing *>::const_iterator endt = rings.end();
+                while( itor != endt )
+                    delete *itor++;
+                rings.clear();
+            }
+        };
+
+        TelemetryState &getState()
+        {
+            static TelemetryState state;
+            return state;
+        }
+
+        thread_local SampleRing *tSampleRing = 0;
+
+        const char *cMetricNames[Telemetry::NumMetrics] = {
+            "LogicTick",            //
+            "LogicUpdate",          //
+            "LogicQueueDepth",      //
+            "TransformStall",       //
+            "GameEntityFinish",     //
+            "RenderFrame",          //
+            "RenderUpdate",         //
+            "RenderPrepare",        //
+            "RenderSubmit",         //
+            "RenderInterpolate",    //
+            "RenderQueueDepth",     //
+            "LogicToSubmitLatency", //
+            "InputToSubmitLatency"  //
+        };
+
+        void drainRing( TelemetryState &state, SampleRing *ring )
+        {
+            size_t readPos = ring->readPos.load( std::memory_order_relaxed );
+            const size_t writePos = ring->writePos.load( std::memory_order_acquire );
+
+            while( readPos != writePos )
+            {
+                const Sample &sample = ring->samples[readPos & ( SampleRing::cCapacity - 1u )];
+                MetricHistory &history = state.history[sample.metric];
+                history.values[history.nextIdx] = sample.value;
+                history.nextIdx = ( history.nextIdx + 1u ) % Telemetry::cHistorySize;
+                history.numValues = std::min( history.numValues + 1u, Telemetry::cHistorySize );
+                state.dirty[sample.metric] = true;
+                ++readPos;
+            }
+
+            ring->readPos.store( readPos, std::memory_order_release );
+        }
+
+        void aggregate( TelemetryState &state )
+        {
+            for( size_t i = 0u; i < Telemetry::NumMetrics; ++i )
+            {
+                if( !state.dirty[i] )
+                    continue;
+
+                const MetricHistory &history = state.history[i];
+                state.scratch.assign( history.values, history.values + history.numValues );
+                std::sort( state.scratch.begin(), state.scratch.end() );
+
+                // Nearest rank
+                const size_t numValues = state.scratch.size();
+                Telemetry::Percentiles &percentiles = state.percentiles[i];
+                percentiles.p50 = state.scratch[( numValues * 50u ) / 100u];
+                percentiles.p95 = state.scratch[( numValues * 95u ) / 100u];
+                percentiles.p99 = state.scratch[( numValues * 99u ) / 100u];
+                percentiles.max = state.scratch.back();
+                percentiles.numSamples = static_cast<Ogre::uint32>( numValues );
+
+                state.dirty[i] = false;
+            }
+        }
+
+        void writeExportRows( TelemetryState &state, Ogre::uint64 timestamp )
+        {
+            for( size_t i = 0u; i < Telemetry::NumMetrics; ++i )
+            {
+                const Telemetry::Metric metric = static_cast<Telemetry::Metric>( i );
+                const Telemetry::Percentiles &percentiles = state.percentiles[i];
+                if( !percentiles.numSamples )
+                    continue;
+
+                state.exportFile << timestamp << ',' << cMetricNames[i] << ','
+                                 << Telemetry::getMetricUnits( metric ) << ','
+                                 << percentiles.numSamples << ',' << percentiles.p50 << ','
+                                 << percentiles.p95 << ',' << percentiles.p99 << ','
+                                 << percentiles.max << '\n';
+            }
+            state.exportFile.flush();
+        }
+
+        /// Microseconds are shown in milliseconds.
+        Ogre::String toDisplayString( Telemetry::Metric metric, Ogre::uint32 value )
+        {
+            if( metric == Telemetry::LogicQueueDepth || metric == Telemetry::RenderQueueDepth )
+                return Ogre::StringConverter::toString( value );
+            return Ogre::StringConverter::toString( float( value ) / 1000.0f, 3u );
+        }
+    }  // namespace
+
+    std::atomic<bool> Telemetry::msEnabled( true );
+
+    //-----------------------------------------------------------------------------------
+    void Telemetry::setEnabled( bool bEnabled )
+    {
+        msEnabled.store( bEnabled, std::memory_order_relaxed );
+    }
+    //-----------------------------------------------------------------------------------
+    void Telemetry::pushSample( Metric metric, Ogre::uint64 value )
+    {
+        SampleRing *ring = tSampleRing;
+        if( !ring )
+        {
+            // First sample from this thread. Rings live until the process exits,
+            // since the thread may outlive any object we could tie them to.
+            ring = new SampleRing();
+            TelemetryState &state = getState();
+            std::lock_guard<std::mutex> lock( state.ringsMutex );
+            state.rings.push_back( ring );
+            tSampleRing = ring;
+        }
+
+        const size_t writePos = ring->writePos.load( std::memory_order_relaxed );
+        if( writePos - ring->readPos.load( std::memory_order_acquire ) >= SampleRing::cCapacity )
+        {
+            ring->numDropped.fetch_add( 1u, std::memory_order_relaxed );
+            return;
+        }
+
+        Sample &sample = ring->samples[writePos & ( SampleRing::cCapacity - 1u )];
+        sample.metric = static_cast<Ogre::uint32>( metric );
+        sample.value = static_cast<Ogre::uint32>( std::min<Ogre::uint64>( value, 0xFFFFFFFFu ) );
+        ring->writePos.store( writePos + 1u, std::memory_order_release );
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::uint64 Telemetry::now()
+    {
+        return SteadyClock::getMicroseconds();
+    }
+    //-----------------------------------------------------------------------------------
+    void Telemetry::update()
+    {
+        TelemetryState &state = getState();
+
+        {
+            std::lock_guard<std::mutex> lock( state.ringsMutex );
+            std::vector<SampleRing *>::const_iterator itor = state.rings.begin();
+            std::vector<SampleRing *>::const_iterator endt = state.rings.end();
+            while( itor != endt )
+                drainRing( state, *itor++ );
+        }
+
+        const Ogre::uint64 currentTime = now();
+        const bool bExportDue = state.exportFile.is_open() && currentTime >= state.nextExport;
+
+        if( currentTime >= state.nextAggregate || bExportDue )
+        {
+            aggregate( state );
+            state.nextAggregate = currentTime + cAggregateMicroseconds;
+        }
+
+        if( bExportDue )
+        {
+            writeExportRows( state, currentTime );
+            state.nextExport = currentTime + state.exportInterval;
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    const Telemetry::Percentiles &Telemetry::getPercentiles( Metric metric )
+    {
+        return getState().percentiles[metric];
+    }
+    //-----------------------------------------------------------------------------------
+    const char *Telemetry::getMetricName( Metric metric ) { return cMetricNames[metric]; }
+    //-----------------------------------------------------------------------------------
+    const char *Telemetry::getMetricUnits( Metric metric )
+    {
+        return ( metric == LogicQueueDepth || metric == RenderQueueDepth ) ? "bytes" : "us";
+    }
+    //-----------------------------------------------------------------------------------
+    void Telemetry::setExportFile( const Ogre::String &path, Ogre::uint64 intervalMicroseconds )
+    {
+        TelemetryState &state = getState();
+
+        if( state.exportFile.is_open() )
+            state.exportFile.close();
+
+        if( path.empty() )
+            return;
+
+        state.exportFile.open( path.c_str(), std::ios::out | std::ios::trunc );
+        if( !state.exportFile.is_open() )
+        {
+            Ogre::LogManager::getSingleton().logMessage( "Telemetry: could not open " + path,
+                                                         Ogre::LML_CRITICAL );
+            return;
+        }
+
+        state.exportFile << "Timestamp (us),Metric,Units,Samples,p50,p95,p99,Max\n";
+        state.exportInterval = intervalMicroseconds;
+        state.nextExport = now() + intervalMicroseconds;
+    }
+    //-----------------------------------------------------------------------------------
+    void Telemetry::generateOverlayText( Ogre::String &outText )
+    {
+        const TelemetryState &state = getState();
+
+        outText += "\nTelemetry (ms):\tp50 / p95 / p99 / max";
+        for( size_t i = 0u; i < NumMetrics; ++i )
+        {
+            const Metric metric = static_cast<Metric>( i );
+            const Percentiles &percentiles = state.percentiles[i];
+            if( !percentiles.numSamples )
+                continue;
+
+            outText += "\n";
+            outText += cMetricNames[i];
+            outText += ":\t";
+            outText += toDisplayString( metric, percentiles.p50 ) + " / ";
+            outText += toDisplayString( metric, percentiles.p95 ) + " / ";
+            outText += toDisplayString( metric, percentiles.p99 ) + " / ";
+            outText += toDisplayString( metric, percentiles.max );
+            if( metric == LogicQueueDepth || metric == RenderQueueDepth )
+                outText += " bytes";
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::uint64 Telemetry::getNumDroppedSamples()
+    {
+        TelemetryState &state = getState();
+        std::lock_guard<std::mutex> lock( state.ringsMutex );
+
+        Ogre::uint64 numDropped = 0u;
+        std::vector<SampleRing *>::const_iterator itor = state.rings.begin();
+        std::vector<SampleRing *>::const_iterator endt = state.rings.end();
+        while( itor != endt )
+            numDropped += ( *itor++ )->numDropped.load( std::memory_order_relaxed );
+        return numDropped;
+    }
+    //-----------------------------------------------------------------------------------
+    void Telemetry::shutdown()
+    {
+        update();
+
+        TelemetryState &state = getState();
+        aggregate( state );
+
+        if( state.exportFile.is_open() )
+        {
+            writeExportRows( state, now() );
+            state.exportFile.close();
+        }
+
+        Ogre::LogManager &logManager = Ogre::LogManager::getSingleton();
+        logManager.logMessage( "Telemetry percentiles (us or bytes). Dropped samples: " +
+                               Ogre::StringConverter::toString( getNumDroppedSamples() ) );
+        for( size_t i = 0u; i < NumMetrics; ++i )
+        {
+            const Percentiles &percentiles = state.percentiles[i];
+            if( !percentiles.numSamples )
+                continue;
+
+            logManager.logMessage(
+                Ogre::String( cMetricNames[i] ) +
+                " p50: " + Ogre::StringConverter::toString( percentiles.p50 ) +
+                " p95: " + Ogre::StringConverter::toString( percentiles.p95 ) +
+                " p99: " + Ogre::StringConverter::toString( percentiles.p99 ) +
+                " max: " + Ogre::StringConverter::toString( percentiles.max ) + " (" +
+                Ogre::StringConverter::toString( percentiles.numSamples ) + " samples)" );
+        }
+    }
+}  // namespace Demo
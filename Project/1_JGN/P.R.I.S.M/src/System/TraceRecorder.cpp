@@ -0,0 +1,305 @@
+
+#include "System/TraceRecorder.h"
+
+#include "Utils/SteadyClock.h"
+
+#include "OgreLogManager.h"
+#include "OgreProfiler.h"
+#include "OgreStringConverter.h"
+
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace Demo
+{
+    namespace
+    {
+        struct TraceEvent
+        {
+            const char  *name;
+            Ogre::uint64 start;
+            Ogre::uint64 end;
+        };
+
+        /// Written only by the thread that created it, read only by TraceRecorder::update.
+        /// Same scheme as Telemetry's rings.
+        struct EventRing
+        {
+            /// Must be a power of 2. Only needs to hold what a thread records in a frame.
+            static const size_t cCapacity = 8192u;
+
+            TraceEvent events[cCapacity];
+
+            char padding0[64];
+            std::atomic<size_t> readPos;
+            char padding1[64];
+            std::atomic<size_t> writePos;
+
+            Ogre::uint32 threadId;
+            /// Protected by TraceState::ringsMutex
+            Ogre::String threadName;
+
+            /// Only touched by the thread calling update. Sorted by end time.
+            /// Events that ended before the oldest frame get discarded.
+            std::deque<TraceEvent> history;
+
+            EventRing( Ogre::uint32 _threadId ) :
+                readPos( 0u ),
+                writePos( 0u ),
+                threadId( _threadId )
+            {
+            }
+        };
+
+        struct TraceState
+        {
+            std::mutex               ringsMutex;
+            std::vector<EventRing *> rings;
+            /// Protected by ringsMutex
+            Ogre::String pendingCapturePath;
+
+            // Only touched by the thread calling update.
+            size_t                   numFrames;
+            Ogre::uint64             frameCount;
+            std::deque<Ogre::uint64> frameStarts;
+
+            TraceState() : numFrames( 0u ), frameCount( 0u )
+            {
+            }
+
+            ~TraceState()
+            {
+                std::vector<EventRing *>::const_iterator itor = rings.begin();
+                std::vector<EventRing *>::const_iterator endt = rings.end();
+                while( itor != endt )
+                    delete *itor++;
+                rings.clear();
+            }
+        };
+
+        TraceState &getState()
+        {
+            static TraceState state;
+            return state;
+        }
+
+        thread_local EventRing *tEventRing = 0;
+
+        /// Ids 1000 and up are left for Ogre's OfflineProfiler.
+        const Ogre::uint32 cOgreFirstThreadId = 1000u;
+
+        EventRing *getThreadRing()
+        {
+            if( !tEventRing )
+            {
+                TraceState &state = getState();
+                std::lock_guard<std::mutex> lock( state.ringsMutex );
+                tEventRing = new EventRing( static_cast<Ogre::uint32>( state.rings.size() + 1u ) );
+                tEventRing->threadName = "Thread #" + Ogre::StringConverter::toString(
+                                                          tEventRing->threadId );
+                state.rings.push_back( tEventRing );
+            }
+            return tEventRing;
+        }
+
+        void drainRing( EventRing *ring )
+        {
+            size_t readPos = ring->readPos.load( std::memory_order_relaxed );
+            const size_t writePos = ring->writePos.load( std::memory_order_acquire );
+
+            while( readPos != writePos )
+                ring->history.push_back( ring->events[readPos++ & ( EventRing::cCapacity - 1u )] );
+
+            ring->readPos.store( readPos, std::memory_order_release );
+        }
+
+        void appendEscaped( Ogre::String &outJson, const char *str )
+        {
+            while( *str )
+            {
+                if( *str == '"' || *str == '\\' )
+                    outJson += '\\';
+                outJson += static_cast<unsigned char>( *str ) >= ' ' ? *str : ' ';
+                ++str;
+            }
+        }
+
+        void appendThreadName( Ogre::String &outJson, Ogre::uint32 threadId, const char *name )
+        {
+            outJson += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+            outJson += Ogre::StringConverter::toString( threadId );
+            outJson += ",\"args\":{\"name\":\"";
+            appendEscaped( outJson, name );
+            outJson += "\"}}";
+        }
+    }  // namespace
+
+    std::atomic<bool> TraceRecorder::msEnabled( false );
+
+    //-----------------------------------------------------------------------------------
+    void TraceRecorder::setNumFrames( size_t numFrames )
+    {
+        TraceState &state = getState();
+        std::lock_guard<std::mutex> lock( state.ringsMutex );
+        state.numFrames = numFrames;
+        if( !numFrames )
+            state.frameStarts.clear();
+        msEnabled.store( numFrames != 0u, std::memory_order_relaxed );
+    }
+    //-----------------------------------------------------------------------------------
+    size_t TraceRecorder::getNumFrames() { return getState().numFrames; }
+    //-----------------------------------------------------------------------------------
+    void TraceRecorder::setThreadName( const Ogre::String &name )
+    {
+        EventRing *ring = getThreadRing();
+        std::lock_guard<std::mutex> lock( getState().ringsMutex );
+        ring->threadName = name;
+    }
+    //-----------------------------------------------------------------------------------
+    void TraceRecorder::record( const char *name, Ogre::uint64 start, Ogre::uint64 end )
+    {
+        EventRing *ring = getThreadRing();
+
+        const size_t writePos = ring->writePos.load( std::memory_order_relaxed );
+        // Full means update isn't being called. Nobody's looking; just drop it.
+        if( writePos - ring->readPos.load( std::memory_order_acquire ) >= EventRing::cCapacity )
+            return;
+
+        TraceEvent &event = ring->events[writePos & ( EventRing::cCapacity - 1u )];
+        event.name = name;
+        event.start = start;
+        event.end = end;
+        ring->writePos.store( writePos + 1u, std::memory_order_release );
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::uint64 TraceRecorder::now()
+    {
+        return SteadyClock::getMicroseconds();
+    }
+    //-----------------------------------------------------------------------------------
+    void TraceRecorder::update()
+    {
+        TraceState &state = getState();
+
+        Ogre::String capturePath;
+
+        {
+            std::lock_guard<std::mutex> lock( state.ringsMutex );
+
+            if( state.numFrames )
+            {
+                state.frameStarts.push_back( now() );
+                ++state.frameCount;
+                while( state.frameStarts.size() > state.numFrames )
+                    state.frameStarts.pop_front();
+            }
+
+            const Ogre::uint64 oldestFrameStart =
+                state.frameStarts.empty() ? ~Ogre::uint64( 0u ) : state.frameStarts.front();
+
+            std::vector<EventRing *>::const_iterator itor = state.rings.begin();
+            std::vector<EventRing *>::const_iterator endt = state.rings.end();
+            while( itor != endt )
+            {
+                EventRing *ring = *itor++;
+                drainRing( ring );
+
+                std::deque<TraceEvent> &history = ring->history;
+                while( !history.empty() && history.front().end < oldestFrameStart )
+                    history.pop_front();
+            }
+
+            capturePath.swap( state.pendingCapturePath );
+        }
+
+        if( !capturePath.empty() )
+            capture( capturePath );
+    }
+    //-----------------------------------------------------------------------------------
+    void TraceRecorder::requestCapture( const Ogre::String &path )
+    {
+        TraceState &state = getState();
+        std::lock_guard<std::mutex> lock( state.ringsMutex );
+        state.pendingCapturePath = path;
+    }
+    //-----------------------------------------------------------------------------------
+    void TraceRecorder::capture( const Ogre::String &path )
+    {
+        TraceState &state = getState();
+
+        Ogre::String json;
+        json.reserve( 1024u * 1024u );
+        json += "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"PRISM\"}}";
+
+        {
+            std::lock_guard<std::mutex> lock( state.ringsMutex );
+
+            std::vector<EventRing *>::const_iterator itor = state.rings.begin();
+            std::vector<EventRing *>::const_iterator endt = state.rings.end();
+
+            while( itor != endt )
+            {
+                const EventRing *ring = *itor;
+                appendThreadName( json, ring->threadId, ring->threadName.c_str() );
+
+                const Ogre::String tid = Ogre::StringConverter::toString( ring->threadId );
+
+                std::deque<TraceEvent>::const_iterator itEvent = ring->history.begin();
+                std::deque<TraceEvent>::const_iterator enEvent = ring->history.end();
+                while( itEvent != enEvent )
+                {
+                    json += ",\n{\"name\":\"";
+                    appendEscaped( json, itEvent->name );
+                    json += "\",\"ph\":\"X\",\"ts\":";
+                    json += Ogre::StringConverter::toString( itEvent->start );
+                    json += ",\"dur\":";
+                    json += Ogre::StringConverter::toString( itEvent->end - itEvent->start );
+                    json += ",\"pid\":1,\"tid\":" + tid + "}";
+                    ++itEvent;
+                }
+                ++itor;
+            }
+        }
+
+        // Frame boundaries, as global instant events
+        Ogre::uint64 frameNumber = state.frameCount - state.frameStarts.size();
+        std::deque<Ogre::uint64>::const_iterator itFrame = state.frameStarts.begin();
+        std::deque<Ogre::uint64>::const_iterator enFrame = state.frameStarts.end();
+        while( itFrame != enFrame )
+        {
+            json += ",\n{\"name\":\"Frame " + Ogre::StringConverter::toString( frameNumber++ );
+            json += "\",\"ph\":\"i\",\"s\":\"g\",\"ts\":";
+            json += Ogre::StringConverter::toString( *itFrame++ );
+            json += ",\"pid\":1,\"tid\":0}";
+        }
+
+#if OGRE_PROFILING == OGRE_PROFILING_INTERNAL_OFFLINE
+        if( Ogre::Profiler::getSingletonPtr() )
+        {
+            Ogre::OfflineProfiler &offlineProfiler =
+                Ogre::Profiler::getSingleton().getOfflineProfiler();
+            const Ogre::int64 usTimeOffset =
+                static_cast<Ogre::int64>( now() ) -
+                static_cast<Ogre::int64>( offlineProfiler.getMicroseconds() );
+            offlineProfiler.dumpChromeTraceEventsStr( json, usTimeOffset, cOgreFirstThreadId );
+        }
+#endif
+
+        json += "\n]\n";
+
+        std::ofstream outFile( path.c_str(), std::ios::binary | std::ios::out | std::ios::trunc );
+        if( !outFile.is_open() )
+        {
+            Ogre::LogManager::getSingleton().logMessage( "TraceRecorder: could not open " + path,
+                                                         Ogre::LML_CRITICAL );
+            return;
+        }
+        outFile.write( json.c_str(), static_cast<std::streamsize>( json.size() ) );
+
+        Ogre::LogManager::getSingleton().logMessage(
+            "TraceRecorder: wrote the last " +
+            Ogre::StringConverter::toString( state.frameStarts.size() ) + " frames to " + path );
+    }
+}  // namespace Demo
@@ -0,0 +1,190 @@
+
+#include "Threading/FramePacer.h"
+
+#include "OgreLogManager.h"
+#include "OgreStringConverter.h"
+#include "OgreTimer.h"
+
+#include <algorithm>
+#include <string.h>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    define VC_EXTRALEAN
+#    define NOMINMAX
+#    include <windows.h>
+#    ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#        define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#    endif
+#else
+#    include <sched.h>
+#    include <time.h>
+#endif
+
+namespace Demo
+{
+    /// Starting guess of how much the OS oversleeps, until we've measured it.
+    static const double cInitialSleepOvershoot = 1000.0;
+    /// Per frame. Makes the estimate forget old spikes after a few seconds.
+    static const double cSleepOvershootDecay = 0.99;
+    /// Upper limit of the estimate, as a fraction of the frame. getSpinMicroseconds adds
+    /// 50% on top, so we never spin for more than about half a frame, and a single long
+    /// preemption can't keep us from ever sleeping again.
+    static const double cMaxSleepOvershootFraction = 1.0 / 3.0;
+
+    FramePacer::FramePacer( Ogre::Timer *timer ) :
+        mTimer( timer ),
+        mWaitableTimer( 0 ),
+        mSleepEnabled( true ),
+        mMaxJitterMicroseconds( 250u ),
+        mMinSpinMicroseconds( 100u ),
+        mSleepOvershootEstimate( cInitialSleepOvershoot )
+    {
+        resetStats();
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+        // Sleep() has a 1ms granularity at best (15.6ms by default). High resolution
+        // waitable timers are available since Windows 10 1803.
+        mWaitableTimer = CreateWaitableTimerExW( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                                 TIMER_ALL_ACCESS );
+#endif
+    }
+    //-----------------------------------------------------------------------------------
+    FramePacer::~FramePacer()
+    {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+        if( mWaitableTimer )
+        {
+            CloseHandle( mWaitableTimer );
+            mWaitableTimer = 0;
+        }
+#endif
+    }
+    //-----------------------------------------------------------------------------------
+    void FramePacer::sleepMicroseconds( Ogre::uint64 microseconds )
+    {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+        if( mWaitableTimer )
+        {
+            LARGE_INTEGER dueTime;
+            // Negative means relative, in 100ns units.
+            dueTime.QuadPart = -static_cast<LONGLONG>( microseconds * 10u );
+            SetWaitableTimer( mWaitableTimer, &dueTime, 0, NULL, NULL, FALSE );
+            WaitForSingleObject( mWaitableTimer, INFINITE );
+        }
+        else
+        {
+            Sleep( static_cast<DWORD>( microseconds / 1000u ) );
+        }
+#else
+        timespec duration;
+        duration.tv_sec = static_cast<time_t>( microseconds / 1000000u );
+        duration.tv_nsec = static_cast<long>( ( microseconds % 1000000u ) * 1000u );
+#    if OGRE_PLATFORM == OGRE_PLATFORM_LINUX || OGRE_PLATFORM == OGRE_PLATFORM_ANDROID
+        clock_nanosleep( CLOCK_MONOTONIC, 0, &duration, 0 );
+#    else
+        nanosleep( &duration, 0 );
+#    endif
+#endif
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::uint64 FramePacer::wait( double frameTime, Ogre::uint64 startTime )
+    {
+        const Ogre::uint64 frameMicroseconds = static_cast<Ogre::uint64>( frameTime * 1000000.0 );
+        const Ogre::uint64 deadline = startTime + frameMicroseconds;
+        const double maxSleepOvershoot = double( frameMicroseconds ) * cMaxSleepOvershootFraction;
+
+        ++mStats.numFrames;
+
+        // Every frame, whether we sleep or not. Otherwise a spike that stops us from
+        // sleeping would never be forgotten.
+        mSleepOvershootEstimate =
+            std::min( mSleepOvershootEstimate * cSleepOvershootDecay, maxSleepOvershoot );
+
+        Ogre::uint64 now = mTimer->getMicroseconds();
+
+        if( now >= deadline )
+        {
+            // Logic took longer than a tick. Nothing to wait for. Keep the grid unless
+            // we fell so far behind that catching up would mean running ticks back to back.
+            ++mStats.numLateFrames;
+            return ( now - deadline ) > frameMicroseconds ? now : deadline;
+        }
+
+        const Ogre::uint64 spinMicroseconds = getSpinMicroseconds();
+        if( mSleepEnabled && deadline - now > spinMicroseconds )
+        {
+            const Ogre::uint64 wakeUpTime = deadline - spinMicroseconds;
+            sleepMicroseconds( wakeUpTime - now );
+
+            const Ogre::uint64 sleepStart = now;
+            now = mTimer->getMicroseconds();
+            mStats.sleptMicroseconds += now - sleepStart;
+
+            const double overslept = now > wakeUpTime ? double( now - wakeUpTime ) : 0.0;
+            mSleepOvershootEstimate =
+                std::min( std::max( overslept, mSleepOvershootEstimate ), maxSleepOvershoot );
+        }
+
+        const Ogre::uint64 spinStart = now;
+        while( now < deadline )
+        {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+            SwitchToThread();
+#else
+            sched_yield();
+#endif
+            now = mTimer->getMicroseconds();
+        }
+        mStats.spunMicroseconds += now - spinStart;
+
+        const Ogre::uint64 overshoot = now - deadline;
+        mStats.overshootMicroseconds += overshoot;
+        mStats.maxOvershootMicroseconds = std::max( mStats.maxOvershootMicroseconds, overshoot );
+
+        if( overshoot > mMaxJitterMicroseconds )
+        {
+            // Overslept past the deadline. Spin longer from now on.
+            ++mStats.numJitterViolations;
+            mSleepOvershootEstimate =
+                std::min( mSleepOvershootEstimate + double( overshoot ), maxSleepOvershoot );
+        }
+
+        return overshoot > frameMicroseconds ? now : deadline;
+    }
+    //-----------------------------------------------------------------------------------
+    void FramePacer::setMaxJitterMicroseconds( Ogre::uint64 microseconds )
+    {
+        mMaxJitterMicroseconds = microseconds;
+        // We can't wake up any closer than the spin loop's granularity.
+        mMinSpinMicroseconds = std::min<Ogre::uint64>( 100u, microseconds );
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::uint64 FramePacer::getSpinMicroseconds() const
+    {
+        // 50% margin over the recent worst case.
+        return mMinSpinMicroseconds + static_cast<Ogre::uint64>( mSleepOvershootEstimate * 1.5 );
+    }
+    //-----------------------------------------------------------------------------------
+    void FramePacer::resetStats() { memset( &mStats, 0, sizeof( mStats ) ); }
+    //-----------------------------------------------------------------------------------
+    void FramePacer::logStats() const
+    {
+        const double numFrames = double( std::max<Ogre::uint64>( mStats.numFrames, 1u ) );
+        const double totalWait = double(
+            std::max<Ogre::uint64>( mStats.sleptMicroseconds + mStats.spunMicroseconds, 1u ) );
+
+        Ogre::LogManager::getSingleton().logMessage(
+            "FramePacer over " + Ogre::StringConverter::toString( mStats.numFrames ) +
+            " frames. Late: " + Ogre::StringConverter::toString( mStats.numLateFrames ) +
+            " Avg overshoot: " +
+            Ogre::StringConverter::toString( double( mStats.overshootMicroseconds ) / numFrames ) +
+            "us Max overshoot: " + Ogre::StringConverter::toString( mStats.maxOvershootMicroseconds ) +
+            "us Jitter violations (>" + Ogre::StringConverter::toString( mMaxJitterMicroseconds ) +
+            "us): " + Ogre::StringConverter::toString( mStats.numJitterViolations ) +
+            " Time spent spinning: " +
+            Ogre::StringConverter::toString( 100.0 * double( mStats.spunMicroseconds ) / totalWait ) +
+            "% Current spin slice: " + Ogre::StringConverter::toString( getSpinMicroseconds() ) +
+            "us" );
+    }
+}  // namespace Demo
@@ -0,0 +1,329 @@
+
+#include "Threading/JobSystem.h"
+#include "System/TraceRecorder.h"
+
+#include "OgrePlatformInformation.h"
+#include "OgreStringConverter.h"
+
+#include <algorithm>
+
+namespace Demo
+{
+    namespace
+    {
+        // Lets jobs that submit more jobs push them to their own queue.
+        thread_local const JobSystem *tCurrentJobSystem = 0;
+        thread_local size_t           tCurrentThreadIdx = 0;
+    }  // namespace
+
+    size_t JobGraph::addJob( const JobFunc &func )
+    {
+        mNodes.push_back( Node( func ) );
+        return mNodes.size() - 1u;
+    }
+    //-----------------------------------------------------------------------------------
+    void JobGraph::addDependency( size_t jobIdx, size_t dependsOnIdx )
+    {
+        assert( jobIdx < mNodes.size() && dependsOnIdx < mNodes.size() );
+        assert( jobIdx != dependsOnIdx );
+        mNodes[dependsOnIdx].successors.push_back( jobIdx );
+        ++mNodes[jobIdx].numDependencies;
+    }
+    //-----------------------------------------------------------------------------------
+    JobSystem::JobSystem( size_t numWorkerThreads ) : mNumQueuedJobs( 0 ), mQuit( false )
+    {
+        mQueues.reserve( numWorkerThreads + 1u );
+        for( size_t i = 0u; i < numWorkerThreads + 1u; ++i )
+            mQueues.push_back( new WorkQueue() );
+
+        // Queue 0 belongs to the owner thread. Workers start at 1.
+        mWorkers.reserve( numWorkerThreads );
+        for( size_t i = 0u; i < numWorkerThreads; ++i )
+            mWorkers.push_back( std::thread( &JobSystem::workerThread, this, i + 1u ) );
+    }
+    //-----------------------------------------------------------------------------------
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock( mWakeMutex );
+            mQuit = true;
+        }
+        mWakeCondition.notify_all();
+
+        std::vector<std::thread>::iterator itor = mWorkers.begin();
+        std::vector<std::thread>::iterator endt = mWorkers.end();
+        while( itor != endt )
+            ( itor++ )->join();
+        mWorkers.clear();
+
+        std::vector<WorkQueue *>::const_iterator itQueue = mQueues.begin();
+        std::vector<WorkQueue *>::const_iterator enQueue = mQueues.end();
+        while( itQueue != enQueue )
+        {
+            assert( ( *itQueue )->jobs.empty() && "Destroying JobSystem with jobs in flight!" );
+            delete *itQueue++;
+        }
+        mQueues.clear();
+    }
+    //-----------------------------------------------------------------------------------
+    size_t JobSystem::getCurrentThreadIdx() const
+    {
+        return tCurrentJobSystem == this ? tCurrentThreadIdx : 0u;
+    }
+    //-----------------------------------------------------------------------------------
+    void JobSystem::push( const Job &job, size_t threadIdx ) { pushBatch( &job, 1u, threadIdx ); }
+    //-----------------------------------------------------------------------------------
+    void JobSystem::pushBatch( const Job *jobs, size_t numJobs, size_t threadIdx )
+    {
+        // Count first, so mNumQueuedJobs never drops below zero when a worker
+        // steals the job before we get to increment it.
+        {
+            std::lock_guard<std::mutex> lock( mWakeMutex );
+            mNumQueuedJobs.fetch_add( numJobs, std::memory_order_relaxed );
+        }
+
+        {
+            WorkQueue *queue = mQueues[threadIdx];
+            std::lock_guard<std::mutex> lock( queue->mutex );
+            queue->jobs.insert( queue->jobs.end(), jobs, jobs + numJobs );
+        }
+
+        if( numJobs == 1u )
+            mWakeCondition.notify_one();
+        else
+            mWakeCondition.notify_all();
+    }
+    //-----------------------------------------------------------------------------------
+    bool JobSystem::tryPop( size_t threadIdx, Job &outJob )
+    {
+        // Our own queue is LIFO: the most recent job is the most likely to be in cache.
+        WorkQueue *queue = mQueues[threadIdx];
+        std::lock_guard<std::mutex> lock( queue->mutex );
+        if( queue->jobs.empty() )
+            return false;
+
+        outJob = queue->jobs.back();
+        queue->jobs.pop_back();
+        mNumQueuedJobs.fetch_sub( 1u, std::memory_order_relaxed );
+        return true;
+    }
+    //-----------------------------------------------------------------------------------
+    bool JobSystem::trySteal( size_t threadIdx, Job &outJob )
+    {
+        // Steal the oldest job, which for parallelFor & graphs tends to be the biggest
+        // chunk of pending work, and is the farthest away from what the owner is touching.
+        const size_t numQueues = mQueues.size();
+        for( size_t i = 1u; i < numQueues; ++i )
+        {
+            WorkQueue *queue = mQueues[( threadIdx + i ) % numQueues];
+            std::lock_guard<std::mutex> lock( queue->mutex );
+            if( !queue->jobs.empty() )
+            {
+                outJob = queue->jobs.front();
+                queue->jobs.pop_front();
+                mNumQueuedJobs.fetch_sub( 1u, std::memory_order_relaxed );
+                return true;
+            }
+        }
+
+        return false;
+    }
+    //-----------------------------------------------------------------------------------
+    bool JobSystem::tryRunOne( size_t threadIdx )
+    {
+        Job job;
+        if( !tryPop( threadIdx, job ) && !trySteal( threadIdx, job ) )
+            return false;
+
+        {
+            TraceRecorder::ScopedEvent jobEvent( "Job" );
+            job.execute( this, job, threadIdx );
+        }
+        job.counter->mPending.fetch_sub( 1u, std::memory_order_release );
+        return true;
+    }
+    //-----------------------------------------------------------------------------------
+    void JobSystem::workerThread( size_t threadIdx )
+    {
+        tCurrentJobSystem = this;
+        tCurrentThreadIdx = threadIdx;
+
+        TraceRecorder::setThreadName( "Job worker #" + Ogre::StringConverter::toString( threadIdx ) );
+
+        while( true )
+        {
+            if( tryRunOne( threadIdx ) )
+                continue;
+
+            std::unique_lock<std::mutex> lock( mWakeMutex );
+            while( !mQuit && mNumQueuedJobs.load( std::memory_order_relaxed ) == 0u )
+                mWakeCondition.wait( lock );
+            if( mQuit )
+                break;
+        }
+
+        tCurrentJobSystem = 0;
+    }
+    //-----------------------------------------------------------------------------------
+    void JobSystem::executeJobFunc( JobSystem *, const Job &job, size_t threadIdx )
+    {
+        const JobFunc *func = reinterpret_cast<const JobFunc *>( job.userData );
+        ( *func )( threadIdx );
+        delete func;
+    }
+    //-----------------------------------------------------------------------------------
+    void JobSystem::executeRangeFunc( JobSystem *, const Job &job, size_t threadIdx )
+    {
+        const RangeFunc *func = reinterpret_cast<const RangeFunc *>( job.userData );
+        ( *func )( job.begin, job.end, threadIdx );
+    }
+    //-----------------------------------------------------------------------------------
+    void JobSystem::executeGraphNode( JobSystem *jobSystem, const Job &job, size_t threadIdx )
+    {
+        JobGraph *graph = const_cast<JobGraph *>( reinterpret_cast<const JobGraph *>( job.userData ) );
+        JobGraph::Node &node = graph->mNodes[job.begin];
+        node.func( threadIdx );
+
+        // Release the jobs that were waiting on us. They go to our own queue so
+        // they likely run right after us, while the data is still hot.
+        std::vector<size_t>::const_iterator itor = node.successors.begin();
+        std::vector<size_t>::const_iterator endt = node.successors.end();
+        while( itor != endt )
+        {
+            JobGraph::Node &successor = graph->mNodes[*itor];
+            if( successor.pendingDependencies.fetch_sub( 1u, std::memory_order_acq_rel ) == 1u )
+            {
+                Job nextJob = job;
+                nextJob.begin = *itor;
+                nextJob.end = *itor + 1u;
+                jobSystem->push( nextJob, threadIdx );
+            }
+            ++itor;
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void JobSystem::submit( const JobFunc &func, JobCounter *counter )
+    {
+        counter->mPending.fetch_add( 1u, std::memory_order_relaxed );
+
+        Job job;
+        job.execute = executeJobFunc;
+        job.userData = new JobFunc( func );
+        job.begin = 0u;
+        job.end = 0u;
+        job.counter = counter;
+        push( job, getCurrentThreadIdx() );
+    }
+    //-----------------------------------------------------------------------------------
+    void JobSystem::wait( JobCounter *counter )
+    {
+        const size_t threadIdx = getCurrentThreadIdx();
+        while( !counter->isDone() )
+        {
+            if( !tryRunOne( threadIdx ) )
+                std::this_thread::yield();
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void JobSystem::parallelFor( size_t begin, size_t end, size_t grainSize, const RangeFunc &func )
+    {
+        if( begin >= end )
+            return;
+
+        const size_t numElements = end - begin;
+        if( grainSize == 0u )
+            grainSize = std::max<size_t>( numElements / ( getNumThreads() * 4u ), 1u );
+
+        const size_t threadIdx = getCurrentThreadIdx();
+
+        const size_t numJobs = ( numElements + grainSize - 1u ) / grainSize;
+
+        if( getNumThreads() == 1u || numJobs == 1u )
+        {
+            // Still honour grainSize; func may rely on the chunk boundaries.
+            for( size_t i = begin; i < end; i += grainSize )
+                func( i, std::min( i + grainSize, end ), threadIdx );
+            return;
+        }
+
+        JobCounter counter;
+        counter.mPending.store( numJobs, std::memory_order_relaxed );
+
+        std::vector<Job> jobs;
+        jobs.reserve( numJobs );
+        for( size_t i = 0u; i < numJobs; ++i )
+        {
+            Job job;
+            job.execute = executeRangeFunc;
+            job.userData = &func;
+            job.begin = begin + i * grainSize;
+            job.end = std::min( job.begin + grainSize, end );
+            job.counter = &counter;
+            jobs.push_back( job );
+        }
+
+        // Pushed in reverse, so that we (LIFO) start from the first chunk
+        // and thieves (FIFO) from the last one.
+        std::reverse( jobs.begin(), jobs.end() );
+        pushBatch( &jobs[0], numJobs, threadIdx );
+
+        wait( &counter );
+    }
+    //-----------------------------------------------------------------------------------
+    void JobSystem::run( JobGraph &graph )
+    {
+        const size_t numNodes = graph.mNodes.size();
+        if( numNodes == 0u )
+            return;
+
+        JobCounter counter;
+        counter.mPending.store( numNodes, std::memory_order_relaxed );
+
+        std::vector<Job> roots;
+        for( size_t i = 0u; i < numNodes; ++i )
+        {
+            JobGraph::Node &node = graph.mNodes[i];
+            node.pendingDependencies.store( node.numDependencies, std::memory_order_relaxed );
+            if( node.numDependencies == 0u )
+            {
+                Job job;
+                job.execute = executeGraphNode;
+                job.userData = &graph;
+                job.begin = i;
+                job.end = i + 1u;
+                job.counter = &counter;
+                roots.push_back( job );
+            }
+        }
+
+        assert( !roots.empty() && "JobGraph has a cycle!" );
+
+        std::reverse( roots.begin(), roots.end() );
+        pushBatch( &roots[0], roots.size(), getCurrentThreadIdx() );
+
+        wait( &counter );
+    }
+    //-----------------------------------------------------------------------------------
+    void JobSystem::partitionCores( bool bLogicAndGraphicsOverlap, size_t &outSceneManagerThreads,
+                                    size_t &outJobWorkerThreads )
+    {
+        // getNumLogicalCores() may return 0 if couldn't detect
+        const size_t numCores = std::max<size_t>( 1u, Ogre::PlatformInformation::getNumLogicalCores() );
+
+        if( !bLogicAndGraphicsOverlap )
+        {
+            // Logic and Graphics never run at the same time. Both can use every core.
+            outSceneManagerThreads = numCores;
+            outJobWorkerThreads = numCores - 1u;
+            return;
+        }
+
+        // The render & logic threads take one core each. Split the rest evenly between
+        // SceneManager's workers and ours. Note SceneManager's count includes the render
+        // thread, and ours excludes the logic thread. Thus:
+        //  outSceneManagerThreads + outJobWorkerThreads + 1 = numCores
+        const size_t numSpareCores = numCores > 2u ? ( numCores - 2u ) : 0u;
+        outJobWorkerThreads = numSpareCores / 2u;
+        outSceneManagerThreads = std::max<size_t>( numCores - 1u - outJobWorkerThreads, 1u );
+    }
+}  // namespace Demo
@@ -7,5 +7,57 @@ namespace Demo
     {
         const size_t MessageQueueSystem::cSizeOfHeader =
             Ogre::alignToNextMultiple( sizeof( Ogre::uint32 ) * 2, sizeof( size_t ) );
-    }
+
+        MessageQueueSystem::MessageQueueSystem() :
+            mHasIncomingMessages( false ),
+            mNumRingOverflows( 0 ),
+            mLastIncomingBytes( 0 )
+        {
+        }
+        //-----------------------------------------------------------------------------------
+        MessageQueueSystem::~MessageQueueSystem()
+        {
+            IncomingRingArray::const_iterator itor = mIncomingRings.begin();
+            IncomingRingArray::const_iterator endt = mIncomingRings.end();
+
+            while( itor != endt )
+                delete *itor++;
+
+            mIncomingRings.clear();
+        }
+        //-----------------------------------------------------------------------------------
+        void MessageQueueSystem::connectSpscTransport( MessageQueueSystem *dstSystem,
+                                                       size_t capacityBytes )
+        {
+            assert( dstSystem != this );
+            assert( !findOutgoingRing( dstSystem ) && "Already connected!" );
+            assert( ( mPendingOutgoingMessages.find( dstSystem ) == mPendingOutgoingMessages.end() ||
+                      mPendingOutgoingMessages[dstSystem].empty() ) &&
+                    "Connect before sending any message to dstSystem" );
+
+            SpscMessageRing *ring = new SpscMessageRing( capacityBytes );
+            dstSystem->mIncomingRings.push_back( ring );
+            mOutgoingRings.push_back( OutgoingRing( dstSystem, ring ) );
+        }
+        //-----------------------------------------------------------------------------------
+        void MessageQueueSystem::drainOverflow( OutgoingRing &outgoingRing )
+        {
+            MessageArray::iterator itor = outgoingRing.overflow.begin();
+            MessageArray::iterator endt = outgoingRing.overflow.end();
+
+            while( itor != endt )
+            {
+                const Ogre::uint32 totalSize = *reinterpret_cast<const Ogre::uint32 *>( itor );
+
+                unsigned char *dst = outgoingRing.ring->reserve( totalSize );
+                if( !dst )
+                    break;  // Still full. Try again next flush.
+
+                memcpy( dst, itor, totalSize );
+                itor += totalSize;
+            }
+
+            outgoingRing.overflow.erasePOD( outgoingRing.overflow.begin(), itor );
+        }
+    }  // namespace Mq
 }  // namespace Demo
@@ -0,0 +1,87 @@
+
+#include "Threading/SpscMessageRing.h"
+
+#include <limits>
+
+namespace Demo
+{
+    namespace Mq
+    {
+        const Ogre::uint32 SpscMessageRing::cPaddingMessageId =
+            std::numeric_limits<Ogre::uint32>::max();
+        //-----------------------------------------------------------------------------------
+        /// Same as Ogre::Bitwise::firstPO2From, but doesn't truncate sizes above 4GB.
+        static size_t firstPO2From( size_t n )
+        {
+            assert( n <= ( ( std::numeric_limits<size_t>::max() >> 1u ) + 1u ) &&
+                    "Ring capacity too big!" );
+            size_t retVal = 1u;
+            while( retVal < n )
+                retVal <<= 1u;
+            return retVal;
+        }
+        //-----------------------------------------------------------------------------------
+
+        SpscMessageRing::SpscMessageRing( size_t capacityBytes ) :
+            mBuffer( 0 ),
+            mCapacity( std::max<size_t>( firstPO2From( capacityBytes ), 64u ) ),
+            mMask( 0 ),
+            mReadPos( 0 ),
+            mWritePos( 0 ),
+            mPendingWritePos( 0 ),
+            mCachedReadPos( 0 )
+        {
+            mMask = mCapacity - 1u;
+            mBuffer = reinterpret_cast<unsigned char *>(
+                OGRE_MALLOC_SIMD( mCapacity, Ogre::MEMCATEGORY_GENERAL ) );
+        }
+        //-----------------------------------------------------------------------------------
+        SpscMessageRing::~SpscMessageRing()
+        {
+            OGRE_FREE_SIMD( mBuffer, Ogre::MEMCATEGORY_GENERAL );
+            mBuffer = 0;
+        }
+        //-----------------------------------------------------------------------------------
+        bool SpscMessageRing::hasFreeSpace( size_t numBytes )
+        {
+            if( mCapacity - ( mPendingWritePos - mCachedReadPos ) < numBytes )
+            {
+                // Only touch the consumer's cache line when our cached copy says we're full.
+                mCachedReadPos = mReadPos.load( std::memory_order_acquire );
+                if( mCapacity - ( mPendingWritePos - mCachedReadPos ) < numBytes )
+                    return false;
+            }
+            return true;
+        }
+        //-----------------------------------------------------------------------------------
+        unsigned char *SpscMessageRing::reserve( size_t totalSize )
+        {
+            assert( totalSize <= mCapacity && "Message is bigger than the whole ring!" );
+
+            // Records can't straddle the end of the buffer. If it doesn't fit, the remaining
+            // bytes are wasted with a padding record and we start again from offset 0.
+            // The padding is committed on its own; otherwise a record bigger than half the
+            // ring could need more than mCapacity bytes and never fit.
+            const size_t offset = mPendingWritePos & mMask;
+            const size_t contiguous = mCapacity - offset;
+
+            if( totalSize > contiguous )
+            {
+                if( !hasFreeSpace( contiguous ) )
+                    return 0;
+
+                *reinterpret_cast<Ogre::uint32 *>( mBuffer + offset ) = (Ogre::uint32)contiguous;
+                *reinterpret_cast<Ogre::uint32 *>( mBuffer + offset + sizeof( Ogre::uint32 ) ) =
+                    cPaddingMessageId;
+                mPendingWritePos += contiguous;
+            }
+
+            if( !hasFreeSpace( totalSize ) )
+                return 0;
+
+            unsigned char *retVal = mBuffer + ( mPendingWritePos & mMask );
+            mPendingWritePos += totalSize;
+            return retVal;
+        }
+    }  // namespace Mq
+}  // namespace Demo
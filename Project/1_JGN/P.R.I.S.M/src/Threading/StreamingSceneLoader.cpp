@@ -0,0 +1,433 @@
+
+#include "Threading/StreamingSceneLoader.h"
+
+#include "Utils/SteadyClock.h"
+
+#include "OgreArchive.h"
+#include "OgreCamera.h"
+#include "OgreLogManager.h"
+#include "OgreMesh2.h"
+#include "OgreMeshManager2.h"
+#include "OgreSceneNode.h"
+#include "OgreStringConverter.h"
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+namespace Demo
+{
+    struct MeshRequestCmp
+    {
+        template <typename T>
+        bool operator()( const T *_l, const T *_r ) const
+        {
+            // Highest priority (lowest value) at the back
+            return _l->priority > _r->priority;
+        }
+    };
+
+    StreamingSceneLoader::StreamingSceneLoader( size_t numThreads ) :
+        mQuit( false ),
+        mCurrentLoad( 0 ),
+        mPrevLoadingListener( 0 ),
+        mLoadBudgetMicroseconds( 4000u ),
+        mOffscreenPenalty( 16.0f ),
+        mBusyStart( 0 )
+    {
+        memset( &mStats, 0, sizeof( mStats ) );
+
+        Ogre::ResourceGroupManager &resourceGroupManager = Ogre::ResourceGroupManager::getSingleton();
+        mPrevLoadingListener = resourceGroupManager.getLoadingListener();
+        resourceGroupManager.setLoadingListener( this );
+
+        for( size_t i = 0u; i < numThreads; ++i )
+            mThreads.push_back( std::thread( &StreamingSceneLoader::ioThread, this ) );
+    }
+    //-----------------------------------------------------------------------------------
+    StreamingSceneLoader::~StreamingSceneLoader()
+    {
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            mQuit = true;
+        }
+        mCondition.notify_all();
+
+        for( std::thread &thread : mThreads )
+            thread.join();
+        mThreads.clear();
+
+        Ogre::ResourceGroupManager::getSingleton().setLoadingListener( mPrevLoadingListener );
+
+        MeshRequestMap::const_iterator itor = mMeshRequests.begin();
+        MeshRequestMap::const_iterator endt = mMeshRequests.end();
+        while( itor != endt )
+        {
+            delete itor->second;
+            ++itor;
+        }
+        mMeshRequests.clear();
+    }
+    //-----------------------------------------------------------------------------------
+    void StreamingSceneLoader::ioThread()
+    {
+        while( true )
+        {
+            MeshRequest *request = 0;
+            {
+                std::unique_lock<std::mutex> lock( mMutex );
+                while( !mQuit && mReadQueue.empty() )
+                    mCondition.wait( lock );
+
+                if( mQuit )
+                    return;
+
+                request = mReadQueue.back();
+                mReadQueue.pop_back();
+            }
+
+            // Only the I/O threads touch request->data until it's in mReadDone.
+            const Ogre::uint64 readStart = SteadyClock::getMicroseconds();
+            try
+            {
+                Ogre::DataStreamPtr file = request->archive->open( request->name );
+                request->data =
+                    Ogre::DataStreamPtr( OGRE_NEW Ogre::MemoryDataStream( request->name, file ) );
+            }
+            catch( Ogre::Exception & )
+            {
+                // Mesh::load will try again & report the error.
+                request->data.reset();
+            }
+            request->readMicroseconds = SteadyClock::getMicroseconds() - readStart;
+
+            std::lock_guard<std::mutex> lock( mMutex );
+            mReadDone.push_back( request );
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::Real StreamingSceneLoader::getPriority( const MeshRequest *request,
+                                                  const Ogre::Camera *camera ) const
+    {
+        const Ogre::Vector3 cameraPos = camera->getDerivedPosition();
+
+        Ogre::Real retVal = std::numeric_limits<Ogre::Real>::max();
+
+        GameEntityVec::const_iterator itor = request->waitingEntities.begin();
+        GameEntityVec::const_iterator endt = request->waitingEntities.end();
+        while( itor != endt )
+        {
+            // Placeholders are children of the root node or, with floating origin, of an
+            // origin node (see GraphicsSystem::getOriginSceneNode). Either way the parent is
+            // only translated, and we run before the scene graph update, so add its offset
+            // rather than reading the (possibly stale) derived position.
+            const Ogre::SceneNode *sceneNode = ( *itor )->mGraphics->sceneNode;
+            const Ogre::Vector3 entityPos =
+                sceneNode->getParentSceneNode()->getPosition() + sceneNode->getPosition();
+            Ogre::Real priority = cameraPos.squaredDistance( entityPos );
+            if( !camera->isVisible( entityPos ) )
+                priority *= mOffscreenPenalty;
+            retVal = std::min( retVal, priority );
+            ++itor;
+        }
+
+        return retVal;
+    }
+    //-----------------------------------------------------------------------------------
+    void StreamingSceneLoader::updatePriorities( const Ogre::Camera *camera )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            for( MeshRequest *request : mReadQueue )
+                request->priority = getPriority( request, camera );
+            std::sort( mReadQueue.begin(), mReadQueue.end(), MeshRequestCmp() );
+
+            // Take what the I/O threads finished
+            for( MeshRequest *request : mReadDone )
+            {
+                if( request->data )
+                    mStats.bytesRead += request->data->size();
+                mStats.readMicroseconds += request->readMicroseconds;
+            }
+            mLoadQueue.insert( mLoadQueue.end(), mReadDone.begin(), mReadDone.end() );
+            mReadDone.clear();
+        }
+
+        for( MeshRequest *request : mLoadQueue )
+            request->priority = getPriority( request, camera );
+        std::sort( mLoadQueue.begin(), mLoadQueue.end(), MeshRequestCmp() );
+    }
+    //-----------------------------------------------------------------------------------
+    bool StreamingSceneLoader::loadMesh( MeshRequest *request )
+    {
+        const Ogre::uint64 loadStart = SteadyClock::getMicroseconds();
+
+        bool retVal = true;
+        mCurrentLoad = request;
+        try
+        {
+            Ogre::MeshManager::getSingleton().load( request->name, request->group );
+        }
+        catch( Ogre::Exception &e )
+        {
+            Ogre::LogManager::getSingleton().logMessage(
+                "StreamingSceneLoader: could not load " + request->name + ": " + e.getDescription(),
+                Ogre::LML_CRITICAL );
+            retVal = false;
+        }
+        mCurrentLoad = 0;
+        request->data.reset();
+
+        mStats.loadMicroseconds += SteadyClock::getMicroseconds() - loadStart;
+
+        return retVal;
+    }
+    //-----------------------------------------------------------------------------------
+    void StreamingSceneLoader::attachEntities( MeshRequest *request, GameEntityVec &outReadyEntities )
+    {
+        const size_t numEntities = request->waitingEntities.size();
+
+        if( request->state == MeshLoaded )
+        {
+            outReadyEntities.insert( outReadyEntities.end(), request->waitingEntities.begin(),
+                                     request->waitingEntities.end() );
+            mStats.numEntitiesAttached += numEntities;
+            ++mStats.numMeshesLoaded;
+        }
+        else
+        {
+            // loadMesh already logged why
+            Ogre::LogManager::getSingleton().logMessage(
+                "StreamingSceneLoader: " + Ogre::StringConverter::toString( numEntities ) +
+                    " GameEntities using " + request->name +
+                    " will stay as placeholders without an Item",
+                Ogre::LML_CRITICAL );
+            ++mStats.numMeshesFailed;
+        }
+
+        mStats.numEntitiesPending -= numEntities;
+        request->waitingEntities.clear();
+    }
+    //-----------------------------------------------------------------------------------
+    bool StreamingSceneLoader::addGameEntity( GameEntity *gameEntity )
+    {
+        const MovableObjectDefinition *moDefinition = gameEntity->mMoDefinition;
+        if( moDefinition->moType != MoTypeItem )
+            return false;
+
+        const std::pair<Ogre::String, Ogre::String> key( moDefinition->meshName,
+                                                          moDefinition->resourceGroup );
+
+        MeshRequest *request = 0;
+
+        MeshRequestMap::const_iterator itRequest = mMeshRequests.find( key );
+        if( itRequest != mMeshRequests.end() )
+        {
+            request = itRequest->second;
+            if( request->state != MeshPending )
+                return false;
+        }
+        else
+        {
+            Ogre::String groupName = moDefinition->resourceGroup;
+            Ogre::Archive *archive = 0;
+
+            try
+            {
+                Ogre::ResourceGroupManager &resourceGroupManager =
+                    Ogre::ResourceGroupManager::getSingleton();
+                if( groupName == Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME )
+                    groupName = resourceGroupManager.findGroupContainingResource( key.first );
+
+                Ogre::MeshPtr mesh =
+                    Ogre::MeshManager::getSingleton().getByName( key.first, groupName );
+                if( mesh && mesh->isLoaded() )
+                    return false;
+
+                // Manual meshes (i.e. MeshUtils::importV1Mesh) have nothing for us to read.
+                if( !mesh || !mesh->isManuallyLoaded() )
+                {
+                    archive = resourceGroupManager._getArchiveToResource( key.first, groupName );
+                    if( archive->getType() != "FileSystem" )
+                        archive = 0;
+                }
+            }
+            catch( Ogre::Exception & )
+            {
+                // Doesn't exist. Let the caller raise the error as usual.
+                return false;
+            }
+
+            if( isIdle() )
+                mBusyStart = SteadyClock::getMicroseconds();
+
+            request = new MeshRequest();
+            request->name = key.first;
+            request->group = groupName;
+            request->archive = archive;
+            request->state = MeshPending;
+            request->priority = std::numeric_limits<Ogre::Real>::max();
+            request->readMicroseconds = 0u;
+            mMeshRequests[key] = request;
+            ++mStats.numMeshesRequested;
+
+            if( archive )
+            {
+                {
+                    std::lock_guard<std::mutex> lock( mMutex );
+                    // Sorted on the next update
+                    mReadQueue.push_back( request );
+                }
+                mCondition.notify_one();
+            }
+            else
+            {
+                mLoadQueue.push_back( request );
+            }
+        }
+
+        request->waitingEntities.push_back( gameEntity );
+        ++mStats.numEntitiesPending;
+
+        return true;
+    }
+    //-----------------------------------------------------------------------------------
+    void StreamingSceneLoader::removeGameEntity( GameEntity *gameEntity )
+    {
+        const MovableObjectDefinition *moDefinition = gameEntity->mMoDefinition;
+        const std::pair<Ogre::String, Ogre::String> key( moDefinition->meshName,
+                                                          moDefinition->resourceGroup );
+
+        MeshRequestMap::const_iterator itRequest = mMeshRequests.find( key );
+
+        if( itRequest == mMeshRequests.end() )
+            return;
+
+        // The mesh still gets loaded. Others will likely use it.
+        GameEntityVec &waitingEntities = itRequest->second->waitingEntities;
+        GameEntityVec::iterator itor =
+            std::find( waitingEntities.begin(), waitingEntities.end(), gameEntity );
+        if( itor != waitingEntities.end() )
+        {
+            waitingEntities.erase( itor );
+            --mStats.numEntitiesPending;
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void StreamingSceneLoader::update( const Ogre::Camera *camera, GameEntityVec &outReadyEntities )
+    {
+        if( isIdle() )
+            return;
+
+        updatePriorities( camera );
+
+        const Ogre::uint64 loadStart = SteadyClock::getMicroseconds();
+
+        bool bLoadedAny = false;
+        while( !mLoadQueue.empty() &&
+               ( !bLoadedAny || SteadyClock::getMicroseconds() - loadStart < mLoadBudgetMicroseconds ) )
+        {
+            MeshRequest *request = mLoadQueue.back();
+            mLoadQueue.pop_back();
+
+            request->state = loadMesh( request ) ? MeshLoaded : MeshFailed;
+            attachEntities( request, outReadyEntities );
+            bLoadedAny = true;
+        }
+
+        if( bLoadedAny && isIdle() )
+        {
+            mStats.busyMicroseconds += SteadyClock::getMicroseconds() - mBusyStart;
+            logStats();
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void StreamingSceneLoader::setLoadBudget( Ogre::uint64 microseconds )
+    {
+        mLoadBudgetMicroseconds = microseconds;
+    }
+    //-----------------------------------------------------------------------------------
+    bool StreamingSceneLoader::isIdle() const
+    {
+        return mStats.numMeshesLoaded + mStats.numMeshesFailed == mStats.numMeshesRequested;
+    }
+    //-----------------------------------------------------------------------------------
+    float StreamingSceneLoader::getProgress() const
+    {
+        if( !mStats.numMeshesRequested )
+            return 1.0f;
+        return float( mStats.numMeshesLoaded + mStats.numMeshesFailed ) /
+               float( mStats.numMeshesRequested );
+    }
+    //-----------------------------------------------------------------------------------
+    void StreamingSceneLoader::logStats() const
+    {
+        const double megabytes = double( mStats.bytesRead ) / ( 1024.0 * 1024.0 );
+        const double busySeconds =
+            double( std::max<Ogre::uint64>( mStats.busyMicroseconds, 1u ) ) / 1000000.0;
+
+        Ogre::LogManager::getSingleton().logMessage(
+            "StreamingSceneLoader: " + Ogre::StringConverter::toString( mStats.numMeshesLoaded ) +
+            " meshes loaded (" + Ogre::StringConverter::toString( mStats.numMeshesFailed ) +
+            " failed) for " + Ogre::StringConverter::toString( mStats.numEntitiesAttached ) +
+            " entities in " + Ogre::StringConverter::toString( busySeconds * 1000.0 ) +
+            "ms. Read " + Ogre::StringConverter::toString( megabytes ) + "MB (" +
+            Ogre::StringConverter::toString( megabytes / busySeconds ) + "MB/s, " +
+            Ogre::StringConverter::toString( mStats.readMicroseconds / 1000u ) +
+            "ms in I/O threads). Render thread: " +
+            Ogre::StringConverter::toString( mStats.loadMicroseconds / 1000u ) + "ms" );
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::DataStreamPtr StreamingSceneLoader::resourceLoading( const Ogre::String &name,
+                                                               const Ogre::String &group,
+                                                               Ogre::Resource *resource )
+    {
+        if( mCurrentLoad && mCurrentLoad->data && mCurrentLoad->name == name )
+        {
+            Ogre::DataStreamPtr retVal = mCurrentLoad->data;
+            mCurrentLoad->data.reset();
+            return retVal;
+        }
+
+        if( mPrevLoadingListener )
+            return mPrevLoadingListener->resourceLoading( name, group, resource );
+        return Ogre::DataStreamPtr();
+    }
+    //-----------------------------------------------------------------------------------
+    bool StreamingSceneLoader::grouplessResourceExists( const Ogre::String &name )
+    {
+        return mPrevLoadingListener && mPrevLoadingListener->grouplessResourceExists( name );
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::DataStreamPtr StreamingSceneLoader::grouplessResourceLoading( const Ogre::String &name )
+    {
+        if( mPrevLoadingListener )
+            return mPrevLoadingListener->grouplessResourceLoading( name );
+        return Ogre::DataStreamPtr();
+    }
+    //-----------------------------------------------------------------------------------
+    Ogre::DataStreamPtr StreamingSceneLoader::grouplessResourceOpened( const Ogre::String &name,
+                                                                       Ogre::Archive *archive,
+                                                                       Ogre::DataStreamPtr &dataStream )
+    {
+        if( mPrevLoadingListener )
+            return mPrevLoadingListener->grouplessResourceOpened( name, archive, dataStream );
+        return dataStream;
+    }
+    //-----------------------------------------------------------------------------------
+    void StreamingSceneLoader::resourceStreamOpened( const Ogre::String &name,
+                                                     const Ogre::String &group,
+                                                     Ogre::Resource *resource,
+                                                     Ogre::DataStreamPtr &dataStream )
+    {
+        if( mPrevLoadingListener )
+            mPrevLoadingListener->resourceStreamOpened( name, group, resource, dataStream );
+    }
+    //-----------------------------------------------------------------------------------
+    bool StreamingSceneLoader::resourceCollision( Ogre::Resource *resource,
+                                                  Ogre::ResourceManager *resourceManager )
+    {
+        return mPrevLoadingListener &&
+               mPrevLoadingListener->resourceCollision( resource, resourceManager );
+    }
+}  // namespace Demo
@@ -2,6 +2,8 @@
 #include "TutorialGameState.h"
 #include "CameraController.h"
 #include "GraphicsSystem.h"
+#include "System/Telemetry.h"
+#include "Threading/StreamingSceneLoader.h"
 
 #include "OgreSceneManager.h"
 
@@ -35,7 +37,7 @@ namespace Demo
         mCameraController( 0 ),
         mHelpDescription( helpDescription ),
         mDisplayHelpMode( 1 ),
-        mNumDisplayHelpModes( 2 ),
+        mNumDisplayHelpModes( 3 ),
         mDebugText( 0 )
     {
     }
@@ -88,6 +90,7 @@ namespace Demo
                 "\n\nProtip: Ctrl+F1 will reload PBS shaders (for real time template editing).\n"
                 "Ctrl+F2 reloads Unlit shaders.\n"
                 "Ctrl+F3 reloads Compute shaders.\n"
+                "Ctrl+F6 captures a trace of the last frames (see --trace-frames).\n"
                 "Note: If the modified templates produce invalid shader code, "
                 "crashes or exceptions can happen.\n";
             return;
@@ -107,6 +110,43 @@ namespace Demo
         finalText += " ms\n";
         finalText += "Avg FPS:\t";
         finalText += Ogre::StringConverter::toString( frameStats->getRollingAverageFps() );
+
+        const StreamingSceneLoader *streamingLoader = mGraphicsSystem->getStreamingSceneLoader();
+        if( streamingLoader && !streamingLoader->isIdle() )
+        {
+            const StreamingSceneLoader::Stats &stats = streamingLoader->getStats();
+            finalText += "\nStreaming:\t";
+            finalText += Ogre::StringConverter::toString( streamingLoader->getProgress() * 100.0f );
+            finalText += "% (";
+            finalText += Ogre::StringConverter::toString( stats.numEntitiesPending );
+            finalText += " entities waiting)";
+        }
+
+        // Mode 2 adds the frame time & latency percentiles
+        if( mDisplayHelpMode == 2 )
+        {
+            if( Telemetry::isEnabled() )
+                Telemetry::generateOverlayText( finalText );
+            else
+                finalText += "\nTelemetry disabled";
+
+            const GraphicsSystem::FramePipelineStats &stats = mGraphicsSystem->getFramePipelineStats();
+            if( stats.numDynamicEntities )
+            {
+                const double asleep = 1.0 - double( stats.numInterpolatedEntities ) /
+                                                double( stats.numDynamicEntities );
+                finalText += "\nInterpolated:\t";
+                finalText += Ogre::StringConverter::toString( stats.numInterpolatedEntities /
+                                                              stats.numInterpolations );
+                finalText += " / ";
+                finalText += Ogre::StringConverter::toString( stats.numDynamicEntities /
+                                                              stats.numInterpolations );
+                finalText += " entities (";
+                finalText += Ogre::StringConverter::toString( asleep * 100.0 );
+                finalText += "% asleep)";
+            }
+        }
+
         finalText += "\n\nPress F1 to toggle help";
 #ifdef AUTO_TESTING
         frameCount++;
@@ -242,6 +282,12 @@ namespace Demo
             Ogre::Root *root = mGraphicsSystem->getRoot();
             root->getRenderSystem()->validateDevice( true );
         }
+        else if( arg.keysym.scancode == SDL_SCANCODE_F6 &&
+                 ( arg.keysym.mod & ( KMOD_LCTRL | KMOD_RCTRL ) ) )
+        {
+            // Dump the last frames to a .json for chrome://tracing. Needs --trace-frames
+            mGraphicsSystem->captureTrace();
+        }
         else
         {
             bool handledEvent = false;
@@ -1,15 +1,268 @@
 
 #include "Utils/MeshUtils.h"
 
+#include "OgreArchive.h"
+#include "OgreArchiveManager.h"
+#include "OgreLogManager.h"
 #include "OgreMesh.h"
 #include "OgreMesh2.h"
+#include "OgreMesh2Serializer.h"
 #include "OgreMeshManager.h"
 #include "OgreMeshManager2.h"
+#include "OgreRenderSystem.h"
+#include "OgreResourceGroupManager.h"
+#include "OgreRoot.h"
+
+#include "Hash/MurmurHash3.h"
+
+#include <fstream>
+#include <map>
+#include <stdio.h>
 
 namespace Demo
 {
+    /// Bump whenever the conversion changes in a way the hash can't see.
+    static const Ogre::uint32 cMeshCacheVersion = 1u;
+    static const char *cMeshCachePrefix = "meshCache_";
+    /// Hex digits of the hash in the file name.
+    static const size_t cMeshCacheHashLength = 16u;
+
+    static const bool cHalfPos = true;
+    static const bool cHalfTexCoords = true;
+    static const bool cQTangents = true;
+
+    Ogre::String MeshUtils::msMeshCacheFolder;
+
+    /// Loads (and reloads, e.g. to recover from a lost device) meshes from the cache.
+    class CachedMeshLoader final : public Ogre::ManualResourceLoader
+    {
+        struct Entry
+        {
+            Ogre::String folder;
+            Ogre::String filename;
+        };
+        /// Keyed by mesh name, which is unique within MeshManager. Unlike the Resource's
+        /// address it can't be reused by another mesh after this one is destroyed, and
+        /// recreating the mesh replaces its entry, so the map can't grow unbounded.
+        typedef std::map<Ogre::String, Entry> EntryMap;
+
+        EntryMap mEntries;
+
+    public:
+        void add( const Ogre::String &meshName, const Ogre::String &folder,
+                  const Ogre::String &filename )
+        {
+            Entry &entry = mEntries[meshName];
+            entry.folder = folder;
+            entry.filename = filename;
+        }
+
+        void loadResource( Ogre::Resource *resource ) override;
+    };
+
+    static CachedMeshLoader sCachedMeshLoader;
+
+    //-----------------------------------------------------------------------------------
+    static Ogre::VaoManager *getVaoManager()
+    {
+        return Ogre::Root::getSingleton().getRenderSystem()->getVaoManager();
+    }
+    //-----------------------------------------------------------------------------------
+    static Ogre::DataStreamPtr readCachedMesh( const Ogre::String &folder,
+                                               const Ogre::String &filename )
+    {
+        std::ifstream file( ( folder + "/" + filename ).c_str(),
+                            std::ios::binary | std::ios::in | std::ios::ate );
+        if( !file.is_open() )
+            return Ogre::DataStreamPtr();
+
+        const size_t fileSize = static_cast<size_t>( file.tellg() );
+        file.seekg( 0 );
+
+        Ogre::MemoryDataStream *stream = OGRE_NEW Ogre::MemoryDataStream( filename, fileSize );
+        file.read( reinterpret_cast<char *>( stream->getPtr() ),
+                   static_cast<std::streamsize>( fileSize ) );
+        return Ogre::DataStreamPtr( stream );
+    }
+    //-----------------------------------------------------------------------------------
+    static Ogre::String toCacheName( const Ogre::String &meshName )
+    {
+        // Mesh names may contain paths
+        Ogre::String retVal = meshName;
+        for( size_t i = 0u; i < retVal.size(); ++i )
+        {
+            const char c = retVal[i];
+            if( !( ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) ||
+                   ( c >= '0' && c <= '9' ) || c == '.' || c == '-' || c == '_' ) )
+            {
+                retVal[i] = '_';
+            }
+        }
+        return cMeshCachePrefix + retVal + "_";
+    }
+    //-----------------------------------------------------------------------------------
+    static Ogre::String hashSourceMesh( const Ogre::String &meshName, const Ogre::String &groupName )
+    {
+        Ogre::DataStreamPtr stream =
+            Ogre::ResourceGroupManager::getSingleton().openResource( meshName, groupName );
+        Ogre::MemoryDataStream data( stream );
+
+        const Ogre::uint32 seed = cMeshCacheVersion | ( Ogre::uint32( cHalfPos ) << 16u ) |
+                                  ( Ogre::uint32( cHalfTexCoords ) << 17u ) |
+                                  ( Ogre::uint32( cQTangents ) << 18u );
+        Ogre::uint32 hash[4];
+        Ogre::MurmurHash3_x86_128( data.getPtr(), static_cast<int>( data.size() ), seed, hash );
+
+        char hexHash[cMeshCacheHashLength + 1u];
+        snprintf( hexHash, sizeof( hexHash ), "%08x%08x", hash[0], hash[1] );
+        return Ogre::String( hexHash );
+    }
+    //-----------------------------------------------------------------------------------
+    /// Saves the converted mesh & deletes the ones cached from older versions of the source.
+    /// It's exported to a temporary file first, so a crash midway can't leave a truncated
+    /// mesh that importV1Mesh would take for a cache hit.
+    static void saveCachedMesh( Ogre::Mesh *mesh, const Ogre::String &folder,
+                                const Ogre::String &cacheName, const Ogre::String &filename )
+    {
+        Ogre::ArchiveManager &archiveManager = Ogre::ArchiveManager::getSingleton();
+        Ogre::Archive *rwAccessFolderArchive = archiveManager.load( folder, "FileSystem", false );
+
+        const Ogre::String tmpFilename = filename + ".tmp";
+
+        // "meshCache_foo_*.mesh" also matches meshCache_foo_bar_<hash>.mesh
+        // Leftovers of interrupted saves (*.mesh.tmp) go too.
+        const size_t expectedLength = cacheName.size() + cMeshCacheHashLength + 5u;
+        Ogre::StringVectorPtr staleFiles = rwAccessFolderArchive->find( cacheName + "*.mesh*", false );
+        Ogre::StringVector::const_iterator itor = staleFiles->begin();
+        Ogre::StringVector::const_iterator endt = staleFiles->end();
+        while( itor != endt )
+        {
+            if( ( itor->size() == expectedLength && *itor != filename ) ||
+                ( itor->size() == expectedLength + 4u && *itor != tmpFilename ) )
+            {
+                rwAccessFolderArchive->remove( *itor );
+            }
+            ++itor;
+        }
+
+        bool bExported = false;
+        try
+        {
+            Ogre::DataStreamPtr cacheFile = rwAccessFolderArchive->create( tmpFilename );
+            Ogre::MeshSerializer meshSerializer( getVaoManager() );
+            meshSerializer.exportMesh( mesh, cacheFile );
+            cacheFile->close();
+            bExported = true;
+        }
+        catch( Ogre::Exception &e )
+        {
+            // Not fatal. We'll convert again next time.
+            Ogre::LogManager::getSingleton().logMessage(
+                "Could not save " + filename + " to the mesh cache: " + e.getDescription() );
+        }
+
+        if( bExported )
+        {
+            const Ogre::String tmpPath = folder + "/" + tmpFilename;
+            const Ogre::String finalPath = folder + "/" + filename;
+            // rename() doesn't overwrite on Windows.
+            rwAccessFolderArchive->remove( filename );
+            bExported = rename( tmpPath.c_str(), finalPath.c_str() ) == 0;
+            if( !bExported )
+            {
+                Ogre::LogManager::getSingleton().logMessage( "Could not rename " + tmpFilename +
+                                                             " to " + filename );
+            }
+        }
+
+        if( !bExported )
+            rwAccessFolderArchive->remove( tmpFilename );
+
+        archiveManager.unload( folder );
+    }
+    //-----------------------------------------------------------------------------------
+    void CachedMeshLoader::loadResource( Ogre::Resource *resource )
+    {
+        Ogre::Mesh *mesh = static_cast<Ogre::Mesh *>( resource );
+
+        EntryMap::const_iterator itor = mEntries.find( resource->getName() );
+        if( itor == mEntries.end() )
+        {
+            OGRE_EXCEPT( Ogre::Exception::ERR_ITEM_NOT_FOUND,
+                         "Cannot find the cached mesh for " + resource->getName(),
+                         "CachedMeshLoader::loadResource" );
+        }
+
+        Ogre::DataStreamPtr stream = readCachedMesh( itor->second.folder, itor->second.filename );
+        if( stream )
+        {
+            try
+            {
+                Ogre::MeshSerializer meshSerializer( getVaoManager() );
+                meshSerializer.importMesh( stream, mesh );
+                return;
+            }
+            catch( Ogre::Exception &e )
+            {
+                // Corrupt or stale. Delete it, otherwise every later load would throw too.
+                Ogre::LogManager::getSingleton().logMessage(
+                    "Mesh cache file " + itor->second.filename +
+                    " could not be loaded: " + e.getDescription() + ". Converting " +
+                    mesh->getName() );
+                const Ogre::String path = itor->second.folder + "/" + itor->second.filename;
+                remove( path.c_str() );
+
+                // Whatever importMesh got to create before failing.
+                while( mesh->getNumSubMeshes() )
+                    mesh->destroySubMesh( 0u );
+            }
+        }
+        else
+        {
+            // Someone deleted the cache while we were running. Convert it again.
+            Ogre::LogManager::getSingleton().logMessage( "Mesh cache file " +
+                                                         itor->second.filename +
+                                                         " is gone. Converting " + mesh->getName() );
+        }
+
+        Ogre::v1::MeshPtr v1Mesh = Ogre::v1::MeshManager::getSingleton().load(
+            mesh->getName(), mesh->getGroup(), Ogre::v1::HardwareBuffer::HBU_STATIC,
+            Ogre::v1::HardwareBuffer::HBU_STATIC );
+        mesh->importV1( v1Mesh.get(), cHalfPos, cHalfTexCoords, cQTangents );
+        v1Mesh->unload();
+
+        saveCachedMesh( mesh, itor->second.folder, toCacheName( mesh->getName() ),
+                        itor->second.filename );
+    }
+    //-----------------------------------------------------------------------------------
+    void MeshUtils::setMeshCacheFolder( const Ogre::String &folder ) { msMeshCacheFolder = folder; }
+    //-----------------------------------------------------------------------------------
     void MeshUtils::importV1Mesh( const Ogre::String &meshName, const Ogre::String &groupName )
     {
+        Ogre::String cacheName;
+        Ogre::String cacheFilename;
+
+        if( !msMeshCacheFolder.empty() )
+        {
+            // Hashing the source is much cheaper than parsing & converting it.
+            cacheName = toCacheName( meshName );
+            cacheFilename = cacheName + hashSourceMesh( meshName, groupName ) + ".mesh";
+
+            std::ifstream cacheFile( ( msMeshCacheFolder + "/" + cacheFilename ).c_str(),
+                                     std::ios::binary | std::ios::in );
+            if( cacheFile.is_open() )
+            {
+                Ogre::MeshPtr v2Mesh = Ogre::MeshManager::getSingleton().createManual(
+                    meshName, groupName, &sCachedMeshLoader );
+                sCachedMeshLoader.add( meshName, msMeshCacheFolder, cacheFilename );
+
+                Ogre::LogManager::getSingleton().logMessage( "Mesh cache hit: " + meshName );
+                return;
+            }
+
+            Ogre::LogManager::getSingleton().logMessage( "Mesh cache miss: " + meshName );
+        }
+
         Ogre::v1::MeshPtr v1Mesh;
         Ogre::MeshPtr v2Mesh;
 
@@ -18,8 +271,15 @@ namespace Demo
                                                              Ogre::v1::HardwareBuffer::HBU_STATIC );
 
         // Create a v2 mesh to import to, with the same name (arbitrary).
-        v2Mesh = Ogre::MeshManager::getSingleton().createByImportingV1( meshName, groupName,
-                                                                        v1Mesh.get(), true, true, true );
+        v2Mesh = Ogre::MeshManager::getSingleton().createByImportingV1(
+            meshName, groupName, v1Mesh.get(), cHalfPos, cHalfTexCoords, cQTangents );
+
+        if( !cacheFilename.empty() )
+        {
+            // Convert now rather than on first use, so it can be saved.
+            v2Mesh->load();
+            saveCachedMesh( v2Mesh.get(), msMeshCacheFolder, cacheName, cacheFilename );
+        }
 
         // Free memory
         v1Mesh->unload();
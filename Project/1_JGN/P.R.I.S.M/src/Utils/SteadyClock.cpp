@@ -0,0 +1,15 @@
+
+#include "Utils/SteadyClock.h"
+
+#include <chrono>
+
+namespace Demo
+{
+    Ogre::uint64 SteadyClock::getMicroseconds()
+    {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return static_cast<Ogre::uint64>( std::chrono::duration_cast<std::chrono::microseconds>(
+                                              std::chrono::steady_clock::now() - epoch )
+                                              .count() );
+    }
+}  // namespace Demo
@@ -0,0 +1,548 @@
+
+#include "Utils/TextureMetadataCache.h"
+
+#include "OgreLogManager.h"
+#include "OgreLwString.h"
+#include "OgrePixelFormatGpuUtils.h"
+#include "OgreStringConverter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    define VC_EXTRALEAN
+#    define NOMINMAX
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace Demo
+{
+    static const Ogre::uint32 cTextureCacheMagic = 0x43545250u;  // 'PRTC'
+    static const Ogre::uint16 cTextureCacheVersion = 1u;
+
+    static size_t alignToSegment( size_t bytes ) { return ( bytes + 7u ) & ~size_t( 7u ); }
+
+    TextureMetadataCache::TextureMetadataCache() :
+        mData( 0 ),
+        mDataSize( 0 )
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+        ,
+        mFileHandle( 0 ),
+        mMappingHandle( 0 )
+#endif
+    {
+    }
+    //-----------------------------------------------------------------------------------
+    TextureMetadataCache::~TextureMetadataCache() { close(); }
+    //-----------------------------------------------------------------------------------
+    void TextureMetadataCache::toKey( Ogre::IdString name, Ogre::uint32 outKey[4] )
+    {
+        memset( outKey, 0, sizeof( Ogre::uint32 ) * 4u );
+        memcpy( outKey, &name.mHash, sizeof( name.mHash ) );
+    }
+    //-----------------------------------------------------------------------------------
+    bool TextureMetadataCache::keyLess( const Entry &a, const Entry &b )
+    {
+        for( size_t i = 0u; i < 4u; ++i )
+        {
+            if( a.key[i] != b.key[i] )
+                return a.key[i] < b.key[i];
+        }
+        return false;
+    }
+    //-----------------------------------------------------------------------------------
+    bool TextureMetadataCache::open( const Ogre::String &path )
+    {
+        close();
+        mPath = path;
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+        HANDLE fileHandle = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                         OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL );
+        if( fileHandle == INVALID_HANDLE_VALUE )
+            return false;
+
+        LARGE_INTEGER fileSize;
+        HANDLE mappingHandle = 0;
+        if( GetFileSizeEx( fileHandle, &fileSize ) &&
+            fileSize.QuadPart >= LONGLONG( sizeof( FileHeader ) ) )
+        {
+            mappingHandle = CreateFileMappingA( fileHandle, NULL, PAGE_READONLY, 0, 0, NULL );
+        }
+        if( !mappingHandle )
+        {
+            CloseHandle( fileHandle );
+            return false;
+        }
+
+        mFileHandle = fileHandle;
+        mMappingHandle = mappingHandle;
+        mData = reinterpret_cast<const Ogre::uint8 *>(
+            MapViewOfFile( mappingHandle, FILE_MAP_READ, 0, 0, 0 ) );
+        mDataSize = static_cast<size_t>( fileSize.QuadPart );
+#else
+        const int fd = ::open( path.c_str(), O_RDONLY );
+        if( fd < 0 )
+            return false;
+
+        struct stat fileStat;
+        if( fstat( fd, &fileStat ) != 0 || fileStat.st_size < off_t( sizeof( FileHeader ) ) )
+        {
+            ::close( fd );
+            return false;
+        }
+
+        mDataSize = static_cast<size_t>( fileStat.st_size );
+        void *data = mmap( 0, mDataSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+        // The mapping stays valid after closing the descriptor
+        ::close( fd );
+        if( data != MAP_FAILED )
+        {
+            mData = reinterpret_cast<const Ogre::uint8 *>( data );
+            // Lookups jump around; don't bother reading ahead.
+            madvise( data, mDataSize, MADV_RANDOM );
+        }
+#endif
+
+        if( !mData )
+        {
+            close();
+            return false;
+        }
+
+        const FileHeader *header = reinterpret_cast<const FileHeader *>( mData );
+        if( header->magic != cTextureCacheMagic || header->version != cTextureCacheVersion ||
+            header->keySize != sizeof( Ogre::IdString().mHash ) )
+        {
+            Ogre::LogManager::getSingleton().logMessage(
+                "[INFO] Texture cache " + path + " is from another version. Ignoring it." );
+            close();
+            return false;
+        }
+
+        size_t offset = sizeof( FileHeader );
+        for( Ogre::uint32 i = 0u; i < header->numSegments; ++i )
+        {
+            if( mDataSize - offset < sizeof( SegmentHeader ) )
+                break;
+
+            const SegmentHeader *segment = reinterpret_cast<const SegmentHeader *>( mData + offset );
+            const Ogre::uint64 segmentBytes =
+                sizeof( SegmentHeader ) + Ogre::uint64( segment->numEntries ) * sizeof( Entry ) +
+                alignToSegment( segment->stringBytes );
+            if( segmentBytes > mDataSize - offset )
+                break;
+
+            mSegments.push_back( segment );
+            offset += static_cast<size_t>( segmentBytes );
+        }
+
+        if( mSegments.empty() )
+        {
+            // Nothing to keep (e.g. the app died writing the first segment). Save will
+            // write the file from scratch.
+            Ogre::LogManager::getSingleton().logMessage(
+                "[WARNING] Texture cache " + path + " has no valid segments. Ignoring it." );
+            close();
+            return false;
+        }
+
+        if( mSegments.size() != header->numSegments )
+        {
+            // The app died while saving. Keep what's valid.
+            Ogre::LogManager::getSingleton().logMessage(
+                "[WARNING] Texture cache " + path + " is truncated. Only " +
+                Ogre::StringConverter::toString( mSegments.size() ) + " out of " +
+                Ogre::StringConverter::toString( header->numSegments ) + " segments are valid." );
+        }
+
+        std::reverse( mSegments.begin(), mSegments.end() );
+        return true;
+    }
+    //-----------------------------------------------------------------------------------
+    void TextureMetadataCache::close()
+    {
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+        if( mData )
+            UnmapViewOfFile( mData );
+        if( mMappingHandle )
+            CloseHandle( mMappingHandle );
+        if( mFileHandle )
+            CloseHandle( mFileHandle );
+        mFileHandle = 0;
+        mMappingHandle = 0;
+#else
+        if( mData )
+            munmap( const_cast<Ogre::uint8 *>( mData ), mDataSize );
+#endif
+        mData = 0;
+        mDataSize = 0;
+        mSegments.clear();
+        mRemoved.clear();
+    }
+    //-----------------------------------------------------------------------------------
+    const TextureMetadataCache::Entry *TextureMetadataCache::findEntry(
+        Ogre::IdString name, const SegmentHeader **outSegment ) const
+    {
+        Entry probe;
+        toKey( name, probe.key );
+
+        SegmentVec::const_iterator itor = mSegments.begin();
+        SegmentVec::const_iterator endt = mSegments.end();
+
+        while( itor != endt )
+        {
+            const Entry *entries = reinterpret_cast<const Entry *>( *itor + 1 );
+            const Entry *entriesEnd = entries + ( *itor )->numEntries;
+            const Entry *entry = std::lower_bound( entries, entriesEnd, probe, keyLess );
+            if( entry != entriesEnd && !keyLess( probe, *entry ) )
+            {
+                *outSegment = *itor;
+                return entry;
+            }
+            ++itor;
+        }
+
+        return 0;
+    }
+    //-----------------------------------------------------------------------------------
+    void TextureMetadataCache::toMetadataCacheEntry( const Entry &entry, const SegmentHeader *segment,
+                                                     bool bWithAlias,
+                                                     MetadataCacheEntry &outEntry ) const
+    {
+        outEntry.width = entry.width;
+        outEntry.height = entry.height;
+        outEntry.depthOrSlices = entry.depthOrSlices;
+        outEntry.poolId = entry.poolId;
+        outEntry.numMipmaps = entry.numMipmaps;
+        outEntry.pixelFormat = entry.pixelFormat < Ogre::PFG_COUNT
+                                   ? static_cast<Ogre::PixelFormatGpu>( entry.pixelFormat )
+                                   : Ogre::PFG_UNKNOWN;
+        outEntry.textureType = static_cast<Ogre::TextureTypes::TextureTypes>(
+            std::min<Ogre::uint8>( entry.textureType, Ogre::TextureTypes::Type3D ) );
+
+        if( bWithAlias )
+        {
+            const char *strings = reinterpret_cast<const char *>(
+                reinterpret_cast<const Entry *>( segment + 1 ) + segment->numEntries );
+            if( Ogre::uint64( entry.aliasOffset ) + entry.aliasLength <= segment->stringBytes )
+                outEntry.aliasName.assign( strings + entry.aliasOffset, entry.aliasLength );
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void TextureMetadataCache::getAllEntries( PendingEntryVec &outEntries ) const
+    {
+        std::map<Ogre::IdString, PendingEntry> liveEntries;
+
+        // Oldest first, so newer versions overwrite older ones
+        SegmentVec::const_reverse_iterator itor = mSegments.rbegin();
+        SegmentVec::const_reverse_iterator endt = mSegments.rend();
+
+        while( itor != endt )
+        {
+            const Entry *entries = reinterpret_cast<const Entry *>( *itor + 1 );
+            for( Ogre::uint32 i = 0u; i < ( *itor )->numEntries; ++i )
+            {
+                PendingEntry pendingEntry;
+                memcpy( &pendingEntry.name.mHash, entries[i].key, sizeof( pendingEntry.name.mHash ) );
+                if( entries[i].removed )
+                {
+                    liveEntries.erase( pendingEntry.name );
+                }
+                else
+                {
+                    pendingEntry.removed = false;
+                    toMetadataCacheEntry( entries[i], *itor, true, pendingEntry.entry );
+                    liveEntries[pendingEntry.name] = pendingEntry;
+                }
+            }
+            ++itor;
+        }
+
+        outEntries.reserve( outEntries.size() + liveEntries.size() );
+        std::map<Ogre::IdString, PendingEntry>::const_iterator itLive = liveEntries.begin();
+        std::map<Ogre::IdString, PendingEntry>::const_iterator enLive = liveEntries.end();
+        while( itLive != enLive )
+        {
+            outEntries.push_back( itLive->second );
+            ++itLive;
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    bool TextureMetadataCache::writeSegment( std::ostream &outFile, PendingEntryVec &entries )
+    {
+        std::vector<Entry> fileEntries;
+        fileEntries.resize( entries.size() );
+        Ogre::String strings;
+
+        for( size_t i = 0u; i < entries.size(); ++i )
+        {
+            const MetadataCacheEntry &src = entries[i].entry;
+            Entry &dst = fileEntries[i];
+            memset( &dst, 0, sizeof( dst ) );
+            toKey( entries[i].name, dst.key );
+            dst.width = src.width;
+            dst.height = src.height;
+            dst.depthOrSlices = src.depthOrSlices;
+            dst.poolId = src.poolId;
+            dst.aliasOffset = static_cast<Ogre::uint32>( strings.size() );
+            dst.aliasLength =
+                static_cast<Ogre::uint16>( std::min<size_t>( src.aliasName.size(), 0xFFFFu ) );
+            dst.pixelFormat = static_cast<Ogre::uint16>( src.pixelFormat );
+            dst.textureType = static_cast<Ogre::uint8>( src.textureType );
+            dst.numMipmaps = src.numMipmaps;
+            dst.removed = entries[i].removed ? 1u : 0u;
+            strings.append( src.aliasName.c_str(), dst.aliasLength );
+        }
+
+        std::sort( fileEntries.begin(), fileEntries.end(), keyLess );
+
+        SegmentHeader segment;
+        segment.numEntries = static_cast<Ogre::uint32>( fileEntries.size() );
+        segment.stringBytes = static_cast<Ogre::uint32>( strings.size() );
+        strings.resize( alignToSegment( strings.size() ), '\0' );
+
+        outFile.write( reinterpret_cast<const char *>( &segment ), sizeof( segment ) );
+        if( !fileEntries.empty() )
+        {
+            outFile.write( reinterpret_cast<const char *>( &fileEntries[0] ),
+                           static_cast<std::streamsize>( fileEntries.size() * sizeof( Entry ) ) );
+        }
+        outFile.write( strings.c_str(), static_cast<std::streamsize>( strings.size() ) );
+
+        return !outFile.fail();
+    }
+    //-----------------------------------------------------------------------------------
+    void TextureMetadataCache::save( const Ogre::String &path, const MetadataCacheMap &sessionEntries )
+    {
+        const bool bSameFile = isOpen() && path == mPath;
+
+        PendingEntryVec pending;
+        pending.reserve( sessionEntries.size() );
+
+        MetadataCacheMap::const_iterator itor = sessionEntries.begin();
+        MetadataCacheMap::const_iterator endt = sessionEntries.end();
+
+        while( itor != endt )
+        {
+            const MetadataCacheEntry &entry = itor->second;
+
+            const SegmentHeader *segment = 0;
+            const Entry *cached = bSameFile ? findEntry( itor->first, &segment ) : 0;
+            if( !cached || cached->removed || cached->width != entry.width ||
+                cached->height != entry.height || cached->depthOrSlices != entry.depthOrSlices ||
+                cached->poolId != entry.poolId || cached->pixelFormat != entry.pixelFormat ||
+                cached->textureType != entry.textureType || cached->numMipmaps != entry.numMipmaps )
+            {
+                PendingEntry pendingEntry;
+                pendingEntry.name = itor->first;
+                pendingEntry.entry = entry;
+                pendingEntry.removed = false;
+                pending.push_back( pendingEntry );
+            }
+            ++itor;
+        }
+
+        if( bSameFile )
+        {
+            std::set<Ogre::IdString>::const_iterator itRemoved = mRemoved.begin();
+            std::set<Ogre::IdString>::const_iterator enRemoved = mRemoved.end();
+
+            while( itRemoved != enRemoved )
+            {
+                const SegmentHeader *segment = 0;
+                const Entry *cached = findEntry( *itRemoved, &segment );
+                if( cached && !cached->removed &&
+                    sessionEntries.find( *itRemoved ) == sessionEntries.end() )
+                {
+                    PendingEntry pendingEntry;
+                    pendingEntry.name = *itRemoved;
+                    pendingEntry.removed = true;
+                    pending.push_back( pendingEntry );
+                }
+                ++itRemoved;
+            }
+
+            if( pending.empty() )
+                return;
+        }
+
+        // open() fails if there are no valid segments, so there's always one to append after.
+        const bool bAppend = bSameFile && mSegments.size() < cMaxSegments;
+
+        Ogre::uint32 numSegments = 1u;
+        size_t appendOffset = 0u;
+
+        if( bAppend )
+        {
+            numSegments = static_cast<Ogre::uint32>( mSegments.size() ) + 1u;
+            // Right after the newest valid segment, overwriting any garbage left by a crash.
+            assert( !mSegments.empty() );
+            const SegmentHeader *newest = mSegments.front();
+            appendOffset = static_cast<size_t>( reinterpret_cast<const Ogre::uint8 *>( newest ) -
+                                                mData ) +
+                           sizeof( SegmentHeader ) + newest->numEntries * sizeof( Entry ) +
+                           alignToSegment( newest->stringBytes );
+        }
+        else if( bSameFile )
+        {
+            // Compact everything into a single segment.
+            PendingEntryVec allEntries;
+            getAllEntries( allEntries );
+
+            std::map<Ogre::IdString, size_t> indices;
+            for( size_t i = 0u; i < allEntries.size(); ++i )
+                indices[allEntries[i].name] = i;
+
+            PendingEntryVec::const_iterator itPending = pending.begin();
+            PendingEntryVec::const_iterator enPending = pending.end();
+            while( itPending != enPending )
+            {
+                std::map<Ogre::IdString, size_t>::const_iterator itIdx =
+                    indices.find( itPending->name );
+                if( itIdx != indices.end() )
+                    allEntries[itIdx->second] = *itPending;
+                else
+                    allEntries.push_back( *itPending );
+                ++itPending;
+            }
+
+            pending.clear();
+            for( size_t i = 0u; i < allEntries.size(); ++i )
+            {
+                if( !allEntries[i].removed )
+                    pending.push_back( allEntries[i] );
+            }
+        }
+
+        // On Windows a mapped file can't be written to.
+        close();
+
+        FileHeader header;
+        memset( &header, 0, sizeof( header ) );
+        header.magic = cTextureCacheMagic;
+        header.version = cTextureCacheVersion;
+        header.keySize = static_cast<Ogre::uint16>( sizeof( Ogre::IdString().mHash ) );
+        header.numSegments = numSegments;
+
+        bool bSuccess = false;
+        if( bAppend )
+        {
+            std::fstream file( path.c_str(), std::ios::binary | std::ios::in | std::ios::out );
+            if( file.is_open() )
+            {
+                file.seekp( static_cast<std::streamoff>( appendOffset ) );
+                // The header goes last. If we die mid-way, the new segment is just ignored.
+                if( writeSegment( file, pending ) )
+                {
+                    file.flush();
+                    file.seekp( 0 );
+                    file.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+                    bSuccess = !file.fail();
+                }
+            }
+        }
+        else
+        {
+            // Write a copy & swap it, so a crash can't leave us without a cache.
+            const Ogre::String tmpPath = path + ".tmp";
+            {
+                std::ofstream file( tmpPath.c_str(), std::ios::binary | std::ios::out );
+                if( file.is_open() )
+                {
+                    file.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+                    bSuccess = writeSegment( file, pending );
+                }
+            }
+            if( bSuccess )
+            {
+                remove( path.c_str() );
+                bSuccess = rename( tmpPath.c_str(), path.c_str() ) == 0;
+            }
+        }
+
+        if( !bSuccess )
+        {
+            Ogre::LogManager::getSingleton().logMessage( "[WARNING] Could not save texture cache to " +
+                                                         path );
+        }
+
+        open( path );
+    }
+    //-----------------------------------------------------------------------------------
+    static bool OrderByAlias( const TextureMetadataCache::MetadataCacheEntry *a,
+                              const TextureMetadataCache::MetadataCacheEntry *b )
+    {
+        return a->aliasName < b->aliasName;
+    }
+    //-----------------------------------------------------------------------------------
+    void TextureMetadataCache::exportJson( Ogre::String &outJson ) const
+    {
+        PendingEntryVec allEntries;
+        getAllEntries( allEntries );
+
+        // Sorted so dumps from different runs can be diffed.
+        std::vector<const MetadataCacheEntry *> sortedEntries;
+        sortedEntries.reserve( allEntries.size() );
+        for( size_t i = 0u; i < allEntries.size(); ++i )
+            sortedEntries.push_back( &allEntries[i].entry );
+        std::sort( sortedEntries.begin(), sortedEntries.end(), OrderByAlias );
+
+        char tmpBuffer[4096];
+        Ogre::LwString jsonStr( Ogre::LwString::FromEmptyPointer( tmpBuffer, sizeof( tmpBuffer ) ) );
+
+        outJson += "{\n\t\"reserved_pool_ids\" :\n\t[\n\t],\n\t\"textures\" :\n\t{";
+
+        for( size_t i = 0u; i < sortedEntries.size(); ++i )
+        {
+            const MetadataCacheEntry &entry = *sortedEntries[i];
+
+            if( i != 0u )
+                outJson += ",";
+            outJson += "\n\t\t\"" + entry.aliasName + "\" : \n\t\t{";
+
+            jsonStr.clear();
+            jsonStr.a( "\n\t\t\t\"resolution\" : [", entry.width, ", ", entry.height, ", ",
+                       entry.depthOrSlices, "]" );
+            jsonStr.a( ",\n\t\t\t\"mipmaps\" : ", entry.numMipmaps );
+            jsonStr.a( ",\n\t\t\t\"format\" : \"",
+                       Ogre::PixelFormatGpuUtils::toString( entry.pixelFormat ), "\"" );
+            jsonStr.a( ",\n\t\t\t\"texture_type\" : ", (int)entry.textureType );
+            jsonStr.a( ",\n\t\t\t\"poolId\" : ", entry.poolId );
+            jsonStr.a( "\n\t\t}" );
+            outJson += jsonStr.c_str();
+        }
+
+        outJson += "\n\t}\n}";
+    }
+    //-----------------------------------------------------------------------------------
+    bool TextureMetadataCache::findMetadataCacheEntry( Ogre::IdString name,
+                                                       MetadataCacheEntry &outEntry )
+    {
+        if( !mRemoved.empty() && mRemoved.find( name ) != mRemoved.end() )
+            return false;
+
+        const SegmentHeader *segment = 0;
+        const Entry *entry = findEntry( name, &segment );
+        if( !entry || entry->removed )
+            return false;
+
+        // The alias is only needed for exporting, and we'd have to allocate it.
+        toMetadataCacheEntry( *entry, segment, false, outEntry );
+        return outEntry.pixelFormat != Ogre::PFG_UNKNOWN;
+    }
+    //-----------------------------------------------------------------------------------
+    void TextureMetadataCache::removeMetadataCacheEntry( Ogre::IdString name )
+    {
+        mRemoved.insert( name );
+    }
+}  // namespace Demo
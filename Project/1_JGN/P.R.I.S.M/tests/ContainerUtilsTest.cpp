@@ -0,0 +1,93 @@
+
+#include "PrismTest.h"
+
+#include "Utils/ContainerUtils.h"
+
+#include <functional>
+
+using namespace Demo;
+
+namespace
+{
+    struct Indexed
+    {
+        size_t idx;
+    };
+}  // namespace
+
+static void testSwapAndPop()
+{
+    Indexed objects[4];
+    std::vector<Indexed *> container;
+    for( size_t i = 0u; i < 4u; ++i )
+    {
+        objects[i].idx = i;
+        container.push_back( &objects[i] );
+    }
+
+    ContainerUtils::swapAndPop( container, 1u, &Indexed::idx );
+    PRISM_CHECK( container.size() == 3u );
+    PRISM_CHECK( container[1] == &objects[3] && objects[3].idx == 1u );
+
+    // Removing the last one moves nothing around.
+    ContainerUtils::swapAndPop( container, 2u, &Indexed::idx );
+    PRISM_CHECK( container.size() == 2u );
+    PRISM_CHECK( container[0] == &objects[0] && container[1] == &objects[3] );
+
+    std::vector<int> values( 3u );
+    values[0] = 10;
+    values[1] = 20;
+    values[2] = 30;
+    ContainerUtils::swapAndPop( values, 0u );
+    PRISM_CHECK( values.size() == 2u && values[0] == 30 && values[1] == 20 );
+}
+
+static void testRemoveSorted()
+{
+    std::vector<int> container;
+    for( int i = 0; i < 10; ++i )
+        container.push_back( i * 2 );
+
+    std::vector<int> toRemove;
+    toRemove.push_back( 2 );
+    toRemove.push_back( 5 );  // Not in container
+    toRemove.push_back( 8 );
+    toRemove.push_back( 18 );
+
+    const size_t numRemoved = ContainerUtils::removeSorted( container, toRemove, std::less<int>() );
+    PRISM_CHECK( numRemoved == 3u );
+    PRISM_CHECK( container.size() == 7u );
+
+    const int expected[] = { 0, 4, 6, 10, 12, 14, 16 };
+    for( size_t i = 0u; i < container.size(); ++i )
+        PRISM_CHECK( container[i] == expected[i] );
+
+    PRISM_CHECK( ContainerUtils::removeSorted( container, std::vector<int>(), std::less<int>() ) ==
+                 0u );
+}
+
+static void testMergeSorted()
+{
+    std::vector<int> container;
+    container.push_back( 1 );
+    container.push_back( 5 );
+    container.push_back( 9 );
+    container.push_back( 7 );
+    container.push_back( 0 );
+    container.push_back( 5 );
+
+    ContainerUtils::mergeSorted( container, 3u, std::less<int>() );
+
+    const int expected[] = { 0, 1, 5, 5, 7, 9 };
+    PRISM_CHECK( container.size() == 6u );
+    for( size_t i = 0u; i < container.size(); ++i )
+        PRISM_CHECK( container[i] == expected[i] );
+}
+
+int main()
+{
+    testSwapAndPop();
+    testRemoveSorted();
+    testMergeSorted();
+    return PrismTest::exitCode();
+}
@@ -0,0 +1,181 @@
+
+#include "PrismTest.h"
+
+#include "GameEntityManager.h"
+#include "LogicSystem.h"
+
+#include <vector>
+
+using namespace Demo;
+
+namespace
+{
+    /// Stands in for GraphicsSystem. Keeps the Mq::ORIGIN_REBASED it receives.
+    class RecordingGraphicsSystem : public Mq::MessageQueueSystem
+    {
+    public:
+        std::vector<GameEntityManager::OriginRebased> mOriginsRebased;
+
+        void processIncomingMessage( Mq::MessageId messageId, const void *data ) override
+        {
+            if( messageId == Mq::ORIGIN_REBASED )
+            {
+                mOriginsRebased.push_back(
+                    *reinterpret_cast<const GameEntityManager::OriginRebased *>( data ) );
+            }
+        }
+
+        void _processIncomingMessages() { this->processIncomingMessages(); }
+    };
+
+    const size_t cNumDynamicEntities = 5u;
+
+    bool samePosition( const Ogre::Vector3 &a, const Ogre::Vector3 &b )
+    {
+        return a.squaredDistance( b ) < 1e-6f;
+    }
+
+    /// True if the GameEntity's transform in transformIdx is its world position
+    /// relative to the current origin.
+    bool isRebased( const GameEntityManager &mgr, const GameEntity *gameEntity,
+                    size_t transformIdx )
+    {
+        return gameEntity->mOriginEpoch[transformIdx] == mgr.getOriginEpoch() &&
+               samePosition( gameEntity->getPosition( transformIdx ),
+                             mgr.getWorldPosition( gameEntity ).relativeTo( mgr.getOrigin() ) );
+    }
+
+    struct Fixture
+    {
+        RecordingGraphicsSystem graphicsSystem;
+        LogicSystem             logicSystem;
+        GameEntityManager *     mgr;
+        MovableObjectDefinition moDefinition;
+        GameEntityVec           dynamicEntities;
+        GameEntity *            staticEntity;
+
+        Fixture() : logicSystem( 0 ), mgr( 0 ), staticEntity( 0 )
+        {
+            logicSystem.setFloatingOrigin( true );
+            mgr = new GameEntityManager( &graphicsSystem, &logicSystem );
+            mgr->setRebaseDistance( 100.0 );
+            mgr->setRebaseEntitiesPerTick( 2u );
+
+            for( size_t i = 0u; i < cNumDynamicEntities; ++i )
+            {
+                dynamicEntities.push_back( mgr->addGameEntity(
+                    Ogre::SCENE_DYNAMIC, &moDefinition, Ogre::Vector3( Ogre::Real( i ), 0, 0 ),
+                    Ogre::Quaternion::IDENTITY, Ogre::Vector3::UNIT_SCALE ) );
+            }
+            staticEntity =
+                mgr->addGameEntity( Ogre::SCENE_STATIC, &moDefinition, Ogre::Vector3( 0, 0, 5 ),
+                                    Ogre::Quaternion::IDENTITY, Ogre::Vector3::UNIT_SCALE );
+        }
+
+        ~Fixture() { delete mgr; }
+
+        size_t currIdx() const { return logicSystem.getCurrentTransformIdx(); }
+
+        size_t countRebased() const
+        {
+            size_t numRebased = 0u;
+            for( size_t i = 0u; i < dynamicEntities.size(); ++i )
+                numRebased += isRebased( *mgr, dynamicEntities[i], currIdx() ) ? 1u : 0u;
+            return numRebased;
+        }
+    };
+}  // namespace
+
+/// The origin only moves once the focus is far enough, snapped to whole units, and
+/// Graphics is told about it.
+static void testRebaseDistance()
+{
+    Fixture f;
+
+    f.mgr->updateOrigin( WorldPosition( 50.0, 0.0, 50.0 ) );
+    PRISM_CHECK( f.mgr->getOriginEpoch() == 0u && !f.mgr->isRebasing() );
+
+    f.mgr->updateOrigin( WorldPosition( 1000.4, 0.0, -1000.6 ) );
+    PRISM_CHECK( f.mgr->getOriginEpoch() == 1u && f.mgr->isRebasing() );
+    PRISM_CHECK( f.mgr->getOrigin().x == 1000.0 && f.mgr->getOrigin().z == -1001.0 );
+
+    f.logicSystem.flushQueuedMessages();
+    f.graphicsSystem._processIncomingMessages();
+    PRISM_CHECK( f.graphicsSystem.mOriginsRebased.size() == 1u );
+    PRISM_CHECK( f.graphicsSystem.mOriginsRebased.back().epoch == 1u );
+    PRISM_CHECK( f.graphicsSystem.mOriginsRebased.back().origin.x == 1000.0 );
+}
+
+/// Dynamic entities are migrated a few per tick. A new rebase can't start until the
+/// previous one is done. Static entities stay relative to their original origin.
+static void testAmortizedRebase()
+{
+    Fixture f;
+
+    f.mgr->updateOrigin( WorldPosition( 1000.0, 0.0, 0.0 ) );
+    PRISM_CHECK( f.countRebased() == 0u );
+
+    f.mgr->finishFrameParallel();
+    PRISM_CHECK( f.countRebased() == 2u && f.mgr->isRebasing() );
+
+    f.mgr->updateOrigin( WorldPosition( 5000.0, 0.0, 0.0 ) );
+    PRISM_CHECK( f.mgr->getOriginEpoch() == 1u );
+
+    f.mgr->finishFrameParallel();
+    f.mgr->finishFrameParallel();
+    PRISM_CHECK( f.countRebased() == cNumDynamicEntities && !f.mgr->isRebasing() );
+    PRISM_CHECK( samePosition( f.dynamicEntities[3]->getPosition( f.currIdx() ),
+                               Ogre::Vector3( -997, 0, 0 ) ) );
+
+    PRISM_CHECK( f.staticEntity->mOriginEpoch[f.currIdx()] == 0u );
+    PRISM_CHECK( samePosition( f.staticEntity->getPosition( f.currIdx() ),
+                               Ogre::Vector3( 0, 0, 5 ) ) );
+
+    // Done, so the next one can start.
+    f.mgr->updateOrigin( WorldPosition( 5000.0, 0.0, 0.0 ) );
+    PRISM_CHECK( f.mgr->getOriginEpoch() == 2u );
+}
+
+/// Entities the GameState moves through setWorldPosition while rebasing are written
+/// relative to the new origin right away, and don't need migrating anymore.
+static void testSetWorldPositionWhileRebasing()
+{
+    Fixture f;
+
+    f.mgr->updateOrigin( WorldPosition( 1000.0, 0.0, 0.0 ) );
+    for( size_t i = 0u; i < 3u; ++i )
+        f.mgr->setWorldPosition( f.dynamicEntities[i], WorldPosition( 990.0, 0.0, 0.0 ) );
+    PRISM_CHECK( f.countRebased() == 3u );
+    PRISM_CHECK( samePosition( f.dynamicEntities[0]->getPosition( f.currIdx() ),
+                               Ogre::Vector3( -10, 0, 0 ) ) );
+
+    f.mgr->finishFrameParallel();
+    PRISM_CHECK( f.countRebased() == cNumDynamicEntities && !f.mgr->isRebasing() );
+}
+
+/// LogicSystem follows the camera position Graphics sends each frame.
+static void testFollowsCamera()
+{
+    Fixture f;
+
+    f.graphicsSystem.queueSendMessage( &f.logicSystem, Mq::CAMERA_MOVED,
+                                       WorldPosition( 50.0, 0.0, 0.0 ) );
+    f.graphicsSystem.flushQueuedMessages();
+    f.logicSystem.beginFrameParallel();
+    PRISM_CHECK( f.mgr->getOriginEpoch() == 0u );
+
+    f.graphicsSystem.queueSendMessage( &f.logicSystem, Mq::CAMERA_MOVED,
+                                       WorldPosition( 0.0, 2000.0, 0.0 ) );
+    f.graphicsSystem.flushQueuedMessages();
+    f.logicSystem.beginFrameParallel();
+    PRISM_CHECK( f.mgr->getOriginEpoch() == 1u && f.mgr->getOrigin().y == 2000.0 );
+}
+
+int main()
+{
+    testRebaseDistance();
+    testAmortizedRebase();
+    testSetWorldPositionWhileRebasing();
+    testFollowsCamera();
+    return PrismTest::exitCode();
+}
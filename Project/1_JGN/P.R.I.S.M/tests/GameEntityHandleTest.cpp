@@ -0,0 +1,114 @@
+
+#include "PrismTest.h"
+
+#include "GameEntityManager.h"
+#include "LogicSystem.h"
+
+using namespace Demo;
+
+namespace
+{
+    /// Stands in for GraphicsSystem. Ignores everything.
+    class NullGraphicsSystem : public Mq::MessageQueueSystem
+    {
+    public:
+        void processIncomingMessage( Mq::MessageId, const void * ) override {}
+    };
+
+    struct Fixture
+    {
+        NullGraphicsSystem      graphicsSystem;
+        LogicSystem             logicSystem;
+        GameEntityManager *     mgr;
+        MovableObjectDefinition moDefinition;
+
+        Fixture() : logicSystem( 0 ), mgr( 0 )
+        {
+            mgr = new GameEntityManager( &graphicsSystem, &logicSystem );
+        }
+
+        ~Fixture() { delete mgr; }
+
+        GameEntity *add()
+        {
+            return mgr->addGameEntity( Ogre::SCENE_DYNAMIC, &moDefinition, Ogre::Vector3::ZERO,
+                                       Ogre::Quaternion::IDENTITY, Ogre::Vector3::UNIT_SCALE );
+        }
+
+        /// Removes the GameEntity and destroys it right away, as if Graphics had
+        /// already confirmed it's done with it.
+        void removeAndDestroy( GameEntity *gameEntity )
+        {
+            mgr->removeGameEntity( gameEntity );
+            mgr->finishFrameParallel();
+            mgr->_notifyGameEntitiesRemoved( 0u );
+        }
+    };
+}  // namespace
+
+/// Handles resolve to their GameEntity until it's removed, and stay null afterwards.
+static void testHandleInvalidation()
+{
+    Fixture f;
+
+    PRISM_CHECK( f.mgr->getGameEntity( GameEntityHandle() ) == 0 );
+
+    GameEntity *a = f.add();
+    GameEntity *b = f.add();
+    const GameEntityHandle handleA = a->getHandle();
+    const GameEntityHandle handleB = b->getHandle();
+    PRISM_CHECK( !handleA.isNull() && handleA != handleB );
+    PRISM_CHECK( f.mgr->getGameEntity( handleA ) == a );
+    PRISM_CHECK( f.mgr->getGameEntity( handleB ) == b );
+
+    // Null as soon as it's removed, even though it's not destroyed yet.
+    f.mgr->removeGameEntity( a );
+    PRISM_CHECK( f.mgr->getGameEntity( handleA ) == 0 );
+    PRISM_CHECK( f.mgr->getGameEntity( handleB ) == b );
+
+    PRISM_CHECK( f.mgr->getGameEntity( GameEntityHandle( 1000000u, 1u ) ) == 0 );
+}
+
+/// A reused slot gets a new generation, so old handles don't resolve to the newcomer.
+/// Its GameEntityGraphics starts clean.
+static void testSlotReuse()
+{
+    Fixture f;
+
+    GameEntity *a = f.add();
+    const GameEntityHandle handleA = a->getHandle();
+    GameEntityGraphics *graphicsA = a->mGraphics;
+    graphicsA->originEpoch = 5u;
+
+    f.removeAndDestroy( a );
+
+    GameEntity *c = f.add();
+    const GameEntityHandle handleC = c->getHandle();
+    PRISM_CHECK( c == a && handleC.slot == handleA.slot );
+    PRISM_CHECK( handleC.generation != handleA.generation );
+    PRISM_CHECK( f.mgr->getGameEntity( handleA ) == 0 );
+    PRISM_CHECK( f.mgr->getGameEntity( handleC ) == c );
+
+    PRISM_CHECK( c->mGraphics == graphicsA );
+    PRISM_CHECK( !c->mGraphics->sceneNode && !c->mGraphics->movableObject &&
+                 c->mGraphics->originEpoch == 0u );
+}
+
+/// The GameEntityGraphics of consecutive slots are contiguous.
+static void testGraphicsLayout()
+{
+    Fixture f;
+
+    GameEntity *a = f.add();
+    GameEntity *b = f.add();
+    PRISM_CHECK( b->getHandle().slot == a->getHandle().slot + 1u );
+    PRISM_CHECK( b->mGraphics == a->mGraphics + 1u );
+}
+
+int main()
+{
+    testHandleInvalidation();
+    testSlotReuse();
+    testGraphicsLayout();
+    return PrismTest::exitCode();
+}
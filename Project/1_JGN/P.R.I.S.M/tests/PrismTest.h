@@ -0,0 +1,43 @@
+
+#ifndef _Demo_PrismTest_H_
+#define _Demo_PrismTest_H_
+
+#include <iostream>
+
+namespace Demo
+{
+    /** Bare bones checks for the tests in this folder. Each test is its own executable
+        (see tests/CMakeLists.txt) whose main returns PrismTest::exitCode(), so ctest
+        reports it as failed if any PRISM_CHECK failed.
+    */
+    struct PrismTest
+    {
+        static int &numFailures()
+        {
+            static int failures = 0;
+            return failures;
+        }
+
+        static void fail( const char *expr, const char *file, int line )
+        {
+            std::cerr << file << "(" << line << "): check failed: " << expr << std::endl;
+            ++numFailures();
+        }
+
+        static int exitCode()
+        {
+            if( numFailures() )
+                std::cerr << numFailures() << " check(s) failed" << std::endl;
+            return numFailures() ? 1 : 0;
+        }
+    };
+}  // namespace Demo
+
+#define PRISM_CHECK( expr ) \
+    do \
+    { \
+        if( !( expr ) ) \
+            Demo::PrismTest::fail( #expr, __FILE__, __LINE__ ); \
+    } while( 0 )
+
+#endif
@@ -0,0 +1,172 @@
+
+#include "PrismTest.h"
+
+#include "Threading/MessageQueueSystem.h"
+
+#include <vector>
+
+using namespace Demo;
+
+namespace
+{
+    /// Records every message it receives so the tests can check what arrived, and in
+    /// which order.
+    class RecordingQueueSystem : public Mq::MessageQueueSystem
+    {
+    public:
+        std::vector<Mq::MessageId> mIds;
+        std::vector<Ogre::uint32>  mValues;
+
+        void processIncomingMessage( Mq::MessageId messageId, const void *data ) override
+        {
+            mIds.push_back( messageId );
+            if( messageId == Mq::GAME_ENTITY_ADDED_BATCH )
+            {
+                size_t numValues = 0;
+                const Ogre::uint32 *values =
+                    Mq::MessageQueueSystem::getMessageArray<Ogre::uint32>( data, numValues );
+                mValues.insert( mValues.end(), values, values + numValues );
+            }
+            else
+            {
+                mValues.push_back( *reinterpret_cast<const Ogre::uint32 *>( data ) );
+            }
+        }
+
+        void _processIncomingMessages() { this->processIncomingMessages(); }
+    };
+
+    bool isSequence( const std::vector<Ogre::uint32> &values, Ogre::uint32 first, size_t count )
+    {
+        if( values.size() != count )
+            return false;
+        for( size_t i = 0u; i < count; ++i )
+        {
+            if( values[i] != first + i )
+                return false;
+        }
+        return true;
+    }
+}  // namespace
+
+/// Capacities are rounded up to a power of 2, and never truncated to 32 bits.
+static void testCapacity()
+{
+    PRISM_CHECK( Mq::SpscMessageRing( 1u ).getCapacity() == 64u );
+    PRISM_CHECK( Mq::SpscMessageRing( 100u ).getCapacity() == 128u );
+    PRISM_CHECK( Mq::SpscMessageRing( 4096u ).getCapacity() == 4096u );
+}
+
+/// Pushes many more bytes than the ring holds, a frame at a time, so the write
+/// position wraps around the end of the buffer (with padding records) many times.
+static void testWrapAround()
+{
+    RecordingQueueSystem sender;
+    RecordingQueueSystem receiver;
+    sender.connectSpscTransport( &receiver, 256u );
+
+    std::vector<Ogre::uint32> values;
+    Ogre::uint32 nextValue = 0u;
+    for( int frame = 0; frame < 100; ++frame )
+    {
+        // Records of 24 to 40 bytes, which don't line up with the end of the buffer.
+        for( int i = 0; i < 3; ++i )
+        {
+            values.clear();
+            for( int j = 0; j <= ( frame + i ) % 5; ++j )
+                values.push_back( nextValue++ );
+            sender.queueSendMessageArray( &receiver, Mq::GAME_ENTITY_ADDED_BATCH, &values[0],
+                                          values.size() );
+        }
+        sender.flushQueuedMessages();
+        receiver._processIncomingMessages();
+    }
+
+    PRISM_CHECK( isSequence( receiver.mValues, 0u, nextValue ) );
+    PRISM_CHECK( receiver.mIds.size() == 300u );
+    PRISM_CHECK( sender.getNumRingOverflows() == 0u );
+}
+
+/// When the consumer falls behind, messages spill to the overflow queue and must
+/// still arrive exactly once, in order.
+static void testOverflow()
+{
+    RecordingQueueSystem sender;
+    RecordingQueueSystem receiver;
+    sender.connectSpscTransport( &receiver, 64u );
+
+    // 64 bytes hold 4 messages. Send 10 without letting the receiver read.
+    for( Ogre::uint32 i = 0u; i < 10u; ++i )
+        sender.queueSendMessage( &receiver, Mq::GAME_ENTITY_ADDED, i );
+    sender.flushQueuedMessages();
+    PRISM_CHECK( sender.getNumRingOverflows() == 1u );
+
+    receiver._processIncomingMessages();
+    PRISM_CHECK( isSequence( receiver.mValues, 0u, 4u ) );
+
+    // Messages sent while the overflow isn't empty go after it, not into the ring.
+    sender.queueSendMessage( &receiver, Mq::GAME_ENTITY_ADDED, Ogre::uint32( 10u ) );
+
+    for( int i = 0; i < 4; ++i )
+    {
+        sender.flushQueuedMessages();
+        receiver._processIncomingMessages();
+    }
+
+    PRISM_CHECK( isSequence( receiver.mValues, 0u, 11u ) );
+}
+
+/// A record bigger than half the ring must still fit after wrapping.
+static void testRecordBiggerThanHalfTheRing()
+{
+    RecordingQueueSystem sender;
+    RecordingQueueSystem receiver;
+    sender.connectSpscTransport( &receiver, 256u );
+
+    // Moves the write position to the middle of the buffer.
+    sender.queueSendMessage( &receiver, Mq::GAME_ENTITY_ADDED, Ogre::uint32( 0u ) );
+    sender.flushQueuedMessages();
+    receiver._processIncomingMessages();
+
+    std::vector<Ogre::uint32> values;
+    for( Ogre::uint32 i = 1u; i <= 40u; ++i )
+        values.push_back( i );
+
+    for( int i = 0; i < 3; ++i )
+    {
+        sender.queueSendMessageArray( &receiver, Mq::GAME_ENTITY_ADDED_BATCH, &values[0],
+                                      values.size() );
+        sender.flushQueuedMessages();
+        receiver._processIncomingMessages();
+    }
+
+    PRISM_CHECK( receiver.mIds.size() == 4u );
+    PRISM_CHECK( receiver.mValues.size() == 1u + 3u * values.size() );
+    PRISM_CHECK( sender.getNumRingOverflows() == 0u );
+}
+
+/// Nothing is visible to the consumer until flushQueuedMessages publishes it.
+static void testPublish()
+{
+    RecordingQueueSystem sender;
+    RecordingQueueSystem receiver;
+    sender.connectSpscTransport( &receiver, 256u );
+
+    sender.queueSendMessage( &receiver, Mq::GAME_ENTITY_ADDED, Ogre::uint32( 7u ) );
+    receiver._processIncomingMessages();
+    PRISM_CHECK( receiver.mValues.empty() );
+
+    sender.flushQueuedMessages();
+    receiver._processIncomingMessages();
+    PRISM_CHECK( receiver.mValues.size() == 1u && receiver.mValues[0] == 7u );
+}
+
+int main()
+{
+    testCapacity();
+    testWrapAround();
+    testOverflow();
+    testRecordBiggerThanHalfTheRing();
+    testPublish();
+    return PrismTest::exitCode();
+}
@@ -0,0 +1,154 @@
+
+#include "PrismTest.h"
+
+#include "Utils/TextureMetadataCache.h"
+
+#include "OgreLogManager.h"
+
+#include <fstream>
+#include <stdio.h>
+
+using namespace Demo;
+
+namespace
+{
+    const char *cCachePath = "TextureMetadataCacheTest.bin";
+
+    TextureMetadataCache::MetadataCacheEntry makeEntry( const char *aliasName, Ogre::uint32 width )
+    {
+        TextureMetadataCache::MetadataCacheEntry entry;
+        entry.aliasName = aliasName;
+        entry.width = width;
+        entry.height = width;
+        entry.depthOrSlices = 1u;
+        entry.pixelFormat = Ogre::PFG_RGBA8_UNORM_SRGB;
+        entry.poolId = 0u;
+        entry.textureType = Ogre::TextureTypes::Type2D;
+        entry.numMipmaps = 1u;
+        return entry;
+    }
+
+    bool hasEntry( TextureMetadataCache &cache, const char *aliasName, Ogre::uint32 width )
+    {
+        TextureMetadataCache::MetadataCacheEntry entry;
+        return cache.findMetadataCacheEntry( aliasName, entry ) && entry.width == width;
+    }
+
+    size_t getFileSize( const char *path )
+    {
+        std::ifstream file( path, std::ios::binary | std::ios::ate );
+        return file ? static_cast<size_t>( file.tellg() ) : 0u;
+    }
+
+    /// Keeps the first numBytes of the file, as if the app died while saving.
+    void truncateFile( const char *path, size_t numBytes )
+    {
+        std::vector<char> data( numBytes );
+        {
+            std::ifstream file( path, std::ios::binary );
+            file.read( &data[0], static_cast<std::streamsize>( numBytes ) );
+        }
+        std::ofstream file( path, std::ios::binary | std::ios::trunc );
+        file.write( &data[0], static_cast<std::streamsize>( numBytes ) );
+    }
+}  // namespace
+
+/// Every save appends a segment; lookups see the newest version of each entry.
+static void testAppend()
+{
+    remove( cCachePath );
+
+    TextureMetadataCache::MetadataCacheMap session;
+    session["a.png"] = makeEntry( "a.png", 64u );
+
+    TextureMetadataCache cache;
+    PRISM_CHECK( !cache.open( cCachePath ) );
+    cache.save( cCachePath, session );
+    PRISM_CHECK( cache.isOpen() && cache.getNumSegments() == 1u );
+
+    session["a.png"] = makeEntry( "a.png", 128u );
+    session["b.png"] = makeEntry( "b.png", 32u );
+    cache.save( cCachePath, session );
+    PRISM_CHECK( cache.getNumSegments() == 2u );
+    PRISM_CHECK( hasEntry( cache, "a.png", 128u ) );
+    PRISM_CHECK( hasEntry( cache, "b.png", 32u ) );
+}
+
+/// A file cut in the middle of its second segment keeps the first one, and
+/// the next save appends right after it.
+static void testTruncatedSegment()
+{
+    remove( cCachePath );
+
+    TextureMetadataCache::MetadataCacheMap session;
+    session["a.png"] = makeEntry( "a.png", 64u );
+
+    TextureMetadataCache cache;
+    cache.save( cCachePath, session );
+    const size_t oneSegmentSize = getFileSize( cCachePath );
+
+    session["b.png"] = makeEntry( "b.png", 32u );
+    cache.save( cCachePath, session );
+    cache.close();
+
+    truncateFile( cCachePath, oneSegmentSize + 8u );
+
+    PRISM_CHECK( cache.open( cCachePath ) );
+    PRISM_CHECK( cache.getNumSegments() == 1u );
+    PRISM_CHECK( hasEntry( cache, "a.png", 64u ) );
+    PRISM_CHECK( !hasEntry( cache, "b.png", 32u ) );
+
+    cache.save( cCachePath, session );
+    PRISM_CHECK( cache.getNumSegments() == 2u );
+    PRISM_CHECK( hasEntry( cache, "b.png", 32u ) );
+}
+
+/// A file whose only segment is cut, or that has none, is rejected; saving
+/// over it must write it from scratch instead of appending.
+static void testNoValidSegments()
+{
+    remove( cCachePath );
+
+    TextureMetadataCache::MetadataCacheMap session;
+    session["a.png"] = makeEntry( "a.png", 64u );
+
+    TextureMetadataCache cache;
+    cache.save( cCachePath, session );
+    cache.close();
+
+    // Just the FileHeader, which still claims one segment.
+    truncateFile( cCachePath, 16u );
+    PRISM_CHECK( !cache.open( cCachePath ) );
+    PRISM_CHECK( !cache.isOpen() && cache.getNumSegments() == 0u );
+
+    cache.save( cCachePath, session );
+    PRISM_CHECK( cache.isOpen() && cache.getNumSegments() == 1u );
+    PRISM_CHECK( hasEntry( cache, "a.png", 64u ) );
+
+    // Header & segment are there, but the header claims zero segments.
+    cache.close();
+    {
+        std::fstream file( cCachePath, std::ios::binary | std::ios::in | std::ios::out );
+        const Ogre::uint32 numSegments = 0u;
+        file.seekp( 8 );
+        file.write( reinterpret_cast<const char *>( &numSegments ), sizeof( numSegments ) );
+    }
+    PRISM_CHECK( !cache.open( cCachePath ) );
+
+    cache.save( cCachePath, session );
+    PRISM_CHECK( cache.getNumSegments() == 1u );
+    PRISM_CHECK( hasEntry( cache, "a.png", 64u ) );
+}
+
+int main()
+{
+    Ogre::LogManager logManager;
+    logManager.createLog( "TextureMetadataCacheTest.log", true, false, true );
+
+    testAppend();
+    testTruncatedSegment();
+    testNoValidSegments();
+
+    remove( cCachePath );
+    return PrismTest::exitCode();
+}
@@ -46,6 +46,9 @@ namespace Ogre
             ProfileSample *mRoot;
             ProfileSample *mCurrentSample;
             Timer         *mTimer;
+            /// OfflineProfiler::getMicroseconds at the time mTimer was created.
+            /// Adding it to our samples puts all threads on the same timeline.
+            uint64 mUsEpochOffset;
 
             uint64 mTotalAccumTime;
 
@@ -72,8 +75,11 @@ namespace Ogre
 
             void reset();
 
+            static void dumpSampleChromeTrace( const ProfileSample *sample, String &outJson,
+                                               int64 usTimeOffset, uint32 threadId );
+
         public:
-            PerThreadData( bool startPaused, size_t bytesPerPool );
+            PerThreadData( bool startPaused, size_t bytesPerPool, uint64 usEpochOffset );
             ~PerThreadData();
 
             void setPauseRequest( bool bPause );
@@ -84,6 +90,8 @@ namespace Ogre
 
             void dumpProfileResultsStr( String &outCsvStringPerFrame, String &outCsvStringAccum );
             void dumpProfileResults( const String &fullPathPerFrame, const String &fullPathAccum );
+
+            void dumpChromeTraceEventsStr( String &outJson, int64 usTimeOffset, uint32 threadId );
         };
 
         typedef FastArray<PerThreadData *> PerThreadDataArray;
@@ -96,6 +104,10 @@ namespace Ogre
 
         size_t mBytesPerPool;
 
+        /// steady_clock time (in microseconds) at which we were created.
+        /// See getMicroseconds.
+        uint64 mUsEpoch;
+
         String mOnShutdownPerFramePath;
         String mOnShutdownAccumPath;
 
@@ -149,6 +161,31 @@ namespace Ogre
         */
         void dumpProfileResults( const String &fullPathPerFrame, const String &fullPathAccum );
 
+        /** Appends all the samples collected so far, from all threads, as "complete" events
+            (ph = X) of the Trace Event Format used by chrome://tracing & Perfetto.
+            Unlike dumpProfileResults, the samples are not discarded.
+        @remarks
+            Only the events are written, each preceded by a comma, so that they can be merged
+            into a bigger trace. The caller must write the enclosing array and at least one
+            event before them. See dumpChromeTrace.
+        @param usTimeOffset
+            Added to all timestamps, to align them with another clock. See getMicroseconds.
+        @param firstThreadId
+            Each thread that collected samples gets a consecutive "tid", starting from this one.
+            A thread_name metadata event is written for each.
+        */
+        void dumpChromeTraceEventsStr( String &outJson, int64 usTimeOffset, uint32 firstThreadId );
+
+        /** Writes a .json file that can be opened in chrome://tracing or Perfetto.
+            See dumpChromeTraceEventsStr.
+        @param fullPath
+            Full path to the json file, extension included.
+        */
+        void dumpChromeTrace( const String &fullPath );
+
+        /// The clock samples are timestamped with. Thread safe.
+        uint64 getMicroseconds() const;
+
         /** Ogre will call dumpProfileResults for your on shutdown if you set these paths
         @param fullPathPerFrame
             Full path to csv without extension to generate where to dump the per-frame CSV data.
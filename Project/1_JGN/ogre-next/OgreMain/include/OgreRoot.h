@@ -875,6 +875,15 @@ namespace Ogre
         */
         bool _fireFrameEnded();
 
+        /** Adds a frame time sample to the stats returned by getFrameStats.
+        @remarks
+            Only needed if you run your own rendering loop instead of calling
+            renderOneFrame; call it once per frame after _updateAllRenderTargets.
+        @param timeMicroseconds
+            The time at which the frame ended, as returned by getTimer()->getMicroseconds()
+        */
+        void _addFrameStatsSample( uint64 timeMicroseconds );
+
         /** Gets the number of the next frame to be rendered.
         @remarks
             Note that this is 'next frame' rather than 'current frame' because
@@ -279,6 +279,25 @@ namespace Ogre
 
         typedef map<IdString, MetadataCacheEntry>::type MetadataCacheMap;
 
+        /** Lets the application keep the metadata cache in its own storage (e.g. a memory
+            mapped file) and answer queries on demand, instead of parsing everything upfront
+            via importTextureMetadataCache.
+            Entries in the regular cache (i.e. imported or updated from loaded textures)
+            take precedence over the ones returned by the source.
+        */
+        class MetadataCacheSource
+        {
+        public:
+            virtual ~MetadataCacheSource() {}
+
+            /// outEntry.aliasName does not need to be filled.
+            /// Returns false if the entry was not found.
+            virtual bool findMetadataCacheEntry( IdString name, MetadataCacheEntry &outEntry ) = 0;
+
+            /// The entry turned out to be out of date. It must no longer be returned.
+            virtual void removeMetadataCacheEntry( IdString name ) = 0;
+        };
+
         struct ResourceEntry
         {
             String      name;
@@ -570,7 +589,8 @@ namespace Ogre
 
         StagingTextureVec mTmpAvailableStagingTex;
 
-        MetadataCacheMap mMetadataCache;
+        MetadataCacheMap     mMetadataCache;
+        MetadataCacheSource *mMetadataCacheSource;
 
         typedef vector<AsyncTextureTicket *>::type AsyncTextureTicketVec;
         AsyncTextureTicketVec                      mAsyncTextureTickets;
@@ -1074,6 +1094,13 @@ namespace Ogre
                                          bool bCreateReservedPools );
         void exportTextureMetadataCache( String &outJson );
 
+        /// See MetadataCacheSource. Pointer can be null. Caller retains ownership.
+        void setMetadataCacheSource( MetadataCacheSource *source );
+        MetadataCacheSource *getMetadataCacheSource() const { return mMetadataCacheSource; }
+
+        /// Entries that were imported or updated from loaded textures during this session.
+        const MetadataCacheMap &getMetadataCache() const { return mMetadataCache; }
+
         void getMemoryStats( size_t &outTextureBytesCpu, size_t &outTextureBytesGpu,
                              size_t &outUsedStagingTextureBytes,
                              size_t &outAvailableStagingTextureBytes );
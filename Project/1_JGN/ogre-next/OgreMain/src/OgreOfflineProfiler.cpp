@@ -8,14 +8,24 @@
 #include "OgreRoot.h"
 #include "OgreTimer.h"
 
+#include <chrono>
 #include <fstream>
 
 namespace Ogre
 {
+    /// Unlike Ogre::Timer, steady_clock can be read from any thread
+    static uint64 getSteadyClockMicroseconds()
+    {
+        return static_cast<uint64>( std::chrono::duration_cast<std::chrono::microseconds>(
+                                        std::chrono::steady_clock::now().time_since_epoch() )
+                                        .count() );
+    }
+    //-----------------------------------------------------------------------------------
     OfflineProfiler::OfflineProfiler() :
         mPaused( false ),
         mTlsHandle( OGRE_TLS_INVALID_HANDLE ),
-        mBytesPerPool( sizeof( ProfileSample ) * 10000 )
+        mBytesPerPool( sizeof( ProfileSample ) * 10000 ),
+        mUsEpoch( getSteadyClockMicroseconds() )
     {
         Threads::CreateTls( &mTlsHandle );
     }
@@ -41,13 +51,15 @@ namespace Ogre
         mTlsHandle = OGRE_TLS_INVALID_HANDLE;
     }
     //-----------------------------------------------------------------------------------
-    OfflineProfiler::PerThreadData::PerThreadData( bool startPaused, size_t bytesPerPool ) :
+    OfflineProfiler::PerThreadData::PerThreadData( bool startPaused, size_t bytesPerPool,
+                                                   uint64 usEpochOffset ) :
         mPaused( startPaused ),
         mPauseRequest( startPaused ),
         mResetRequest( false ),
         mRoot( 0 ),
         mCurrentSample( 0 ),
         mTimer( OGRE_NEW Ogre::Timer() ),
+        mUsEpochOffset( usEpochOffset ),
         mTotalAccumTime( 0 ),
         mCurrMemoryPoolOffset( 0 ),
         mBytesPerPool( bytesPerPool )
@@ -205,7 +217,7 @@ namespace Ogre
     //-----------------------------------------------------------------------------------
     OfflineProfiler::PerThreadData *OfflineProfiler::allocatePerThreadData()
     {
-        PerThreadData *perThreadData = new PerThreadData( mPaused, mBytesPerPool );
+        PerThreadData *perThreadData = new PerThreadData( mPaused, mBytesPerPool, getMicroseconds() );
 
         mMutex.lock();
         mThreadData.push_back( perThreadData );
@@ -334,6 +346,66 @@ namespace Ogre
         }
     }
     //-----------------------------------------------------------------------------------
+    void OfflineProfiler::PerThreadData::dumpSampleChromeTrace( const ProfileSample *sample,
+                                                                String &outJson, int64 usTimeOffset,
+                                                                uint32 threadId )
+    {
+        outJson += ",\n{\"name\":\"";
+
+        // Escape what would break the JSON string. Written straight into outJson
+        // because escaping can make the name longer than any fixed buffer
+        const char *name = (const char *)sample->nameStr;
+        while( *name )
+        {
+            if( *name == '"' || *name == '\\' )
+                outJson += '\\';
+            outJson += (unsigned char)*name >= ' ' ? *name : ' ';
+            ++name;
+        }
+
+        char tmpBuffer[128];
+        LwString tmpStr( LwString::FromEmptyPointer( tmpBuffer, sizeof( tmpBuffer ) ) );
+        tmpStr.a( "\",\"ph\":\"X\",\"ts\":", (int64)sample->usStart + usTimeOffset );
+        tmpStr.a( ",\"dur\":", sample->usTaken, ",\"pid\":1,\"tid\":", threadId, "}" );
+        outJson += tmpStr.c_str();
+
+        FastArray<ProfileSample *>::const_iterator itor = sample->children.begin();
+        FastArray<ProfileSample *>::const_iterator endt = sample->children.end();
+
+        while( itor != endt )
+        {
+            dumpSampleChromeTrace( *itor, outJson, usTimeOffset, threadId );
+            ++itor;
+        }
+    }
+    //-----------------------------------------------------------------------------------
+    void OfflineProfiler::PerThreadData::dumpChromeTraceEventsStr( String &outJson,
+                                                                   int64 usTimeOffset,
+                                                                   uint32 threadId )
+    {
+        char tmpBuffer[256];
+        LwString tmpStr( LwString::FromEmptyPointer( tmpBuffer, sizeof( tmpBuffer ) ) );
+
+        tmpStr.a( ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":", threadId );
+        tmpStr.a( ",\"args\":{\"name\":\"Ogre profiler thread #", threadId, "\"}}" );
+        outJson += tmpStr.c_str();
+
+        // Our samples are relative to when our mTimer was created
+        usTimeOffset += static_cast<int64>( mUsEpochOffset );
+
+        mMutex.lock();
+        // Skip the root, it has no timings
+        FastArray<ProfileSample *>::const_iterator itor = mRoot->children.begin();
+        FastArray<ProfileSample *>::const_iterator endt = mRoot->children.end();
+
+        while( itor != endt )
+        {
+            dumpSampleChromeTrace( *itor, outJson, usTimeOffset, threadId );
+            ++itor;
+        }
+        mMutex.unlock();
+    }
+    //-----------------------------------------------------------------------------------
     void OfflineProfiler::setPaused( bool bPaused )
     {
         if( mPaused == bPaused )
@@ -425,6 +497,40 @@ namespace Ogre
         mMutex.unlock();
     }
     //-----------------------------------------------------------------------------------
+    void OfflineProfiler::dumpChromeTraceEventsStr( String &outJson, int64 usTimeOffset,
+                                                    uint32 firstThreadId )
+    {
+        mMutex.lock();
+
+        uint32 threadId = firstThreadId;
+
+        PerThreadDataArray::const_iterator itor = mThreadData.begin();
+        PerThreadDataArray::const_iterator endt = mThreadData.end();
+
+        while( itor != endt )
+        {
+            ( *itor )->dumpChromeTraceEventsStr( outJson, usTimeOffset, threadId );
+            ++threadId;
+            ++itor;
+        }
+
+        mMutex.unlock();
+    }
+    //-----------------------------------------------------------------------------------
+    void OfflineProfiler::dumpChromeTrace( const String &fullPath )
+    {
+        String json = "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+                      "\"args\":{\"name\":\"Ogre\"}}";
+        dumpChromeTraceEventsStr( json, 0, 1u );
+        json += "\n]\n";
+
+        std::ofstream outFile( fullPath.c_str(), std::ios::binary | std::ios::out );
+        outFile.write( json.c_str(), static_cast<std::streamsize>( json.size() ) );
+        outFile.close();
+    }
+    //-----------------------------------------------------------------------------------
+    uint64 OfflineProfiler::getMicroseconds() const { return getSteadyClockMicroseconds() - mUsEpoch; }
+    //-----------------------------------------------------------------------------------
     void OfflineProfiler::setDumpPathsOnShutdown( const String &fullPathPerFrame,
                                                   const String &fullPathAccum )
     {
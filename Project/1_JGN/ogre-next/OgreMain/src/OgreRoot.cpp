@@ -1077,6 +1077,11 @@ namespace Ogre
     //-----------------------------------------------------------------------
     void Root::resetFrameStats() { mFrameStats->reset( mTimer->getMicroseconds() ); }
     //-----------------------------------------------------------------------
+    void Root::_addFrameStatsSample( uint64 timeMicroseconds )
+    {
+        mFrameStats->addSample( timeMicroseconds );
+    }
+    //-----------------------------------------------------------------------
     void Root::startRendering()
     {
         assert( mActiveRenderer != 0 );
@@ -4724,7 +4724,14 @@ namespace Ogre
         while( !exitThread )
         {
             mWorkerThreadsBarrier->sync();
-            exitThread = updateWorkerThreadImpl( threadIdx );
+            {
+#if OGRE_PROFILING == OGRE_PROFILING_REMOTERY || OGRE_PROFILING == OGRE_PROFILING_INTERNAL_OFFLINE
+                // Only these two profilers are thread safe. Lets captures show how the
+                // work is spread across the worker threads.
+                OgreProfile( "SceneManager worker" );
+#endif
+                exitThread = updateWorkerThreadImpl( threadIdx );
+            }
             mWorkerThreadsBarrier->sync();
         }
 
@@ -119,6 +119,7 @@ namespace Ogre
 #else
         mStagingTextureMaxBudgetBytes( 128u * 1024u * 1024u ),
 #endif
+        mMetadataCacheSource( 0 ),
         mDelayListenerCalls( false ),
         mIgnoreScheduledTasks( false ),
 #ifdef OGRE_PROFILING_TEXTURES
@@ -920,16 +921,25 @@ namespace Ogre
     bool TextureGpuManager::applyMetadataCacheTo( TextureGpu *texture )
     {
         bool retVal = false;
+        MetadataCacheEntry cacheEntry;
         MetadataCacheMap::const_iterator itor = mMetadataCache.find( texture->getName() );
         if( itor != mMetadataCache.end() )
         {
-            MetadataCacheEntry cacheEntry = itor->second;
+            cacheEntry = itor->second;
+            retVal = true;
+        }
+        else if( mMetadataCacheSource )
+        {
+            retVal = mMetadataCacheSource->findMetadataCacheEntry( texture->getName(), cacheEntry );
+        }
+
+        if( retVal )
+        {
             texture->setResolution( cacheEntry.width, cacheEntry.height, cacheEntry.depthOrSlices );
             texture->setNumMipmaps( cacheEntry.numMipmaps );
             texture->setTextureType( cacheEntry.textureType );
             texture->setPixelFormat( cacheEntry.pixelFormat );
             texture->setTexturePoolId( cacheEntry.poolId );
-            retVal = true;
         }
         return retVal;
     }
@@ -958,6 +968,8 @@ namespace Ogre
     void TextureGpuManager::_removeMetadataCacheEntry( TextureGpu *texture )
     {
         mMetadataCache.erase( texture->getName() );
+        if( mMetadataCacheSource )
+            mMetadataCacheSource->removeMetadataCacheEntry( texture->getName() );
     }
     //-----------------------------------------------------------------------------------
     void TextureGpuManager::importTextureMetadataCache( const String &filename, const char *jsonString,
@@ -1350,6 +1362,11 @@ namespace Ogre
             mTextureGpuManagerListener = &sDefaultTextureGpuManagerListener;
     }
     //-----------------------------------------------------------------------------------
+    void TextureGpuManager::setMetadataCacheSource( MetadataCacheSource *source )
+    {
+        mMetadataCacheSource = source;
+    }
+    //-----------------------------------------------------------------------------------
     void TextureGpuManager::setStagingTextureMaxBudgetBytes( size_t stagingTextureMaxBudgetBytes )
     {
         mStagingTextureMaxBudgetBytes = stagingTextureMaxBudgetBytes;
@@ -79,6 +79,15 @@ public:
         if (vkCreateQueryPool(device, &statPoolInfo, nullptr, &queryPoolStats) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create statistics query pool!");
         }
+
+        // 3. Indirect Count Draw 함수 (매 Draw마다 찾지 않도록 한 번만 조회, 1.2 코어 -> KHR 확장 순)
+        pfnCmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCount)vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCount");
+        if (!pfnCmdDrawIndexedIndirectCount) {
+            pfnCmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCount)vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR");
+        }
+        if (!pfnCmdDrawIndexedIndirectCount) {
+            throw std::runtime_error("vkCmdDrawIndexedIndirectCount is not available! (VK_KHR_draw_indirect_count)");
+        }
     }
 
     void cleanup() {
@@ -107,6 +116,11 @@ public:
         frameDrawCalls++; frameInstanceCount += instC;
         vkCmdDraw(cb, vc, instC, fv, fInst);
     }
+    // [추가] GPU Culling용 Indirect Draw (인스턴스 수는 GPU가 정하므로 Draw Call만 셈)
+    void CmdDrawIndexedIndirectCount(VkCommandBuffer cb, VkBuffer buf, VkDeviceSize off, VkBuffer countBuf, VkDeviceSize countOff, uint32_t maxDraws, uint32_t stride) {
+        frameDrawCalls++;
+        pfnCmdDrawIndexedIndirectCount(cb, buf, off, countBuf, countOff, maxDraws, stride);
+    }
     void CmdDispatch(VkCommandBuffer cb, uint32_t x, uint32_t y, uint32_t z) {
         frameDispatchCalls++; vkCmdDispatch(cb, x, y, z);
     }
@@ -213,6 +227,7 @@ private:
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkQueryPool queryPoolTimestamp = VK_NULL_HANDLE;
     VkQueryPool queryPoolStats = VK_NULL_HANDLE;
+    PFN_vkCmdDrawIndexedIndirectCount pfnCmdDrawIndexedIndirectCount = nullptr;
     float timestampPeriod = 1.0f;
     uint32_t maxQueries = 0;
     uint32_t currentQueryIdx = 0;
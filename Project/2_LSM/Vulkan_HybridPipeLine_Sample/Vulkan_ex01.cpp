@@ -28,6 +28,7 @@
 #include <array>
 #include <optional>
 #include <set>
+#include <map>
 #include <unordered_map>
 
 const uint32_t WIDTH = 1280;
@@ -45,7 +46,8 @@ const std::vector<const char*> deviceExtensions = {
     VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
     VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
     VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
-    VK_EXT_MEMORY_BUDGET_EXTENSION_NAME // <--- [필수 추가] 이거 없으면 VRAM 측정 불가
+    VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, // <--- [필수 추가] 이거 없으면 VRAM 측정 불가
+    VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME // [추가] GPU Culling 결과로 vkCmdDrawIndexedIndirectCount 사용
 };
 
 #ifdef NDEBUG
@@ -174,6 +176,7 @@ struct GeometryData {
     VkAccelerationStructureKHR blas;
     VkBuffer blasBuffer;
     VkDeviceMemory blasMemory;
+    float boundsRadius; // [추가] 모델 원점 기준 바운딩 스피어 반지름 (GPU Culling용)
 };
 
 // 쉐이더(GLSL)와 데이터 레이아웃을 맞추기 위한 구조체
@@ -194,6 +197,47 @@ public:
         cleanup();
     }
 
+    // [추가] 커맨드 라인 옵션 (TLAS 업데이트 성능 비교용)
+    // --instances=N               : 움직이는 돼지 저금통 개수 (2000 / 20000 / 200000 비교)
+    // --tlas-mode=update|rebuild  : update(기본) = 대부분 Refit, rebuild = 매 프레임 전체 빌드
+    // --tlas-rebuild-interval=N   : N 프레임마다 강제 전체 빌드 (0이면 스케줄 끔)
+    // --tlas-rebuild-distance=F   : 마지막 빌드 이후 인스턴스가 F 이상 이동하면 전체 빌드
+    // --gpu-cull=0|1              : Raster 패스 GPU 절두체 컬링 (0이면 전부 그림, 비교용)
+    // --composite=offscreen|copy  : offscreen(기본) = storageImage에 직접 래스터, copy = 기존 2번 복사
+    void parseArgs(int argc, char** argv) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            std::string value = arg.substr(arg.find('=') + 1);
+
+            if (arg.rfind("--instances=", 0) == 0) {
+                dynamicObjectTarget = (uint32_t)std::stoul(value);
+            }
+            else if (arg.rfind("--tlas-mode=", 0) == 0) {
+                tlasUpdateEnabled = (value != "rebuild");
+            }
+            else if (arg.rfind("--tlas-rebuild-interval=", 0) == 0) {
+                tlasRebuildInterval = (uint32_t)std::stoul(value);
+            }
+            else if (arg.rfind("--tlas-rebuild-distance=", 0) == 0) {
+                tlasRebuildDistance = std::stof(value);
+            }
+            else if (arg.rfind("--composite=", 0) == 0) {
+                offscreenComposite = (value != "copy");
+            }
+            else if (arg.rfind("--gpu-cull=", 0) == 0) {
+                gpuCullingEnabled = (value != "0");
+            }
+            else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+            }
+        }
+
+        std::cout << "TLAS Mode: " << (tlasUpdateEnabled ? "update" : "rebuild")
+            << ", Rebuild Interval: " << tlasRebuildInterval
+            << ", Rebuild Distance: " << tlasRebuildDistance
+            << ", Dynamic Instances: " << dynamicObjectTarget << std::endl;
+    }
+
 private:
     GLFWwindow* window;
     Camera camera;
@@ -277,6 +321,12 @@ private:
 
     // --- [추가] 래스터화(Rasterization) 관련 변수들 ---
     VkRenderPass renderPass;
+
+    // [최적화] Offscreen 합성 모드: 래스터가 스왑체인 대신 storageImage에 바로 그리고,
+    // RT가 그 위에 쓴 뒤 스왑체인으로 한 번만 복사합니다. (기존: 스왑체인 <-> storageImage 2번 복사)
+    bool offscreenComposite = true; // --composite=copy|offscreen
+    VkRenderPass offscreenRenderPass;
+    VkFramebuffer offscreenFramebuffer;
     VkPipelineLayout graphicsPipelineLayout;
     VkPipeline graphicsPipeline;
 
@@ -324,10 +374,106 @@ private:
 
 
     // [추가] TLAS 빌드용 스크래치 버퍼 (매 프레임 재사용)
+    // [수정] Build/Update 둘 다 쓰므로 크기는 max(buildScratchSize, updateScratchSize)
     VkBuffer tlasScratchBuffer;
     VkDeviceMemory tlasScratchBufferMemory;
     VkDeviceAddress tlasScratchBufferAddress;
 
+    // -------- [TLAS Update(Refit) 관련] --------
+
+    // [최적화] 정적 물체는 앞쪽, 움직이는 물체는 뒤쪽의 연속된 인스턴스 구간에 모읍니다.
+    // Compute Shader는 [dynamicObjectFirst, dynamicObjectFirst + dynamicObjectCount) 구간만 돌립니다.
+    uint32_t dynamicObjectTarget = 20000; // --instances=N
+    uint32_t dynamicObjectFirst = 0;
+    uint32_t dynamicObjectCount = 0;
+
+    // [최적화] 대부분의 프레임은 MODE_UPDATE(Refit)로 처리하고, 아래 조건일 때만 전체 빌드합니다.
+    // 1) 스케줄: tlasRebuildInterval 프레임마다
+    // 2) 품질 휴리스틱: 마지막 전체 빌드 이후 인스턴스 최대 이동 거리가 tlasRebuildDistance 초과
+    //    (Refit된 노드 AABB는 자식이 움직인 만큼만 커지므로, 최대 이동 거리가 BV 팽창의 상한입니다)
+    bool tlasUpdateEnabled = true;
+    uint32_t tlasRebuildInterval = 120;
+    float tlasRebuildDistance = 2.0f;
+    uint32_t tlasFramesSinceRebuild = 0;
+    bool tlasRebuildRequested = false; // 품질 휴리스틱이 요청
+    bool tlasForceRebuild = true; // 첫 프레임(기준 위치 기록), 순간이동/스폰 등 명시적 요청
+
+    // 전체 빌드 세대 번호. 통계 슬롯이 현재 세대에서 측정된 값일 때만 휴리스틱에 사용합니다.
+    uint32_t tlasBuildGeneration = 0;
+    uint32_t tlasStatsGeneration[MAX_FRAMES_IN_FLIGHT] = {};
+
+    // 마지막 전체 빌드 시점의 인스턴스 위치 (Compute 전용, 오브젝트 인덱스 기준)
+    VkBuffer tlasRefPositionBuffer;
+    VkDeviceMemory tlasRefPositionBufferMemory;
+
+    // 프레임 슬롯별 최대 이동 거리 (float 비트를 uint로 atomicMax, CPU에서 읽음)
+    VkBuffer tlasStatsBuffer;
+    VkDeviceMemory tlasStatsBufferMemory;
+    uint32_t* tlasStatsMapped = nullptr;
+
+    // -------- [GPU Culling 관련] --------
+
+    // [최적화] Raster 패스 전에 Compute로 인스턴스별 절두체 컬링 -> 보이는 것만 Indirect Draw
+    bool gpuCullingEnabled = true;
+    glm::mat4 rasterViewProj = glm::mat4(1.0f); // updateRasterUniformBuffer에서 갱신
+
+    VkPipeline cullPipeline;
+    VkPipelineLayout cullPipelineLayout;
+    VkDescriptorSetLayout cullDescriptorSetLayout;
+    VkDescriptorPool cullDescriptorPool;
+    VkDescriptorSet cullDescriptorSet;
+
+    // 오브젝트별 컬링 정보 (배치 인덱스, 반지름, 배치 시작 인덱스)
+    VkBuffer cullObjectBuffer;
+    VkDeviceMemory cullObjectBufferMemory;
+
+    // 배치별 VkDrawIndexedIndirectCommand (매 프레임 템플릿에서 복사 -> Compute가 instanceCount 채움)
+    VkBuffer drawCommandTemplateBuffer;
+    VkDeviceMemory drawCommandTemplateBufferMemory;
+    VkBuffer drawCommandBuffer;
+    VkDeviceMemory drawCommandBufferMemory;
+
+    // 배치별 Draw 개수 (0/1) + 보이는 오브젝트 인덱스 목록
+    VkBuffer drawCountBuffer;
+    VkDeviceMemory drawCountBufferMemory;
+    VkBuffer visibleIndexBuffer;
+    VkDeviceMemory visibleIndexBufferMemory;
+
+    // -------- [Upload Ring 관련] --------
+
+    // [최적화] GPU 버퍼는 전부 Device Local에 두고, CPU가 런타임에 바꾸는 값(생성/순간이동/색 변경)은
+    // 프레임 슬롯별 Staging Ring -> vkCmdCopyBuffer로 전달합니다. (Host Visible 버퍼를 직접 쓰면 GPU 읽기가 느리고,
+    // 아직 GPU가 읽는 중인 메모리를 덮어쓰게 됨)
+    // 링은 MAX_FRAMES_IN_FLIGHT 개의 슬롯으로 나뉘고, 슬롯은 그 프레임의 펜스를 기다린 뒤에만 다시 씁니다.
+    VkDeviceSize uploadRingFrameSize = 4 * 1024 * 1024; // 프레임 슬롯당 4MB
+    VkBuffer uploadRingBuffer;
+    VkDeviceMemory uploadRingBufferMemory;
+    uint8_t* uploadRingMapped = nullptr;
+
+    // 아직 GPU로 보내지 않은 업로드 (데이터는 CPU 쪽 pendingUploadData에 모아 두고, 기록 시점에 링으로 복사)
+    struct PendingUpload {
+        VkBuffer dstBuffer;
+        VkDeviceSize dstOffset;
+        VkDeviceSize size;
+        size_t dataOffset;        // pendingUploadData 안의 위치
+        VkDeviceSize ringOffset;  // flush 때 채워짐
+    };
+    std::vector<PendingUpload> pendingUploads;
+    std::vector<uint8_t> pendingUploadData;
+    // 같은 영역을 한 프레임에 여러 번 쓰면 마지막 값만 남기기 위한 인덱스 (dstBuffer, dstOffset) -> pendingUploads
+    std::map<std::pair<VkBuffer, VkDeviceSize>, size_t> pendingUploadLookup;
+
+    // 콘솔 출력용 카운터
+    uint32_t uploadRegionCount = 0;
+    VkDeviceSize uploadByteCount = 0;
+
+    // 콘솔 출력용 카운터
+    uint32_t tlasUpdateCount = 0;
+    uint32_t tlasScheduledRebuildCount = 0;
+    uint32_t tlasHeuristicRebuildCount = 0;
+    uint32_t tlasForcedRebuildCount = 0; // --tlas-mode=rebuild, 첫 프레임, 순간이동/스폰
+    float tlasStatsTimer = 0.0f;
+
     // -------- [Model Instancing 관련] --------
 
     // [추가] 각 오브젝트가 몇 번째 지오메트리(모델)를 사용하는지 저장하는 리스트
@@ -388,6 +534,11 @@ private:
                 app->isLightOn = !app->isLightOn;
                 std::cout << "Light Toggled: " << (app->isLightOn ? "ON" : "OFF") << std::endl;
             }
+
+            // [추가] Upload Ring 사용 예시: C = 색 변경, T = 순간이동 (움직이는 물체 중 일부)
+            if (key == GLFW_KEY_C || key == GLFW_KEY_T) {
+                app->shuffleDynamicObjects(key == GLFW_KEY_T);
+            }
         }
         else if (action == GLFW_RELEASE) {
             app->keys[key] = false;
@@ -525,31 +676,27 @@ private:
         geoData.vertexCount = vertices.size();
         geoData.indexCount = indices.size();
 
+        // [추가] GPU Culling용 바운딩 스피어 (원점 기준, 인스턴스 위치 = 스피어 중심)
+        geoData.boundsRadius = 0.0f;
+        for (const auto& v : vertices) {
+            geoData.boundsRadius = std::max(geoData.boundsRadius, glm::length(v.pos));
+        }
+
+        // [수정] Host Visible -> Device Local (Staging 경유 1회 업로드)
         VkDeviceSize vertexBufferSize = sizeof(Vertex) * vertices.size();
-        createBuffer(vertexBufferSize,
+        createDeviceLocalBuffer(vertices.data(), vertexBufferSize,
             VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
             VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
             geoData.vertexBuffer, geoData.vertexMemory);
 
-        void* data;
-        vkMapMemory(device, geoData.vertexMemory, 0, vertexBufferSize, 0, &data);
-        memcpy(data, vertices.data(), vertexBufferSize);
-        vkUnmapMemory(device, geoData.vertexMemory);
-
         VkDeviceSize indexBufferSize = sizeof(uint32_t) * indices.size();
-        createBuffer(indexBufferSize,
+        createDeviceLocalBuffer(indices.data(), indexBufferSize,
             VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
             VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
             geoData.indexBuffer, geoData.indexMemory);
 
-        vkMapMemory(device, geoData.indexMemory, 0, indexBufferSize, 0, &data);
-        memcpy(data, indices.data(), indexBufferSize);
-        vkUnmapMemory(device, geoData.indexMemory);
-
         return geoData;
     }
 
@@ -568,6 +715,7 @@ private:
         // 2. 렌더링 리소스 (RenderPass, Depth)
         createDepthResources();
         createRenderPass();
+        createOffscreenRenderPass(); // [추가] storageImage에 직접 그리는 Render Pass
         createDepthSampler();
         createFramebuffers();
 
@@ -586,11 +734,14 @@ private:
         createBottomLevelAS();
         createObjDescriptionBuffer();
         createTopLevelAS(); // 여기서 instanceBuffer가 생성됨!
+        createCullingResources(); // [추가] GPU Culling 버퍼 (renderBatches 필요)
 
         // 3-4. RT용 캔버스 생성
         createStorageImage();
+        createOffscreenFramebuffer(); // [추가] storageImage + Depth
         createInstanceColorBuffer();
         createUniformBuffers();
+        createUploadRing(); // [추가] 런타임 CPU -> GPU 부분 업데이트용 Staging Ring
 
         // =========================================================
         // [중요] 4. 파이프라인 및 디스크립터 (버퍼가 다 있는 상태에서 연결)
@@ -599,6 +750,7 @@ private:
         // 4-1. Compute 파이프라인 (SSBO + InstanceBuffer 연결)
         // 이제 objectSSBO와 instanceBuffer가 모두 존재하므로 안전함
         createComputePipeline();
+        createCullPipeline(); // [추가] GPU Culling (SSBO + Indirect 버퍼 연결)
 
         // 4-2. Raster 파이프라인 (SSBO 연결)
         createRasterDescriptorSetLayout();
@@ -742,15 +894,17 @@ private:
             false
             });
 
-        // 2. 돼지 저금통 군단 생성 (예: 2,000마리)
+        // 2. 돼지 저금통 군단 생성 (기본 20,000마리, --instances=N 으로 조절)
+        // [수정] 40 x 50 한 층(2,000마리)씩 위로 쌓아서 dynamicObjectTarget 개수를 채웁니다.
         int countX = 40;
-        int countY = 10;
         int countZ = 50;
+        int countY = std::max(1, (int)((dynamicObjectTarget + countX * countZ - 1) / (countX * countZ)));
         float spacing = 0.5f;
+        uint32_t spawned = 0;
 
         for (int x = 0; x < countX; x++) {
             for (int y = 0; y < countY; y++) {
-                for (int z = 0; z < countZ; z++) {
+                for (int z = 0; z < countZ && spawned < dynamicObjectTarget; z++, spawned++) {
                     objects.push_back({
                         /*"models/cube.obj",*/
                         "models/PiggyBank.obj",
@@ -789,16 +943,28 @@ private:
 
 
         // [핵심 추가] 모델별로 정렬 (Sorting)
+        // [최적화] 0순위: 정적 물체를 앞으로, 움직이는 물체를 뒤로 (Compute/TLAS 인스턴스 구간 분리)
         // 1순위: Raster 물체끼리 모으기 (그리기 효율 위해)
         // 2순위: 같은 모델(Path)끼리 모으기
         std::sort(objects.begin(), objects.end(), [](const ObjectInstance& a, const ObjectInstance& b) {
+            if (a.isDynamic != b.isDynamic) {
+                return a.isDynamic < b.isDynamic; // false(Static)가 앞으로 오도록
+            }
             if (a.isRaster != b.isRaster) {
                 return a.isRaster > b.isRaster; // true(Raster)가 앞으로 오도록
             }
             return a.modelPath < b.modelPath; // 같은 속성이라면 모델 이름순 정렬
             });
 
-        std::cout << "Scene Objects Sorted" << std::endl;
+        // [추가] 움직이는 물체 구간 계산 (정렬 덕분에 항상 맨 뒤에 연속으로 존재)
+        auto firstDynamic = std::find_if(objects.begin(), objects.end(), [](const ObjectInstance& o) {
+            return o.isDynamic;
+            });
+        dynamicObjectFirst = (uint32_t)(firstDynamic - objects.begin());
+        dynamicObjectCount = (uint32_t)objects.size() - dynamicObjectFirst;
+
+        std::cout << "Scene Objects Sorted (Static: " << dynamicObjectFirst
+            << ", Dynamic: " << dynamicObjectCount << ")" << std::endl;
 
     }
 
@@ -832,6 +998,16 @@ private:
 
     void drawFrame() {
         vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+
+        // [추가] 이 프레임 슬롯이 마지막으로 측정한 최대 이동 거리 확인 (MAX_FRAMES_IN_FLIGHT 프레임 전 결과)
+        // 그 사이에 전체 빌드가 있었다면 기준 위치가 바뀌었으므로 무시합니다.
+        if (tlasStatsGeneration[currentFrame] == tlasBuildGeneration) {
+            float maxDisplacement;
+            memcpy(&maxDisplacement, &tlasStatsMapped[currentFrame], sizeof(float));
+            if (maxDisplacement > tlasRebuildDistance) {
+                tlasRebuildRequested = true;
+            }
+        }
         uint32_t imageIndex;
         VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
 
@@ -854,7 +1030,9 @@ private:
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
         VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+        // [수정] Offscreen 합성 모드에서는 스왑체인 이미지를 처음 건드리는 것이 마지막 복사(Transfer)입니다.
+        // 그 전의 Compute/Raster/RT는 이미지 획득을 기다리지 않고 먼저 시작할 수 있습니다.
+        VkPipelineStageFlags waitStages[] = { offscreenComposite ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
         submitInfo.waitSemaphoreCount = 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
@@ -899,6 +1077,25 @@ private:
         //}
         profiler.updateAndPrintConsole();
 
+        // [추가] TLAS Update / Rebuild 비율 출력 (2초마다)
+        tlasStatsTimer += deltaTime;
+        if (tlasStatsTimer > 2.0f) {
+            std::cout << "[TLAS] Update: " << tlasUpdateCount
+                << ", Rebuild (Schedule): " << tlasScheduledRebuildCount
+                << ", Rebuild (Heuristic): " << tlasHeuristicRebuildCount
+                << ", Rebuild (Forced): " << tlasForcedRebuildCount << std::endl;
+            tlasUpdateCount = tlasScheduledRebuildCount = tlasHeuristicRebuildCount = tlasForcedRebuildCount = 0;
+            tlasStatsTimer = 0.0f;
+
+            // [추가] Upload Ring으로 보낸 부분 업데이트 양 (있을 때만)
+            if (uploadRegionCount > 0) {
+                std::cout << "[Upload] Regions: " << uploadRegionCount
+                    << ", Bytes: " << uploadByteCount << std::endl;
+                uploadRegionCount = 0;
+                uploadByteCount = 0;
+            }
+        }
+
 
         currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
@@ -944,15 +1141,57 @@ private:
         // Phase 0: Compute Simulation (물리 연산)
         // 설명: GPU에서 물체의 위치와 속도를 계산하고, SSBO와 TLAS Instance Buffer를 업데이트합니다.
         // ==========================================================================================
+        // [추가] 이번 프레임 TLAS를 전체 빌드할지 Refit할지 결정
+        bool scheduledRebuild = tlasRebuildInterval > 0 && tlasFramesSinceRebuild + 1 >= tlasRebuildInterval;
+        bool forcedRebuild = !tlasUpdateEnabled || tlasForceRebuild;
+        bool rebuildTLAS = forcedRebuild || tlasRebuildRequested || scheduledRebuild;
+
+        if (rebuildTLAS) {
+            // [수정] 여러 조건이 겹치면 강제 > 휴리스틱 > 스케줄 순으로 하나만 집계
+            if (forcedRebuild) tlasForcedRebuildCount++;
+            else if (tlasRebuildRequested) tlasHeuristicRebuildCount++;
+            else tlasScheduledRebuildCount++;
+
+            tlasBuildGeneration++;
+            tlasFramesSinceRebuild = 0;
+            tlasRebuildRequested = false;
+            tlasForceRebuild = false;
+        }
+        else {
+            tlasUpdateCount++;
+            tlasFramesSinceRebuild++;
+        }
+        tlasStatsGeneration[currentFrame] = tlasBuildGeneration;
+
+        // [추가] CPU가 이번 프레임에 요청한 부분 업데이트(생성/순간이동/색 변경)를 Compute 전에 반영
+        flushPendingUploads(commandBuffer);
+
         profiler.beginSection(commandBuffer, "0. Compute Sim");
 
+        // [추가] 이 프레임 슬롯의 최대 이동 거리 초기화 (Transfer -> Compute)
+        vkCmdFillBuffer(commandBuffer, tlasStatsBuffer, sizeof(uint32_t) * currentFrame, sizeof(uint32_t), 0);
+
+        VkMemoryBarrier clearBarrier{};
+        clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSet, 0, nullptr);
 
-        struct ComputePush { float dt; float time; int count; } push;
+        // [수정] 움직이는 물체 구간만 처리 + 전체 빌드 프레임이면 기준 위치 갱신
+        struct ComputePush { float dt; float time; int count; int first; int resetReference; int statsSlot; } push;
         push.dt = 0.016f; // 고정 델타 타임 (실제로는 변수로 받으세요)
         push.time = (float)glfwGetTime();
         push.count = (int)objects.size();
+        push.first = (int)dynamicObjectFirst;
+        push.resetReference = rebuildTLAS ? 1 : 0;
+        push.statsSlot = (int)currentFrame;
 
         vkCmdPushConstants(commandBuffer, computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
 
@@ -961,13 +1200,33 @@ private:
 
         // [수정 1] Compute Dispatch -> profiler 래퍼 함수 사용
         // 기존: vkCmdDispatch(commandBuffer, (uint32_t)(objects.size() + 255) / 256, 1, 1);
-        profiler.CmdDispatch(commandBuffer, (uint32_t)(objects.size() + 255) / 256, 1, 1);
+        // [최적화] 정적 물체 구간은 건너뛰고 움직이는 물체 개수만큼만 디스패치
+        if (dynamicObjectCount > 0) {
+            profiler.CmdDispatch(commandBuffer, (dynamicObjectCount + 255) / 256, 1, 1);
+        }
+
+        // [추가] Compute(쓰기) -> Host(읽기): 펜스 대기 후 CPU가 최대 이동 거리를 읽을 수 있도록
+        VkBufferMemoryBarrier statsBarrier{};
+        statsBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        statsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        statsBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        statsBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        statsBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        statsBarrier.buffer = tlasStatsBuffer;
+        statsBarrier.offset = sizeof(uint32_t) * currentFrame;
+        statsBarrier.size = sizeof(uint32_t);
+
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT,
+            0, 0, nullptr, 1, &statsBarrier, 0, nullptr);
 
         profiler.endSection(commandBuffer); // Compute 끝
 
         // ==========================================================================================
-        // Phase 0.5: GPU-Driven TLAS Rebuild (가속 구조 업데이트)
-        // 설명: Compute Shader가 수정한 Instance Buffer를 바탕으로, GPU가 TLAS를 다시 짓습니다.
+        // Phase 0.5: GPU-Driven TLAS Update / Rebuild (가속 구조 업데이트)
+        // 설명: Compute Shader가 수정한 Instance Buffer를 바탕으로, GPU가 TLAS를 Refit(UPDATE)합니다.
+        //       스케줄/휴리스틱이 걸린 프레임에만 전체 빌드(BUILD)로 BVH 품질을 회복합니다.
         // ==========================================================================================
         profiler.beginSection(commandBuffer, "0.5 TLAS Build");
 
@@ -980,8 +1239,10 @@ private:
         // 기존 코드 에러 수정: BUILD_READ_BIT_KHR 대신 READ_BIT_KHR 사용
         buildBarrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
 
+        // [수정] 이전 프레임의 레이 트레이싱이 TLAS 읽기를 마친 뒤에 덮어써야 합니다. (WAR)
+        // UPDATE는 같은 TLAS를 읽고 쓰므로(In-place) 특히 중요합니다.
         vkCmdPipelineBarrier(commandBuffer,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
             VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
             0, 1, &buildBarrier, 0, nullptr, 0, nullptr);
 
@@ -998,9 +1259,18 @@ private:
         VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
         buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
         buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-        buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-        // [중요] 업데이트가 아니라 '전체 빌드(BUILD)' 모드 사용 (구조가 많이 바뀌므로 안전함)
-        buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+        // [수정] createTopLevelAS와 플래그가 같아야 UPDATE가 가능합니다 (ALLOW_UPDATE)
+        buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+            VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+        // [최적화] 평소에는 'UPDATE(Refit)' 모드: BVH 토폴로지는 그대로 두고 AABB만 다시 계산
+        // 전체 빌드 프레임에만 'BUILD' 모드로 BVH를 새로 짓습니다.
+        if (rebuildTLAS) {
+            buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+        }
+        else {
+            buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+            buildInfo.srcAccelerationStructure = topLevelAS; // In-place Refit (src == dst)
+        }
         buildInfo.dstAccelerationStructure = topLevelAS; // 기존 TLAS 덮어쓰기
         buildInfo.geometryCount = 1;
         buildInfo.pGeometries = &geometry;
@@ -1030,6 +1300,72 @@ private:
 
         profiler.endSection(commandBuffer); // TLAS Build 끝
 
+        // ==========================================================================================
+        // Phase 0.7: GPU Culling (인스턴스별 절두체 컬링)
+        // 설명: 보이는 인스턴스만 골라 visibleIndexBuffer에 모으고, 배치별 Indirect Draw 명령을 채웁니다.
+        //       Raster 패스의 버텍스 작업량이 전체 인스턴스 수가 아니라 '보이는' 인스턴스 수에 비례하게 됩니다.
+        // ==========================================================================================
+        profiler.beginSection(commandBuffer, "0.7 GPU Cull");
+
+        // [Barrier] 이전 프레임의 Indirect/Vertex 읽기가 끝난 뒤에 덮어써야 합니다. (WAR)
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+        // Draw 명령 초기화 (instanceCount = 0) + Draw 개수 0으로 초기화
+        VkBufferCopy drawCommandCopy{ 0, 0, sizeof(VkDrawIndexedIndirectCommand) * renderBatches.size() };
+        vkCmdCopyBuffer(commandBuffer, drawCommandTemplateBuffer, drawCommandBuffer, 1, &drawCommandCopy);
+        vkCmdFillBuffer(commandBuffer, drawCountBuffer, 0, VK_WHOLE_SIZE, 0);
+
+        // [Barrier] Transfer(초기화) + Compute Sim(SSBO 쓰기) -> Cull(읽기/쓰기)
+        VkMemoryBarrier cullInputBarrier{};
+        cullInputBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cullInputBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        cullInputBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &cullInputBarrier, 0, nullptr, 0, nullptr);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSet, 0, nullptr);
+
+        // 절두체 평면 추출 (Gribb-Hartmann, Vulkan 깊이 0~1 기준)
+        struct CullPush { glm::vec4 planes[6]; int count; int enabled; } cullPush;
+        glm::vec4 row0(rasterViewProj[0][0], rasterViewProj[1][0], rasterViewProj[2][0], rasterViewProj[3][0]);
+        glm::vec4 row1(rasterViewProj[0][1], rasterViewProj[1][1], rasterViewProj[2][1], rasterViewProj[3][1]);
+        glm::vec4 row2(rasterViewProj[0][2], rasterViewProj[1][2], rasterViewProj[2][2], rasterViewProj[3][2]);
+        glm::vec4 row3(rasterViewProj[0][3], rasterViewProj[1][3], rasterViewProj[2][3], rasterViewProj[3][3]);
+        cullPush.planes[0] = row3 + row0; // Left
+        cullPush.planes[1] = row3 - row0; // Right
+        cullPush.planes[2] = row3 + row1; // Bottom
+        cullPush.planes[3] = row3 - row1; // Top
+        cullPush.planes[4] = row2;        // Near
+        cullPush.planes[5] = row3 - row2; // Far
+        for (auto& plane : cullPush.planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        cullPush.count = (int)objects.size();
+        cullPush.enabled = gpuCullingEnabled ? 1 : 0;
+
+        vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(cullPush), &cullPush);
+        profiler.CmdDispatch(commandBuffer, (uint32_t)(objects.size() + 255) / 256, 1, 1);
+
+        // [Barrier] Cull(쓰기) -> Indirect 명령 읽기 + Vertex Shader(visibleIndices 읽기)
+        VkMemoryBarrier cullOutputBarrier{};
+        cullOutputBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cullOutputBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cullOutputBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+            0, 1, &cullOutputBarrier, 0, nullptr, 0, nullptr);
+
+        profiler.endSection(commandBuffer); // GPU Cull 끝
+
         // ==========================================================================================
         // Phase 1: Rasterization Pass
         // 설명: 래스터화 파이프라인으로 기본 물체를 그립니다. (Compute가 업데이트한 SSBO 위치 사용)
@@ -1055,8 +1391,9 @@ private:
 
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderPass;
-        renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+        // [수정] Offscreen 모드면 스왑체인 대신 storageImage에 바로 그립니다. (파이프라인은 호환되는 Render Pass)
+        renderPassInfo.renderPass = offscreenComposite ? offscreenRenderPass : renderPass;
+        renderPassInfo.framebuffer = offscreenComposite ? offscreenFramebuffer : swapChainFramebuffers[imageIndex];
         renderPassInfo.renderArea.offset = { 0, 0 };
         renderPassInfo.renderArea.extent = swapChainExtent;
 
@@ -1091,8 +1428,11 @@ private:
 
         // [최적화] 진정한 인스턴싱 렌더링
         // renderBatches 벡터에는 "모델A 500개", "모델B 1000개" 식의 정보가 들어있습니다.
+        // [최적화] GPU Culling 결과로 그리기: instanceCount는 GPU가 채운 '보이는' 개수,
+        //          배치가 통째로 안 보이면 countBuffer가 0이라 Draw 자체가 생략됩니다.
 
-        for (const auto& batch : renderBatches) {
+        for (size_t b = 0; b < renderBatches.size(); b++) {
+            const auto& batch = renderBatches[b];
             // 1. 모델(버텍스 버퍼) 바인딩
             VkBuffer vertexBuffers[] = { geometryDataList[batch.geometryIndex].vertexBuffer };
             VkDeviceSize offsets[] = { 0 };
@@ -1109,13 +1449,10 @@ private:
             //    0,                                                // firstIndex
             //    0,                                                // vertexOffset
             //    batch.firstInstance);                             // firstInstance (SSBO Offset)
-            // 기존: vkCmdDrawIndexed(commandBuffer, ...);
-            profiler.CmdDrawIndexed(commandBuffer,
-                geometryDataList[batch.geometryIndex].indexCount, // indexCount
-                batch.instanceCount,                              // instanceCount
-                0,                                                // firstIndex
-                0,                                                // vertexOffset
-                batch.firstInstance);                             // firstInstance
+            profiler.CmdDrawIndexedIndirectCount(commandBuffer,
+                drawCommandBuffer, sizeof(VkDrawIndexedIndirectCommand) * b, // 이 배치의 Draw 명령
+                drawCountBuffer, sizeof(uint32_t) * b,                        // 이 배치의 Draw 개수 (0/1)
+                1, sizeof(VkDrawIndexedIndirectCommand));
         }
 
         vkCmdEndRenderPass(commandBuffer);
@@ -1124,30 +1461,9 @@ private:
         // ==========================================================================================
         // Phase 2: Copy Background (Swapchain -> Storage Image)
         // 설명: 래스터화 결과를 RT용 캔버스로 복사합니다.
+        //       [최적화] Offscreen 모드에서는 래스터가 storageImage에 직접 그리므로 이 복사를 건너뜁니다.
         // ==========================================================================================
 
-        VkImageMemoryBarrier swapChainReadBarrier{};
-        swapChainReadBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        swapChainReadBarrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-        swapChainReadBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        swapChainReadBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        swapChainReadBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        swapChainReadBarrier.image = swapChainImages[imageIndex];
-        swapChainReadBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-        swapChainReadBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-        swapChainReadBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-        VkImageMemoryBarrier storageWriteBarrier{};
-        storageWriteBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        storageWriteBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        storageWriteBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        storageWriteBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        storageWriteBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        storageWriteBarrier.image = storageImage;
-        storageWriteBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-        storageWriteBarrier.srcAccessMask = 0;
-        storageWriteBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
         VkImageMemoryBarrier depthBarrier{};
         depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
@@ -1159,18 +1475,68 @@ private:
         depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
         depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-        VkImageMemoryBarrier preCopyBarriers[] = { swapChainReadBarrier, storageWriteBarrier, depthBarrier };
-
-        vkCmdPipelineBarrier(commandBuffer,
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
-            0, 0, nullptr, 0, nullptr, 3, preCopyBarriers);
-
         VkImageCopy copyRegion{};
         copyRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
         copyRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
         copyRegion.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
-        vkCmdCopyImage(commandBuffer, swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, storageImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+        if (!offscreenComposite) {
+            profiler.beginSection(commandBuffer, "1.5 Copy In");
+
+            VkImageMemoryBarrier swapChainReadBarrier{};
+            swapChainReadBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            swapChainReadBarrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            swapChainReadBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            swapChainReadBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            swapChainReadBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            swapChainReadBarrier.image = swapChainImages[imageIndex];
+            swapChainReadBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+            swapChainReadBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            swapChainReadBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+            VkImageMemoryBarrier storageWriteBarrier{};
+            storageWriteBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            storageWriteBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            storageWriteBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            storageWriteBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            storageWriteBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            storageWriteBarrier.image = storageImage;
+            storageWriteBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+            storageWriteBarrier.srcAccessMask = 0;
+            storageWriteBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+            VkImageMemoryBarrier preCopyBarriers[] = { swapChainReadBarrier, storageWriteBarrier, depthBarrier };
+
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+                0, 0, nullptr, 0, nullptr, 3, preCopyBarriers);
+
+            vkCmdCopyImage(commandBuffer, swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, storageImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+            profiler.endSection(commandBuffer); // Copy In 끝
+        }
+        else {
+            // [최적화] Offscreen 모드: 래스터가 이미 storageImage에 그렸고 (Render Pass finalLayout = GENERAL)
+            // RT가 그 위에 바로 쓰므로 복사가 필요 없습니다. 쓰기 -> 읽기/쓰기 동기화만 합니다.
+            VkImageMemoryBarrier rasterToRTBarrier{};
+            rasterToRTBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            rasterToRTBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            rasterToRTBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            rasterToRTBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            rasterToRTBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            rasterToRTBarrier.image = storageImage;
+            rasterToRTBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+            rasterToRTBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            rasterToRTBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+            VkImageMemoryBarrier preRTBarriers[] = { rasterToRTBarrier, depthBarrier };
+
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+                0, 0, nullptr, 0, nullptr, 2, preRTBarriers);
+        }
 
         // ==========================================================================================
         // Phase 3: Ray Tracing Pass
@@ -1178,21 +1544,24 @@ private:
         // ==========================================================================================
         profiler.beginSection(commandBuffer, "2. RayTrace");
 
-        VkImageMemoryBarrier storageGeneralBarrier{};
-        storageGeneralBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        storageGeneralBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        storageGeneralBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
-        storageGeneralBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        storageGeneralBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        storageGeneralBarrier.image = storageImage;
-        storageGeneralBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-        storageGeneralBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        storageGeneralBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
-            0, 0, nullptr, 0, nullptr, 1, &storageGeneralBarrier);
+        // Copy 모드: Copy In으로 TRANSFER_DST가 된 storageImage를 GENERAL로 전환
+        if (!offscreenComposite) {
+            VkImageMemoryBarrier storageGeneralBarrier{};
+            storageGeneralBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            storageGeneralBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            storageGeneralBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            storageGeneralBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            storageGeneralBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            storageGeneralBarrier.image = storageImage;
+            storageGeneralBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+            storageGeneralBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            storageGeneralBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+                0, 0, nullptr, 0, nullptr, 1, &storageGeneralBarrier);
+        }
 
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rtPipeline);
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rtPipelineLayout, 0, 1, &rtDescriptorSets[currentFrame], 0, nullptr);
@@ -1209,8 +1578,9 @@ private:
 
         // ==========================================================================================
         // Phase 4: Final Copy (Storage Image -> Swapchain)
-        // 설명: RT 결과물을 다시 화면으로 복사합니다.
+        // 설명: RT 결과물을 다시 화면으로 복사합니다. (Offscreen 모드에서는 스왑체인에 쓰는 유일한 작업)
         // ==========================================================================================
+        profiler.beginSection(commandBuffer, "3. Copy Out");
 
         VkImageMemoryBarrier copySrcBarrier{};
         copySrcBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -1225,13 +1595,14 @@ private:
 
         VkImageMemoryBarrier copyDstBarrier{};
         copyDstBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        copyDstBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        // [수정] Offscreen 모드에서는 스왑체인 이전 내용이 필요 없으므로 UNDEFINED에서 전환
+        copyDstBarrier.oldLayout = offscreenComposite ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
         copyDstBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         copyDstBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         copyDstBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         copyDstBarrier.image = swapChainImages[imageIndex];
         copyDstBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-        copyDstBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        copyDstBarrier.srcAccessMask = offscreenComposite ? 0 : VK_ACCESS_TRANSFER_READ_BIT;
         copyDstBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 
         VkImageMemoryBarrier postRTBarriers[] = { copySrcBarrier, copyDstBarrier };
@@ -1243,6 +1614,8 @@ private:
 
         vkCmdCopyImage(commandBuffer, storageImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
 
+        profiler.endSection(commandBuffer); // Copy Out 끝
+
         // ==========================================================================================
         // Phase 5: Present 준비
         // 설명: 화면 출력을 위해 스왑체인 이미지를 Present Layout으로 전환합니다.
@@ -1470,6 +1843,8 @@ private:
         // [중요] 다른 기본 기능들도 필요하면 여기서 켜야 합니다. (예: samplerAnisotropy 등)
         deviceFeatures2.features.samplerAnisotropy = VK_TRUE;
         deviceFeatures2.features.fragmentStoresAndAtomics = VK_TRUE; // 필요시
+        // [추가] Indirect Draw에서 firstInstance(배치 시작 인덱스) 사용
+        deviceFeatures2.features.drawIndirectFirstInstance = VK_TRUE;
 
         // pNext 체인 연결 (기본 기능 -> 확장 기능들)
         deviceFeatures2.pNext = &descriptorIndexingFeatures;
@@ -1597,7 +1972,9 @@ private:
         imageInfo.format = swapChainImageFormat;
         imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        // [수정] Offscreen 합성 모드에서 래스터 Color Attachment로도 사용
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
@@ -1665,15 +2042,10 @@ private:
 
         VkDeviceSize sz = sizeof(Color4) * colors.size();
 
-        createBuffer(sz,
+        // [수정] Device Local (런타임 색 변경은 uploadObjectColor -> Upload Ring)
+        createDeviceLocalBuffer(colors.data(), sz,
             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
             instanceColorBuffer, instanceColorMemory);
-
-        void* data;
-        vkMapMemory(device, instanceColorMemory, 0, sz, 0, &data);
-        memcpy(data, colors.data(), sz);
-        vkUnmapMemory(device, instanceColorMemory);
     }
 
 
@@ -1752,10 +2124,7 @@ private:
     }*/
 
     void createBottomLevelAS() {
-        auto vkGetAccelerationStructureBuildSizesKHR = (PFN_vkGetAccelerationStructureBuildSizesKHR)vkGetDeviceProcAddr(device, "vkGetAccelerationStructureBuildSizesKHR");
-        auto vkCreateAccelerationStructureKHR = (PFN_vkCreateAccelerationStructureKHR)vkGetDeviceProcAddr(device, "vkCreateAccelerationStructureKHR");
-        auto vkCmdBuildAccelerationStructuresKHR = (PFN_vkCmdBuildAccelerationStructuresKHR)vkGetDeviceProcAddr(device, "vkCmdBuildAccelerationStructuresKHR");
-        auto vkGetAccelerationStructureDeviceAddressKHR = (PFN_vkGetAccelerationStructureDeviceAddressKHR)vkGetDeviceProcAddr(device, "vkGetAccelerationStructureDeviceAddressKHR");
+        auto loadStart = std::chrono::high_resolution_clock::now();
 
         // [캐싱] 파일 경로(모델 이름) -> geometryDataList의 인덱스
         std::unordered_map<std::string, int> loadedModels;
@@ -1789,73 +2158,14 @@ private:
                 // 하나의 BLAS를 크기가 다른 여러 물체가 공유할 수 있습니다.
                 GeometryData newData = loadGeometry(path, glm::vec3(1.0f));
 
-                // --- BLAS 빌드 시작 ---
-                VkAccelerationStructureGeometryKHR geometry{};
-                geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-                geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
-                geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
-                geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
-                geometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
-                geometry.geometry.triangles.vertexData.deviceAddress = getBufferDeviceAddress(newData.vertexBuffer);
-                geometry.geometry.triangles.vertexStride = sizeof(Vertex);
-                geometry.geometry.triangles.maxVertex = newData.vertexCount;
-                geometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
-                geometry.geometry.triangles.indexData.deviceAddress = getBufferDeviceAddress(newData.indexBuffer);
-
-                VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
-                buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-                buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-                buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-                buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-                buildInfo.geometryCount = 1;
-                buildInfo.pGeometries = &geometry;
-
-                uint32_t primitiveCount = newData.indexCount / 3;
-                VkAccelerationStructureBuildSizesInfoKHR sizeInfo{};
-                sizeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
-                vkGetAccelerationStructureBuildSizesKHR(device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, &primitiveCount, &sizeInfo);
-
-                createBuffer(sizeInfo.accelerationStructureSize,
-                    VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                    newData.blasBuffer, newData.blasMemory);
-
-                VkAccelerationStructureCreateInfoKHR createInfo{};
-                createInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-                createInfo.buffer = newData.blasBuffer;
-                createInfo.size = sizeInfo.accelerationStructureSize;
-                createInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-
-                if (vkCreateAccelerationStructureKHR(device, &createInfo, nullptr, &newData.blas) != VK_SUCCESS) {
-                    throw std::runtime_error("failed to create BLAS!");
-                }
-
-                // Scratch Buffer (임시)
-                VkBuffer scratchBuffer;
-                VkDeviceMemory scratchMemory;
-                createBuffer(sizeInfo.buildScratchSize,
-                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                    scratchBuffer, scratchMemory);
-
-                buildInfo.dstAccelerationStructure = newData.blas;
-                buildInfo.scratchData.deviceAddress = getBufferDeviceAddress(scratchBuffer);
-
-                VkAccelerationStructureBuildRangeInfoKHR buildRangeInfo{};
-                buildRangeInfo.primitiveCount = primitiveCount;
-                const VkAccelerationStructureBuildRangeInfoKHR* pBuildRangeInfo = &buildRangeInfo;
-
-                VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-                vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &buildInfo, &pBuildRangeInfo);
-                endSingleTimeCommands(commandBuffer);
-
-                vkDestroyBuffer(device, scratchBuffer, nullptr);
-                vkFreeMemory(device, scratchMemory, nullptr);
-                // --- BLAS 빌드 끝 ---
+                // [수정] BLAS는 여기서 바로 빌드하지 않고, 모든 모델을 로드한 뒤
+                // buildBottomLevelASBatched()에서 한 번에 빌드 + 압축(Compaction)합니다.
+                newData.blas = VK_NULL_HANDLE;
+                newData.blasBuffer = VK_NULL_HANDLE;
+                newData.blasMemory = VK_NULL_HANDLE;
 
                 // 리스트에 추가
                 geometryDataList.push_back(newData);
-                bottomLevelAS.push_back(newData.blas);
 
                 geometryIndex = (int)geometryDataList.size() - 1;
                 loadedModels[path] = geometryIndex; // 맵에 등록
@@ -1875,8 +2185,10 @@ private:
                     currentBatch.firstInstance = (uint32_t)i;
                     currentBatch.instanceCount = 1;
                 }
-                else if (currentBatch.geometryIndex != geometryIndex) {
+                else if (currentBatch.geometryIndex != geometryIndex ||
+                         currentBatch.firstInstance + currentBatch.instanceCount != (uint32_t)i) {
                     // 이전 배치를 저장하고 새로 시작
+                    // [수정] 같은 모델이라도 사이에 RT 전용 물체가 끼어 있으면 인덱스가 끊기므로 새 배치
                     renderBatches.push_back(currentBatch);
 
                     currentBatch.geometryIndex = geometryIndex;
@@ -1895,8 +2207,228 @@ private:
             renderBatches.push_back(currentBatch);
         }
 
+        auto loadEnd = std::chrono::high_resolution_clock::now();
+
+        // [최적화] 모든 BLAS를 한 번에 빌드하고 압축
+        buildBottomLevelASBatched();
+
+        auto buildEnd = std::chrono::high_resolution_clock::now();
+
         std::cout << "Total Unique Meshes: " << geometryDataList.size() << std::endl;
         std::cout << "Total Objects: " << objects.size() << std::endl;
+        std::cout << "Scene Load Time: Model "
+            << std::chrono::duration<float, std::milli>(loadEnd - loadStart).count() << " ms, BLAS "
+            << std::chrono::duration<float, std::milli>(buildEnd - loadEnd).count() << " ms" << std::endl;
+    }
+
+    // [추가] BLAS 일괄 빌드 + 압축(Compaction)
+    // 기존: 모델마다 스크래치 버퍼 생성/해제 + beginSingleTimeCommands/endSingleTimeCommands 왕복 (GPU 대기 N번)
+    // 변경: 1) 공유 스크래치 버퍼 하나를 오프셋으로 나눠 쓰고, vkCmdBuildAccelerationStructuresKHR 한 번으로 전부 빌드
+    //       2) 압축 크기 쿼리 -> 압축된 크기로 새 BLAS 생성 -> COMPACT 모드로 복사 -> 원본 삭제
+    void buildBottomLevelASBatched() {
+        auto vkGetAccelerationStructureBuildSizesKHR = (PFN_vkGetAccelerationStructureBuildSizesKHR)vkGetDeviceProcAddr(device, "vkGetAccelerationStructureBuildSizesKHR");
+        auto vkCreateAccelerationStructureKHR = (PFN_vkCreateAccelerationStructureKHR)vkGetDeviceProcAddr(device, "vkCreateAccelerationStructureKHR");
+        auto vkDestroyAccelerationStructureKHR = (PFN_vkDestroyAccelerationStructureKHR)vkGetDeviceProcAddr(device, "vkDestroyAccelerationStructureKHR");
+        auto vkCmdBuildAccelerationStructuresKHR = (PFN_vkCmdBuildAccelerationStructuresKHR)vkGetDeviceProcAddr(device, "vkCmdBuildAccelerationStructuresKHR");
+        auto vkCmdWriteAccelerationStructuresPropertiesKHR = (PFN_vkCmdWriteAccelerationStructuresPropertiesKHR)vkGetDeviceProcAddr(device, "vkCmdWriteAccelerationStructuresPropertiesKHR");
+        auto vkCmdCopyAccelerationStructureKHR = (PFN_vkCmdCopyAccelerationStructureKHR)vkGetDeviceProcAddr(device, "vkCmdCopyAccelerationStructureKHR");
+
+        const uint32_t blasCount = (uint32_t)geometryDataList.size();
+        if (blasCount == 0) {
+            return;
+        }
+
+        // 스크래치 버퍼 서브 할당 시 오프셋 정렬 조건
+        VkPhysicalDeviceAccelerationStructurePropertiesKHR asProperties{};
+        asProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+        VkPhysicalDeviceProperties2 deviceProperties2{};
+        deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        deviceProperties2.pNext = &asProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties2);
+        const VkDeviceSize scratchAlignment = asProperties.minAccelerationStructureScratchOffsetAlignment;
+
+        // =========================================================
+        // 1. BLAS별 빌드 정보 준비 + 크기 조회 + (압축 전) BLAS 생성
+        // =========================================================
+        std::vector<VkAccelerationStructureGeometryKHR> geometries(blasCount);
+        std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos(blasCount);
+        std::vector<VkAccelerationStructureBuildRangeInfoKHR> buildRangeInfos(blasCount);
+        std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> pBuildRangeInfos(blasCount);
+        std::vector<VkDeviceSize> scratchOffsets(blasCount);
+        VkDeviceSize scratchSize = 0;
+        VkDeviceSize originalSize = 0;
+
+        for (uint32_t i = 0; i < blasCount; i++) {
+            GeometryData& data = geometryDataList[i];
+
+            VkAccelerationStructureGeometryKHR& geometry = geometries[i];
+            geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+            geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+            geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+            geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+            geometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+            geometry.geometry.triangles.vertexData.deviceAddress = getBufferDeviceAddress(data.vertexBuffer);
+            geometry.geometry.triangles.vertexStride = sizeof(Vertex);
+            geometry.geometry.triangles.maxVertex = data.vertexCount;
+            geometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
+            geometry.geometry.triangles.indexData.deviceAddress = getBufferDeviceAddress(data.indexBuffer);
+
+            VkAccelerationStructureBuildGeometryInfoKHR& buildInfo = buildInfos[i];
+            buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+            buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+            // [추가] 압축을 하려면 빌드할 때 ALLOW_COMPACTION 플래그가 있어야 합니다.
+            buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+                VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+            buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+            buildInfo.geometryCount = 1;
+            buildInfo.pGeometries = &geometry;
+
+            uint32_t primitiveCount = data.indexCount / 3;
+            VkAccelerationStructureBuildSizesInfoKHR sizeInfo{};
+            sizeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+            vkGetAccelerationStructureBuildSizesKHR(device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, &primitiveCount, &sizeInfo);
+
+            createBuffer(sizeInfo.accelerationStructureSize,
+                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                data.blasBuffer, data.blasMemory);
+
+            VkAccelerationStructureCreateInfoKHR createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+            createInfo.buffer = data.blasBuffer;
+            createInfo.size = sizeInfo.accelerationStructureSize;
+            createInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+
+            if (vkCreateAccelerationStructureKHR(device, &createInfo, nullptr, &data.blas) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create BLAS!");
+            }
+            buildInfo.dstAccelerationStructure = data.blas;
+
+            // 공유 스크래치 버퍼 안에서의 위치 (정렬 맞춤)
+            scratchOffsets[i] = scratchSize;
+            scratchSize += (sizeInfo.buildScratchSize + scratchAlignment - 1) / scratchAlignment * scratchAlignment;
+            originalSize += sizeInfo.accelerationStructureSize;
+
+            buildRangeInfos[i] = {};
+            buildRangeInfos[i].primitiveCount = primitiveCount;
+            pBuildRangeInfos[i] = &buildRangeInfos[i];
+        }
+
+        // =========================================================
+        // 2. 공유 스크래치 버퍼 하나 생성 후 BLAS마다 오프셋으로 나눠 쓰기
+        // =========================================================
+        // 베이스 주소도 정렬되도록 정렬 크기만큼 여유를 둡니다.
+        VkBuffer scratchBuffer;
+        VkDeviceMemory scratchMemory;
+        createBuffer(scratchSize + scratchAlignment,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            scratchBuffer, scratchMemory);
+
+        VkDeviceAddress scratchAddress = getBufferDeviceAddress(scratchBuffer);
+        scratchAddress = (scratchAddress + scratchAlignment - 1) / scratchAlignment * scratchAlignment;
+        for (uint32_t i = 0; i < blasCount; i++) {
+            buildInfos[i].scratchData.deviceAddress = scratchAddress + scratchOffsets[i];
+        }
+
+        // 압축 크기 조회용 쿼리 풀
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+        queryPoolInfo.queryCount = blasCount;
+
+        VkQueryPool compactionQueryPool;
+        if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &compactionQueryPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create BLAS compaction query pool!");
+        }
+
+        std::vector<VkAccelerationStructureKHR> originalBlas(blasCount);
+        for (uint32_t i = 0; i < blasCount; i++) {
+            originalBlas[i] = geometryDataList[i].blas;
+        }
+
+        // =========================================================
+        // 3. 한 번의 제출로 전체 빌드 + 압축 크기 기록
+        // =========================================================
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+        vkCmdResetQueryPool(commandBuffer, compactionQueryPool, 0, blasCount);
+        vkCmdBuildAccelerationStructuresKHR(commandBuffer, blasCount, buildInfos.data(), pBuildRangeInfos.data());
+
+        // 빌드(쓰기)가 끝나야 압축 크기를 읽을 수 있습니다.
+        VkMemoryBarrier buildBarrier{};
+        buildBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        buildBarrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+        buildBarrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+            VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+            0, 1, &buildBarrier, 0, nullptr, 0, nullptr);
+
+        vkCmdWriteAccelerationStructuresPropertiesKHR(commandBuffer, blasCount, originalBlas.data(),
+            VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, compactionQueryPool, 0);
+
+        endSingleTimeCommands(commandBuffer);
+
+        std::vector<VkDeviceSize> compactedSizes(blasCount);
+        vkGetQueryPoolResults(device, compactionQueryPool, 0, blasCount,
+            sizeof(VkDeviceSize) * blasCount, compactedSizes.data(), sizeof(VkDeviceSize),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+        vkDestroyQueryPool(device, compactionQueryPool, nullptr);
+        vkDestroyBuffer(device, scratchBuffer, nullptr);
+        vkFreeMemory(device, scratchMemory, nullptr);
+
+        // =========================================================
+        // 4. 압축된 크기로 새 BLAS 생성 후 COMPACT 복사 (한 번의 제출)
+        // =========================================================
+        std::vector<GeometryData> originalData = geometryDataList;
+        VkDeviceSize compactedSize = 0;
+
+        commandBuffer = beginSingleTimeCommands();
+        for (uint32_t i = 0; i < blasCount; i++) {
+            GeometryData& data = geometryDataList[i];
+
+            createBuffer(compactedSizes[i],
+                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                data.blasBuffer, data.blasMemory);
+
+            VkAccelerationStructureCreateInfoKHR createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+            createInfo.buffer = data.blasBuffer;
+            createInfo.size = compactedSizes[i];
+            createInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+
+            if (vkCreateAccelerationStructureKHR(device, &createInfo, nullptr, &data.blas) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create compacted BLAS!");
+            }
+
+            VkCopyAccelerationStructureInfoKHR copyInfo{};
+            copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+            copyInfo.src = originalData[i].blas;
+            copyInfo.dst = data.blas;
+            copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+            vkCmdCopyAccelerationStructureKHR(commandBuffer, &copyInfo);
+
+            compactedSize += compactedSizes[i];
+        }
+        endSingleTimeCommands(commandBuffer);
+
+        // 압축 전 원본 BLAS 삭제 (endSingleTimeCommands가 큐 대기를 하므로 안전)
+        bottomLevelAS.clear();
+        for (uint32_t i = 0; i < blasCount; i++) {
+            vkDestroyAccelerationStructureKHR(device, originalData[i].blas, nullptr);
+            vkDestroyBuffer(device, originalData[i].blasBuffer, nullptr);
+            vkFreeMemory(device, originalData[i].blasMemory, nullptr);
+
+            bottomLevelAS.push_back(geometryDataList[i].blas);
+        }
+
+        std::cout << "Built " << blasCount << " BLAS (1 batched build, scratch " << scratchSize / 1024 << " KB)" << std::endl;
+        std::cout << "BLAS Memory: " << originalSize / 1024 << " KB -> " << compactedSize / 1024
+            << " KB (Compacted)" << std::endl;
     }
 
     void createObjDescriptionBuffer() {
@@ -1918,15 +2450,10 @@ private:
 
         VkDeviceSize bufferSize = sizeof(ObjDesc) * objDescs.size();
 
-        createBuffer(bufferSize,
+        // [수정] Host Visible -> Device Local
+        createDeviceLocalBuffer(objDescs.data(), bufferSize,
             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
             objDescBuffer, objDescBufferMemory);
-
-        void* data;
-        vkMapMemory(device, objDescBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, objDescs.data(), bufferSize);
-        vkUnmapMemory(device, objDescBufferMemory);
     }
 
     void createTopLevelAS() {
@@ -1971,19 +2498,14 @@ private:
         }
 
         // [중요] Instance Buffer 생성 (STORAGE_BUFFER 비트 포함)
+        // [수정] 매 프레임 Compute가 쓰고 AS 빌드가 읽으므로 Device Local (정적 물체 순간이동은 Upload Ring)
         VkDeviceSize instanceBufferSize = sizeof(VkAccelerationStructureInstanceKHR) * instances.size();
-        createBuffer(instanceBufferSize,
+        createDeviceLocalBuffer(instances.data(), instanceBufferSize,
             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
             VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, // <-- Compute Shader에서 쓰기 위해 필수!
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
             instanceBuffer, instanceMemory);
 
-        void* data;
-        vkMapMemory(device, instanceMemory, 0, instanceBufferSize, 0, &data);
-        memcpy(data, instances.data(), instanceBufferSize);
-        vkUnmapMemory(device, instanceMemory);
-
         VkAccelerationStructureGeometryKHR geometry{};
         geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
         geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
@@ -1995,7 +2517,9 @@ private:
         VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
         buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
         buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-        buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+        // [수정] 매 프레임 Refit(UPDATE)을 하려면 처음부터 ALLOW_UPDATE로 만들어야 합니다.
+        buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+            VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
         buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
         buildInfo.geometryCount = 1;
         buildInfo.pGeometries = &geometry;
@@ -2022,7 +2546,8 @@ private:
 
         // [수정] 스크래치 버퍼 생성 (멤버 변수에 저장)
         // 기존에 있던 지역 변수 scratchBuffer 생성 코드는 삭제하고 아래 코드로 대체합니다.
-        createBuffer(sizeInfo.buildScratchSize,
+        // [수정] BUILD와 UPDATE가 같은 스크래치 버퍼를 쓰므로 둘 중 큰 쪽으로 생성
+        createBuffer(std::max(sizeInfo.buildScratchSize, sizeInfo.updateScratchSize),
             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             tlasScratchBuffer, tlasScratchBufferMemory);
@@ -2048,6 +2573,23 @@ private:
         // 이 버퍼는 매 프레임 recordCommandBuffer에서 재사용해야 하므로 cleanup()에서 지워야 합니다.
 
         std::cout << "Created Top Level AS with " << instances.size() << " instances" << std::endl;
+
+        // [추가] Refit 품질 휴리스틱용 버퍼
+        // (1) 기준 위치: 첫 프레임이 전체 빌드이므로 Compute가 채웁니다. 초기화 불필요.
+        createBuffer(sizeof(glm::vec4) * objects.size(),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            tlasRefPositionBuffer, tlasRefPositionBufferMemory);
+
+        // (2) 프레임 슬롯별 최대 이동 거리 (CPU가 읽으므로 HOST_VISIBLE, 계속 매핑해 둠)
+        VkDeviceSize statsSize = sizeof(uint32_t) * MAX_FRAMES_IN_FLIGHT;
+        createBuffer(statsSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            tlasStatsBuffer, tlasStatsBufferMemory);
+
+        vkMapMemory(device, tlasStatsBufferMemory, 0, statsSize, 0, (void**)&tlasStatsMapped);
+        memset(tlasStatsMapped, 0, statsSize);
     }
 
     void createRTDescriptorSetLayout() {
@@ -2454,6 +2996,33 @@ private:
         vkBindBufferMemory(device, buffer, bufferMemory, 0);
     }
 
+    // [추가] Staging Buffer를 거쳐 Device Local 버퍼를 만들고 초기 데이터를 한 번 올립니다. (로드 시점 전용, 복사 완료까지 대기)
+    void createDeviceLocalBuffer(const void* srcData, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+        createBuffer(size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            stagingBuffer, stagingBufferMemory);
+
+        void* data;
+        vkMapMemory(device, stagingBufferMemory, 0, size, 0, &data);
+        memcpy(data, srcData, (size_t)size);
+        vkUnmapMemory(device, stagingBufferMemory);
+
+        // 런타임 부분 업데이트(Upload Ring)도 받을 수 있도록 TRANSFER_DST는 항상 포함
+        createBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        VkBufferCopy copyRegion{};
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer, buffer, 1, &copyRegion);
+        endSingleTimeCommands(commandBuffer);
+
+        vkDestroyBuffer(device, stagingBuffer, nullptr);
+        vkFreeMemory(device, stagingBufferMemory, nullptr);
+    }
+
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
         VkPhysicalDeviceMemoryProperties memProperties;
         vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -2667,10 +3236,12 @@ private:
 
 
         createStorageImage();
+        createOffscreenFramebuffer(); // [추가] storageImage가 새로 만들어졌으므로 재생성
         createRTDescriptorSets();
     }
 
     void cleanupSwapChain() {
+        vkDestroyFramebuffer(device, offscreenFramebuffer, nullptr); // [추가]
         vkDestroyImageView(device, storageImageView, nullptr);
         vkDestroyImage(device, storageImage, nullptr);
         vkFreeMemory(device, storageImageMemory, nullptr);
@@ -2707,6 +3278,7 @@ private:
         vkDestroyPipeline(device, graphicsPipeline, nullptr);
         vkDestroyPipelineLayout(device, graphicsPipelineLayout, nullptr);
         vkDestroyRenderPass(device, renderPass, nullptr);
+        vkDestroyRenderPass(device, offscreenRenderPass, nullptr); // [추가]
 
         // Ray Tracing
         vkDestroyPipeline(device, rtPipeline, nullptr);
@@ -2716,6 +3288,10 @@ private:
         vkDestroyPipeline(device, computePipeline, nullptr);
         vkDestroyPipelineLayout(device, computePipelineLayout, nullptr);
 
+        // [추가] GPU Culling Pipeline
+        vkDestroyPipeline(device, cullPipeline, nullptr);
+        vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+
         // =========================================================
         // 4. 디스크립터 관련 해제
         // =========================================================
@@ -2732,6 +3308,10 @@ private:
         vkDestroyDescriptorPool(device, computeDescriptorPool, nullptr);
         vkDestroyDescriptorSetLayout(device, computeDescriptorSetLayout, nullptr);
 
+        // [추가] GPU Culling Descriptor
+        vkDestroyDescriptorPool(device, cullDescriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(device, cullDescriptorSetLayout, nullptr);
+
         // =========================================================
         // 5. 버퍼 및 메모리 해제
         // =========================================================
@@ -2754,6 +3334,23 @@ private:
         vkDestroyBuffer(device, objectSSBO, nullptr);
         vkFreeMemory(device, objectSSBOMemory, nullptr);
 
+        // [추가] Upload Ring
+        vkUnmapMemory(device, uploadRingBufferMemory);
+        vkDestroyBuffer(device, uploadRingBuffer, nullptr);
+        vkFreeMemory(device, uploadRingBufferMemory, nullptr);
+
+        // [추가] GPU Culling 버퍼
+        vkDestroyBuffer(device, cullObjectBuffer, nullptr);
+        vkFreeMemory(device, cullObjectBufferMemory, nullptr);
+        vkDestroyBuffer(device, drawCommandTemplateBuffer, nullptr);
+        vkFreeMemory(device, drawCommandTemplateBufferMemory, nullptr);
+        vkDestroyBuffer(device, drawCommandBuffer, nullptr);
+        vkFreeMemory(device, drawCommandBufferMemory, nullptr);
+        vkDestroyBuffer(device, drawCountBuffer, nullptr);
+        vkFreeMemory(device, drawCountBufferMemory, nullptr);
+        vkDestroyBuffer(device, visibleIndexBuffer, nullptr);
+        vkFreeMemory(device, visibleIndexBufferMemory, nullptr);
+
         // UBOs
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             vkDestroyBuffer(device, rasterUniformBuffers[i], nullptr);
@@ -2809,6 +3406,13 @@ private:
         vkDestroyBuffer(device, tlasScratchBuffer, nullptr);
         vkFreeMemory(device, tlasScratchBufferMemory, nullptr);
 
+        // [추가] TLAS Refit 휴리스틱 버퍼 해제
+        vkDestroyBuffer(device, tlasRefPositionBuffer, nullptr);
+        vkFreeMemory(device, tlasRefPositionBufferMemory, nullptr);
+        vkUnmapMemory(device, tlasStatsBufferMemory);
+        vkDestroyBuffer(device, tlasStatsBuffer, nullptr);
+        vkFreeMemory(device, tlasStatsBufferMemory, nullptr);
+
         // =========================================================
         // 7. 디바이스 및 인스턴스 해제
         // =========================================================
@@ -2997,6 +3601,90 @@ private:
         }
     }
 
+    // [추가] Offscreen 합성용 Render Pass
+    // 기존 renderPass와 포맷/샘플 수가 같으므로 호환(Compatible)되어 graphicsPipeline을 그대로 사용합니다.
+    // 차이점: Color가 스왑체인이 아니라 storageImage이고, 끝나면 RT가 바로 쓸 수 있게 GENERAL로 전환됩니다.
+    void createOffscreenRenderPass() {
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = swapChainImageFormat;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // CLEAR하므로 이전 내용 불필요
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_GENERAL;     // RT Storage Image로 바로 사용
+
+        VkAttachmentDescription depthAttachment{};
+        depthAttachment.format = findDepthFormat();
+        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference colorAttachmentRef{};
+        colorAttachmentRef.attachment = 0;
+        colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference depthAttachmentRef{};
+        depthAttachmentRef.attachment = 1;
+        depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+        subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+        // 이전 프레임의 RT 쓰기 / 최종 복사 읽기가 끝난 뒤에 storageImage를 덮어써야 합니다. (WAR)
+        VkSubpassDependency dependency{};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstSubpass = 0;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+            VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependency.srcAccessMask = 0;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &dependency;
+
+        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &offscreenRenderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen render pass!");
+        }
+    }
+
+    // [추가] Offscreen 합성용 Framebuffer (storageImage + Depth, 스왑체인 크기 변경 시 재생성)
+    void createOffscreenFramebuffer() {
+        std::array<VkImageView, 2> attachments = {
+            storageImageView,
+            depthImageView
+        };
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = offscreenRenderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = swapChainExtent.width;
+        framebufferInfo.height = swapChainExtent.height;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &offscreenFramebuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen framebuffer!");
+        }
+    }
+
     // [추가] 4. 그래픽스 파이프라인(Graphics Pipeline) 생성
     void createGraphicsPipeline() {
         auto vertShaderCode = readFile("shaders/raster.vert.spv"); // 파일 필요!
@@ -3156,7 +3844,7 @@ private:
 
     // [추가] 래스터화용 디스크립터 셋 레이아웃 생성 (UBO: View/Proj)
     void createRasterDescriptorSetLayout() {
-        std::vector<VkDescriptorSetLayoutBinding> bindings(2); // 1개 -> 2개로 변경
+        std::vector<VkDescriptorSetLayoutBinding> bindings(3); // 1개 -> 2개 -> 3개로 변경
 
         // Binding 0: Raster UBO (View, Proj)
         bindings[0].binding = 0;
@@ -3170,6 +3858,12 @@ private:
         bindings[1].descriptorCount = 1;
         bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // 버텍스 쉐이더에서 읽음
 
+        // [추가] Binding 2: 보이는 오브젝트 인덱스 목록 (GPU Culling 결과)
+        bindings[2].binding = 2;
+        bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[2].descriptorCount = 1;
+        bindings[2].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -3202,9 +3896,9 @@ private:
         poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
         poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
-        // 2. Storage Buffer (추가)
+        // 2. Storage Buffer (추가) - [수정] SSBO + 보이는 인덱스 목록 = 셋당 2개
         poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * 2;
 
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -3244,7 +3938,13 @@ private:
             ssboInfo.offset = 0;
             ssboInfo.range = VK_WHOLE_SIZE;
 
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+            // 3. 보이는 오브젝트 인덱스 목록 (Binding 2) - [추가]
+            VkDescriptorBufferInfo visibleInfo{};
+            visibleInfo.buffer = visibleIndexBuffer;
+            visibleInfo.offset = 0;
+            visibleInfo.range = VK_WHOLE_SIZE;
+
+            std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
 
             // Binding 0 쓰기
             descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -3262,6 +3962,14 @@ private:
             descriptorWrites[1].descriptorCount = 1;
             descriptorWrites[1].pBufferInfo = &ssboInfo;
 
+            // Binding 2 쓰기 (GPU Culling 결과 연결)
+            descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[2].dstSet = rasterDescriptorSets[i];
+            descriptorWrites[2].dstBinding = 2;
+            descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[2].descriptorCount = 1;
+            descriptorWrites[2].pBufferInfo = &visibleInfo;
+
             vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
         }
     }
@@ -3275,6 +3983,9 @@ private:
         ubo.proj[1][1] *= -1; // Vulkan Y 좌표계 반전
 
         memcpy(rasterUniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+
+        // [추가] GPU Culling 절두체 계산용
+        rasterViewProj = ubo.proj * ubo.view;
     }
 
     // [추가] 초기화 함수 (initVulkan에서 호출 필요)
@@ -3302,15 +4013,7 @@ private:
     void createObjectSSBO() {
         VkDeviceSize bufferSize = sizeof(ObjState) * objects.size();
 
-        // 1. Staging Buffer 생성 (CPU에서 데이터를 만들어서 잠깐 담을 곳)
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            stagingBuffer, stagingBufferMemory);
-
-        // 2. 초기 데이터 생성 (램덤 속도 부여 등)
+        // 1. 초기 데이터 생성 (램덤 속도 부여 등)
         std::vector<ObjState> initialStates(objects.size());
         for (size_t i = 0; i < objects.size(); i++) {
             initialStates[i].model = glm::mat4(1.0f);
@@ -3341,38 +4044,22 @@ private:
             initialStates[i].scale = glm::vec4(objects[i].scale, 0.0f);
         }
 
-        // 3. 데이터 복사 (Map -> Memcpy -> Unmap)
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, initialStates.data(), (size_t)bufferSize);
-        vkUnmapMemory(device, stagingBufferMemory);
-
-        // 4. 실제 SSBO 생성 (GPU 전용 메모리)
+        // 2. 실제 SSBO 생성 (GPU 전용 메모리, Staging 경유 업로드)
         // 용도: Compute가 쓰고(STORAGE), Vertex가 읽고(STORAGE or VERTEX), 전송받음(TRANSFER_DST)
-        createBuffer(bufferSize,
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        // 이후 CPU 쪽 변경(생성/순간이동/색 변경)은 uploadObjectState 등 -> Upload Ring으로 부분 업데이트
+        createDeviceLocalBuffer(initialStates.data(), bufferSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
             objectSSBO, objectSSBOMemory);
 
-        // 5. Staging -> SSBO 복사 명령 실행
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-        VkBufferCopy copyRegion{};
-        copyRegion.size = bufferSize;
-        vkCmdCopyBuffer(commandBuffer, stagingBuffer, objectSSBO, 1, &copyRegion);
-        endSingleTimeCommands(commandBuffer);
-
-        // 6. Staging Buffer 제거
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
-
         std::cout << "Created Object SSBO for " << objects.size() << " objects." << std::endl;
     }
 
     void createComputePipeline() {
         // =================================================================
-        // 1. Descriptor Set Layout (Binding 0: SSBO, Binding 1: Instance Buffer)
+        // 1. Descriptor Set Layout (Binding 0: SSBO, Binding 1: Instance Buffer,
+        //                          Binding 2: TLAS 기준 위치, Binding 3: TLAS 이동 통계)
         // =================================================================
-        std::vector<VkDescriptorSetLayoutBinding> bindings(2); // [수정] 1 -> 2개
+        std::vector<VkDescriptorSetLayoutBinding> bindings(4); // [수정] 1 -> 2 -> 4개
 
         // Binding 0: Object SSBO (기존)
         bindings[0].binding = 0;
@@ -3386,6 +4073,14 @@ private:
         bindings[1].descriptorCount = 1;
         bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT; // Compute에서만 씀
 
+        // [추가] Binding 2, 3: TLAS Refit 품질 휴리스틱 (Compute에서만 씀)
+        for (uint32_t b = 2; b < 4; b++) {
+            bindings[b].binding = b;
+            bindings[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[b].descriptorCount = 1;
+            bindings[b].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size()); // [수정] size() 사용
@@ -3396,12 +4091,12 @@ private:
         }
 
         // =================================================================
-        // 2. Pipeline Layout (Push Constant: dt, time, count)
+        // 2. Pipeline Layout (Push Constant: dt, time, count, first, resetReference, statsSlot)
         // =================================================================
         VkPushConstantRange pushConstant{};
         pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
         pushConstant.offset = 0;
-        pushConstant.size = sizeof(float) * 2 + sizeof(int); // 12 bytes
+        pushConstant.size = sizeof(float) * 2 + sizeof(int) * 4; // [수정] 12 -> 24 bytes
 
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -3442,7 +4137,7 @@ private:
         // =================================================================
         VkDescriptorPoolSize poolSize{};
         poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        poolSize.descriptorCount = 2; // [수정] SSBO 1개 + Instance Buffer 1개 = 2개
+        poolSize.descriptorCount = 4; // [수정] SSBO + Instance Buffer + TLAS 기준 위치 + TLAS 통계 = 4개
 
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -3465,9 +4160,9 @@ private:
         }
 
         // -----------------------------------------------------------
-        // Descriptor Update (Binding 0: SSBO, Binding 1: Instance Buffer)
+        // Descriptor Update (Binding 0: SSBO, Binding 1: Instance Buffer, Binding 2~3: TLAS 휴리스틱)
         // -----------------------------------------------------------
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+        std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
 
         // (1) Binding 0: Object SSBO 연결
         VkDescriptorBufferInfo ssboInfo{};
@@ -3496,16 +4191,436 @@ private:
         descriptorWrites[1].descriptorCount = 1;
         descriptorWrites[1].pBufferInfo = &instanceInfo;
 
+        // (3) Binding 2, 3: TLAS 기준 위치 / 이동 통계 연결 [추가]
+        VkDescriptorBufferInfo refPositionInfo{ tlasRefPositionBuffer, 0, VK_WHOLE_SIZE };
+        VkDescriptorBufferInfo statsInfo{ tlasStatsBuffer, 0, VK_WHOLE_SIZE };
+        const VkDescriptorBufferInfo* tlasInfos[] = { &refPositionInfo, &statsInfo };
+
+        for (uint32_t b = 2; b < 4; b++) {
+            descriptorWrites[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[b].dstSet = computeDescriptorSet;
+            descriptorWrites[b].dstBinding = b;
+            descriptorWrites[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[b].descriptorCount = 1;
+            descriptorWrites[b].pBufferInfo = tlasInfos[b - 2];
+        }
+
         // 업데이트 실행 (배열로 한 번에)
         vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     }
 
+    // [추가] GPU Culling용 버퍼 생성
+    void createCullingResources() {
+        // 1. 오브젝트별 컬링 정보 (Raster 대상이 아니면 batchIndex = 0xFFFFFFFF)
+        struct CullObject { uint32_t batchIndex; float localRadius; uint32_t firstInstance; uint32_t padding; };
+        std::vector<CullObject> cullObjects(objects.size(), { 0xFFFFFFFFu, 0.0f, 0, 0 });
+
+        std::vector<VkDrawIndexedIndirectCommand> drawCommands(renderBatches.size());
+        for (size_t b = 0; b < renderBatches.size(); b++) {
+            const RenderBatch& batch = renderBatches[b];
+            const GeometryData& geometry = geometryDataList[batch.geometryIndex];
+
+            for (uint32_t i = batch.firstInstance; i < batch.firstInstance + batch.instanceCount; i++) {
+                cullObjects[i] = { (uint32_t)b, geometry.boundsRadius, batch.firstInstance, 0 };
+            }
+
+            // 2. Draw 명령 템플릿 (instanceCount는 매 프레임 Compute가 채움)
+            drawCommands[b].indexCount = geometry.indexCount;
+            drawCommands[b].instanceCount = 0;
+            drawCommands[b].firstIndex = 0;
+            drawCommands[b].vertexOffset = 0;
+            drawCommands[b].firstInstance = batch.firstInstance;
+        }
+
+        // [수정] 한 번 올리고 매 프레임 GPU만 읽으므로 Device Local
+        VkDeviceSize cullObjectSize = sizeof(CullObject) * cullObjects.size();
+        createDeviceLocalBuffer(cullObjects.data(), cullObjectSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            cullObjectBuffer, cullObjectBufferMemory);
+
+        drawCommands.resize(std::max<size_t>(drawCommands.size(), 1));
+        VkDeviceSize drawCommandSize = sizeof(VkDrawIndexedIndirectCommand) * drawCommands.size();
+        createDeviceLocalBuffer(drawCommands.data(), drawCommandSize,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            drawCommandTemplateBuffer, drawCommandTemplateBufferMemory);
+
+        // 3. GPU가 매 프레임 채우는 버퍼들 (Device Local)
+        createBuffer(drawCommandSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            drawCommandBuffer, drawCommandBufferMemory);
+
+        createBuffer(sizeof(uint32_t) * std::max<size_t>(renderBatches.size(), 1),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            drawCountBuffer, drawCountBufferMemory);
+
+        // 배치마다 자기 영역 [firstInstance, firstInstance + instanceCount)을 쓰므로 오브젝트 수만큼이면 충분
+        createBuffer(sizeof(uint32_t) * objects.size(),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            visibleIndexBuffer, visibleIndexBufferMemory);
+    }
+
+    // [추가] GPU Culling Compute 파이프라인 (Binding 0: SSBO, 1: 컬링 정보, 2: Draw 명령, 3: Draw 개수, 4: 보이는 인덱스)
+    void createCullPipeline() {
+        std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+        for (uint32_t b = 0; b < bindings.size(); b++) {
+            bindings[b].binding = b;
+            bindings[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[b].descriptorCount = 1;
+            bindings[b].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+
+        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullDescriptorSetLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create cull descriptor set layout!");
+        }
+
+        // Push Constant: 절두체 평면 6개 + count + enabled = 104 bytes
+        VkPushConstantRange pushConstant{};
+        pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstant.offset = 0;
+        pushConstant.size = sizeof(glm::vec4) * 6 + sizeof(int) * 2;
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &cullDescriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstant;
+
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create cull pipeline layout!");
+        }
+
+        auto cullShaderCode = readFile("shaders/cull.comp.spv");
+        VkShaderModule cullShaderModule = createShaderModule(cullShaderCode);
+
+        VkPipelineShaderStageCreateInfo shaderStageInfo{};
+        shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shaderStageInfo.module = cullShaderModule;
+        shaderStageInfo.pName = "main";
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = shaderStageInfo;
+        pipelineInfo.layout = cullPipelineLayout;
+
+        if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &cullPipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create cull pipeline!");
+        }
+
+        vkDestroyShaderModule(device, cullShaderModule, nullptr);
+
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSize.descriptorCount = static_cast<uint32_t>(bindings.size());
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        poolInfo.maxSets = 1;
+
+        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &cullDescriptorPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create cull descriptor pool!");
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = cullDescriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &cullDescriptorSetLayout;
+
+        if (vkAllocateDescriptorSets(device, &allocInfo, &cullDescriptorSet) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate cull descriptor set!");
+        }
+
+        VkBuffer buffers[] = { objectSSBO, cullObjectBuffer, drawCommandBuffer, drawCountBuffer, visibleIndexBuffer };
+        std::array<VkDescriptorBufferInfo, 5> bufferInfos{};
+        std::array<VkWriteDescriptorSet, 5> descriptorWrites{};
+
+        for (uint32_t b = 0; b < descriptorWrites.size(); b++) {
+            bufferInfos[b] = { buffers[b], 0, VK_WHOLE_SIZE };
+
+            descriptorWrites[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[b].dstSet = cullDescriptorSet;
+            descriptorWrites[b].dstBinding = b;
+            descriptorWrites[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[b].descriptorCount = 1;
+            descriptorWrites[b].pBufferInfo = &bufferInfos[b];
+        }
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    // ==========================================================================================
+    // [추가] Upload Ring: CPU -> Device Local 버퍼 부분 업데이트
+    // 사용법: 프레임 사이 아무 때나 uploadObjectState / uploadObjectPosition / uploadObjectColor 호출
+    //         -> 다음 recordCommandBuffer 시작 부분에서 한 번에 vkCmdCopyBuffer로 반영됩니다.
+    // ==========================================================================================
+
+    void createUploadRing() {
+        VkDeviceSize ringSize = uploadRingFrameSize * MAX_FRAMES_IN_FLIGHT;
+        createBuffer(ringSize,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            uploadRingBuffer, uploadRingBufferMemory);
+
+        // 계속 매핑해 둠 (슬롯 재사용은 drawFrame의 펜스 대기로 보호됨)
+        vkMapMemory(device, uploadRingBufferMemory, 0, ringSize, 0, (void**)&uploadRingMapped);
+    }
+
+    // dstBuffer의 [dstOffset, dstOffset + size) 영역을 다음 프레임에 data로 덮어쓰도록 예약합니다.
+    void queueBufferUpload(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+        if (size == 0) return;
+        if (size > uploadRingFrameSize) {
+            throw std::runtime_error("upload is larger than a staging ring slot!");
+        }
+
+        // 같은 영역을 이미 예약했다면 이전 것은 무효화 (순서를 지키기 위해 지우지 않고 크기만 0으로)
+        auto key = std::make_pair(dstBuffer, dstOffset);
+        auto it = pendingUploadLookup.find(key);
+        if (it != pendingUploadLookup.end() && pendingUploads[it->second].size == size) {
+            pendingUploads[it->second].size = 0;
+        }
+
+        PendingUpload upload{};
+        upload.dstBuffer = dstBuffer;
+        upload.dstOffset = dstOffset;
+        upload.size = size;
+        upload.dataOffset = pendingUploadData.size();
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        pendingUploadData.insert(pendingUploadData.end(), bytes, bytes + size);
+        pendingUploadLookup[key] = pendingUploads.size();
+        pendingUploads.push_back(upload);
+    }
+
+    // [추가] 오브젝트 생성(Spawn): ObjState 전체 + TLAS 인스턴스 변환 + RT 색상
+    // (Compute는 움직이는 물체 구간만 돌리므로, 정적 구간에 velocity.w = 1로 넣어도 움직이지 않습니다)
+    void uploadObjectState(uint32_t index, const ObjState& state) {
+        objects[index].position = glm::vec3(state.position);
+        objects[index].scale = glm::vec3(state.scale);
+        objects[index].color = glm::vec3(state.color);
+
+        queueBufferUpload(objectSSBO, sizeof(ObjState) * index, &state, sizeof(ObjState));
+
+        glm::mat4 transposed = glm::transpose(state.model);
+        queueBufferUpload(instanceBuffer, sizeof(VkAccelerationStructureInstanceKHR) * index, &transposed, sizeof(VkTransformMatrixKHR));
+
+        glm::vec4 color = glm::vec4(glm::vec3(state.color), 1.0f);
+        queueBufferUpload(instanceColorBuffer, sizeof(glm::vec4) * index, &color, sizeof(glm::vec4));
+
+        tlasForceRebuild = true; // 새 인스턴스는 Refit으로 감당하기엔 이동이 큼
+    }
+
+    // [추가] 순간이동(Teleport): model + position만 부분 업데이트 (velocity/color/scale은 그대로)
+    void uploadObjectPosition(uint32_t index, const glm::vec3& position) {
+        ObjectInstance& obj = objects[index];
+        obj.position = position;
+
+        // SSBO 쪽은 createObjectSSBO / simulation.comp와 같이 이동 + 스케일만
+        glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), position), obj.scale);
+        glm::vec4 position4 = glm::vec4(position, 1.0f);
+        queueBufferUpload(objectSSBO, sizeof(ObjState) * index + offsetof(ObjState, model), &model, sizeof(glm::mat4));
+        queueBufferUpload(objectSSBO, sizeof(ObjState) * index + offsetof(ObjState, position), &position4, sizeof(glm::vec4));
+
+        // TLAS 인스턴스 쪽은 createTopLevelAS와 같은 순서로 회전까지 포함 (움직이는 물체는 다음 Compute가 덮어씀)
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+        transform = glm::rotate(transform, glm::radians(obj.rotation.x), glm::vec3(1, 0, 0));
+        transform = glm::rotate(transform, glm::radians(obj.rotation.y), glm::vec3(0, 1, 0));
+        transform = glm::rotate(transform, glm::radians(obj.rotation.z), glm::vec3(0, 0, 1));
+        transform = glm::scale(transform, obj.scale);
+        glm::mat4 transposed = glm::transpose(transform);
+        queueBufferUpload(instanceBuffer, sizeof(VkAccelerationStructureInstanceKHR) * index, &transposed, sizeof(VkTransformMatrixKHR));
+
+        tlasForceRebuild = true; // 순간이동은 Refit하면 BV가 크게 늘어나므로 전체 빌드
+    }
+
+    // [추가] 색 변경(Recolor): Raster용 SSBO color + RT용 instanceColorBuffer
+    void uploadObjectColor(uint32_t index, const glm::vec3& color) {
+        objects[index].color = color;
+
+        glm::vec4 color4 = glm::vec4(color, 1.0f);
+        queueBufferUpload(objectSSBO, sizeof(ObjState) * index + offsetof(ObjState, color), &color4, sizeof(glm::vec4));
+        queueBufferUpload(instanceColorBuffer, sizeof(glm::vec4) * index, &color4, sizeof(glm::vec4));
+    }
+
+    // 예약된 업로드를 이번 프레임 링 슬롯에 담고 대상 버퍼별로 vkCmdCopyBuffer를 기록합니다.
+    // 슬롯에 다 안 들어가는 나머지는 다음 프레임으로 넘어갑니다. (멈추지 않음)
+    void flushPendingUploads(VkCommandBuffer commandBuffer) {
+        if (pendingUploads.empty()) return;
+
+        // 1. 이번 프레임 슬롯으로 데이터 복사 (이 슬롯은 drawFrame에서 펜스를 기다렸으므로 GPU가 안 씀)
+        VkDeviceSize slotBase = uploadRingFrameSize * currentFrame;
+        VkDeviceSize head = 0;
+        std::vector<const PendingUpload*> accepted;
+        size_t consumed = 0;
+
+        for (; consumed < pendingUploads.size(); consumed++) {
+            PendingUpload& upload = pendingUploads[consumed];
+            if (upload.size == 0) continue; // 같은 영역에 더 나중 값이 있음
+
+            VkDeviceSize offset = (head + 15) & ~VkDeviceSize(15);
+            if (offset + upload.size > uploadRingFrameSize) break;
+
+            memcpy(uploadRingMapped + slotBase + offset, pendingUploadData.data() + upload.dataOffset, (size_t)upload.size);
+            upload.ringOffset = slotBase + offset;
+            head = offset + upload.size;
+            accepted.push_back(&upload);
+
+            uploadRegionCount++;
+            uploadByteCount += upload.size;
+        }
+
+        if (!accepted.empty()) {
+            profiler.beginSection(commandBuffer, "0.0 Upload");
+
+            // 2. 이전 프레임의 읽기/쓰기(Compute, Vertex, RT, AS 빌드)가 끝난 뒤에 덮어쓰기
+            VkMemoryBarrier beforeBarrier{};
+            beforeBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            beforeBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            beforeBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0, 1, &beforeBarrier, 0, nullptr, 0, nullptr);
+
+            // 3. 대상 버퍼별로 영역을 모아 vkCmdCopyBuffer 한 번씩
+            auto byDestination = [](const PendingUpload* a, const PendingUpload* b) {
+                if (a->dstBuffer != b->dstBuffer) return std::less<VkBuffer>()(a->dstBuffer, b->dstBuffer);
+                return a->dstOffset < b->dstOffset;
+            };
+            auto overlaps = [](const PendingUpload* a, const PendingUpload* b) {
+                return a->dstBuffer == b->dstBuffer &&
+                    a->dstOffset < b->dstOffset + b->size && b->dstOffset < a->dstOffset + a->size;
+            };
+            auto recordCopies = [&](std::vector<const PendingUpload*>& group) {
+                std::stable_sort(group.begin(), group.end(), byDestination);
+                std::vector<VkBufferCopy> regions;
+                for (size_t i = 0; i < group.size(); i++) {
+                    regions.push_back({ group[i]->ringOffset, group[i]->dstOffset, group[i]->size });
+                    if (i + 1 == group.size() || group[i + 1]->dstBuffer != group[i]->dstBuffer) {
+                        vkCmdCopyBuffer(commandBuffer, uploadRingBuffer, group[i]->dstBuffer, (uint32_t)regions.size(), regions.data());
+                        regions.clear();
+                    }
+                }
+                group.clear();
+            };
+
+            // 한 번의 vkCmdCopyBuffer 안에서는 대상 영역이 겹치면 안 됨 -> 정렬 후 이웃끼리만 비교
+            std::vector<const PendingUpload*> group = accepted;
+            std::stable_sort(group.begin(), group.end(), byDestination);
+            bool anyOverlap = false;
+            for (size_t i = 1; i < group.size() && !anyOverlap; i++) {
+                anyOverlap = overlaps(group[i - 1], group[i]);
+            }
+
+            if (!anyOverlap) {
+                recordCopies(group);
+            }
+            else {
+                // 드문 경우: 예약 순서대로 나눠서 기록하고, 겹치는 지점마다 Transfer -> Transfer 배리어
+                group.clear();
+                VkMemoryBarrier orderBarrier{};
+                orderBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                orderBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                orderBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+                for (const PendingUpload* upload : accepted) {
+                    bool conflict = std::any_of(group.begin(), group.end(),
+                        [&](const PendingUpload* other) { return overlaps(upload, other); });
+                    if (conflict) {
+                        recordCopies(group);
+                        vkCmdPipelineBarrier(commandBuffer,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            0, 1, &orderBarrier, 0, nullptr, 0, nullptr);
+                    }
+                    group.push_back(upload);
+                }
+                recordCopies(group);
+            }
+
+            // 4. Transfer(쓰기) -> 이번 프레임의 Compute / Vertex / RT / AS 빌드(읽기)
+            VkMemoryBarrier afterBarrier{};
+            afterBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            afterBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            afterBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+                VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+                0, 1, &afterBarrier, 0, nullptr, 0, nullptr);
+
+            profiler.endSection(commandBuffer);
+        }
+
+        // 5. 처리한 만큼 비우고, 남은 것은 데이터를 앞으로 당겨서 다음 프레임으로
+        if (consumed == pendingUploads.size()) {
+            pendingUploads.clear();
+            pendingUploadData.clear();
+            pendingUploadLookup.clear();
+            return;
+        }
+
+        std::vector<PendingUpload> remaining;
+        std::vector<uint8_t> remainingData;
+        pendingUploadLookup.clear();
+        for (size_t i = consumed; i < pendingUploads.size(); i++) {
+            PendingUpload upload = pendingUploads[i];
+            if (upload.size == 0) continue;
+
+            const uint8_t* bytes = pendingUploadData.data() + upload.dataOffset;
+            upload.dataOffset = remainingData.size();
+            remainingData.insert(remainingData.end(), bytes, bytes + upload.size);
+            pendingUploadLookup[std::make_pair(upload.dstBuffer, upload.dstOffset)] = remaining.size();
+            remaining.push_back(upload);
+        }
+        pendingUploads.swap(remaining);
+        pendingUploadData.swap(remainingData);
+    }
+
+    // [추가] Upload Ring 사용 예시 (C / T 키): 움직이는 물체 중 최대 256개의 색을 바꾸거나 중앙 근처로 순간이동
+    void shuffleDynamicObjects(bool teleport) {
+        if (dynamicObjectCount == 0) return;
+
+        uint32_t count = std::min<uint32_t>(dynamicObjectCount, 256);
+        for (uint32_t n = 0; n < count; n++) {
+            // rand()는 RAND_MAX가 작을 수 있으므로 두 번 섞어서 20만 개 구간도 고르게 선택
+            uint32_t r = ((uint32_t)rand() << 15) ^ (uint32_t)rand();
+            uint32_t index = dynamicObjectFirst + r % dynamicObjectCount;
+
+            if (teleport) {
+                glm::vec3 position(((rand() % 100) / 25.0f) - 2.0f, 5.0f + ((rand() % 100) / 25.0f), ((rand() % 100) / 25.0f) - 2.0f);
+                uploadObjectPosition(index, position);
+            }
+            else {
+                glm::vec3 color((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f);
+                uploadObjectColor(index, color);
+            }
+        }
+
+        std::cout << (teleport ? "Teleported " : "Recolored ") << count << " dynamic objects (Upload Ring)" << std::endl;
+    }
+
 
 };
 
-int main() {
+int main(int argc, char** argv) {
     RayTracedScene app;
     try {
+        app.parseArgs(argc, argv);
         app.run();
     }
     catch (const std::exception& e) {
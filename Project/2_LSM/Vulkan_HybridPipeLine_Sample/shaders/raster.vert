@@ -17,6 +17,12 @@ layout(std140, binding = 1) readonly buffer ObjectBuffer {
     ObjectData objects[];
 } objData;
 
+// [߰] GPU Culling ä ̴ Ʈ ε 
+// gl_InstanceIndex = ġ  ε(firstInstance) + ̴ νϽ ȣ
+layout(std430, binding = 2) readonly buffer VisibleIndexBuffer {
+    uint visibleIndices[];
+};
+
 layout(binding = 0) uniform RasterUBO {
     mat4 view;
     mat4 proj;
@@ -30,10 +36,12 @@ layout(location = 1) out vec3 fragNormal;
 
 void main() {
     // gl_InstanceIndex vkCmdDrawIndexed last param(firstInstance) ޹ 
-    mat4 modelMatrix = objData.objects[gl_InstanceIndex].model;
+    // [] ø    ļ  Ʈ ε ϴ.
+    uint objectIndex = visibleIndices[gl_InstanceIndex];
+    mat4 modelMatrix = objData.objects[objectIndex].model;
     
     gl_Position = ubo.proj * ubo.view * modelMatrix * vec4(inPosition, 1.0);
     
-    fragColor = objData.objects[gl_InstanceIndex].color.rgb;
+    fragColor = objData.objects[objectIndex].color.rgb;
     fragNormal = mat3(modelMatrix) * inNormal;
 }
\ No newline at end of file